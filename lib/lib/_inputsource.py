@@ -5,6 +5,7 @@ from __future__ import with_statement
 
 import os
 import urllib, urllib2
+import itertools
 from cStringIO import StringIO
 from uuid import uuid4
 
@@ -23,6 +24,15 @@ XMLSTRING = 1
 XMLURI = 2
 XMLFILE = 3
 
+#Dummy base URIs for strings and streams.  A UUID per source costs more than
+#parsing a small document, so the URIs share a random (version 4) UUID prefix
+#for the process and differ in the last 12 hex digits
+_dummy_uri_prefix = uuid4().urn[:-12]
+_dummy_uri_counter = itertools.count()
+
+def _dummy_uri():
+    return '%s%012x' % (_dummy_uri_prefix, next(_dummy_uri_counter) & 0xffffffffffff)
+
 class _inputsource(InputSource):
     """
     The representation of a resource. Supports further, relative resolution of
@@ -32,7 +42,8 @@ class _inputsource(InputSource):
         _supported_schemes is a list of URI schemes supported 
         for dereferencing (representation retrieval).
     """
-    def __new__(cls, arg, uri=None, encoding=None, resolver=None, sourcetype=0):
+    def __new__(cls, arg, uri=None, encoding=None, resolver=None, sourcetype=0,
+                zerocopy=False):
         """
         arg - a string, Unicode object (only if you really know what you're doing),
               file-like object (stream), file path or URI.  You can also pass an
@@ -40,6 +51,10 @@ class _inputsource(InputSource):
               object, possibly with the URI modified
         uri - optional override URI.  The base URI for the IS will be set to this
               value
+        zerocopy - if true, the parser maps local files into memory (or uses
+              the buffer of a string) and parses it in place rather than
+              reading the stream in blocks.  The file must not be truncated
+              while it is being parsed
 
         Returns an input source which can be passed to Amara APIs.
         """
@@ -64,13 +79,13 @@ class _inputsource(InputSource):
             stream = resolver.resolve(arg)
         elif hasattr(arg, 'read'):
             #Create dummy Uri to use as base
-            uri = uri or uuid4().urn
+            uri = uri or _dummy_uri()
             stream = arg
         #XXX: Should we at this point refuse to proceed unless it's a basestring?
         elif sourcetype == XMLSTRING or isxml(arg):
             #See this article about XML detection heuristics
             #http://www.xml.com/pub/a/2007/02/28/what-does-xml-smell-like.html
-            uri = uri or uuid4().urn
+            uri = uri or _dummy_uri()
             stream = StringIO(arg)
         elif is_absolute(arg) and not os.path.isfile(arg):
             uri = arg
@@ -91,9 +106,10 @@ class _inputsource(InputSource):
 
         #import inspect; print inspect.stack()
         #InputSource.__new__ is in C: expat/input_source.c:inputsource_new
-        return InputSource.__new__(cls, stream, uri, encoding)
+        return InputSource.__new__(cls, stream, uri, encoding, zerocopy)
 
-    def __init__(self, arg, uri=None, encoding=None, resolver=None, sourcetype=0):
+    def __init__(self, arg, uri=None, encoding=None, resolver=None, sourcetype=0,
+                 zerocopy=False):
         #uri is set 
         from amara.lib.irihelpers import DEFAULT_RESOLVER
         self.resolver = resolver or DEFAULT_RESOLVER
@@ -10,7 +10,10 @@ from amara.tree import parse
 # for any kind of production.  It is an experimental prototype
 # ------------------------------------------------------------
 
-def pushtree(obj, pattern, target, uri=None, entity_factory=None, standalone=False, validate=False, namespaces=None):
+# With prune, each matched element is released once target returns, as is
+# everything outside of the matches, so that memory use is bounded by the
+# largest match rather than the document (see amara.tree.parse)
+def pushtree(obj, pattern, target, uri=None, entity_factory=None, standalone=False, validate=False, namespaces=None, prune=False):
     # Adapter for what Dave uses. FIXME?!
     class Handler(object):
         def startElementMatch(self, node):
@@ -28,6 +31,6 @@ def pushtree(obj, pattern, target, uri=None, entity_factory=None, standalone=Fal
     rhand = mgr.build_pushtree_handler()
 
     # Run the parser on the rule handler
-    return parse(obj,uri,entity_factory,standalone,validate,rule_handler=rhand)
+    return parse(obj,uri,entity_factory,standalone,validate,rule_handler=rhand,prune=prune)
 
 
@@ -696,11 +696,13 @@ class RuleMachineHandler(object):
         handlers = self.machine_states[next_state][0]
         for handler in handlers:
             handler.startElementMatch(node)
+        # Tell the builder whether the element matched
+        matched = bool(handlers)
 
         # Also handle any attributes
         attr_ops = self.machine_states[next_state][2]
         if not attr_ops:
-            return
+            return matched
 
         for namespace, localname in attrs.keys():
             for (ns, ln, attr_state_id) in attr_ops:
@@ -714,6 +716,7 @@ class RuleMachineHandler(object):
                         # This is a hack until I can figure out how to get
                         # the attribute node
                         handler.attributeMatch( (node, (namespace, localname) ) )
+        return matched
 
     def endElementNS(self, node, name, qname):
         #print "endElementNS", node, name, qname
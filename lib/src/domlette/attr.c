@@ -81,7 +81,11 @@ int Attr_SetValue(AttrObject *self, PyObject *value)
   Attr_SET_VALUE(self, value);
 
   owner = Node_GET_PARENT(self);
-  if (owner == NULL || Element_CheckExact(owner))
+  if (owner == NULL)
+    return 0;
+  if (Attr_GET_TYPE(self) == ATTRIBUTE_TYPE_ID)
+    Entity_InvalidateIds(owner);
+  if (Element_CheckExact(owner))
     return 0;
 
   return Node_DispatchEvent(owner, modified_event, (NodeObject *)self);
@@ -14,6 +14,8 @@ static PyTypeObject NodeIter_Type;
 #define AttributeMap_Check(op) PyObject_TypeCheck(op, &AttributeMap_Type)
 #define AttributeMap_CheckExact(op) ((op)->ob_type == &AttributeMap_Type)
 
+#define AttributeMap_IS_SMALL(op) ((op)->nm_table == (op)->nm_smalltable)
+
 #define INIT_MINSIZE(op) do {                                       \
   (op)->nm_used = 0;                                                \
   (op)->nm_mask = AttributeMap_MINSIZE - 1;                         \
@@ -33,6 +35,10 @@ remove_attribute_node(AttrObject *target)
       return -1;
   }
   Node_SET_PARENT(target, NULL);
+  if (Attr_GET_TYPE(target) == ATTRIBUTE_TYPE_ID)
+    Entity_InvalidateIds(parent);
+  Node_InvalidateOrder(parent);
+  Node_InvalidateOrder((NodeObject *)target);
   Py_DECREF(parent);
   return 0;
 }
@@ -83,7 +89,12 @@ key_eq(AttrObject *node, Py_ssize_t hash, register PyObject *name,
            NAMESPACE_EQ(node_namespace, namespace)));
 }
 
-Py_LOCAL_INLINE(size_t)
+/* Returns the slot holding the node for the key, or else the slot a node
+ * with that key is to be stored in.  Small maps keep their nodes packed at
+ * the start of `nm_smalltable` and are searched linearly; NULL is returned
+ * if such a map is full and the key is not found.
+ */
+Py_LOCAL_INLINE(AttrObject **)
 get_entry(AttributeMapObject *nm, Py_ssize_t hash, PyObject *name,
           PyObject *namespace)
 {
@@ -93,12 +104,20 @@ get_entry(AttributeMapObject *nm, Py_ssize_t hash, PyObject *name,
   register size_t entry = i;
   AttrObject **table = nm->nm_table;
 
+  if (AttributeMap_IS_SMALL(nm)) {
+    AttrObject **end = table + nm->nm_used;
+    for (; table < end; table++) {
+      if (key_eq(*table, hash, name, namespace))
+        return table;
+    }
+    return (nm->nm_used < AttributeMap_MINSIZE) ? table : NULL;
+  }
   while (table[entry] && !key_eq(table[entry], hash, name, namespace)) {
     i = (i << 2) + i + perturb + 1;
     perturb >>= 5;
     entry = i & mask;
   }
-  return entry;
+  return table + entry;
 }
 
 Py_LOCAL_INLINE(void)
@@ -136,8 +155,7 @@ next_entry(AttributeMapObject *nm, Py_ssize_t *ppos)
 
 /*
 Restructure the table by allocating a new table and reinserting all
-items again.  When entries have been deleted, the new table may
-actually be smaller than the old one.
+items again.  A full small map is turned into a hash table this way.
 */
 Py_LOCAL(int)
 resize_table(AttributeMapObject *self)
@@ -148,17 +166,10 @@ resize_table(AttributeMapObject *self)
   /* Get space for a new table. */
   oldtable = self->nm_table;
   size = (self->nm_mask + 1) << 1;
-  if (size <= AttributeMap_MINSIZE) {
-    size = AttributeMap_MINSIZE;
-    newtable = self->nm_smalltable;
-    if (oldtable == newtable)
-      return 0;
-  } else {
-    newtable = PyMem_New(AttrObject *, size);
-    if (newtable == NULL) {
-      PyErr_NoMemory();
-      return -1;
-    }
+  newtable = PyMem_New(AttrObject *, size);
+  if (newtable == NULL) {
+    PyErr_NoMemory();
+    return -1;
   }
 
   /* Make the dict empty, using the new table. */
@@ -261,7 +272,7 @@ AttrObject *
 AttributeMap_GetNode(PyObject *self, PyObject *namespace, PyObject *name)
 {
   AttributeMapObject *nm = (AttributeMapObject *)self;
-  size_t entry;
+  AttrObject **entry;
   long hash;
 
   if (!AttributeMap_Check(nm)) {
@@ -291,14 +302,14 @@ AttributeMap_GetNode(PyObject *self, PyObject *namespace, PyObject *name)
   entry = get_entry(nm, hash, name, namespace);
   Py_DECREF(namespace);
   Py_DECREF(name);
-  return nm->nm_table[entry];
+  return entry ? *entry : NULL;
 }
 
 int
 AttributeMap_SetNode(PyObject *self, AttrObject *node)
 {
   AttributeMapObject *nm = (AttributeMapObject *)self;
-  size_t entry;
+  AttrObject **entry;
   AttrObject *old_node;
   PyObject *namespace, *name;
   long hash;
@@ -313,7 +324,13 @@ AttributeMap_SetNode(PyObject *self, AttrObject *node)
   name = Attr_GET_LOCAL_NAME(node);
   namespace = Attr_GET_NAMESPACE_URI(node);
   entry = get_entry(nm, hash, name, namespace);
-  old_node = nm->nm_table[entry];
+  if (entry == NULL) {
+    /* the small map is full, switch to a hash table */
+    if (resize_table(nm) < 0)
+      return -1;
+    entry = get_entry(nm, hash, name, namespace);
+  }
+  old_node = *entry;
   if (old_node == NULL) {
     /* adding the attribute to the table */
     nm->nm_used++;
@@ -323,22 +340,28 @@ AttributeMap_SetNode(PyObject *self, AttrObject *node)
       return -1;
   }
   /* store the attribute in the table */
-  nm->nm_table[entry] = node;
+  *entry = node;
   Py_INCREF(node);
   /* update the attribute's owner */
   temp = Node_GET_PARENT(node);
   Node_SET_PARENT(node, (NodeObject *)nm->nm_owner);
   Py_INCREF(nm->nm_owner);
-  Py_XDECREF(temp);
+  if (Attr_GET_TYPE(node) == ATTRIBUTE_TYPE_ID)
+    Entity_InvalidateIds((NodeObject *)nm->nm_owner);
+  if (temp != NULL) {
+    /* moved from another element */
+    Node_InvalidateOrder(temp);
+    Node_InvalidateOrder((NodeObject *)node);
+    Py_DECREF(temp);
+  }
   /* success */
   if (!Element_CheckExact(nm->nm_owner)) {
     if (Node_DispatchEvent((NodeObject *)nm->nm_owner, added_event,
                            (NodeObject *)node) < 0)
       return -1;
   }
-  /* If fill >= 2/3 size, adjust size.  Normally, this doubles the size,
-   * but it's also possible for the dict to shrink. */
-  if (nm->nm_used*3 >= (nm->nm_mask+1)*2) {
+  /* If fill >= 2/3 size, adjust size. */
+  if (!AttributeMap_IS_SMALL(nm) && nm->nm_used*3 >= (nm->nm_mask+1)*2) {
     if (resize_table(nm) < 0)
       return -1;
   }
@@ -349,7 +372,7 @@ int
 AttributeMap_DelNode(PyObject *self, PyObject *namespace, PyObject *name)
 {
   AttributeMapObject *nm = (AttributeMapObject *)self;
-  size_t entry;
+  AttrObject **entry;
   AttrObject *old_node; 
   long hash;
 
@@ -378,7 +401,7 @@ AttributeMap_DelNode(PyObject *self, PyObject *namespace, PyObject *name)
     return -1;
   }
   entry = get_entry(nm, hash, name, namespace);
-  old_node = nm->nm_table[entry];
+  old_node = entry ? *entry : NULL;
   if (old_node == NULL) {
     PyErr_Format(PyExc_AttributeError,
 		 "attributemap instance has no such entry");
@@ -388,8 +411,15 @@ AttributeMap_DelNode(PyObject *self, PyObject *namespace, PyObject *name)
   }
   
   /* Zero out entry, and decrement the count of entries */
-  nm->nm_table[entry] = NULL;
   nm->nm_used--;
+  if (AttributeMap_IS_SMALL(nm)) {
+    /* keep the remaining nodes packed */
+    AttrObject **end = nm->nm_table + nm->nm_used;
+    memmove(entry, entry + 1, (end - entry) * sizeof(AttrObject *));
+    *end = NULL;
+  } else {
+    *entry = NULL;
+  }
   if (remove_attribute_node(old_node) < 0) {
     Py_DECREF(old_node);
     Py_DECREF(namespace);
@@ -743,13 +773,14 @@ static PyMappingMethods attributemap_as_mapping = {
 static int attributemap_contains(AttributeMapObject *self, PyObject *key)
 {
   PyObject *namespace, *name;
-  Py_ssize_t hash, entry;
+  Py_ssize_t hash, pos;
+  AttrObject **entry;
   int status;
 
   if (Attr_Check(key)) {
     AttrObject *node;
-    entry = 0;
-    while ((node = next_entry(self, &entry))) {
+    pos = 0;
+    while ((node = next_entry(self, &pos))) {
       switch (PyObject_RichCompareBool(key, (PyObject *)node, Py_EQ)) {
       case 1:
         return 1;
@@ -777,7 +808,7 @@ static int attributemap_contains(AttributeMapObject *self, PyObject *key)
   entry = get_entry(self, hash, name, namespace);
   Py_DECREF(namespace);
   Py_DECREF(name);
-  return self->nm_table[entry] != NULL;
+  return entry != NULL && *entry != NULL;
 }
 
 static PySequenceMethods attributemap_as_sequence = {
@@ -14,6 +14,8 @@ typedef struct _context {
   /* Add warning about how these work */
   NodeObject **children;
   Py_ssize_t children_allocated;
+
+  int matched;                  /* the rule matcher matched the element */
 } Context;
 
 typedef struct {
@@ -32,6 +34,15 @@ typedef struct {
 
   EntityObject *owner_document;
   RuleMatchObject *rule_matcher; 
+
+  /* With `prune`, nodes are released once complete, unless part of a
+   * matched element (`match_depth` is the number of those open). */
+  int prune;
+  Py_ssize_t match_depth;
+
+  /* document order keys are assigned as the nodes are created */
+  Py_ssize_t order_stamp;
+  Py_ssize_t order_next;
 } ParserState;
 
 typedef enum {
@@ -233,6 +244,23 @@ static void ParserState_Del(ParserState *self)
   PyMem_Free(self);
 }
 
+/* Releases what the last parse left in the state, so that it can be used
+ * for another (the free contexts, and their children arrays, are kept). */
+static void ParserState_Reset(ParserState *self)
+{
+  /* only an aborted parse leaves contexts open */
+  if (self->context) {
+    Context_Del(self->context);
+    self->context = NULL;
+  }
+  PyDict_Clear(self->new_namespaces);
+  Py_CLEAR(self->element_factory);
+  Py_CLEAR(self->text_factory);
+  Py_CLEAR(self->processing_instruction_factory);
+  Py_CLEAR(self->comment_factory);
+  Py_CLEAR(self->owner_document);
+}
+
 Py_LOCAL_INLINE(Context *)
 ParserState_AddContext(ParserState *self, NodeObject *node)
 {
@@ -254,6 +282,7 @@ ParserState_AddContext(ParserState *self, NodeObject *node)
   /* make it the active context */
   context->next = self->context;
   self->context = context;
+  context->matched = 0;
   return context;
 }
 
@@ -274,6 +303,24 @@ ParserState_FreeContext(ParserState *self)
   }
 }
 
+#define ParserState_SetOrder(state, node) \
+  Node_SET_DOCORDER((node), (state)->order_stamp, (state)->order_next++)
+
+/* True if a completed node is to be released rather than kept */
+#define ParserState_PRUNING(state) \
+  ((state)->prune && (state)->match_depth == 0)
+
+/* Releases a completed node that has just been added (unless the rule
+ * handler has moved it meanwhile). */
+static int ParserState_ReleaseNode(ParserState *self, NodeObject *node)
+{
+  NodeObject *parent = self->context->node;
+
+  if (Node_GET_PARENT(node) != parent)
+    return 0;
+  return _Container_FastRemove(parent, node);
+}
+
 static int ParserState_AddNode(ParserState *self, NodeObject *node)
 {
   Context *context = self->context;
@@ -350,6 +397,21 @@ builder_StartDocument(void *userState)
   if (document == NULL)
     return EXPAT_STATUS_ERROR;
 
+  state->order_stamp = Node_NewOrderStamp();
+  state->order_next = 0;
+  ParserState_SetOrder(state, document);
+
+  /* the ID index is filled in as ID attributes are reported (but would keep
+   * every element having an ID when pruning) */
+  Py_CLEAR(document->ids);
+  state->match_depth = 0;
+  if (Container_GET_COUNT(document) == 0 && !state->prune) {
+    document->ids = PyDict_New();
+    if (document->ids == NULL) {
+      Py_DECREF(document);
+      return EXPAT_STATUS_ERROR;
+    }
+  }
 
   /* Callout to matcher */
   if (state->rule_matcher) {
@@ -425,8 +487,10 @@ builder_StartElement(void *userState, ExpatName *name,
   ParserState *state = (ParserState *)userState;
   PyObject *attribute_factory=NULL;
   ElementObject *elem=NULL;
+  Context *context;
   Py_ssize_t i;
   PyObject *key, *value;
+  int matched = 0;
 
 #ifdef DEBUG_PARSER
   fprintf(stderr, "--- builder_StartElement(name=");
@@ -462,6 +526,7 @@ builder_StartElement(void *userState, ExpatName *name,
     if (elem == NULL)
       return EXPAT_STATUS_ERROR;
   }
+  ParserState_SetOrder(state, elem);
 
   /** namespaces *******************************************************/
 
@@ -469,9 +534,10 @@ builder_StartElement(void *userState, ExpatName *name,
    * is the uri.
    */
   if (((PyDictObject *)state->new_namespaces)->ma_used) {
+    NamespaceObject *nsnode;
     i = 0;
     while (PyDict_Next(state->new_namespaces, &i, &key, &value)) {
-      NamespaceObject *nsnode = Element_AddNamespace(elem, key, value);
+      nsnode = Element_AddNamespace(elem, key, value);
       if (nsnode == NULL) {
         Py_DECREF(elem);
         Py_XDECREF(attribute_factory);
@@ -479,6 +545,10 @@ builder_StartElement(void *userState, ExpatName *name,
       }
       Py_DECREF(nsnode);
     }
+    /* numbered in the order Node_NumberTree() would use */
+    i = 0;
+    while ((nsnode = NamespaceMap_Next(Element_NAMESPACES(elem), &i)))
+      ParserState_SetOrder(state, nsnode);
     /* make sure children don't set these namespaces */
     PyDict_Clear(state->new_namespaces);
   }
@@ -495,22 +565,36 @@ builder_StartElement(void *userState, ExpatName *name,
     }
     /* save the attribute type as well (for getElementById) */
     Attr_SET_TYPE(attr, atts[i].type);
+    ParserState_SetOrder(state, attr);
     Py_DECREF(attr);
+    if (atts[i].type == ATTRIBUTE_TYPE_ID) {
+      if (Entity_AddId(state->owner_document, atts[i].value,
+                       (NodeObject *)elem) < 0) {
+        Py_DECREF(elem);
+        return EXPAT_STATUS_ERROR;
+      }
+    }
   }
 
   /* Check for rule matching */
   if (state->rule_matcher) {
-    if (RuleMatch_StartElement(state->rule_matcher,(PyObject *) elem,name,atts,natts) < 0) {
+    matched = RuleMatch_StartElement(state->rule_matcher,(PyObject *) elem,name,atts,natts);
+    if (matched < 0) {
       Py_DECREF(elem);
       return EXPAT_STATUS_ERROR;
     }
   }
 
   /* save states on the context */
-  if (ParserState_AddContext(state, (NodeObject *) elem) == NULL) {
+  context = ParserState_AddContext(state, (NodeObject *) elem);
+  if (context == NULL) {
     Py_DECREF(elem);
     return EXPAT_STATUS_ERROR;
   }
+  if (matched) {
+    context->matched = 1;
+    state->match_depth++;
+  }
   return EXPAT_STATUS_OK;
 }
 
@@ -520,6 +604,7 @@ builder_EndElement(void *userState, ExpatName *name)
   ParserState *state = (ParserState *)userState;
   Context *context = state->context;
   NodeObject *node;
+  int matched = context->matched;
 
 #ifdef DEBUG_PARSER
   fprintf(stderr, "--- builder_EndElement(name=");
@@ -558,6 +643,12 @@ builder_EndElement(void *userState, ExpatName *name)
       return EXPAT_STATUS_ERROR;
     }
   }
+  if (matched)
+    state->match_depth--;
+  if (ParserState_PRUNING(state)) {
+    if (ParserState_ReleaseNode(state, node) < 0)
+      return EXPAT_STATUS_ERROR;
+  }
   return EXPAT_STATUS_OK;
 }
 
@@ -584,6 +675,14 @@ builder_Attribute(void *userState, ExpatName *name, PyObject *value,
 
   /* save the attribute type as well (for getElementById) */
   attr->type = type;
+  ParserState_SetOrder(state, attr);
+  if (type == ATTRIBUTE_TYPE_ID) {
+    if (Entity_AddId(state->owner_document, value,
+                     state->context->node) < 0) {
+      Py_DECREF(attr);
+      return EXPAT_STATUS_ERROR;
+    }
+  }
 
   Py_DECREF(attr);
   return EXPAT_STATUS_OK;
@@ -601,6 +700,9 @@ builder_Characters(void *userState, PyObject *data)
   fprintf(stderr, ")\n");
 #endif
 
+  if (ParserState_PRUNING(state))
+    return EXPAT_STATUS_OK;
+
   if (state->text_factory) {
     node = (NodeObject *)PyObject_CallFunctionObjArgs(state->text_factory,
                                                       data, NULL);
@@ -619,6 +721,8 @@ builder_Characters(void *userState, PyObject *data)
       return EXPAT_STATUS_ERROR;
   }
 
+  ParserState_SetOrder(state, node);
+
   /* ParserState_AddNode steals the reference to the new node */
   if (ParserState_AddNode(state, node) < 0) {
     Py_DECREF(node);
@@ -661,6 +765,8 @@ builder_ProcessingInstruction(void *userState, PyObject *target, PyObject *data)
       return EXPAT_STATUS_ERROR;
   }
 
+  ParserState_SetOrder(state, node);
+
   /* ParserState_AddNode steals the reference to the new node */
   if (ParserState_AddNode(state, node) < 0) {
     Py_DECREF(node);
@@ -673,6 +779,10 @@ builder_ProcessingInstruction(void *userState, PyObject *target, PyObject *data)
       return EXPAT_STATUS_ERROR;
     }
   }
+  if (ParserState_PRUNING(state)) {
+    if (ParserState_ReleaseNode(state, node) < 0)
+      return EXPAT_STATUS_ERROR;
+  }
   return EXPAT_STATUS_OK;
 }
 
@@ -688,6 +798,9 @@ builder_Comment(void *userState, PyObject *data)
   fprintf(stderr, ")\n");
 #endif
 
+  if (ParserState_PRUNING(state))
+    return EXPAT_STATUS_OK;
+
   if (state->comment_factory) {
     node = (NodeObject *)PyObject_CallFunctionObjArgs(state->comment_factory,
                                                       data, NULL);
@@ -706,6 +819,8 @@ builder_Comment(void *userState, PyObject *data)
       return EXPAT_STATUS_ERROR;
   }
 
+  ParserState_SetOrder(state, node);
+
   /* ParserState_AddNode steals the reference to the new node */
   if (ParserState_AddNode(state, node) < 0) {
     Py_DECREF(node);
@@ -799,22 +914,88 @@ create_reader(ParserState *state)
 
   if (handler == NULL)
     return NULL;
+  /* the reader keeps a copy of the handler */
   reader = ExpatReader_New(handler);
-  if (reader == NULL) {
-    ExpatHandler_Del(handler);
-    return NULL;
-  }
+  ExpatHandler_Del(handler);
   return reader;
 }
 
+/* Disables GC (if enabled) while building the DOM tree, returning whether
+ * it was enabled or -1 on error */
+Py_LOCAL_INLINE(int)
+builder_gc_disable(void)
+{
+  PyObject *result;
+  int gc_enabled;
+
+  result = PyObject_Call(gc_isenabled_function, empty_args_tuple, NULL);
+  if (result == NULL)
+    return -1;
+  gc_enabled = PyObject_IsTrue(result);
+  Py_DECREF(result);
+  if (gc_enabled) {
+    result = PyObject_Call(gc_disable_function, empty_args_tuple, NULL);
+    if (result == NULL)
+      return -1;
+    Py_DECREF(result);
+  }
+  return gc_enabled;
+}
+
+Py_LOCAL_INLINE(int)
+builder_gc_restore(int gc_enabled)
+{
+  if (gc_enabled) {
+    PyObject *result = PyObject_Call(gc_enable_function, empty_args_tuple,
+                                     NULL);
+    if (result == NULL)
+      return -1;
+    Py_DECREF(result);
+  }
+  return 0;
+}
+
+/* Parses `inputSource` with the reader of `state`, returning the new
+ * document or NULL. */
+static PyObject *builder_run(ParserState *state, PyObject *inputSource,
+                             ParseFlags flags, int asEntity,
+                             PyObject *namespaces)
+{
+  int gc_enabled = 0;
+  ExpatStatus status;
+
+  /* the released nodes are reference cycles (with their children and
+   * attributes) and so are left for the collector when pruning */
+  if (!state->prune) {
+    gc_enabled = builder_gc_disable();
+    if (gc_enabled < 0)
+      return NULL;
+  }
+
+  Expat_SetValidation(state->reader, flags == PARSE_FLAGS_VALIDATE);
+  Expat_SetParamEntityParsing(state->reader, flags != PARSE_FLAGS_STANDALONE);
+
+  if (asEntity)
+    status = ExpatReader_ParseEntity(state->reader, inputSource, namespaces);
+  else
+    status = ExpatReader_Parse(state->reader, inputSource);
+
+  if (builder_gc_restore(gc_enabled) < 0)
+    return NULL;
+
+  /* the document context, now finished, hands over its reference */
+  if (status != EXPAT_STATUS_OK)
+    return NULL;
+  return (PyObject *)state->owner_document;
+}
+
 static PyObject *builder_parse(PyObject *inputSource, ParseFlags flags,
                                PyObject *entity_factory, int asEntity,
-                               PyObject *namespaces, PyObject *rule_handler)
+                               PyObject *namespaces, PyObject *rule_handler,
+                               int prune)
 {
   ParserState *state;
   PyObject *result;
-  int gc_enabled;
-  ExpatStatus status;
 
 #ifdef DEBUG_PARSER
   FILE *stream = PySys_GetFile("stderr", stderr);
@@ -838,43 +1019,11 @@ static PyObject *builder_parse(PyObject *inputSource, ParseFlags flags,
 
   if (rule_handler) {
     state->rule_matcher = RuleMatchObject_New(rule_handler);
+    state->prune = prune;
   }
 
-  /* Disable GC (if enabled) while building the DOM tree */
-  result = PyObject_Call(gc_isenabled_function, empty_args_tuple, NULL);
-  if (result == NULL)
-    goto finally;
-  gc_enabled = PyObject_IsTrue(result);
-  Py_DECREF(result);
-  if (gc_enabled) {
-    result = PyObject_Call(gc_disable_function, empty_args_tuple, NULL);
-    if (result == NULL)
-      goto finally;
-    Py_DECREF(result);
-  }
-
-  Expat_SetValidation(state->reader, flags == PARSE_FLAGS_VALIDATE);
-  Expat_SetParamEntityParsing(state->reader, flags != PARSE_FLAGS_STANDALONE);
+  result = builder_run(state, inputSource, flags, asEntity, namespaces);
 
-  if (asEntity)
-    status = ExpatReader_ParseEntity(state->reader, inputSource, namespaces);
-  else
-    status = ExpatReader_Parse(state->reader, inputSource);
-
-  if (gc_enabled) {
-    result = PyObject_Call(gc_enable_function, empty_args_tuple, NULL);
-    if (result == NULL)
-      goto finally;
-    Py_DECREF(result);
-  }
-
-  /* save off the created document */
-  if (status == EXPAT_STATUS_OK)
-    result = (PyObject *)state->owner_document;
-  else
-    result = NULL;
-
-finally:
   ExpatReader_Del(state->reader);
   ParserState_Del(state);
 #ifdef DEBUG_PARSER
@@ -887,13 +1036,16 @@ finally:
 
 PyObject *Domlette_Parse(PyObject *self, PyObject *args, PyObject *kw)
 {
-  static char *kwlist[] = {"source", "flags", "entity_factory", "rule_handler", NULL};
+  static char *kwlist[] = {"source", "flags", "entity_factory", "rule_handler",
+                           "prune", NULL};
   PyObject *source, *entity_factory=NULL;
   PyObject *rule_handler=NULL;   /* DB: May be temporary */
   int flags=default_parse_flags;
+  int prune=0;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|iOO:parse", kwlist,
-                                   &source, &flags, &entity_factory,&rule_handler))
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|iOOi:parse", kwlist,
+                                   &source, &flags, &entity_factory,&rule_handler,
+                                   &prune))
     return NULL;
 
   if (entity_factory == Py_None)
@@ -902,7 +1054,8 @@ PyObject *Domlette_Parse(PyObject *self, PyObject *args, PyObject *kw)
   if (rule_handler == Py_None)
     rule_handler = NULL;
 
-  return builder_parse(source, flags, entity_factory, 0, NULL, rule_handler);
+  return builder_parse(source, flags, entity_factory, 0, NULL, rule_handler,
+                       prune);
 }
 
 PyObject *Domlette_ParseFragment(PyObject *self, PyObject *args, PyObject *kw)
@@ -922,9 +1075,255 @@ PyObject *Domlette_ParseFragment(PyObject *self, PyObject *args, PyObject *kw)
     rule_handler = NULL;
 
   return builder_parse(source, PARSE_FLAGS_STANDALONE, entity_factory, 1,
-                       namespaces,rule_handler);
+                       namespaces,rule_handler, 0);
+}
+
+/** Parser Object *****************************************************/
+
+typedef struct {
+  PyObject_HEAD
+  ParserState *state;
+  int flags;
+  int busy;                     /* within a method */
+  int feeding;                  /* a fed document is incomplete */
+} ParserObject;
+
+Py_LOCAL_INLINE(int)
+parser_enter(ParserObject *self, int feeding)
+{
+  /* the reader is released while Expat tokenizes the input */
+  if (self->busy || (self->feeding && !feeding)) {
+    PyErr_SetString(PyExc_RuntimeError, "parser is already parsing");
+    return -1;
+  }
+  if (feeding && !self->feeding) {
+    PyErr_SetString(PyExc_RuntimeError, "no document has been started");
+    return -1;
+  }
+  self->busy = 1;
+  return 0;
+}
+
+static char parser_parse_doc[] = "\
+parse(source) -> entity\n\
+\n\
+Parses the input source `source` as the `parse` function does.";
+
+static PyObject *parser_parse(ParserObject *self, PyObject *args)
+{
+  PyObject *source, *result;
+
+  if (!PyArg_ParseTuple(args, "O:parse", &source))
+    return NULL;
+
+  if (parser_enter(self, 0) < 0)
+    return NULL;
+  result = builder_run(self->state, source, self->flags, 0, NULL);
+  ParserState_Reset(self->state);
+  self->busy = 0;
+  return result;
+}
+
+static char parser_start_doc[] = "\
+start(source)\n\
+\n\
+Begins a document whose content is then passed to `feed()` as it arrives.\n\
+The input source `source` provides the base URI and resolves external\n\
+entities, but its stream is not read.";
+
+static PyObject *parser_start(ParserObject *self, PyObject *args)
+{
+  PyObject *source;
+  ExpatStatus status;
+
+  if (!PyArg_ParseTuple(args, "O:start", &source))
+    return NULL;
+
+  if (parser_enter(self, 0) < 0)
+    return NULL;
+  Expat_SetValidation(self->state->reader,
+                      self->flags == PARSE_FLAGS_VALIDATE);
+  Expat_SetParamEntityParsing(self->state->reader,
+                              self->flags != PARSE_FLAGS_STANDALONE);
+  status = ExpatReader_StartFeed(self->state->reader, source);
+  if (status == EXPAT_STATUS_ERROR)
+    ParserState_Reset(self->state);
+  else
+    self->feeding = 1;
+  self->busy = 0;
+  if (status == EXPAT_STATUS_ERROR)
+    return NULL;
+  Py_RETURN_NONE;
+}
+
+/* Parses the next part of the document begun by `start()`, returning the
+ * document once it is complete, or NULL */
+static PyObject *parser_continue(ParserObject *self, const char *data,
+                                 Py_ssize_t length, int is_final)
+{
+  PyObject *result = NULL;
+  int gc_enabled;
+  ExpatStatus status;
+
+  if (parser_enter(self, 1) < 0)
+    return NULL;
+  gc_enabled = builder_gc_disable();
+  if (gc_enabled < 0) {
+    self->busy = 0;
+    return NULL;
+  }
+  status = ExpatReader_Feed(self->state->reader, data, length, is_final);
+  if (status == EXPAT_STATUS_OK && is_final)
+    result = (PyObject *)self->state->owner_document;
+  if (status == EXPAT_STATUS_ERROR || is_final) {
+    ParserState_Reset(self->state);
+    self->feeding = 0;
+  }
+  self->busy = 0;
+  if (builder_gc_restore(gc_enabled) < 0) {
+    Py_XDECREF(result);
+    return NULL;
+  }
+  if (status == EXPAT_STATUS_ERROR)
+    return NULL;
+  return result;
+}
+
+static char parser_feed_doc[] = "\
+feed(data)\n\
+\n\
+Parses the next part (a string of any length) of the document begun by\n\
+`start()`.";
+
+static PyObject *parser_feed(ParserObject *self, PyObject *args)
+{
+  const char *data;
+  Py_ssize_t length;
+
+  if (!PyArg_ParseTuple(args, "s#:feed", &data, &length))
+    return NULL;
+
+  if (parser_continue(self, data, length, 0) == NULL && PyErr_Occurred())
+    return NULL;
+  Py_RETURN_NONE;
+}
+
+static char parser_close_doc[] = "\
+close() -> entity\n\
+\n\
+Ends the document begun by `start()` and returns it.";
+
+static PyObject *parser_close(ParserObject *self, PyObject *args)
+{
+  return parser_continue(self, NULL, 0, 1);
 }
 
+static PyMethodDef parser_methods[] = {
+  { "parse", (PyCFunction) parser_parse, METH_VARARGS, parser_parse_doc },
+  { "start", (PyCFunction) parser_start, METH_VARARGS, parser_start_doc },
+  { "feed",  (PyCFunction) parser_feed,  METH_VARARGS, parser_feed_doc },
+  { "close", (PyCFunction) parser_close, METH_NOARGS,  parser_close_doc },
+  { NULL }
+};
+
+static PyMemberDef parser_members[] = {
+  { "feeding", T_INT, offsetof(ParserObject, feeding), READONLY,
+    "true between the `start()` and `close()` of a document" },
+  { NULL }
+};
+
+static PyObject *parser_new(PyTypeObject *type, PyObject *args, PyObject *kw)
+{
+  static char *kwlist[] = { "flags", "entity_factory", NULL };
+  PyObject *entity_factory = NULL;
+  int flags = default_parse_flags;
+  ParserObject *self;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "|iO:parser", kwlist,
+                                   &flags, &entity_factory))
+    return NULL;
+  if (entity_factory == Py_None)
+    entity_factory = NULL;
+
+  self = (ParserObject *) type->tp_alloc(type, 0);
+  if (self == NULL)
+    return NULL;
+  self->flags = flags;
+  self->state = ParserState_New(entity_factory);
+  if (self->state == NULL) {
+    Py_DECREF(self);
+    return NULL;
+  }
+  self->state->reader = create_reader(self->state);
+  if (self->state->reader == NULL) {
+    Py_DECREF(self);
+    return NULL;
+  }
+  return (PyObject *) self;
+}
+
+static void parser_dealloc(ParserObject *self)
+{
+  if (self->state) {
+    if (self->state->reader)
+      ExpatReader_Del(self->state->reader);
+    ParserState_Del(self->state);
+  }
+  self->ob_type->tp_free((PyObject *) self);
+}
+
+static char parser_doc[] = "\
+parser([flags[, entity_factory]]) -> parser object\n\
+\n\
+A parser for any number of documents, one at a time, either read from an\n\
+input source (`parse()`) or passed in as they arrive (`start()`, `feed()`\n\
+and `close()`).  The reader, along with its name caches and Expat parser,\n\
+is kept from one document to the next rather than created for each.";
+
+static PyTypeObject Parser_Type = {
+  /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
+  /* ob_size           */ 0,
+  /* tp_name           */ Domlette_MODULE_NAME "." "parser",
+  /* tp_basicsize      */ sizeof(ParserObject),
+  /* tp_itemsize       */ 0,
+  /* tp_dealloc        */ (destructor) parser_dealloc,
+  /* tp_print          */ (printfunc) 0,
+  /* tp_getattr        */ (getattrfunc) 0,
+  /* tp_setattr        */ (setattrfunc) 0,
+  /* tp_compare        */ (cmpfunc) 0,
+  /* tp_repr           */ (reprfunc) 0,
+  /* tp_as_number      */ (PyNumberMethods *) 0,
+  /* tp_as_sequence    */ (PySequenceMethods *) 0,
+  /* tp_as_mapping     */ (PyMappingMethods *) 0,
+  /* tp_hash           */ (hashfunc) 0,
+  /* tp_call           */ (ternaryfunc) 0,
+  /* tp_str            */ (reprfunc) 0,
+  /* tp_getattro       */ (getattrofunc) 0,
+  /* tp_setattro       */ (setattrofunc) 0,
+  /* tp_as_buffer      */ (PyBufferProcs *) 0,
+  /* tp_flags          */ (Py_TPFLAGS_DEFAULT |
+                           Py_TPFLAGS_BASETYPE),
+  /* tp_doc            */ (char *) parser_doc,
+  /* tp_traverse       */ (traverseproc) 0,
+  /* tp_clear          */ (inquiry) 0,
+  /* tp_richcompare    */ (richcmpfunc) 0,
+  /* tp_weaklistoffset */ 0,
+  /* tp_iter           */ (getiterfunc) 0,
+  /* tp_iternext       */ (iternextfunc) 0,
+  /* tp_methods        */ (PyMethodDef *) parser_methods,
+  /* tp_members        */ (PyMemberDef *) parser_members,
+  /* tp_getset         */ (PyGetSetDef *) 0,
+  /* tp_base           */ (PyTypeObject *) 0,
+  /* tp_dict           */ (PyObject *) 0,
+  /* tp_descr_get      */ (descrgetfunc) 0,
+  /* tp_descr_set      */ (descrsetfunc) 0,
+  /* tp_dictoffset     */ 0,
+  /* tp_init           */ (initproc) 0,
+  /* tp_alloc          */ (allocfunc) 0,
+  /* tp_new            */ (newfunc) parser_new,
+  /* tp_free           */ 0,
+};
+
 /** Module Interface **************************************************/
 
 int DomletteBuilder_Init(PyObject *module)
@@ -954,6 +1353,11 @@ int DomletteBuilder_Init(PyObject *module)
   Py_DECREF(import);
 #undef GET_GC_FUNC
 
+  if (PyType_Ready(&Parser_Type) < 0) return -1;
+  Py_INCREF(&Parser_Type);
+  if (PyModule_AddObject(module, "parser", (PyObject *) &Parser_Type) < 0)
+    return -1;
+
 #define ADD_CONSTANT(name) \
   if (PyModule_AddIntConstant(module, #name, name) < 0) return -1
   ADD_CONSTANT(PARSE_FLAGS_STANDALONE);
@@ -19,6 +19,34 @@
 static PyObject *inserted_event;
 static PyObject *removed_event;
 
+typedef struct {
+  PyObject_HEAD
+  NodeObject *container;        /* NULL once detached */
+  PyObject *snapshot;           /* the children when detached */
+} ChildrenObject;
+
+static PyTypeObject Children_Type;
+
+/* returns a new tuple of the current children */
+Py_LOCAL(PyObject *)
+children_tuple(NodeObject *self)
+{
+  register Py_ssize_t count;
+  register Py_ssize_t index;
+  register PyObject *children;
+
+  count = Container_GET_COUNT(self);
+  children = PyTuple_New(count);
+  if (children != NULL) {
+    for (index = 0; index < count; index++) {
+      PyObject *child = (PyObject *)Container_GET_CHILD(self, index);
+      Py_INCREF(child);
+      PyTuple_SET_ITEM(children, index, child);
+    }
+  }
+  return children;
+}
+
 /* Ensure `nodes` has room for at least `newsize` elements, and set
  * `count` to `newsize`.  If `newsize` > `count` on entry, the content
  * of the new slots at exit is undefined heap trash; it's the caller's
@@ -152,6 +180,23 @@ container_index(NodeObject *self, NodeObject *child,
 
 /** Public C API ******************************************************/
 
+int _Container_DetachChildren(NodeObject *self)
+{
+  ChildrenObject *view = (ChildrenObject *)((ContainerObject *)self)->children;
+  PyObject *snapshot;
+
+  assert(view != NULL && view->container == self);
+  snapshot = children_tuple(self);
+  if (snapshot == NULL)
+    return -1;
+  view->snapshot = snapshot;
+  view->container = NULL;
+  ((ContainerObject *)self)->children = NULL;
+  /* the view's reference; the caller still holds `self` */
+  Py_DECREF(self);
+  return 0;
+}
+
 
 void _Container_Del(NodeObject *node)
 {
@@ -181,6 +226,8 @@ void _Container_Del(NodeObject *node)
 int _Container_SetWorkingChildren(NodeObject *self, NodeObject **array, 
 				  Py_ssize_t allocated) {
   
+  if (Container_DETACH_CHILDREN(self) < 0)
+    return -1;
   Container_SET_NODES(self,array);
   Container_SET_ALLOCATED(self,allocated);
   Container_SET_FROZEN(self,0);
@@ -285,6 +332,8 @@ int _Container_FastAppend(NodeObject *self, NodeObject *child)
   Py_ssize_t newsize;
   Py_ssize_t allocated;
 
+  if (Container_DETACH_CHILDREN(self) < 0)
+    return -1;
   children = Container_GET_NODES(self);
   allocated = Container_GET_ALLOCATED(self);
   newsize = Container_GET_COUNT(self) + 1;
@@ -309,6 +358,36 @@ int _Container_FastAppend(NodeObject *self, NodeObject *child)
   return 0;
 }
 
+/* The counterpart of _Container_FastAppend(), used to drop a node from the
+ * tree under construction (the search starts from the last child). */
+int _Container_FastRemove(NodeObject *self, NodeObject *child)
+{
+  NodeObject **nodes;
+  Py_ssize_t count, index;
+
+  if (Container_DETACH_CHILDREN(self) < 0)
+    return -1;
+  nodes = Container_GET_NODES(self);
+  count = Container_GET_COUNT(self);
+  for (index = count; --index >= 0;) {
+    if (nodes[index] == child)
+      break;
+  }
+  if (index == -1) {
+    PyErr_Format(PyExc_ValueError, "child not in children");
+    return -1;
+  }
+
+  Node_SET_PARENT(child, NULL);
+  Node_InvalidateOrder(child);
+  Py_DECREF(self);
+  memmove(&nodes[index], &nodes[index+1],
+          (count - (index + 1)) * sizeof(NodeObject *));
+  Container_SET_COUNT(self, count - 1);
+  Py_DECREF(child);
+  return 0;
+}
+
 int Container_Remove(NodeObject *self, NodeObject *child)
 {
   register NodeObject **nodes;
@@ -333,11 +412,18 @@ int Container_Remove(NodeObject *self, NodeObject *child)
   /* Announce the removal of the child. */
   if (try_dispatch_event(self, removed_event, child) < 0)
     return -1;
+  if (Container_DETACH_CHILDREN(self) < 0)
+    return -1;
 
   /* Set the parent to NULL, indicating no parent */
   assert(Node_GET_PARENT(child) == self);
   Py_DECREF(Node_GET_PARENT(child));
   Node_SET_PARENT(child, NULL);
+  Node_InvalidateOrder(self);
+  Node_InvalidateOrder(child);
+  Entity_InvalidateIds(self);
+  Entity_InvalidateNames(self);
+  Element_InvalidateNamespaces(self);
 
   /* Now shift the nodes in the array over the top of the removed node */
   memmove(&nodes[index], &nodes[index+1],
@@ -358,6 +444,8 @@ int Container_Append(NodeObject *self, NodeObject *child)
     return -1;
 
   /* Make room for the new child */
+  if (Container_DETACH_CHILDREN(self) < 0)
+    return -1;
   count = Container_GET_COUNT(self);
   if (container_resize((ContainerObject *)self, count+1) < 0)
     return -1;
@@ -379,6 +467,10 @@ int Container_Append(NodeObject *self, NodeObject *child)
   /* Set the parent relationship */
   Py_INCREF(self);
   Node_SET_PARENT(child, self);
+  Node_InvalidateOrder(self);
+  Entity_InvalidateIds(self);
+  Entity_InvalidateNames(self);
+  Element_InvalidateNamespaces(self);
 
   /* Almost done; announce the addition of the child. */
   return try_dispatch_event(self, inserted_event, child);
@@ -401,6 +493,8 @@ int Container_Insert(NodeObject *self, Py_ssize_t where, NodeObject *child)
   }
 
   /* Make room for the new child */
+  if (Container_DETACH_CHILDREN(self) < 0)
+    return -1;
   if (container_resize((ContainerObject *)self, count+1) == -1)
     return -1;
 
@@ -433,6 +527,10 @@ int Container_Insert(NodeObject *self, Py_ssize_t where, NodeObject *child)
   /* Set the parent relationship */
   Py_INCREF(self);
   Node_SET_PARENT(child, self);
+  Node_InvalidateOrder(self);
+  Entity_InvalidateIds(self);
+  Entity_InvalidateNames(self);
+  Element_InvalidateNamespaces(self);
 
   /* Almost done; announce the addition of the child. */
   return try_dispatch_event(self, inserted_event, child);
@@ -472,10 +570,13 @@ int Container_Replace(NodeObject *self, NodeObject *oldChild,
     }
     assert(Node_GET_PARENT(newChild) == NULL);
   }
+  if (Container_DETACH_CHILDREN(self) < 0)
+    return -1;
 
   /* Set the parent for `oldChild` to NULL, indicating no parent */
   Py_DECREF(Node_GET_PARENT(oldChild));
   Node_SET_PARENT(oldChild, NULL);
+  Node_InvalidateOrder(oldChild);
 
   /* Remove it from the nodes array (just drop the reference to it as its
    * spot will soon be taken by `newChild`) */
@@ -488,6 +589,10 @@ int Container_Replace(NodeObject *self, NodeObject *oldChild,
   /* Set the parent relationship */
   Py_INCREF(self);
   Node_SET_PARENT(newChild, self);
+  Node_InvalidateOrder(self);
+  Entity_InvalidateIds(self);
+  Entity_InvalidateNames(self);
+  Element_InvalidateNamespaces(self);
 
   /* Almost done; announce the insertion of `newChild`. */
   return try_dispatch_event(self, inserted_event, newChild);
@@ -701,20 +806,21 @@ static PyMemberDef container_members[] = {
 
 static PyObject *get_children(PyObject *self, void *arg)
 {
-  register Py_ssize_t count;
-  register Py_ssize_t index;
-  register PyObject *children;
+  ChildrenObject *view = (ChildrenObject *)((ContainerObject *)self)->children;
 
-  count = Container_GET_COUNT(self);
-  children = PyTuple_New(count);
-  if (children != NULL) {
-    for (index = 0; index < count; index++) {
-      PyObject *child = (PyObject *)Container_GET_CHILD(self, index);
-      Py_INCREF(child);
-      PyTuple_SET_ITEM(children, index, child);
-    }
+  if (view != NULL) {
+    Py_INCREF(view);
+    return (PyObject *)view;
   }
-  return children;
+  view = PyObject_GC_New(ChildrenObject, &Children_Type);
+  if (view != NULL) {
+    Py_INCREF(self);
+    view->container = (NodeObject *)self;
+    view->snapshot = NULL;
+    ((ContainerObject *)self)->children = (PyObject *)view;
+    PyObject_GC_Track(view);
+  }
+  return (PyObject *)view;
 }
 
 static PyObject *get_first_child(PyObject *self, void *arg)
@@ -912,6 +1018,440 @@ static PyTypeObject NodeIter_Type = {
   /* tp_iternext       */ (iternextfunc) nodeiter_next,
 };
 
+/** Children View ****************************************************/
+
+#define Children_GET_COUNT(op)                          \
+  ((op)->container ? Container_GET_COUNT((op)->container) \
+                   : PyTuple_GET_SIZE((op)->snapshot))
+#define Children_GET_ITEM(op, i)                                     \
+  ((op)->container ? (PyObject *)Container_GET_CHILD((op)->container, i) \
+                   : PyTuple_GET_ITEM((op)->snapshot, i))
+
+/* returns a new reference to the children as a tuple */
+Py_LOCAL_INLINE(PyObject *)
+children_as_tuple(ChildrenObject *self)
+{
+  if (self->container == NULL) {
+    Py_INCREF(self->snapshot);
+    return self->snapshot;
+  }
+  return children_tuple(self->container);
+}
+
+/* defers to the tuple method of the same name */
+Py_LOCAL(PyObject *)
+children_call_tuple(ChildrenObject *self, char *name, PyObject *args)
+{
+  PyObject *tuple, *method, *result;
+
+  tuple = children_as_tuple(self);
+  if (tuple == NULL)
+    return NULL;
+  method = PyObject_GetAttrString(tuple, name);
+  Py_DECREF(tuple);
+  if (method == NULL)
+    return NULL;
+  result = PyObject_Call(method, args, NULL);
+  Py_DECREF(method);
+  return result;
+}
+
+static char children_index_doc[] =
+"C.index(value, [start, [stop]]) -> integer -- return first index of value.";
+
+static PyObject *children_index(ChildrenObject *self, PyObject *args)
+{
+  return children_call_tuple(self, "index", args);
+}
+
+static char children_count_doc[] =
+"C.count(value) -> integer -- return number of occurrences of value";
+
+static PyObject *children_count(ChildrenObject *self, PyObject *args)
+{
+  return children_call_tuple(self, "count", args);
+}
+
+static char children_copy_doc[] =
+"C.__copy__() -> tuple -- return the children as a tuple";
+
+static PyObject *children_copy(ChildrenObject *self, PyObject *noargs)
+{
+  return children_as_tuple(self);
+}
+
+static char children_reduce_doc[] =
+"C.__reduce__() -> pickles the children as a tuple";
+
+static PyObject *children_reduce(ChildrenObject *self, PyObject *noargs)
+{
+  PyObject *tuple;
+
+  tuple = children_as_tuple(self);
+  if (tuple == NULL)
+    return NULL;
+  return Py_BuildValue("O(N)", &PyTuple_Type, tuple);
+}
+
+static PyMethodDef children_methods[] = {
+  { "index", (PyCFunction) children_index, METH_VARARGS, children_index_doc },
+  { "count", (PyCFunction) children_count, METH_VARARGS, children_count_doc },
+  { "__copy__", (PyCFunction) children_copy, METH_NOARGS, children_copy_doc },
+  { "__reduce__", (PyCFunction) children_reduce, METH_NOARGS,
+    children_reduce_doc },
+  { NULL }
+};
+
+static Py_ssize_t children_length(ChildrenObject *self)
+{
+  return Children_GET_COUNT(self);
+}
+
+static PyObject *children_item(ChildrenObject *self, Py_ssize_t index)
+{
+  PyObject *item;
+
+  if (index < 0 || index >= Children_GET_COUNT(self)) {
+    PyErr_SetString(PyExc_IndexError, "children index out of range");
+    return NULL;
+  }
+  item = Children_GET_ITEM(self, index);
+  Py_INCREF(item);
+  return item;
+}
+
+static PyObject *children_concat(ChildrenObject *self, PyObject *other)
+{
+  PyObject *tuple, *result;
+
+  tuple = children_as_tuple(self);
+  if (tuple == NULL)
+    return NULL;
+  if (other->ob_type == &Children_Type) {
+    other = children_as_tuple((ChildrenObject *)other);
+    if (other == NULL) {
+      Py_DECREF(tuple);
+      return NULL;
+    }
+  } else {
+    Py_INCREF(other);
+  }
+  result = PySequence_Concat(tuple, other);
+  Py_DECREF(tuple);
+  Py_DECREF(other);
+  return result;
+}
+
+static PyObject *children_repeat(ChildrenObject *self, Py_ssize_t count)
+{
+  PyObject *tuple, *result;
+
+  tuple = children_as_tuple(self);
+  if (tuple == NULL)
+    return NULL;
+  result = PySequence_Repeat(tuple, count);
+  Py_DECREF(tuple);
+  return result;
+}
+
+static int children_contains(ChildrenObject *self, PyObject *value)
+{
+  Py_ssize_t i;
+  int result;
+
+  for (i = 0; i < Children_GET_COUNT(self); i++) {
+    PyObject *item = Children_GET_ITEM(self, i);
+    Py_INCREF(item);
+    result = PyObject_RichCompareBool(item, value, Py_EQ);
+    Py_DECREF(item);
+    if (result != 0)
+      return result;
+  }
+  return 0;
+}
+
+static PySequenceMethods children_as_sequence = {
+  /* sq_length         */ (lenfunc) children_length,
+  /* sq_concat         */ (binaryfunc) children_concat,
+  /* sq_repeat         */ (ssizeargfunc) children_repeat,
+  /* sq_item           */ (ssizeargfunc) children_item,
+  /* sq_slice          */ 0,
+  /* sq_ass_item       */ 0,
+  /* sq_ass_slice      */ 0,
+  /* sq_contains       */ (objobjproc) children_contains,
+  /* sq_inplace_concat */ 0,
+  /* sq_inplace_repeat */ 0,
+};
+
+/* adds as the tuple of the children, with the view on either side, so
+ * that `tuple + children` works as well as `children + tuple` */
+static PyObject *children_add(PyObject *a, PyObject *b)
+{
+  PyObject *result;
+
+  if (a->ob_type == &Children_Type)
+    a = children_as_tuple((ChildrenObject *)a);
+  else if (PyTuple_Check(a))
+    Py_INCREF(a);
+  else
+    goto not_implemented;
+  if (a == NULL)
+    return NULL;
+  if (b->ob_type == &Children_Type)
+    b = children_as_tuple((ChildrenObject *)b);
+  else if (PyTuple_Check(b))
+    Py_INCREF(b);
+  else {
+    Py_DECREF(a);
+    goto not_implemented;
+  }
+  if (b == NULL) {
+    Py_DECREF(a);
+    return NULL;
+  }
+  result = PySequence_Concat(a, b);
+  Py_DECREF(a);
+  Py_DECREF(b);
+  return result;
+
+not_implemented:
+  Py_INCREF(Py_NotImplemented);
+  return Py_NotImplemented;
+}
+
+static PyNumberMethods children_as_number = {
+  /* nb_add            */ (binaryfunc) children_add,
+};
+
+static PyObject *children_subscript(ChildrenObject *self, PyObject *key)
+{
+  if (PyIndex_Check(key)) {
+    Py_ssize_t index = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (index == -1 && PyErr_Occurred())
+      return NULL;
+    if (index < 0)
+      index += Children_GET_COUNT(self);
+    return children_item(self, index);
+  } else if (PySlice_Check(key)) {
+    Py_ssize_t start, stop, step, length, i;
+    PyObject *result;
+    if (PySlice_GetIndicesEx((PySliceObject *)key, Children_GET_COUNT(self),
+                             &start, &stop, &step, &length) < 0)
+      return NULL;
+    result = PyTuple_New(length);
+    if (result == NULL)
+      return NULL;
+    for (i = 0; i < length; i++, start += step) {
+      PyObject *item = Children_GET_ITEM(self, start);
+      Py_INCREF(item);
+      PyTuple_SET_ITEM(result, i, item);
+    }
+    return result;
+  }
+  PyErr_Format(PyExc_TypeError,
+               "children indices must be integers, not %.200s",
+               key->ob_type->tp_name);
+  return NULL;
+}
+
+static PyMappingMethods children_as_mapping = {
+  /* mp_length        */ (lenfunc) children_length,
+  /* mp_subscript     */ (binaryfunc) children_subscript,
+  /* mp_ass_subscript */ (objobjargproc) 0,
+};
+
+static void children_dealloc(ChildrenObject *self)
+{
+  PyObject_GC_UnTrack(self);
+  if (self->container) {
+    ((ContainerObject *)self->container)->children = NULL;
+    Py_DECREF(self->container);
+  }
+  Py_XDECREF(self->snapshot);
+  PyObject_GC_Del(self);
+}
+
+static PyObject *children_repr(ChildrenObject *self)
+{
+  PyObject *tuple, *repr;
+
+  tuple = children_as_tuple(self);
+  if (tuple == NULL)
+    return NULL;
+  repr = PyObject_Repr(tuple);
+  Py_DECREF(tuple);
+  return repr;
+}
+
+static long children_hash(ChildrenObject *self)
+{
+  PyObject *tuple;
+  long hash;
+
+  tuple = children_as_tuple(self);
+  if (tuple == NULL)
+    return -1;
+  hash = PyObject_Hash(tuple);
+  Py_DECREF(tuple);
+  return hash;
+}
+
+static int children_traverse(ChildrenObject *self, visitproc visit, void *arg)
+{
+  Py_VISIT(self->container);
+  Py_VISIT(self->snapshot);
+  return 0;
+}
+
+/* compares as the tuple of the children */
+static PyObject *children_richcompare(PyObject *a, PyObject *b, int op)
+{
+  PyObject *result;
+
+  if (a->ob_type == &Children_Type)
+    a = children_as_tuple((ChildrenObject *)a);
+  else
+    Py_INCREF(a);
+  if (a == NULL)
+    return NULL;
+  if (b->ob_type == &Children_Type)
+    b = children_as_tuple((ChildrenObject *)b);
+  else
+    Py_INCREF(b);
+  if (b == NULL) {
+    Py_DECREF(a);
+    return NULL;
+  }
+  result = PyObject_RichCompare(a, b, op);
+  Py_DECREF(a);
+  Py_DECREF(b);
+  return result;
+}
+
+typedef struct {
+  PyObject_HEAD
+  Py_ssize_t index;
+  ChildrenObject *children; /* NULL when iterator is done */
+} ChildrenIterObject;
+
+static PyTypeObject ChildrenIter_Type;
+
+static PyObject *children_iter(ChildrenObject *self)
+{
+  ChildrenIterObject *iter;
+
+  iter = PyObject_GC_New(ChildrenIterObject, &ChildrenIter_Type);
+  if (iter != NULL) {
+    iter->index = 0;
+    Py_INCREF(self);
+    iter->children = self;
+    PyObject_GC_Track(iter);
+  }
+  return (PyObject *)iter;
+}
+
+static void childreniter_dealloc(ChildrenIterObject *iter)
+{
+  PyObject_GC_UnTrack(iter);
+  Py_XDECREF(iter->children);
+  PyObject_GC_Del(iter);
+}
+
+static int childreniter_traverse(ChildrenIterObject *iter, visitproc visit,
+                                 void *arg)
+{
+  Py_VISIT(iter->children);
+  return 0;
+}
+
+static PyObject *childreniter_next(ChildrenIterObject *iter)
+{
+  ChildrenObject *children = iter->children;
+  if (children == NULL)
+    return NULL;
+
+  if (iter->index < Children_GET_COUNT(children)) {
+    PyObject *item = Children_GET_ITEM(children, iter->index++);
+    Py_INCREF(item);
+    return item;
+  }
+
+  Py_DECREF(children);
+  iter->children = NULL;
+  return NULL;
+}
+
+static PyTypeObject ChildrenIter_Type = {
+  /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
+  /* ob_size           */ 0,
+  /* tp_name           */ "childreniterator",
+  /* tp_basicsize      */ sizeof(ChildrenIterObject),
+  /* tp_itemsize       */ 0,
+  /* tp_dealloc        */ (destructor) childreniter_dealloc,
+  /* tp_print          */ (printfunc) 0,
+  /* tp_getattr        */ (getattrfunc) 0,
+  /* tp_setattr        */ (setattrfunc) 0,
+  /* tp_compare        */ (cmpfunc) 0,
+  /* tp_repr           */ (reprfunc) 0,
+  /* tp_as_number      */ (PyNumberMethods *) 0,
+  /* tp_as_sequence    */ (PySequenceMethods *) 0,
+  /* tp_as_mapping     */ (PyMappingMethods *) 0,
+  /* tp_hash           */ (hashfunc) 0,
+  /* tp_call           */ (ternaryfunc) 0,
+  /* tp_str            */ (reprfunc) 0,
+  /* tp_getattro       */ (getattrofunc) 0,
+  /* tp_setattro       */ (setattrofunc) 0,
+  /* tp_as_buffer      */ (PyBufferProcs *) 0,
+  /* tp_flags          */ (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC),
+  /* tp_doc            */ (char *) 0,
+  /* tp_traverse       */ (traverseproc) childreniter_traverse,
+  /* tp_clear          */ (inquiry) 0,
+  /* tp_richcompare    */ (richcmpfunc) 0,
+  /* tp_weaklistoffset */ 0,
+  /* tp_iter           */ (getiterfunc) 0,
+  /* tp_iternext       */ (iternextfunc) childreniter_next,
+};
+
+static char children_doc[] = "\
+A read-only sequence of the children of a node.\n\
+\n\
+The sequence refers to the node's children in place, without copying\n\
+them.  Once the children are modified, it keeps the children as they\n\
+were before the modification, like a tuple would.";
+
+static PyTypeObject Children_Type = {
+  /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
+  /* ob_size           */ 0,
+  /* tp_name           */ Domlette_MODULE_NAME "." "children",
+  /* tp_basicsize      */ sizeof(ChildrenObject),
+  /* tp_itemsize       */ 0,
+  /* tp_dealloc        */ (destructor) children_dealloc,
+  /* tp_print          */ (printfunc) 0,
+  /* tp_getattr        */ (getattrfunc) 0,
+  /* tp_setattr        */ (setattrfunc) 0,
+  /* tp_compare        */ (cmpfunc) 0,
+  /* tp_repr           */ (reprfunc) children_repr,
+  /* tp_as_number      */ (PyNumberMethods *) &children_as_number,
+  /* tp_as_sequence    */ (PySequenceMethods *) &children_as_sequence,
+  /* tp_as_mapping     */ (PyMappingMethods *) &children_as_mapping,
+  /* tp_hash           */ (hashfunc) children_hash,
+  /* tp_call           */ (ternaryfunc) 0,
+  /* tp_str            */ (reprfunc) 0,
+  /* tp_getattro       */ (getattrofunc) 0,
+  /* tp_setattro       */ (setattrofunc) 0,
+  /* tp_as_buffer      */ (PyBufferProcs *) 0,
+  /* tp_flags          */ (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_CHECKTYPES |
+                           Py_TPFLAGS_HAVE_GC),
+  /* tp_doc            */ (char *) children_doc,
+  /* tp_traverse       */ (traverseproc) children_traverse,
+  /* tp_clear          */ (inquiry) 0,
+  /* tp_richcompare    */ (richcmpfunc) children_richcompare,
+  /* tp_weaklistoffset */ 0,
+  /* tp_iter           */ (getiterfunc) children_iter,
+  /* tp_iternext       */ (iternextfunc) 0,
+  /* tp_methods        */ (PyMethodDef *) children_methods,
+};
+
 /** Module Interface **************************************************/
 
 int DomletteContainer_Init(PyObject *module)
@@ -929,6 +1469,13 @@ int DomletteContainer_Init(PyObject *module)
   NodeIter_Type.tp_iter = PyObject_SelfIter;
   if (PyType_Ready(&NodeIter_Type) < 0)
     return -1;
+  Children_Type.tp_getattro = PyObject_GenericGetAttr;
+  if (PyType_Ready(&Children_Type) < 0)
+    return -1;
+  ChildrenIter_Type.tp_getattro = PyObject_GenericGetAttr;
+  ChildrenIter_Type.tp_iter = PyObject_SelfIter;
+  if (PyType_Ready(&ChildrenIter_Type) < 0)
+    return -1;
 
   inserted_event = PyString_FromString("xml_child_inserted");
   if (inserted_event == NULL)
@@ -946,4 +1493,6 @@ void DomletteContainer_Fini(void)
   Py_DECREF(removed_event);
   PyType_CLEAR(&DomletteContainer_Type);
   PyType_CLEAR(&NodeIter_Type);
+  PyType_CLEAR(&Children_Type);
+  PyType_CLEAR(&ChildrenIter_Type);
 }
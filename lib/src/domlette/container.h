@@ -14,7 +14,8 @@ extern "C" {
     Py_ssize_t count;       \
     NodeObject **nodes;     \
     Py_ssize_t allocated;   \
-    int        frozen;
+    int        frozen;      \
+    PyObject  *children;    /* borrowed; the live `xml_children` view */
 
   /* Nothing is actually declared to be a ContainerObject, but every pointer 
    * to a Domlette container object can be cast to a ContainerObject*.
@@ -53,6 +54,7 @@ extern "C" {
 
   int _Container_FreezeChildren(NodeObject *self);
   int _Container_FastAppend(NodeObject *self, NodeObject *child);
+  int _Container_FastRemove(NodeObject *self, NodeObject *child);
 
   int Container_Append(NodeObject *self, NodeObject *child);
   int Container_Remove(NodeObject *self, NodeObject *child);
@@ -60,6 +62,15 @@ extern "C" {
   int Container_Replace(NodeObject *self, NodeObject *old, NodeObject *new);
   Py_ssize_t Container_Index(NodeObject *self, NodeObject *child);
 
+  /* The `xml_children` view reads the children array in place.  Before
+   * the array is modified, any view of it is detached, taking a copy of
+   * the children as they were (matching the previous tuple semantics).
+   */
+  int _Container_DetachChildren(NodeObject *self);
+#define Container_DETACH_CHILDREN(op) \
+  (((ContainerObject *)(op))->children ? \
+   _Container_DetachChildren((NodeObject *)(op)) : 0)
+
 #endif /* Domlette_BUILDING_MODULE */
 
 #ifdef __cplusplus
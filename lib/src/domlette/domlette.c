@@ -16,6 +16,7 @@ Project home, documentation, distributions: http://4suite.org/\n\
 #include "domlette_interface.h"
 #include "builder.h"
 #include "refcounts.h"
+#include "snapshot.h"
 
 /*
   These are the external interfaces
@@ -463,6 +464,18 @@ static PyObject *PyTestTree(PyObject *self, PyObject *args)
 
 }
 
+static char node_freelists_doc[] = "\
+node_freelists() -> dict\n\
+\n\
+Returns a dictionary mapping the name of each node type to a tuple of the\n\
+(free, allocated, reused) node counts of its freelist.";
+
+static PyObject *Domlette_NodeFreelists(PyObject *self, PyObject *args)
+{
+  return Node_FreelistStats();
+}
+
+
 
 /** The external interface definitions ********************************/
 
@@ -476,10 +489,22 @@ static PyMethodDef module_methods[] = {
   { "parse_fragment", (PyCFunction) Domlette_ParseFragment, METH_KEYWORDS,
     "parse_fragment(source[, namespaces[, node_factories]]) -> Document" },
 
+  /* from frozen.c */
+  { "parse_frozen", (PyCFunction) Domlette_ParseFrozen, METH_KEYWORDS,
+    "parse_frozen(source[, flags]) -> frozen_node" },
+
+  /* from snapshot.c */
+  { "load_snapshot", (PyCFunction) Domlette_LoadSnapshot, METH_KEYWORDS,
+    "load_snapshot(data[, readonly]) -> entity or frozen_node" },
+
   /* from nss.c */
   //Domlette_METHOD(GetAllNs, METH_VARARGS),
   //Domlette_METHOD(SeekNss, METH_VARARGS),
 
+  /* from node.c */
+  { "node_freelists", Domlette_NodeFreelists, METH_NOARGS,
+    node_freelists_doc },
+
   /* defined here (regression tests) */
   { "TestTree", PyTestTree, METH_VARARGS,
     "TestTree() -> Document\n\nFor regression testing." },
@@ -503,11 +528,13 @@ static Domlette_APIObject Domlette_API = {
   Container_Replace,
 
   Entity_New,
+  Entity_NamedDescendants,
 
   Element_New,
   Element_AddNamespace,
   Element_AddAttribute,
   Element_InscopeNamespaces,
+  Element_InscopeBindings,
 
   Text_New,
 
@@ -520,6 +547,13 @@ static Domlette_APIObject Domlette_API = {
   NamespaceMap_Next,
 
   AttributeMap_Next,
+
+  &DomletteFrozenNode_Type,
+  FrozenNode_New,
+  FrozenNode_Axis,
+  FrozenNode_StringValue,
+  Frozen_GetValue,
+  Frozen_InscopeNamespaces,
 };
 
 struct submodule_t {
@@ -543,6 +577,7 @@ struct submodule_t submodules[] = {
   SUBMODULE(Comment),
   SUBMODULE(Entity),
   SUBMODULE(Namespace),
+  SUBMODULE(Frozen),
   { NULL, NULL }
 };
 
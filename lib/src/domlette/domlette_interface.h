@@ -18,6 +18,7 @@ extern "C" {
 #include "comment.h"
 #include "processinginstruction.h"
 #include "namespace.h"
+#include "frozen.h"
 
 /*
 
@@ -52,6 +53,10 @@ extern "C" {
 
     /* Document Methods */
     EntityObject *(*Entity_New)(PyObject *documentURI);
+    PyObject *(*Entity_NamedDescendants)(NodeObject *context,
+                                         PyObject *namespace,
+                                         PyObject *local, Py_ssize_t *start,
+                                         Py_ssize_t *end);
 
     /* Element Methods */
     ElementObject *(*Element_New)(PyObject *namespaceURI,
@@ -66,6 +71,7 @@ extern "C" {
                                         PyObject *localName,
                                         PyObject *value);
     PyObject *(*Element_InscopeNamespaces)(ElementObject *self);
+    PyObject *(*Element_InscopeBindings)(ElementObject *self);
 
     /* Text Methods */
     TextObject *(*Text_New)(PyObject *data);
@@ -85,6 +91,16 @@ extern "C" {
     /* AttributeMap Methods */
     AttrObject *(*AttributeMap_Next)(PyObject *nodemap, Py_ssize_t *ppos);
 
+    /* Frozen Documents */
+    PyTypeObject *FrozenNode_Type;
+    PyObject *(*FrozenNode_New)(FrozenDocumentObject *document, int index,
+                                int owner);
+    PyObject *(*FrozenNode_Axis)(FrozenNodeObject *node, FrozenAxis axis);
+    PyObject *(*FrozenNode_StringValue)(FrozenNodeObject *node);
+    PyObject *(*Frozen_GetValue)(FrozenDocumentObject *document, int index);
+    PyObject *(*Frozen_InscopeNamespaces)(FrozenDocumentObject *document,
+                                          int index);
+
   } Domlette_APIObject;
 
 #ifdef Domlette_BUILDING_MODULE
@@ -127,6 +143,7 @@ extern "C" {
 #define Entity_Check(op) PyObject_TypeCheck((op), DomletteEntity_Type)
 #define Entity_CheckExact(op) ((op)->ob_type == DomletteEntity_Type)
 #define Entity_New Domlette->Entity_New
+#define Entity_NamedDescendants Domlette->Entity_NamedDescendants
 
 #define Element_Check(op) PyObject_TypeCheck((op), DomletteElement_Type)
 #define Element_CheckExact(op) ((op)->ob_type == DomletteElement_Type)
@@ -134,6 +151,7 @@ extern "C" {
 #define Element_AddNamespace Domlette->Element_AddNamespace
 #define Element_AddAttribute Domlette->Element_AddAttribute
 #define Element_InscopeNamespaces Domlette->Element_InscopeNamespaces
+#define Element_InscopeBindings Domlette->Element_InscopeBindings
 
 #define Attr_Check(op) PyObject_TypeCheck((op), DomletteAttr_Type)
 
@@ -159,6 +177,14 @@ extern "C" {
 
 #define AttributeMap_Next Domlette->AttributeMap_Next
 
+#define DomletteFrozenNode_Type Domlette->FrozenNode_Type
+#define FrozenNode_Check(op) ((op)->ob_type == DomletteFrozenNode_Type)
+#define FrozenNode_New Domlette->FrozenNode_New
+#define FrozenNode_Axis Domlette->FrozenNode_Axis
+#define FrozenNode_StringValue Domlette->FrozenNode_StringValue
+#define Frozen_GetValue Domlette->Frozen_GetValue
+#define Frozen_InscopeNamespaces Domlette->Frozen_InscopeNamespaces
+
 #endif /* !Domlette_BUILDING_MODULE */
 
 #ifdef __cplusplus
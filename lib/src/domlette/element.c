@@ -9,6 +9,8 @@ static PyObject *xmlns_string;
 static PyObject *xml_namespace;
 static PyObject *xmlns_namespace;
 
+Py_ssize_t _Element_NamespaceStamps = 0;
+
 Py_LOCAL_INLINE(ElementObject *)
 element_init(ElementObject *self, PyObject *namespaceURI, 
              PyObject *qualifiedName, PyObject *localName)
@@ -29,6 +31,8 @@ element_init(ElementObject *self, PyObject *namespaceURI,
   self->qname = qualifiedName;
   self->namespaces = NULL;
   self->attributes = NULL;
+  self->inscope = NULL;
+  self->inscope_stamp = 0;
   return self;
 }
 
@@ -249,6 +253,7 @@ Element_AddNamespace(ElementObject *self, PyObject *prefix, PyObject *namespace)
     if (NamespaceMap_SetNode(namespaces, node) < 0)
       Py_CLEAR(node);
   }
+  Element_InvalidateNamespaces((NodeObject *)self);
   return node;
 }
 
@@ -272,6 +277,7 @@ Element_SetNamespace(ElementObject *self, NamespaceObject *node)
     return -1;
   }
   /* add the namespace node */
+  Element_InvalidateNamespaces((NodeObject *)self);
   return NamespaceMap_SetNode(namespaces, node);
 }
 
@@ -387,61 +393,128 @@ Element_SetAttribute(ElementObject *self, AttrObject *attr)
   return AttributeMap_SetNode(attributes, attr);
 }
 
+/* Binds a copy of `node` in `namespaces` unless its prefix already is.
+ * The namespace nodes of an element are its own (their parent is the
+ * element) and the copies share the element's document order key. */
+Py_LOCAL_INLINE(int)
+inherit_namespace(PyObject *namespaces, PyObject *prefix, PyObject *uri,
+                  ElementObject *owner)
+{
+  NamespaceObject *copy;
+  int result;
+
+  if (NamespaceMap_GetNode(namespaces, prefix) != NULL)
+    return 0;
+  copy = Namespace_New(prefix, uri);
+  if (copy == NULL)
+    return -1;
+  if (Node_ORDER_VALID(owner))
+    Node_SET_DOCORDER(copy, Node_GET_DOCORDER_STAMP(owner),
+                      Node_GET_DOCORDER(owner));
+  result = NamespaceMap_SetNode(namespaces, copy);
+  Py_DECREF(copy);
+  return result;
+}
+
 /* returns a new reference */
 PyObject *
 Element_InscopeNamespaces(ElementObject *self)
 {
-  NodeObject *current = (NodeObject *)self;
-  PyObject *namespaces, *nodemap, *name, *value;
+  NodeObject *current;
+  PyObject *namespaces, *nodemap;
   Py_ssize_t pos;
   NamespaceObject *node;
 
   namespaces = NamespaceMap_New(self);
-  if (namespaces == NULL) 
+  if (namespaces == NULL)
     return NULL;
 
-  /* add the XML namespace */
-  node = Namespace_New(xml_string, xml_namespace);
-  if (node == NULL) {
-    Py_DECREF(namespaces);
-    return NULL;
-  }
-  if (NamespaceMap_SetNode(namespaces, node) < 0) {
-    Py_DECREF(node);
-    Py_DECREF(namespaces);
-    return NULL;
+  /* the element's own declarations */
+  nodemap = self->namespaces;
+  if (nodemap != NULL) {
+    pos = 0;
+    while ((node = NamespaceMap_Next(nodemap, &pos))) {
+      /* empty string; remove prefix binding */
+      /* NOTE: in XML Namespaces 1.1 it would be possible to do this
+          for all prefixes, for now just the default namespace */
+      if (Namespace_GET_NAME(node) == Py_None &&
+          PyUnicode_GET_SIZE(Namespace_GET_VALUE(node)) == 0)
+        continue;
+      if (NamespaceMap_SetNode(namespaces, node) < 0)
+        goto error;
+    }
   }
-  Py_DECREF(node);
 
-  do {
+  current = Node_GET_PARENT(self);
+  while (current && Element_Check(current)) {
     nodemap = Element_NAMESPACES(current);
     if (nodemap != NULL) {
-      /* process the element's declared namespaces */
       pos = 0;
       while ((node = NamespaceMap_Next(nodemap, &pos))) {
-        /* namespace attribute */
-        name = Namespace_GET_NAME(node);
-        value = Namespace_GET_VALUE(node);
-        if (PyUnicode_GET_SIZE(value) == 0) {
-          /* empty string; remove prefix binding */
-          /* NOTE: in XML Namespaces 1.1 it would be possible to do this
-              for all prefixes, for now just the default namespace */
-          if (name == Py_None)
-            continue;
-        }
-        /* add the declaration if prefix is not already defined */
-        if (NamespaceMap_GetNode(namespaces, name) == NULL) {
-          if (NamespaceMap_SetNode(namespaces, node) < 0) {
-            Py_DECREF(namespaces);
-            return NULL;
-          }
-        }
+        if (Namespace_GET_NAME(node) == Py_None &&
+            PyUnicode_GET_SIZE(Namespace_GET_VALUE(node)) == 0)
+          continue;
+        if (inherit_namespace(namespaces, Namespace_GET_NAME(node),
+                              Namespace_GET_VALUE(node), self) < 0)
+          goto error;
       }
     }
     current = Node_GET_PARENT(current);
-  } while (current && Element_Check(current));
-
+  }
+  /* add the XML namespace */
+  if (inherit_namespace(namespaces, xml_string, xml_namespace, self) < 0)
+    goto error;
   return namespaces;
+
+error:
+  Py_DECREF(namespaces);
+  return NULL;
+}
+
+/* Returns (a new reference to) a map of the namespaces in scope for `self`,
+ * whose nodes may belong to an ancestor.  It is the map built for the
+ * nearest element declaring namespaces, which is kept while the tree is
+ * unchanged (see element.h). */
+PyObject *
+Element_InscopeBindings(ElementObject *self)
+{
+  NodeObject *node, *parent;
+  ElementObject *owner = NULL;
+  Py_ssize_t stamp;
+
+  for (node = (NodeObject *)self; ; node = parent) {
+    parent = Node_GET_PARENT(node);
+    if (owner == NULL &&
+        (Element_NAMESPACES(node) != NULL ||
+         parent == NULL || !Element_Check(parent)))
+      owner = Element(node);
+    if (parent == NULL)
+      break;
+  }
+  /* trees not part of an entity are not stamped */
+  if (!Entity_Check(node))
+    return Element_InscopeNamespaces(owner);
+
+  stamp = Entity(node)->namespace_stamp;
+  if (owner->inscope == NULL || owner->inscope_stamp != stamp) {
+    PyObject *namespaces = Element_InscopeNamespaces(owner);
+    if (namespaces == NULL)
+      return NULL;
+    Py_XDECREF(owner->inscope);
+    owner->inscope = namespaces;
+    owner->inscope_stamp = stamp;
+  }
+  Py_INCREF(owner->inscope);
+  return owner->inscope;
+}
+
+/* Discards the maps kept for the elements of the tree containing `node` */
+void Element_InvalidateNamespaces(NodeObject *node)
+{
+  while (Node_GET_PARENT(node) != NULL)
+    node = Node_GET_PARENT(node);
+  if (Entity_Check(node))
+    Entity(node)->namespace_stamp = Element_NewNamespaceStamp();
 }
 
 /** Python Methods ****************************************************/
@@ -761,6 +834,7 @@ static int set_local(PyObject *self, PyObject *v, void *arg)
   Py_INCREF(local);
   qname = local;
 finally:
+  Entity_InvalidateNames(Node(self));
   Py_DECREF(Element_LOCAL_NAME(self));
   Element_LOCAL_NAME(self) = local;
   Py_DECREF(Element_QNAME(self));
@@ -798,6 +872,7 @@ static int set_namespace(PyObject *self, PyObject *v, void *arg)
     }
   }
 
+  Entity_InvalidateNames(Node(self));
   Py_DECREF(Element_NAMESPACE_URI(self));
   Element_NAMESPACE_URI(self) = namespace;
   Py_DECREF(Element_QNAME(self));
@@ -854,6 +929,7 @@ static void element_dealloc(ElementObject *self)
   Py_CLEAR(self->qname);
   Py_CLEAR(self->attributes);
   Py_CLEAR(self->namespaces);
+  Py_CLEAR(self->inscope);
   Node_Del(self);
 }
 
@@ -882,6 +958,7 @@ static int element_traverse(ElementObject *self, visitproc visit, void *arg)
 {
   Py_VISIT(self->attributes);
   Py_VISIT(self->namespaces);
+  Py_VISIT(self->inscope);
   return DomletteContainer_Type.tp_traverse((PyObject *)self, visit, arg);
 }
 
@@ -889,6 +966,7 @@ static int element_clear(ElementObject *self)
 {
   Py_CLEAR(self->attributes);
   Py_CLEAR(self->namespaces);
+  Py_CLEAR(self->inscope);
   return DomletteContainer_Type.tp_clear((PyObject *)self);
 }
 
@@ -15,6 +15,8 @@ extern "C" {
     PyObject *qname;
     PyObject *attributes;
     PyObject *namespaces;
+    PyObject *inscope;          /* see Element_InscopeBindings() */
+    Py_ssize_t inscope_stamp;
   } ElementObject;
 
 #define Element(op) ((ElementObject *)(op))
@@ -58,6 +60,24 @@ extern "C" {
   int Element_SetAttribute(ElementObject *self, AttrObject *attr);
 
   PyObject *Element_InscopeNamespaces(ElementObject *self);
+  PyObject *Element_InscopeBindings(ElementObject *self);
+
+  /* In-scope namespaces
+   *
+   * Element_InscopeNamespaces() builds a new map on each call, as the
+   * namespace nodes of an element are its own.  Element_InscopeBindings()
+   * is for callers which only need the bindings: its map is kept by the
+   * nearest element (the given one or an ancestor) which declares
+   * namespaces, or else by the topmost element, and so is shared by the
+   * elements which declare none.  A kept map is used while its stamp is
+   * that of the entity; any mutation which may change the namespaces in
+   * scope for an existing element (declaring a namespace or moving nodes)
+   * gives the entity of the changed tree a new stamp.
+   */
+  extern Py_ssize_t _Element_NamespaceStamps;
+
+#define Element_NewNamespaceStamp() (++_Element_NamespaceStamps)
+  void Element_InvalidateNamespaces(NodeObject *node);
 
 #endif /* Domlette_BUILDING_MODULE */
 
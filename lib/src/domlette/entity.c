@@ -1,5 +1,6 @@
 #define PY_SSIZE_T_CLEAN
 #include "domlette_interface.h"
+#include "snapshot.h"
 
 /** Private Routines **************************************************/
 
@@ -43,6 +44,10 @@ entity_init(EntityObject *self, PyObject *documentURI)
 
   self->creationIndex = creationIndex;
   self->unparsed_entities = unparsed_entities;
+  self->ids = NULL;
+  self->names = NULL;
+  self->name_searches = 0;
+  self->namespace_stamp = Element_NewNamespaceStamp();
   Entity_SET_DOCUMENT_URI(self, documentURI);
   Entity_SET_PUBLIC_ID(self, Py_None);
   Py_INCREF(Py_None);
@@ -57,44 +62,97 @@ entity_init(EntityObject *self, PyObject *documentURI)
   return self;
 }
 
-/* returns borrowed reference */
-Py_LOCAL(PyObject *) /* not inlined as its recursive */
-get_element_by_id(NodeObject *node, PyObject *elementId)
+Py_LOCAL(int) /* not inlined as its recursive */
+build_id_index(NodeObject *node, PyObject *ids)
 {
-  PyObject *result;
   Py_ssize_t i;
 
   for (i = 0; i < Container_GET_COUNT(node); i++) {
     NodeObject *child = Container_GET_CHILD(node, i);
     if (Element_Check(child)) {
-      /* Searth the attributes for an ID attr */
+      /* Search the attributes for an ID attr */
       PyObject *attributes = Element_ATTRIBUTES(child);
       if (attributes != NULL) {
         AttrObject *attr;
         Py_ssize_t pos = 0;
         while ((attr = AttributeMap_Next(attributes, &pos)) != NULL) {
           if (Attr_GET_TYPE(attr) == ATTRIBUTE_TYPE_ID) {
-            switch (PyObject_RichCompareBool(Attr_GET_VALUE(attr),
-                                             elementId, Py_EQ)) {
-            case 1:
-              /* Found matching element, return it. */
-              return (PyObject *) child;
-            case 0:
-              break;
-            default:
-              return NULL;
-            }
+            /* the first element in document order wins */
+            PyObject *value = Attr_GET_VALUE(attr);
+            if (PyDict_GetItem(ids, value) == NULL)
+              if (PyDict_SetItem(ids, value, (PyObject *)child) < 0)
+                return -1;
           }
         }
       }
       /* Continue on with the children */
-      result = get_element_by_id(child, elementId);
-      if (result != Py_None) 
-        /* either NULL (an error) or a node (element found) */
-        return result;
+      if (build_id_index(child, ids) < 0)
+        return -1;
     }
   }
-  return Py_None;
+  return 0;
+}
+
+/* Searches of subtrees spanning fewer nodes than this walk them instead */
+#define NAME_INDEX_MIN_SUBTREE 64
+
+Py_LOCAL(int) /* not inlined as its recursive */
+build_name_index(NodeObject *node, PyObject *names)
+{
+  Py_ssize_t i;
+
+  for (i = 0; i < Container_GET_COUNT(node); i++) {
+    NodeObject *child = Container_GET_CHILD(node, i);
+    if (Element_Check(child)) {
+      PyObject *namespaces, *elements;
+      namespaces = PyDict_GetItem(names, Element_LOCAL_NAME(child));
+      if (namespaces == NULL) {
+        namespaces = PyDict_New();
+        if (namespaces == NULL)
+          return -1;
+        if (PyDict_SetItem(names, Element_LOCAL_NAME(child), namespaces) < 0) {
+          Py_DECREF(namespaces);
+          return -1;
+        }
+        Py_DECREF(namespaces);
+      }
+      elements = PyDict_GetItem(namespaces, Element_NAMESPACE_URI(child));
+      if (elements == NULL) {
+        elements = PyList_New(0);
+        if (elements == NULL)
+          return -1;
+        if (PyDict_SetItem(namespaces, Element_NAMESPACE_URI(child),
+                           elements) < 0) {
+          Py_DECREF(elements);
+          return -1;
+        }
+        Py_DECREF(elements);
+      }
+      if (PyList_Append(elements, (PyObject *)child) < 0)
+        return -1;
+      /* Continue on with the children */
+      if (build_name_index(child, names) < 0)
+        return -1;
+    }
+  }
+  return 0;
+}
+
+/* Returns the index of the first element of `elements` whose document order
+ * key is greater than `key` */
+Py_LOCAL_INLINE(Py_ssize_t)
+bisect_elements(PyObject *elements, Py_ssize_t key)
+{
+  Py_ssize_t lo = 0, hi = PyList_GET_SIZE(elements), mid;
+
+  while (lo < hi) {
+    mid = (lo + hi) / 2;
+    if (Node_GET_DOCORDER(PyList_GET_ITEM(elements, mid)) <= key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
 }
 
 /** Public C API ******************************************************/
@@ -110,6 +168,118 @@ EntityObject *Entity_New(PyObject *documentURI)
   return self;
 }
 
+/* Records `element` as the owner of `elementId` unless an element earlier
+ * in document order already claimed it.  Used by the builder while the
+ * document is being constructed. */
+int Entity_AddId(EntityObject *self, PyObject *elementId,
+                 NodeObject *element)
+{
+  if (self->ids == NULL) {
+    /* the index has been invalidated; it is rebuilt on the next lookup */
+    return 0;
+  }
+  if (PyDict_GetItem(self->ids, elementId) != NULL)
+    return 0;
+  return PyDict_SetItem(self->ids, elementId, (PyObject *)element);
+}
+
+/* Discards the ID index of the entity containing `node` (if any). Called
+ * whenever the tree is modified in a way that might change the ID map. */
+void Entity_InvalidateIds(NodeObject *node)
+{
+  while (Node_GET_PARENT(node) != NULL)
+    node = Node_GET_PARENT(node);
+  if (Entity_Check(node))
+    Py_CLEAR(Entity(node)->ids);
+}
+
+/* Discards the element name index of the entity containing `node` (if any).
+ * Called whenever elements are added to, removed from or renamed in the
+ * tree. */
+void Entity_InvalidateNames(NodeObject *node)
+{
+  while (Node_GET_PARENT(node) != NULL)
+    node = Node_GET_PARENT(node);
+  if (Entity_Check(node)) {
+    Py_CLEAR(Entity(node)->names);
+    Entity(node)->name_searches = 0;
+  }
+}
+
+/* Returns the list of the elements named (`namespace`, `local`) in the
+ * entity containing `context`, in document order, and sets `start` and `end`
+ * to the range of those that are descendants of `context`.  The index
+ * behind it is built the second time an entity is searched, as a document
+ * only searched once is quicker to walk.  Until then, if `context` is not
+ * part of an entity or if its subtree is small enough to walk just as
+ * quickly, NULL is returned without an exception set.  Returns NULL with an
+ * exception set on error.
+ */
+PyObject *Entity_NamedDescendants(NodeObject *context, PyObject *namespace,
+                                  PyObject *local, Py_ssize_t *start,
+                                  Py_ssize_t *end)
+{
+  NodeObject *entity, *last;
+  PyObject *elements;
+
+  for (entity = context; Node_GET_PARENT(entity) != NULL;
+       entity = Node_GET_PARENT(entity));
+  if (!Entity_Check(entity))
+    return NULL;
+
+  if (Entity(entity)->names == NULL) {
+    if (++Entity(entity)->name_searches < 2)
+      return NULL;
+    Entity(entity)->names = PyDict_New();
+    if (Entity(entity)->names == NULL)
+      return NULL;
+    if (build_name_index(entity, Entity(entity)->names) < 0) {
+      Py_CLEAR(Entity(entity)->names);
+      return NULL;
+    }
+    /* the keys of a changed tree are stale */
+    if (!Node_ORDER_VALID(entity) && Node_NumberTree(entity) < 0) {
+      Py_CLEAR(Entity(entity)->names);
+      return NULL;
+    }
+  }
+
+  last = NULL;
+  if (context != entity) {
+    /* The tree is unchanged since the index was built (or it would have
+     * been discarded), so its keys stay in step with the index as long as
+     * they were all assigned in one pass. */
+    if (Node_GET_DOCORDER_STAMP(context) != Node_GET_DOCORDER_STAMP(entity)
+        && Node_NumberTree(entity) < 0)
+      return NULL;
+    /* the descendants of `context` are ordered after it and up to its last
+     * descendant */
+    for (last = context;
+         Container_Check(last) && Container_GET_COUNT(last) > 0;
+         last = Container_GET_CHILD(last, Container_GET_COUNT(last) - 1));
+    if (Node_GET_DOCORDER(last) - Node_GET_DOCORDER(context) <
+        NAME_INDEX_MIN_SUBTREE)
+      return NULL;
+  }
+
+  elements = PyDict_GetItem(Entity(entity)->names, local);
+  if (elements != NULL)
+    elements = PyDict_GetItem(elements, namespace);
+  if (elements == NULL) {
+    *start = *end = 0;
+    return PyList_New(0);
+  }
+  Py_INCREF(elements);
+  if (last == NULL) {
+    *start = 0;
+    *end = PyList_GET_SIZE(elements);
+  } else {
+    *start = bisect_elements(elements, Node_GET_DOCORDER(context));
+    *end = bisect_elements(elements, Node_GET_DOCORDER(last));
+  }
+  return elements;
+}
+
 /** Python Methods ****************************************************/
 
 static char entity_lookup_doc[] =
@@ -122,27 +292,42 @@ the entity is returned.";
 static PyObject *entity_lookup(PyObject *self, PyObject *args)
 {
   PyObject *idref, *element;
-  Py_ssize_t i;
+  NodeObject *node;
 
   if (!PyArg_ParseTuple(args, "O:xml_lookup", &idref))
     return NULL;
 
-  /* our "document" can have multiple element children */
-  for (i = 0; i < Container_GET_COUNT(self); i++) {
-    NodeObject *node = Container_GET_CHILD(self, i);
-    if (Element_Check(node)) {
-      element = get_element_by_id(node, idref);
-      if (element == NULL) 
-        return NULL;
-      else if (element != Py_None) {
-        Py_INCREF(element);
-        return element;
-      }
+  if (Entity(self)->ids != NULL) {
+    element = PyDict_GetItem(Entity(self)->ids, idref);
+    if (element == NULL) {
+      Py_RETURN_NONE;
+    }
+    /* Nodes detached while the document was still being built cannot be
+     * traced back to the entity; verify the element is still ours. */
+    for (node = Node(element); Node_GET_PARENT(node) != NULL;
+         node = Node_GET_PARENT(node));
+    if (node == Node(self)) {
+      Py_INCREF(element);
+      return element;
     }
+    Py_CLEAR(Entity(self)->ids);
   }
 
-  Py_INCREF(Py_None);
-  return Py_None;
+  /* (re)build the ID index; our "document" can have multiple element
+   * children */
+  Entity(self)->ids = PyDict_New();
+  if (Entity(self)->ids == NULL)
+    return NULL;
+  if (build_id_index(Node(self), Entity(self)->ids) < 0) {
+    Py_CLEAR(Entity(self)->ids);
+    return NULL;
+  }
+
+  element = PyDict_GetItem(Entity(self)->ids, idref);
+  if (element == NULL)
+    element = Py_None;
+  Py_INCREF(element);
+  return element;
 }
 
 static PyObject *entity_getnewargs(PyObject *self, PyObject *noarg)
@@ -265,11 +450,28 @@ static PyObject *entity_setstate(PyObject *self, PyObject *state)
   Py_RETURN_NONE;
 }
 
+static char entity_dump_doc[] =
+"xml_dump(file)\n\
+\n\
+Writes the entity as a snapshot to `file`, a file name or an object with a\n\
+`write` method.  A snapshot is reloaded with amara.tree.load() much faster\n\
+than the document can be parsed, but only on the same kind of platform.";
+
+static PyObject *entity_dump(PyObject *self, PyObject *args)
+{
+  PyObject *file;
+
+  if (!PyArg_ParseTuple(args, "O:xml_dump", &file))
+    return NULL;
+  return Snapshot_Dump(self, file);
+}
+
 #define Entity_METHOD(name) \
   { "xml_" #name, entity_##name, METH_VARARGS, entity_##name##_doc }
 
 static PyMethodDef entity_methods[] = {
   Entity_METHOD(lookup),
+  Entity_METHOD(dump),
   { "__getnewargs__", entity_getnewargs, METH_NOARGS,  "helper for pickle" },
   { "__getstate__",   entity_getstate,   METH_VARARGS, "helper for pickle" },
   { "__setstate__",   entity_setstate,   METH_O,       "helper for pickle" },
@@ -341,6 +543,8 @@ static void entity_dealloc(EntityObject *self)
   Py_CLEAR(self->systemId);
   Py_CLEAR(self->unparsed_entities);
   Py_CLEAR(self->creationIndex);
+  Py_CLEAR(self->ids);
+  Py_CLEAR(self->names);
   Node_Del(self);
 }
 
@@ -353,12 +557,16 @@ static PyObject *entity_repr(EntityObject *self)
 static int entity_traverse(EntityObject *self, visitproc visit, void *arg)
 {
   Py_VISIT(self->unparsed_entities);
+  Py_VISIT(self->ids);
+  Py_VISIT(self->names);
   return DomletteContainer_Type.tp_traverse((PyObject *)self, visit, arg);
 }
 
 static int entity_clear(EntityObject *self)
 {
   Py_CLEAR(self->unparsed_entities);
+  Py_CLEAR(self->ids);
+  Py_CLEAR(self->names);
   return DomletteContainer_Type.tp_clear((PyObject *)self);
 }
 
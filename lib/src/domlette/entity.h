@@ -15,6 +15,11 @@ extern "C" {
     PyObject *systemId;
     PyObject *unparsed_entities;
     PyObject *creationIndex;
+    PyObject *ids;              /* ID -> element, NULL if not yet built */
+    PyObject *names;            /* local -> {namespace -> [element]}, NULL if
+                                   not yet built */
+    int name_searches;          /* searches by name while not indexed */
+    Py_ssize_t namespace_stamp; /* see Element_InscopeBindings() */
   } EntityObject;
 
 #define Entity(op) ((EntityObject *)(op))
@@ -41,6 +46,13 @@ extern "C" {
 
   /* Entity Methods */
   EntityObject *Entity_New(PyObject *documentURI);
+  int Entity_AddId(EntityObject *self, PyObject *elementId,
+                   NodeObject *element);
+  void Entity_InvalidateIds(NodeObject *node);
+  void Entity_InvalidateNames(NodeObject *node);
+  PyObject *Entity_NamedDescendants(NodeObject *context, PyObject *namespace,
+                                    PyObject *local, Py_ssize_t *start,
+                                    Py_ssize_t *end);
 
 #endif /* Domlette_BUILDING_MODULE */
 
@@ -0,0 +1,1861 @@
+#define PY_SSIZE_T_CLEAN
+#include "domlette_interface.h"
+#include "expat_interface.h"
+#include "snapshot.h"
+
+#define INITIAL_NODES 256
+#define INITIAL_TEXT 4096
+
+static PyObject *xml_string;
+static PyObject *xml_namespace;
+static PyObject *empty_string;
+static PyObject *node_types[FROZEN_PROCESSING_INSTRUCTION + 1];
+static PyObject *kind_names[FROZEN_PROCESSING_INSTRUCTION + 1];
+
+/* imported on first use, as these modules depend on this one */
+static PyObject *select_function;
+static PyObject *write_function;
+static PyObject *encode_function;
+
+static PyTypeObject FrozenAxis_Type;
+
+/** Frozen Document ***************************************************/
+
+static FrozenDocumentObject *frozen_new(PyObject *documentURI)
+{
+  FrozenDocumentObject *self;
+
+  self = PyObject_New(FrozenDocumentObject, &DomletteFrozenDocument_Type);
+  if (self == NULL)
+    return NULL;
+  self->storage = NULL;
+  self->count = 0;
+  self->allocated = INITIAL_NODES;
+  self->kinds = PyMem_New(unsigned char, INITIAL_NODES);
+  self->parents = PyMem_New(int, INITIAL_NODES);
+  self->first_children = PyMem_New(int, INITIAL_NODES);
+  self->next_siblings = PyMem_New(int, INITIAL_NODES);
+  self->names = PyMem_New(int, INITIAL_NODES);
+  self->values = PyMem_New(Py_ssize_t, INITIAL_NODES + 1);
+  self->text_size = 0;
+  self->text_allocated = INITIAL_TEXT;
+  self->text = PyMem_New(char, INITIAL_TEXT);
+  self->names_table = PyList_New(0);
+  self->ids = NULL;
+  Py_INCREF(documentURI);
+  self->documentURI = documentURI;
+  Py_INCREF(Py_None);
+  self->publicId = Py_None;
+  Py_INCREF(Py_None);
+  self->systemId = Py_None;
+  if (self->kinds == NULL || self->parents == NULL ||
+      self->first_children == NULL || self->next_siblings == NULL ||
+      self->names == NULL || self->values == NULL || self->text == NULL) {
+    Py_DECREF(self);
+    PyErr_NoMemory();
+    return NULL;
+  }
+  if (self->names_table == NULL) {
+    Py_DECREF(self);
+    return NULL;
+  }
+  self->values[0] = 0;
+  return self;
+}
+
+static void frozen_dealloc(FrozenDocumentObject *self)
+{
+  if (self->storage) {
+    /* the arrays are part of the storage object */
+    Py_DECREF(self->storage);
+  } else {
+    PyMem_Free(self->kinds);
+    PyMem_Free(self->parents);
+    PyMem_Free(self->first_children);
+    PyMem_Free(self->next_siblings);
+    PyMem_Free(self->names);
+    PyMem_Free(self->values);
+    PyMem_Free(self->text);
+  }
+  Py_XDECREF(self->names_table);
+  Py_XDECREF(self->ids);
+  Py_XDECREF(self->documentURI);
+  Py_XDECREF(self->publicId);
+  Py_XDECREF(self->systemId);
+  PyObject_Del(self);
+}
+
+/* Sets the capacity of the node arrays to `size` nodes */
+static int frozen_resize(FrozenDocumentObject *self, Py_ssize_t size)
+{
+  unsigned char *kinds = self->kinds;
+  int *parents = self->parents;
+  int *first_children = self->first_children;
+  int *next_siblings = self->next_siblings;
+  int *names = self->names;
+  Py_ssize_t *values = self->values;
+
+  /* each array is updated as it is reallocated, so that a failure leaves
+   * the document consistent (if not fully resized) */
+  if (PyMem_Resize(kinds, unsigned char, size) == NULL)
+    return -1;
+  self->kinds = kinds;
+  if (PyMem_Resize(parents, int, size) == NULL)
+    return -1;
+  self->parents = parents;
+  if (PyMem_Resize(first_children, int, size) == NULL)
+    return -1;
+  self->first_children = first_children;
+  if (PyMem_Resize(next_siblings, int, size) == NULL)
+    return -1;
+  self->next_siblings = next_siblings;
+  if (PyMem_Resize(names, int, size) == NULL)
+    return -1;
+  self->names = names;
+  if (PyMem_Resize(values, Py_ssize_t, size + 1) == NULL)
+    return -1;
+  self->values = values;
+  self->allocated = size;
+  return 0;
+}
+
+/* Adds a node without a value, returning its index */
+static int frozen_add_node(FrozenDocumentObject *self, FrozenKind kind,
+                           int parent, int name)
+{
+  Py_ssize_t i = self->count;
+
+  if (i == self->allocated) {
+    if (i >= INT_MAX / 2) {
+      PyErr_SetString(PyExc_OverflowError, "too many nodes in document");
+      return FROZEN_NONE;
+    }
+    if (frozen_resize(self, i << 1) < 0) {
+      PyErr_NoMemory();
+      return FROZEN_NONE;
+    }
+  }
+  self->kinds[i] = (unsigned char)kind;
+  self->parents[i] = parent;
+  self->first_children[i] = FROZEN_NONE;
+  self->next_siblings[i] = FROZEN_NONE;
+  self->names[i] = name;
+  self->values[i + 1] = self->text_size;
+  self->count++;
+  return (int)i;
+}
+
+/* Appends `data` (encoded as UTF-8) to the value of the last node */
+static int frozen_append_value(FrozenDocumentObject *self, PyObject *data)
+{
+  Py_UNICODE *p = PyUnicode_AS_UNICODE(data);
+  Py_ssize_t i, size = PyUnicode_GET_SIZE(data);
+  Py_ssize_t needed;
+  unsigned char *out;
+
+  if (size > (PY_SSIZE_T_MAX - self->text_size) / 4)
+    goto nomemory;
+  needed = self->text_size + size * 4;
+  if (needed > self->text_allocated) {
+    Py_ssize_t allocated = self->text_allocated;
+    char *text = self->text;
+    while (allocated < needed) {
+      if (allocated > PY_SSIZE_T_MAX / 2) {
+        allocated = needed;
+        break;
+      }
+      allocated <<= 1;
+    }
+    if (PyMem_Resize(text, char, allocated) == NULL)
+      goto nomemory;
+    self->text = text;
+    self->text_allocated = allocated;
+  }
+
+  out = (unsigned char *)self->text + self->text_size;
+  for (i = 0; i < size; i++) {
+    Py_UCS4 ch = p[i];
+    if (ch < 0x80) {
+      *out++ = (unsigned char)ch;
+    } else if (ch < 0x800) {
+      *out++ = (unsigned char)(0xc0 | (ch >> 6));
+      *out++ = (unsigned char)(0x80 | (ch & 0x3f));
+    } else {
+#ifndef Py_UNICODE_WIDE
+      if (ch >= 0xd800 && ch <= 0xdbff && i + 1 < size &&
+          p[i + 1] >= 0xdc00 && p[i + 1] <= 0xdfff) {
+        ch = 0x10000 + (((ch & 0x3ff) << 10) | (p[++i] & 0x3ff));
+      }
+#endif
+      if (ch < 0x10000) {
+        *out++ = (unsigned char)(0xe0 | (ch >> 12));
+        *out++ = (unsigned char)(0x80 | ((ch >> 6) & 0x3f));
+        *out++ = (unsigned char)(0x80 | (ch & 0x3f));
+      } else {
+        *out++ = (unsigned char)(0xf0 | (ch >> 18));
+        *out++ = (unsigned char)(0x80 | ((ch >> 12) & 0x3f));
+        *out++ = (unsigned char)(0x80 | ((ch >> 6) & 0x3f));
+        *out++ = (unsigned char)(0x80 | (ch & 0x3f));
+      }
+    }
+  }
+  self->text_size = (char *)out - self->text;
+  self->values[self->count] = self->text_size;
+  return 0;
+
+ nomemory:
+  PyErr_NoMemory();
+  return -1;
+}
+
+/* Releases the room left for more nodes and text once the document is
+ * complete */
+static void frozen_trim(FrozenDocumentObject *self)
+{
+  char *text = self->text;
+
+  if (self->count < self->allocated && frozen_resize(self, self->count) < 0)
+    PyErr_Clear();
+  if (self->text_size < self->text_allocated &&
+      PyMem_Resize(text, char, self->text_size ? self->text_size : 1)) {
+    self->text = text;
+    self->text_allocated = self->text_size;
+  }
+}
+
+/* Returns the first index after the subtree rooted at node `i` */
+Py_LOCAL_INLINE(int)
+frozen_subtree_end(FrozenDocumentObject *self, int i)
+{
+  while (i != FROZEN_NONE) {
+    if (self->next_siblings[i] != FROZEN_NONE)
+      return self->next_siblings[i];
+    i = self->parents[i];
+  }
+  return (int)self->count;
+}
+
+PyObject *Frozen_GetValue(FrozenDocumentObject *self, int i)
+{
+  Py_ssize_t start = self->values[i];
+  Py_ssize_t size = self->values[i + 1] - start;
+
+  if (size == 0) {
+    Py_INCREF(empty_string);
+    return empty_string;
+  }
+  return PyUnicode_DecodeUTF8(self->text + start, size, NULL);
+}
+
+/* Returns the in-scope namespaces of node `i` as a dictionary of prefix
+ * to the index of the namespace node declaring it. */
+static PyObject *frozen_inscope(FrozenDocumentObject *self, int i)
+{
+  PyObject *namespaces, *index;
+  int j;
+
+  namespaces = PyDict_New();
+  if (namespaces == NULL)
+    return NULL;
+  for (; i != FROZEN_NONE; i = self->parents[i]) {
+    for (j = i + 1; j < self->count && self->parents[j] == i &&
+           self->kinds[j] == FROZEN_NAMESPACE; j++) {
+      PyObject *prefix = Frozen_GET_LOCAL_NAME(self, j);
+      if (PyDict_GetItem(namespaces, prefix))
+        continue;
+      index = PyInt_FromLong(j);
+      if (index == NULL || PyDict_SetItem(namespaces, prefix, index) < 0) {
+        Py_XDECREF(index);
+        Py_DECREF(namespaces);
+        return NULL;
+      }
+      Py_DECREF(index);
+    }
+  }
+  return namespaces;
+}
+
+PyObject *Frozen_InscopeNamespaces(FrozenDocumentObject *self, int i)
+{
+  PyObject *declared, *namespaces, *prefix, *index, *uri;
+  Py_ssize_t pos = 0;
+
+  declared = frozen_inscope(self, i);
+  if (declared == NULL)
+    return NULL;
+  namespaces = PyDict_New();
+  if (namespaces == NULL) {
+    Py_DECREF(declared);
+    return NULL;
+  }
+  while (PyDict_Next(declared, &pos, &prefix, &index)) {
+    int j = (int)PyInt_AS_LONG(index);
+    /* skip undeclared prefixes */
+    if (self->values[j] == self->values[j + 1])
+      continue;
+    uri = Frozen_GetValue(self, j);
+    if (uri == NULL || PyDict_SetItem(namespaces, prefix, uri) < 0) {
+      Py_XDECREF(uri);
+      Py_DECREF(namespaces);
+      namespaces = NULL;
+      break;
+    }
+    Py_DECREF(uri);
+  }
+  Py_DECREF(declared);
+  return namespaces;
+}
+
+PyTypeObject DomletteFrozenDocument_Type = {
+  /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
+  /* ob_size           */ 0,
+  /* tp_name           */ Domlette_MODULE_NAME "." "frozen_document",
+  /* tp_basicsize      */ sizeof(FrozenDocumentObject),
+  /* tp_itemsize       */ 0,
+  /* tp_dealloc        */ (destructor) frozen_dealloc,
+  /* tp_print          */ (printfunc) 0,
+  /* tp_getattr        */ (getattrfunc) 0,
+  /* tp_setattr        */ (setattrfunc) 0,
+  /* tp_compare        */ (cmpfunc) 0,
+  /* tp_repr           */ (reprfunc) 0,
+  /* tp_as_number      */ (PyNumberMethods *) 0,
+  /* tp_as_sequence    */ (PySequenceMethods *) 0,
+  /* tp_as_mapping     */ (PyMappingMethods *) 0,
+  /* tp_hash           */ (hashfunc) 0,
+  /* tp_call           */ (ternaryfunc) 0,
+  /* tp_str            */ (reprfunc) 0,
+  /* tp_getattro       */ (getattrofunc) 0,
+  /* tp_setattro       */ (setattrofunc) 0,
+  /* tp_as_buffer      */ (PyBufferProcs *) 0,
+  /* tp_flags          */ Py_TPFLAGS_DEFAULT,
+  /* tp_doc            */ (char *) 0,
+};
+
+/** Builder ***********************************************************/
+
+typedef struct {
+  ExpatReader *reader;
+  FrozenDocumentObject *document;
+  PyObject *name_ids;           /* name tuple -> index in the names table */
+  PyObject *new_namespaces;
+  /* the containers being built and the last child added to each */
+  int *open;
+  int *last_children;
+  Py_ssize_t depth;
+  Py_ssize_t open_allocated;
+} FrozenBuilder;
+
+/* Returns the index of the name (namespace, qname, local) */
+static int builder_name(FrozenBuilder *state, PyObject *namespace,
+                        PyObject *qname, PyObject *local)
+{
+  PyObject *key, *index;
+  Py_ssize_t i;
+
+  key = PyTuple_Pack(3, namespace, qname, local);
+  if (key == NULL)
+    return FROZEN_NONE;
+  index = PyDict_GetItem(state->name_ids, key);
+  if (index) {
+    Py_DECREF(key);
+    return (int)PyInt_AS_LONG(index);
+  }
+  i = PyList_GET_SIZE(state->document->names_table);
+  index = PyInt_FromSsize_t(i);
+  if (index == NULL ||
+      PyDict_SetItem(state->name_ids, key, index) < 0 ||
+      PyList_Append(state->document->names_table, key) < 0) {
+    Py_XDECREF(index);
+    Py_DECREF(key);
+    return FROZEN_NONE;
+  }
+  Py_DECREF(index);
+  Py_DECREF(key);
+  return (int)i;
+}
+
+/* Adds a node as the last child of the innermost open container */
+static int builder_add_child(FrozenBuilder *state, FrozenKind kind, int name)
+{
+  FrozenDocumentObject *document = state->document;
+  Py_ssize_t top = state->depth - 1;
+  int i, last;
+
+  i = frozen_add_node(document, kind, state->open[top], name);
+  if (i == FROZEN_NONE)
+    return FROZEN_NONE;
+  last = state->last_children[top];
+  if (last == FROZEN_NONE)
+    document->first_children[state->open[top]] = i;
+  else
+    document->next_siblings[last] = i;
+  state->last_children[top] = i;
+  return i;
+}
+
+/* Records the ID attribute `attr` unless an earlier one (in document order)
+ * already claimed `id` */
+static int builder_id(FrozenBuilder *state, PyObject *id, int attr)
+{
+  FrozenDocumentObject *document = state->document;
+  PyObject *index;
+  int result;
+
+  if (document->ids == NULL) {
+    document->ids = PyDict_New();
+    if (document->ids == NULL)
+      return -1;
+  } else if (PyDict_GetItem(document->ids, id)) {
+    return 0;
+  }
+  index = PyInt_FromLong(attr);
+  if (index == NULL)
+    return -1;
+  result = PyDict_SetItem(document->ids, id, index);
+  Py_DECREF(index);
+  return result;
+}
+
+static int builder_push(FrozenBuilder *state, int container)
+{
+  if (state->depth == state->open_allocated) {
+    Py_ssize_t allocated = state->open_allocated << 1;
+    int *open = state->open, *last_children = state->last_children;
+    if (PyMem_Resize(open, int, allocated) == NULL) {
+      PyErr_NoMemory();
+      return -1;
+    }
+    state->open = open;
+    if (PyMem_Resize(last_children, int, allocated) == NULL) {
+      PyErr_NoMemory();
+      return -1;
+    }
+    state->last_children = last_children;
+    state->open_allocated = allocated;
+  }
+  state->open[state->depth] = container;
+  state->last_children[state->depth] = FROZEN_NONE;
+  state->depth++;
+  return 0;
+}
+
+/* Adds a namespace node for `prefix` to the last node added */
+static int builder_namespace(FrozenBuilder *state, int parent,
+                             PyObject *prefix, PyObject *uri)
+{
+  int name = builder_name(state, Py_None, prefix, prefix);
+  if (name == FROZEN_NONE)
+    return -1;
+  if (frozen_add_node(state->document, FROZEN_NAMESPACE, parent,
+                      name) == FROZEN_NONE)
+    return -1;
+  return frozen_append_value(state->document, uri);
+}
+
+/* Adds an attribute node to `element` */
+static int builder_attribute(FrozenBuilder *state, int element,
+                             PyObject *namespace, PyObject *qname,
+                             PyObject *local, PyObject *value,
+                             AttributeType type)
+{
+  int i, name;
+
+  name = builder_name(state, namespace, qname, local);
+  if (name == FROZEN_NONE)
+    return -1;
+  i = frozen_add_node(state->document, FROZEN_ATTRIBUTE, element, name);
+  if (i == FROZEN_NONE)
+    return -1;
+  if (frozen_append_value(state->document, value) < 0)
+    return -1;
+  if (type == ATTRIBUTE_TYPE_ID && builder_id(state, value, i) < 0)
+    return -1;
+  return 0;
+}
+
+static int builder_init(FrozenBuilder *state)
+{
+  memset(state, 0, sizeof(FrozenBuilder));
+  state->name_ids = PyDict_New();
+  if (state->name_ids == NULL)
+    return -1;
+  state->new_namespaces = PyDict_New();
+  if (state->new_namespaces == NULL)
+    return -1;
+  state->open_allocated = 32;
+  state->open = PyMem_New(int, state->open_allocated);
+  state->last_children = PyMem_New(int, state->open_allocated);
+  if (state->open == NULL || state->last_children == NULL) {
+    PyErr_NoMemory();
+    return -1;
+  }
+  return 0;
+}
+
+static void builder_fini(FrozenBuilder *state)
+{
+  Py_XDECREF(state->document);
+  Py_XDECREF(state->name_ids);
+  Py_XDECREF(state->new_namespaces);
+  PyMem_Free(state->open);
+  PyMem_Free(state->last_children);
+}
+
+/* Creates the document and its entity node (node 0), which declares the
+ * `xml` prefix */
+static int builder_start(FrozenBuilder *state, PyObject *uri)
+{
+  state->document = frozen_new(uri);
+  if (state->document == NULL)
+    return -1;
+  if (frozen_add_node(state->document, FROZEN_ENTITY, FROZEN_NONE,
+                      FROZEN_NONE) == FROZEN_NONE)
+    return -1;
+  if (builder_namespace(state, 0, xml_string, xml_namespace) < 0)
+    return -1;
+  return builder_push(state, 0);
+}
+
+static ExpatStatus
+frozen_StartDocument(void *userState)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+  PyObject *uri;
+  int result;
+
+  uri = ExpatReader_GetBase(state->reader);
+  if (uri == NULL)
+    return EXPAT_STATUS_ERROR;
+  result = builder_start(state, uri);
+  Py_DECREF(uri);
+  return result < 0 ? EXPAT_STATUS_ERROR : EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_EndDocument(void *userState)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+
+  state->depth--;
+  frozen_trim(state->document);
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_NamespaceDecl(void *userState, PyObject *prefix, PyObject *uri)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+
+  if (uri == Py_None)
+    uri = empty_string;
+  if (PyDict_SetItem(state->new_namespaces, prefix, uri) < 0)
+    return EXPAT_STATUS_ERROR;
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_StartElement(void *userState, ExpatName *name,
+                    ExpatAttribute atts[], size_t natts)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+  PyObject *prefix, *uri;
+  Py_ssize_t pos;
+  size_t i;
+  int element, element_name;
+
+  element_name = builder_name(state, name->namespaceURI, name->qualifiedName,
+                              name->localName);
+  if (element_name == FROZEN_NONE)
+    return EXPAT_STATUS_ERROR;
+  element = builder_add_child(state, FROZEN_ELEMENT, element_name);
+  if (element == FROZEN_NONE)
+    return EXPAT_STATUS_ERROR;
+
+  if (((PyDictObject *)state->new_namespaces)->ma_used) {
+    pos = 0;
+    while (PyDict_Next(state->new_namespaces, &pos, &prefix, &uri)) {
+      if (builder_namespace(state, element, prefix, uri) < 0)
+        return EXPAT_STATUS_ERROR;
+    }
+    PyDict_Clear(state->new_namespaces);
+  }
+
+  for (i = 0; i < natts; i++) {
+    if (builder_attribute(state, element, atts[i].namespaceURI,
+                          atts[i].qualifiedName, atts[i].localName,
+                          atts[i].value, atts[i].type) < 0)
+      return EXPAT_STATUS_ERROR;
+  }
+
+  if (builder_push(state, element) < 0)
+    return EXPAT_STATUS_ERROR;
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_EndElement(void *userState, ExpatName *name)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+
+  state->depth--;
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_Characters(void *userState, PyObject *data)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+  FrozenDocumentObject *document = state->document;
+  int last = state->last_children[state->depth - 1];
+
+  /* adjacent text (e.g., around a CDATA section) forms a single node */
+  if (last != document->count - 1 ||
+      document->kinds[last] != FROZEN_TEXT) {
+    if (builder_add_child(state, FROZEN_TEXT, FROZEN_NONE) == FROZEN_NONE)
+      return EXPAT_STATUS_ERROR;
+  }
+  if (frozen_append_value(document, data) < 0)
+    return EXPAT_STATUS_ERROR;
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_ProcessingInstruction(void *userState, PyObject *target,
+                             PyObject *data)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+  int name;
+
+  name = builder_name(state, Py_None, target, target);
+  if (name == FROZEN_NONE)
+    return EXPAT_STATUS_ERROR;
+  if (builder_add_child(state, FROZEN_PROCESSING_INSTRUCTION,
+                        name) == FROZEN_NONE)
+    return EXPAT_STATUS_ERROR;
+  if (frozen_append_value(state->document, data) < 0)
+    return EXPAT_STATUS_ERROR;
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_Comment(void *userState, PyObject *data)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+
+  if (builder_add_child(state, FROZEN_COMMENT, FROZEN_NONE) == FROZEN_NONE)
+    return EXPAT_STATUS_ERROR;
+  if (frozen_append_value(state->document, data) < 0)
+    return EXPAT_STATUS_ERROR;
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatStatus
+frozen_DoctypeDecl(void *userState, PyObject *name, PyObject *systemId,
+                   PyObject *publicId)
+{
+  FrozenBuilder *state = (FrozenBuilder *)userState;
+
+  Py_DECREF(state->document->systemId);
+  Py_INCREF(systemId);
+  state->document->systemId = systemId;
+
+  Py_DECREF(state->document->publicId);
+  Py_INCREF(publicId);
+  state->document->publicId = publicId;
+  return EXPAT_STATUS_OK;
+}
+
+static ExpatHandlerFuncs frozen_handlers = {
+  /* start_document         */ frozen_StartDocument,
+  /* end_document           */ frozen_EndDocument,
+  /* start_element          */ frozen_StartElement,
+  /* end_element            */ frozen_EndElement,
+  /* attribute              */ NULL,
+  /* characters             */ frozen_Characters,
+  /* ignorable_whitespace   */ frozen_Characters,
+  /* processing_instruction */ frozen_ProcessingInstruction,
+  /* comment                */ frozen_Comment,
+  /* start_namespace_decl   */ frozen_NamespaceDecl,
+  /* end_namespace_decl     */ NULL,
+  /* start_doctype_decl     */ frozen_DoctypeDecl,
+};
+
+PyObject *Domlette_ParseFrozen(PyObject *self, PyObject *args, PyObject *kw)
+{
+  static char *kwlist[] = { "source", "flags", NULL };
+  PyObject *source, *result = NULL;
+  int flags = 1;  /* PARSE_FLAGS_EXTERNAL_ENTITIES */
+  FrozenBuilder state;
+  ExpatHandler *handler;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|i:parse_frozen", kwlist,
+                                   &source, &flags))
+    return NULL;
+
+  if (builder_init(&state) < 0)
+    goto finally;
+
+  handler = ExpatHandler_New(&state, &frozen_handlers);
+  if (handler == NULL)
+    goto finally;
+  /* the reader keeps a copy of the handler */
+  state.reader = ExpatReader_New(handler);
+  ExpatHandler_Del(handler);
+  if (state.reader == NULL)
+    goto finally;
+  /* same meaning as the flags of `parse` */
+  Expat_SetValidation(state.reader, flags == 2);
+  Expat_SetParamEntityParsing(state.reader, flags != 0);
+  if (ExpatReader_Parse(state.reader, source) == EXPAT_STATUS_OK) {
+    result = FrozenNode_New(state.document, 0, FROZEN_NONE);
+  }
+  ExpatReader_Del(state.reader);
+
+ finally:
+  builder_fini(&state);
+  return result;
+}
+
+/** Tree Conversion ***************************************************/
+
+/* Adds the element `node`, with its namespace declarations and attributes,
+ * as the last child of the innermost open container */
+static int builder_element(FrozenBuilder *state, ElementObject *node)
+{
+  NamespaceObject *namespace;
+  AttrObject *attr;
+  PyObject *uri;
+  Py_ssize_t pos;
+  int element, name;
+
+  name = builder_name(state, Element_NAMESPACE_URI(node), Element_QNAME(node),
+                      Element_LOCAL_NAME(node));
+  if (name == FROZEN_NONE)
+    return FROZEN_NONE;
+  element = builder_add_child(state, FROZEN_ELEMENT, name);
+  if (element == FROZEN_NONE)
+    return FROZEN_NONE;
+  if (Element_NAMESPACES(node)) {
+    pos = 0;
+    while ((namespace = NamespaceMap_Next(Element_NAMESPACES(node), &pos))) {
+      uri = Namespace_GET_VALUE(namespace);
+      if (uri == Py_None)
+        uri = empty_string;
+      if (builder_namespace(state, element, Namespace_GET_NAME(namespace),
+                            uri) < 0)
+        return FROZEN_NONE;
+    }
+  }
+  if (Element_ATTRIBUTES(node)) {
+    pos = 0;
+    while ((attr = AttributeMap_Next(Element_ATTRIBUTES(node), &pos))) {
+      if (builder_attribute(state, element, Attr_GET_NAMESPACE_URI(attr),
+                            Attr_GET_QNAME(attr), Attr_GET_LOCAL_NAME(attr),
+                            Attr_GET_VALUE(attr), Attr_GET_TYPE(attr)) < 0)
+        return FROZEN_NONE;
+    }
+  }
+  return element;
+}
+
+/* Returns a frozen copy of the tree `entity`.  The tree is walked without
+ * recursion, so that any document that could be parsed can be copied. */
+FrozenDocumentObject *Frozen_FromTree(EntityObject *entity)
+{
+  FrozenBuilder state;
+  FrozenDocumentObject *document = NULL;
+  NodeObject *container, *node;
+  Py_ssize_t *positions = NULL, allocated = 0, top;
+  PyObject *value;
+  int i, name;
+
+  if (builder_init(&state) < 0)
+    goto finally;
+  if (builder_start(&state, Entity_GET_DOCUMENT_URI(entity)) < 0)
+    goto finally;
+  Py_DECREF(state.document->publicId);
+  Py_INCREF(Entity_GET_PUBLIC_ID(entity));
+  state.document->publicId = Entity_GET_PUBLIC_ID(entity);
+  Py_DECREF(state.document->systemId);
+  Py_INCREF(Entity_GET_SYSTEM_ID(entity));
+  state.document->systemId = Entity_GET_SYSTEM_ID(entity);
+
+  /* `positions` holds the next child to visit of each open container */
+  allocated = state.open_allocated;
+  positions = PyMem_New(Py_ssize_t, allocated);
+  if (positions == NULL) {
+    PyErr_NoMemory();
+    goto finally;
+  }
+  positions[0] = 0;
+  container = (NodeObject *)entity;
+  while (state.depth > 0) {
+    top = state.depth - 1;
+    if (positions[top] == Container_GET_COUNT(container)) {
+      state.depth--;
+      container = Node_GET_PARENT(container);
+      continue;
+    }
+    node = Container_GET_CHILD(container, positions[top]++);
+    if (Element_Check(node)) {
+      int element = builder_element(&state, Element(node));
+      if (element == FROZEN_NONE || builder_push(&state, element) < 0)
+        goto finally;
+      if (state.open_allocated > allocated) {
+        allocated = state.open_allocated;
+        if (PyMem_Resize(positions, Py_ssize_t, allocated) == NULL) {
+          PyErr_NoMemory();
+          goto finally;
+        }
+      }
+      positions[state.depth - 1] = 0;
+      container = node;
+      continue;
+    } else if (Text_Check(node)) {
+      i = builder_add_child(&state, FROZEN_TEXT, FROZEN_NONE);
+      value = Text_GET_VALUE(node);
+    } else if (Comment_Check(node)) {
+      i = builder_add_child(&state, FROZEN_COMMENT, FROZEN_NONE);
+      value = Comment_GET_VALUE(node);
+    } else if (ProcessingInstruction_Check(node)) {
+      value = ProcessingInstruction_GET_TARGET(node);
+      name = builder_name(&state, Py_None, value, value);
+      i = FROZEN_NONE;
+      if (name != FROZEN_NONE)
+        i = builder_add_child(&state, FROZEN_PROCESSING_INSTRUCTION, name);
+      value = ProcessingInstruction_GET_DATA(node);
+    } else {
+      PyErr_Format(PyExc_TypeError, "cannot freeze %s node",
+                   node->ob_type->tp_name);
+      goto finally;
+    }
+    if (i == FROZEN_NONE || frozen_append_value(state.document, value) < 0)
+      goto finally;
+  }
+  frozen_trim(state.document);
+  document = state.document;
+  state.document = NULL;
+
+ finally:
+  PyMem_Free(positions);
+  builder_fini(&state);
+  return document;
+}
+
+/* Gives `container` its own copy of the children appended to it */
+static int thaw_close(NodeObject *container)
+{
+  NodeObject **working;
+  Py_ssize_t allocated;
+  int result;
+
+  if (Container_GET_NODES(container) == NULL)
+    return 0;
+  working = _Container_GetWorkingChildren(container, &allocated);
+  result = _Container_FreezeChildren(container);
+  /* the working array is only still in use if it could not be copied */
+  if (result != -2)
+    PyMem_Free(working);
+  return result < 0 ? -1 : 0;
+}
+
+/* Returns a Domlette tree equivalent to `document`.  The rows are in
+ * document order, so the tree is built in a single pass with the open
+ * elements on a stack. */
+EntityObject *Frozen_ToTree(FrozenDocumentObject *document)
+{
+  EntityObject *entity;
+  NodeObject **open, *node;
+  int *indexes;
+  Py_ssize_t depth = 0, allocated = 32;
+  PyObject *value, *id;
+  int i, parent;
+
+  entity = Entity_New(document->documentURI);
+  if (entity == NULL)
+    return NULL;
+  Py_DECREF(Entity_GET_PUBLIC_ID(entity));
+  Py_INCREF(document->publicId);
+  Entity_SET_PUBLIC_ID(entity, document->publicId);
+  Py_DECREF(Entity_GET_SYSTEM_ID(entity));
+  Py_INCREF(document->systemId);
+  Entity_SET_SYSTEM_ID(entity, document->systemId);
+
+  open = PyMem_New(NodeObject *, allocated);
+  indexes = PyMem_New(int, allocated);
+  if (open == NULL || indexes == NULL) {
+    PyErr_NoMemory();
+    goto error;
+  }
+  open[0] = (NodeObject *)entity;
+  indexes[0] = 0;
+  depth = 1;
+
+  for (i = 1; i < document->count; i++) {
+    parent = document->parents[i];
+    while (indexes[depth - 1] != parent) {
+      if (thaw_close(open[--depth]) < 0)
+        goto error;
+    }
+    if (document->kinds[i] == FROZEN_NAMESPACE) {
+      NamespaceObject *namespace;
+      /* the `xml` prefix is implicit in a tree */
+      if (parent == 0)
+        continue;
+      value = Frozen_GetValue(document, i);
+      if (value == NULL)
+        goto error;
+      namespace = Element_AddNamespace(Element(open[depth - 1]),
+                                       Frozen_GET_QNAME(document, i), value);
+      Py_DECREF(value);
+      if (namespace == NULL)
+        goto error;
+      Py_DECREF(namespace);
+      continue;
+    }
+    if (document->kinds[i] == FROZEN_ATTRIBUTE) {
+      AttrObject *attr;
+      value = Frozen_GetValue(document, i);
+      if (value == NULL)
+        goto error;
+      attr = Element_AddAttribute(Element(open[depth - 1]),
+                                  Frozen_GET_NAMESPACE_URI(document, i),
+                                  Frozen_GET_QNAME(document, i),
+                                  Frozen_GET_LOCAL_NAME(document, i), value);
+      if (attr == NULL) {
+        Py_DECREF(value);
+        goto error;
+      }
+      /* only the attribute the document's ID maps to is known to be one */
+      if (document->ids && (id = PyDict_GetItem(document->ids, value)) &&
+          PyInt_AS_LONG(id) == i)
+        Attr_SET_TYPE(attr, ATTRIBUTE_TYPE_ID);
+      Py_DECREF(value);
+      Py_DECREF(attr);
+      continue;
+    }
+
+    switch (document->kinds[i]) {
+      case FROZEN_ELEMENT:
+        node = (NodeObject *)Element_New(Frozen_GET_NAMESPACE_URI(document, i),
+                                         Frozen_GET_QNAME(document, i),
+                                         Frozen_GET_LOCAL_NAME(document, i));
+        break;
+      case FROZEN_PROCESSING_INSTRUCTION:
+        value = Frozen_GetValue(document, i);
+        if (value == NULL)
+          goto error;
+        node = (NodeObject *)
+          ProcessingInstruction_New(Frozen_GET_QNAME(document, i), value);
+        Py_DECREF(value);
+        break;
+      default:
+        value = Frozen_GetValue(document, i);
+        if (value == NULL)
+          goto error;
+        if (document->kinds[i] == FROZEN_TEXT)
+          node = (NodeObject *)Text_New(value);
+        else
+          node = (NodeObject *)Comment_New(value);
+        Py_DECREF(value);
+        break;
+    }
+    if (node == NULL)
+      goto error;
+    /* steals the reference to `node` */
+    if (_Container_FastAppend(open[depth - 1], node) < 0) {
+      Py_DECREF(node);
+      goto error;
+    }
+    if (document->kinds[i] == FROZEN_ELEMENT) {
+      if (depth == allocated) {
+        NodeObject **new_open = open;
+        int *new_indexes = indexes;
+        allocated <<= 1;
+        if (PyMem_Resize(new_open, NodeObject *, allocated) == NULL) {
+          PyErr_NoMemory();
+          goto error;
+        }
+        open = new_open;
+        if (PyMem_Resize(new_indexes, int, allocated) == NULL) {
+          PyErr_NoMemory();
+          goto error;
+        }
+        indexes = new_indexes;
+      }
+      open[depth] = node;
+      indexes[depth] = i;
+      depth++;
+    }
+  }
+  while (depth > 0) {
+    if (thaw_close(open[--depth]) < 0)
+      goto error;
+  }
+  PyMem_Free(open);
+  PyMem_Free(indexes);
+  return entity;
+
+ error:
+  while (depth > 0)
+    thaw_close(open[--depth]);
+  PyMem_Free(open);
+  PyMem_Free(indexes);
+  Py_DECREF(entity);
+  return NULL;
+}
+
+/** Frozen Nodes ******************************************************/
+
+PyObject *FrozenNode_New(FrozenDocumentObject *document, int index,
+                         int owner)
+{
+  FrozenNodeObject *self;
+
+  self = PyObject_New(FrozenNodeObject, &DomletteFrozenNode_Type);
+  if (self) {
+    Py_INCREF(document);
+    self->document = document;
+    self->index = index;
+    self->owner = owner;
+  }
+  return (PyObject *)self;
+}
+
+/* Returns node `i` (or None), with its parent as the owner */
+Py_LOCAL_INLINE(PyObject *)
+frozen_node(FrozenDocumentObject *document, int i)
+{
+  if (i == FROZEN_NONE) {
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  return FrozenNode_New(document, i, document->parents[i]);
+}
+
+PyObject *FrozenNode_StringValue(FrozenNodeObject *self)
+{
+  FrozenDocumentObject *document = self->document;
+  PyObject *result;
+  Py_ssize_t size;
+  char *buffer, *p;
+  int i, end, found;
+
+  switch (Frozen_GET_KIND(document, self->index)) {
+  case FROZEN_ENTITY:
+  case FROZEN_ELEMENT:
+    /* The concatenation of all text descendants in document order */
+    end = frozen_subtree_end(document, self->index);
+    size = 0;
+    found = FROZEN_NONE;
+    for (i = self->index + 1; i < end; i++) {
+      if (document->kinds[i] == FROZEN_TEXT) {
+        size += document->values[i + 1] - document->values[i];
+        found = (found == FROZEN_NONE) ? i : end;
+      }
+    }
+    if (found == FROZEN_NONE) {
+      Py_INCREF(empty_string);
+      return empty_string;
+    }
+    if (found != end)
+      return Frozen_GetValue(document, found);
+    buffer = p = PyMem_Malloc(size);
+    if (buffer == NULL)
+      return PyErr_NoMemory();
+    for (i = self->index + 1; i < end; i++) {
+      if (document->kinds[i] == FROZEN_TEXT) {
+        Py_ssize_t n = document->values[i + 1] - document->values[i];
+        memcpy(p, document->text + document->values[i], n);
+        p += n;
+      }
+    }
+    result = PyUnicode_DecodeUTF8(buffer, size, NULL);
+    PyMem_Free(buffer);
+    return result;
+  default:
+    return Frozen_GetValue(document, self->index);
+  }
+}
+
+static void frozennode_dealloc(FrozenNodeObject *self)
+{
+  Py_DECREF(self->document);
+  PyObject_Del(self);
+}
+
+/* Nodes are ordered by (position, offset): a namespace node follows the
+ * element it belongs to (in index order among the namespace nodes) and
+ * precedes the attributes of that element. */
+Py_LOCAL_INLINE(void)
+frozennode_order(FrozenNodeObject *node, int *position, int *offset)
+{
+  if (FrozenNode_GET_KIND(node) == FROZEN_NAMESPACE) {
+    *position = node->owner;
+    *offset = node->index + 1;
+  } else {
+    *position = node->index;
+    *offset = 0;
+  }
+}
+
+static PyObject *frozennode_richcompare(PyObject *a, PyObject *b, int op)
+{
+  int position_a, offset_a, position_b, offset_b;
+  Py_ssize_t cmp;
+  int result;
+
+  if (!FrozenNode_Check(a) || !FrozenNode_Check(b)) {
+    Py_INCREF(Py_NotImplemented);
+    return Py_NotImplemented;
+  }
+  if (FrozenNode(a)->document != FrozenNode(b)->document) {
+    /* nodes of different documents are ordered consistently */
+    cmp = (char *)FrozenNode(a)->document - (char *)FrozenNode(b)->document;
+  } else {
+    frozennode_order(FrozenNode(a), &position_a, &offset_a);
+    frozennode_order(FrozenNode(b), &position_b, &offset_b);
+    cmp = position_a - position_b;
+    if (cmp == 0)
+      cmp = offset_a - offset_b;
+  }
+  switch (op) {
+  case Py_LT: result = cmp < 0; break;
+  case Py_LE: result = cmp <= 0; break;
+  case Py_EQ: result = cmp == 0; break;
+  case Py_NE: result = cmp != 0; break;
+  case Py_GT: result = cmp > 0; break;
+  case Py_GE: result = cmp >= 0; break;
+  default:
+    Py_INCREF(Py_NotImplemented);
+    return Py_NotImplemented;
+  }
+  return PyBool_FromLong(result);
+}
+
+static long frozennode_hash(FrozenNodeObject *self)
+{
+  int position, offset;
+  long hash;
+
+  frozennode_order(self, &position, &offset);
+  hash = _Py_HashPointer(self->document);
+  hash ^= (long)position * 1000003L + offset;
+  return hash == -1 ? -2 : hash;
+}
+
+static PyObject *frozennode_repr(FrozenNodeObject *self)
+{
+  return PyString_FromFormat("<%s at %p: %s node %d>",
+                             self->ob_type->tp_name, self,
+                             PyString_AS_STRING(
+                               kind_names[FrozenNode_GET_KIND(self)]),
+                             self->index);
+}
+
+static PyObject *frozennode_iter(FrozenNodeObject *self)
+{
+  switch (FrozenNode_GET_KIND(self)) {
+  case FROZEN_ENTITY:
+  case FROZEN_ELEMENT:
+    return FrozenNode_Axis(self, FROZEN_AXIS_CHILD);
+  default:
+    PyErr_Format(PyExc_TypeError, "'%s' node is not iterable",
+                 PyString_AS_STRING(kind_names[FrozenNode_GET_KIND(self)]));
+    return NULL;
+  }
+}
+
+/* The kinds of node that have a given attribute */
+#define CONTAINER_KINDS ((1 << FROZEN_ENTITY) | (1 << FROZEN_ELEMENT))
+#define NAMED_KINDS ((1 << FROZEN_ELEMENT) | (1 << FROZEN_ATTRIBUTE))
+#define CHILD_KINDS ((1 << FROZEN_ELEMENT) | (1 << FROZEN_TEXT) | \
+                     (1 << FROZEN_COMMENT) | \
+                     (1 << FROZEN_PROCESSING_INSTRUCTION))
+#define VALUE_KINDS ((1 << FROZEN_ATTRIBUTE) | (1 << FROZEN_TEXT) | \
+                     (1 << FROZEN_COMMENT) | (1 << FROZEN_NAMESPACE))
+
+/* Sets AttributeError unless `self` is of one of the `kinds` */
+Py_LOCAL_INLINE(int)
+check_kind(FrozenNodeObject *self, int kinds, const char *name)
+{
+  int kind = FrozenNode_GET_KIND(self);
+  if (kinds & (1 << kind))
+    return 1;
+  PyErr_Format(PyExc_AttributeError, "'%s' node has no attribute '%s'",
+               PyString_AS_STRING(kind_names[kind]), name);
+  return 0;
+}
+
+/** Python Methods ****************************************************/
+
+static char xml_select_doc[] = "xml_select(expr[, prefixes]) -> object\n\n\
+Evaluates the XPath expression `expr` using this node as context.";
+
+static PyObject *frozennode_xml_select(PyObject *self, PyObject *args,
+                                       PyObject *kw)
+{
+  PyObject *expr, *prefixes = Py_None;
+  static char *kwlist[] = { "expr", "prefixes", NULL };
+
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|O:xml_select", kwlist,
+                                   &expr, &prefixes))
+    return NULL;
+  if (select_function == NULL) {
+    PyObject *module = PyImport_ImportModule("amara.xpath.util");
+    if (module == NULL)
+      return NULL;
+    select_function = PyObject_GetAttrString(module, "simple_evaluate");
+    Py_DECREF(module);
+    if (select_function == NULL)
+      return NULL;
+  }
+  return PyObject_CallFunctionObjArgs(select_function, expr, self, prefixes,
+                                      NULL);
+}
+
+/* Calls the function `name` of amara.writers with `self` prepended to the
+ * arguments */
+static PyObject *call_writer(PyObject **pfunc, char *name, PyObject *self,
+                             PyObject *args, PyObject *kw)
+{
+  PyObject *new_args, *result;
+  Py_ssize_t i;
+
+  if (*pfunc == NULL) {
+    PyObject *module = PyImport_ImportModule("amara.writers");
+    if (module == NULL)
+      return NULL;
+    *pfunc = PyObject_GetAttrString(module, name);
+    Py_DECREF(module);
+    if (*pfunc == NULL)
+      return NULL;
+  }
+  new_args = PyTuple_New(1 + PyTuple_GET_SIZE(args));
+  if (new_args == NULL)
+    return NULL;
+  Py_INCREF(self);
+  PyTuple_SET_ITEM(new_args, 0, self);
+  for (i = 0; i < PyTuple_GET_SIZE(args); i++) {
+    PyObject *item = PyTuple_GET_ITEM(args, i);
+    Py_INCREF(item);
+    PyTuple_SET_ITEM(new_args, i + 1, item);
+  }
+  result = PyObject_Call(*pfunc, new_args, kw);
+  Py_DECREF(new_args);
+  return result;
+}
+
+static char xml_write_doc[] = "xml_write()\n\n"
+"serialize node to a stream";
+
+static PyObject *frozennode_xml_write(PyObject *self, PyObject *args,
+                                      PyObject *kw)
+{
+  return call_writer(&write_function, "_xml_write", self, args, kw);
+}
+
+static char xml_encode_doc[] = "xml_encode()\n\n"
+"serialize node to a string";
+
+static PyObject *frozennode_xml_encode(PyObject *self, PyObject *args,
+                                       PyObject *kw)
+{
+  return call_writer(&encode_function, "_xml_encode", self, args, kw);
+}
+
+static char xml_lookup_doc[] =
+"xml_lookup(idref) -> frozen_node\n\
+\n\
+Returns the element whose ID is given by `idref`. If no such element\n\
+exists, returns None. If more than one element has this ID, the first in\n\
+the document is returned.";
+
+static PyObject *frozennode_xml_lookup(PyObject *self, PyObject *args)
+{
+  FrozenDocumentObject *document = FrozenNode_GET_DOCUMENT(self);
+  PyObject *idref, *index = NULL;
+
+  if (!PyArg_ParseTuple(args, "O:xml_lookup", &idref))
+    return NULL;
+  if (!check_kind(FrozenNode(self), 1 << FROZEN_ENTITY, "xml_lookup"))
+    return NULL;
+  if (document->ids)
+    index = PyDict_GetItem(document->ids, idref);
+  if (index == NULL) {
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  /* `ids` maps to the ID attribute */
+  return frozen_node(document,
+                     Frozen_GET_PARENT(document, (int)PyInt_AS_LONG(index)));
+}
+
+static char xml_dump_doc[] = "xml_dump(file)\n\n\
+Writes the document as a snapshot to `file`, a file name or an object with\n\
+a `write` method (see amara.tree.load).";
+
+static PyObject *frozennode_xml_dump(PyObject *self, PyObject *args)
+{
+  PyObject *file;
+
+  if (!PyArg_ParseTuple(args, "O:xml_dump", &file))
+    return NULL;
+  if (!check_kind(FrozenNode(self), 1 << FROZEN_ENTITY, "xml_dump"))
+    return NULL;
+  return Snapshot_Dump(self, file);
+}
+
+#define PyMethod_INIT(NAME, FLAGS) \
+  { #NAME, (PyCFunction)frozennode_##NAME, FLAGS, NAME##_doc }
+
+static PyMethodDef frozennode_methods[] = {
+  PyMethod_INIT(xml_lookup, METH_VARARGS),
+  PyMethod_INIT(xml_dump,   METH_VARARGS),
+  PyMethod_INIT(xml_select, METH_KEYWORDS),
+  PyMethod_INIT(xml_write,  METH_VARARGS|METH_KEYWORDS),
+  PyMethod_INIT(xml_encode, METH_VARARGS|METH_KEYWORDS),
+  { NULL }
+};
+
+/** Python Computed Members *******************************************/
+
+#define RETURN_BORROWED(value) \
+  do { PyObject *_v = (value); Py_INCREF(_v); return _v; } while (0)
+
+static PyObject *get_type(FrozenNodeObject *self, void *arg)
+{
+  RETURN_BORROWED(node_types[FrozenNode_GET_KIND(self)]);
+}
+
+static PyObject *get_parent(FrozenNodeObject *self, void *arg)
+{
+  if (self->owner == FROZEN_NONE) {
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  return frozen_node(self->document, self->owner);
+}
+
+static PyObject *get_root(FrozenNodeObject *self, void *arg)
+{
+  return FrozenNode_New(self->document, 0, FROZEN_NONE);
+}
+
+static PyObject *get_children(FrozenNodeObject *self, void *arg)
+{
+  PyObject *iter, *result;
+
+  if (!check_kind(self, CONTAINER_KINDS, "xml_children"))
+    return NULL;
+  iter = FrozenNode_Axis(self, FROZEN_AXIS_CHILD);
+  if (iter == NULL)
+    return NULL;
+  result = PySequence_Tuple(iter);
+  Py_DECREF(iter);
+  return result;
+}
+
+static PyObject *get_first_child(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, CONTAINER_KINDS, "xml_first_child"))
+    return NULL;
+  return frozen_node(self->document,
+                     self->document->first_children[self->index]);
+}
+
+static PyObject *get_last_child(FrozenNodeObject *self, void *arg)
+{
+  FrozenDocumentObject *document = self->document;
+  int i, last = FROZEN_NONE;
+
+  if (!check_kind(self, CONTAINER_KINDS, "xml_last_child"))
+    return NULL;
+  for (i = document->first_children[self->index]; i != FROZEN_NONE;
+       i = document->next_siblings[i])
+    last = i;
+  return frozen_node(document, last);
+}
+
+static PyObject *get_following_sibling(FrozenNodeObject *self, void *arg)
+{
+  if (!(CHILD_KINDS & (1 << FrozenNode_GET_KIND(self)))) {
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  return frozen_node(self->document,
+                     self->document->next_siblings[self->index]);
+}
+
+static PyObject *get_preceding_sibling(FrozenNodeObject *self, void *arg)
+{
+  FrozenDocumentObject *document = self->document;
+  int i, previous = FROZEN_NONE;
+
+  if (!(CHILD_KINDS & (1 << FrozenNode_GET_KIND(self)))) {
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  for (i = document->first_children[self->owner]; i != self->index;
+       i = document->next_siblings[i])
+    previous = i;
+  return frozen_node(document, previous);
+}
+
+static PyObject *get_namespace(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, NAMED_KINDS, "xml_namespace"))
+    return NULL;
+  RETURN_BORROWED(Frozen_GET_NAMESPACE_URI(self->document, self->index));
+}
+
+static PyObject *get_qname(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, NAMED_KINDS, "xml_qname"))
+    return NULL;
+  RETURN_BORROWED(Frozen_GET_QNAME(self->document, self->index));
+}
+
+static PyObject *get_local(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, NAMED_KINDS, "xml_local"))
+    return NULL;
+  RETURN_BORROWED(Frozen_GET_LOCAL_NAME(self->document, self->index));
+}
+
+static PyObject *get_prefix(FrozenNodeObject *self, void *arg)
+{
+  PyObject *qname;
+  Py_UNICODE *p;
+  Py_ssize_t i, size;
+
+  if (!check_kind(self, NAMED_KINDS, "xml_prefix"))
+    return NULL;
+  qname = Frozen_GET_QNAME(self->document, self->index);
+  p = PyUnicode_AS_UNICODE(qname);
+  size = PyUnicode_GET_SIZE(qname);
+  for (i = 0; i < size; i++) {
+    if (p[i] == ':')
+      return PyUnicode_FromUnicode(p, i);
+  }
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+static PyObject *get_name(FrozenNodeObject *self, void *arg)
+{
+  FrozenDocumentObject *document = self->document;
+
+  switch (FrozenNode_GET_KIND(self)) {
+  case FROZEN_ELEMENT:
+  case FROZEN_ATTRIBUTE:
+    return PyTuple_Pack(2, Frozen_GET_NAMESPACE_URI(document, self->index),
+                        Frozen_GET_LOCAL_NAME(document, self->index));
+  case FROZEN_NAMESPACE:
+    RETURN_BORROWED(Frozen_GET_LOCAL_NAME(document, self->index));
+  default:
+    check_kind(self, 0, "xml_name");
+    return NULL;
+  }
+}
+
+static PyObject *get_value(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, VALUE_KINDS, "xml_value"))
+    return NULL;
+  return Frozen_GetValue(self->document, self->index);
+}
+
+static PyObject *get_target(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, 1 << FROZEN_PROCESSING_INSTRUCTION, "xml_target"))
+    return NULL;
+  RETURN_BORROWED(Frozen_GET_LOCAL_NAME(self->document, self->index));
+}
+
+static PyObject *get_data(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, 1 << FROZEN_PROCESSING_INSTRUCTION, "xml_data"))
+    return NULL;
+  return Frozen_GetValue(self->document, self->index);
+}
+
+static PyObject *get_attributes(FrozenNodeObject *self, void *arg)
+{
+  FrozenDocumentObject *document = self->document;
+  PyObject *attributes, *key, *value;
+  int i;
+
+  if (!check_kind(self, 1 << FROZEN_ELEMENT, "xml_attributes"))
+    return NULL;
+  attributes = PyDict_New();
+  if (attributes == NULL)
+    return NULL;
+  for (i = self->index + 1; i < document->count &&
+         document->parents[i] == self->index; i++) {
+    if (document->kinds[i] == FROZEN_NAMESPACE)
+      continue;
+    if (document->kinds[i] != FROZEN_ATTRIBUTE)
+      break;
+    key = PyTuple_Pack(2, Frozen_GET_NAMESPACE_URI(document, i),
+                       Frozen_GET_LOCAL_NAME(document, i));
+    if (key == NULL)
+      goto error;
+    value = Frozen_GetValue(document, i);
+    if (value == NULL || PyDict_SetItem(attributes, key, value) < 0) {
+      Py_XDECREF(value);
+      Py_DECREF(key);
+      goto error;
+    }
+    Py_DECREF(value);
+    Py_DECREF(key);
+  }
+  return attributes;
+
+ error:
+  Py_DECREF(attributes);
+  return NULL;
+}
+
+static PyObject *get_namespaces(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, 1 << FROZEN_ELEMENT, "xml_namespaces"))
+    return NULL;
+  return Frozen_InscopeNamespaces(self->document, self->index);
+}
+
+static PyObject *get_base(FrozenNodeObject *self, void *arg)
+{
+  RETURN_BORROWED(self->document->documentURI);
+}
+
+static PyObject *get_system_id(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, 1 << FROZEN_ENTITY, "xml_system_id"))
+    return NULL;
+  RETURN_BORROWED(self->document->systemId);
+}
+
+static PyObject *get_public_id(FrozenNodeObject *self, void *arg)
+{
+  if (!check_kind(self, 1 << FROZEN_ENTITY, "xml_public_id"))
+    return NULL;
+  RETURN_BORROWED(self->document->publicId);
+}
+
+static PyGetSetDef frozennode_getset[] = {
+  { "xml_type",              (getter)get_type },
+  { "xml_parent",            (getter)get_parent },
+  { "xml_root",              (getter)get_root },
+  { "xml_base",              (getter)get_base },
+  { "xml_children",          (getter)get_children },
+  { "xml_first_child",       (getter)get_first_child },
+  { "xml_last_child",        (getter)get_last_child },
+  { "xml_following_sibling", (getter)get_following_sibling },
+  { "xml_preceding_sibling", (getter)get_preceding_sibling },
+  { "xml_namespace",         (getter)get_namespace },
+  { "xml_qname",             (getter)get_qname },
+  { "xml_local",             (getter)get_local },
+  { "xml_prefix",            (getter)get_prefix },
+  { "xml_name",              (getter)get_name },
+  { "xml_value",             (getter)get_value },
+  { "xml_target",            (getter)get_target },
+  { "xml_data",              (getter)get_data },
+  { "xml_attributes",        (getter)get_attributes },
+  { "xml_namespaces",        (getter)get_namespaces },
+  { "xml_system_id",         (getter)get_system_id },
+  { "xml_public_id",         (getter)get_public_id },
+  { NULL }
+};
+
+static char frozennode_doc[] = "\
+A node of a read-only document, as returned by parse(..., readonly=True).\n\
+\n\
+The document is stored compactly and the node objects are created as the\n\
+nodes are visited, so the same node may be represented by different\n\
+(equal) objects.";
+
+PyTypeObject DomletteFrozenNode_Type = {
+  /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
+  /* ob_size           */ 0,
+  /* tp_name           */ Domlette_MODULE_NAME "." "frozen_node",
+  /* tp_basicsize      */ sizeof(FrozenNodeObject),
+  /* tp_itemsize       */ 0,
+  /* tp_dealloc        */ (destructor) frozennode_dealloc,
+  /* tp_print          */ (printfunc) 0,
+  /* tp_getattr        */ (getattrfunc) 0,
+  /* tp_setattr        */ (setattrfunc) 0,
+  /* tp_compare        */ (cmpfunc) 0,
+  /* tp_repr           */ (reprfunc) frozennode_repr,
+  /* tp_as_number      */ (PyNumberMethods *) 0,
+  /* tp_as_sequence    */ (PySequenceMethods *) 0,
+  /* tp_as_mapping     */ (PyMappingMethods *) 0,
+  /* tp_hash           */ (hashfunc) frozennode_hash,
+  /* tp_call           */ (ternaryfunc) 0,
+  /* tp_str            */ (reprfunc) 0,
+  /* tp_getattro       */ (getattrofunc) 0,
+  /* tp_setattro       */ (setattrofunc) 0,
+  /* tp_as_buffer      */ (PyBufferProcs *) 0,
+  /* tp_flags          */ (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_RICHCOMPARE),
+  /* tp_doc            */ (char *) frozennode_doc,
+  /* tp_traverse       */ (traverseproc) 0,
+  /* tp_clear          */ (inquiry) 0,
+  /* tp_richcompare    */ (richcmpfunc) frozennode_richcompare,
+  /* tp_weaklistoffset */ 0,
+  /* tp_iter           */ (getiterfunc) frozennode_iter,
+  /* tp_iternext       */ (iternextfunc) 0,
+  /* tp_methods        */ (PyMethodDef *) frozennode_methods,
+  /* tp_members        */ (PyMemberDef *) 0,
+  /* tp_getset         */ (PyGetSetDef *) frozennode_getset,
+  /* tp_base           */ (PyTypeObject *) 0,
+  /* tp_dict           */ (PyObject *) 0,
+  /* tp_descr_get      */ (descrgetfunc) 0,
+  /* tp_descr_set      */ (descrsetfunc) 0,
+  /* tp_dictoffset     */ 0,
+  /* tp_init           */ (initproc) 0,
+  /* tp_alloc          */ (allocfunc) 0,
+  /* tp_new            */ (newfunc) 0,
+  /* tp_free           */ 0,
+};
+
+/** Axes **************************************************************/
+
+/* Iterates over the nodes of an XPath axis by walking the arrays */
+typedef struct {
+  PyObject_HEAD
+  FrozenNodeObject *node;
+  FrozenAxis axis;
+  int self_pending;
+  int next;
+  int end;
+} FrozenAxisObject;
+
+PyObject *FrozenNode_Axis(FrozenNodeObject *node, FrozenAxis axis)
+{
+  FrozenDocumentObject *document = node->document;
+  FrozenAxisObject *self;
+  int kind = FrozenNode_GET_KIND(node);
+  int next = FROZEN_NONE, end = FROZEN_NONE, self_pending = 0;
+
+  switch (axis) {
+  case FROZEN_AXIS_ANCESTOR_OR_SELF:
+    self_pending = 1;
+    /* fall through */
+  case FROZEN_AXIS_ANCESTOR:
+    next = node->owner;
+    break;
+  case FROZEN_AXIS_ATTRIBUTE:
+    if (kind == FROZEN_ELEMENT)
+      next = node->index + 1;
+    break;
+  case FROZEN_AXIS_CHILD:
+    if (CONTAINER_KINDS & (1 << kind))
+      next = document->first_children[node->index];
+    break;
+  case FROZEN_AXIS_DESCENDANT_OR_SELF:
+    self_pending = 1;
+    /* fall through */
+  case FROZEN_AXIS_DESCENDANT:
+    if (CONTAINER_KINDS & (1 << kind)) {
+      next = node->index + 1;
+      end = frozen_subtree_end(document, node->index);
+    }
+    break;
+  case FROZEN_AXIS_FOLLOWING_SIBLING:
+    if (CHILD_KINDS & (1 << kind))
+      next = document->next_siblings[node->index];
+    break;
+  case FROZEN_AXIS_NAMESPACE: {
+    PyObject *declared, *nodes, *prefix, *index, *result;
+    Py_ssize_t pos = 0;
+    if (kind != FROZEN_ELEMENT)
+      return PyObject_GetIter(empty_string);
+    declared = frozen_inscope(document, node->index);
+    if (declared == NULL)
+      return NULL;
+    nodes = PyList_New(0);
+    while (nodes && PyDict_Next(declared, &pos, &prefix, &index)) {
+      int j = (int)PyInt_AS_LONG(index);
+      if (document->values[j] != document->values[j + 1]) {
+        PyObject *nsnode = FrozenNode_New(document, j, node->index);
+        if (nsnode == NULL || PyList_Append(nodes, nsnode) < 0)
+          Py_CLEAR(nodes);
+        Py_XDECREF(nsnode);
+      }
+    }
+    Py_DECREF(declared);
+    if (nodes == NULL)
+      return NULL;
+    result = PyObject_GetIter(nodes);
+    Py_DECREF(nodes);
+    return result;
+  }
+  default:
+    PyErr_BadInternalCall();
+    return NULL;
+  }
+
+  self = PyObject_New(FrozenAxisObject, &FrozenAxis_Type);
+  if (self == NULL)
+    return NULL;
+  Py_INCREF(node);
+  self->node = node;
+  self->axis = axis;
+  self->self_pending = self_pending;
+  self->next = next;
+  self->end = end;
+  return (PyObject *)self;
+}
+
+static void frozenaxis_dealloc(FrozenAxisObject *self)
+{
+  Py_DECREF(self->node);
+  PyObject_Del(self);
+}
+
+static PyObject *frozenaxis_next(FrozenAxisObject *self)
+{
+  FrozenDocumentObject *document = self->node->document;
+  int i = self->next;
+
+  if (self->self_pending) {
+    self->self_pending = 0;
+    Py_INCREF(self->node);
+    return (PyObject *)self->node;
+  }
+  if (i == FROZEN_NONE)
+    return NULL;
+
+  switch (self->axis) {
+  case FROZEN_AXIS_ANCESTOR:
+  case FROZEN_AXIS_ANCESTOR_OR_SELF:
+    self->next = document->parents[i];
+    return FrozenNode_New(document, i, self->next);
+  case FROZEN_AXIS_ATTRIBUTE:
+    for (; i < document->count && document->parents[i] == self->node->index;
+         i++) {
+      if (document->kinds[i] == FROZEN_ATTRIBUTE) {
+        self->next = i + 1;
+        return FrozenNode_New(document, i, self->node->index);
+      }
+      if (document->kinds[i] != FROZEN_NAMESPACE)
+        break;
+    }
+    break;
+  case FROZEN_AXIS_CHILD:
+  case FROZEN_AXIS_FOLLOWING_SIBLING:
+    self->next = document->next_siblings[i];
+    return FrozenNode_New(document, i, document->parents[i]);
+  case FROZEN_AXIS_DESCENDANT:
+  case FROZEN_AXIS_DESCENDANT_OR_SELF:
+    for (; i < self->end; i++) {
+      int kind = document->kinds[i];
+      if (kind != FROZEN_ATTRIBUTE && kind != FROZEN_NAMESPACE) {
+        self->next = i + 1;
+        return FrozenNode_New(document, i, document->parents[i]);
+      }
+    }
+    break;
+  default:
+    break;
+  }
+  self->next = FROZEN_NONE;
+  return NULL;
+}
+
+static PyTypeObject FrozenAxis_Type = {
+  /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
+  /* ob_size           */ 0,
+  /* tp_name           */ Domlette_MODULE_NAME "." "frozen_axis",
+  /* tp_basicsize      */ sizeof(FrozenAxisObject),
+  /* tp_itemsize       */ 0,
+  /* tp_dealloc        */ (destructor) frozenaxis_dealloc,
+  /* tp_print          */ (printfunc) 0,
+  /* tp_getattr        */ (getattrfunc) 0,
+  /* tp_setattr        */ (setattrfunc) 0,
+  /* tp_compare        */ (cmpfunc) 0,
+  /* tp_repr           */ (reprfunc) 0,
+  /* tp_as_number      */ (PyNumberMethods *) 0,
+  /* tp_as_sequence    */ (PySequenceMethods *) 0,
+  /* tp_as_mapping     */ (PyMappingMethods *) 0,
+  /* tp_hash           */ (hashfunc) 0,
+  /* tp_call           */ (ternaryfunc) 0,
+  /* tp_str            */ (reprfunc) 0,
+  /* tp_getattro       */ (getattrofunc) 0,
+  /* tp_setattro       */ (setattrofunc) 0,
+  /* tp_as_buffer      */ (PyBufferProcs *) 0,
+  /* tp_flags          */ Py_TPFLAGS_DEFAULT,
+  /* tp_doc            */ (char *) 0,
+  /* tp_traverse       */ (traverseproc) 0,
+  /* tp_clear          */ (inquiry) 0,
+  /* tp_richcompare    */ (richcmpfunc) 0,
+  /* tp_weaklistoffset */ 0,
+  /* tp_iter           */ (getiterfunc) PyObject_SelfIter,
+  /* tp_iternext       */ (iternextfunc) frozenaxis_next,
+};
+
+/** Module Interface **************************************************/
+
+int DomletteFrozen_Init(PyObject *module)
+{
+  PyTypeObject *types[] = {
+    &DomletteEntity_Type,
+    &DomletteElement_Type,
+    &DomletteNamespace_Type,
+    &DomletteAttr_Type,
+    &DomletteText_Type,
+    &DomletteComment_Type,
+    &DomletteProcessingInstruction_Type,
+  };
+  PyObject *import;
+  int i;
+
+  if (Expat_IMPORT == NULL) return -1;
+
+  if (PyType_Ready(&DomletteFrozenDocument_Type) < 0)
+    return -1;
+  if (PyType_Ready(&FrozenAxis_Type) < 0)
+    return -1;
+  if (PyType_Ready(&DomletteFrozenNode_Type) < 0)
+    return -1;
+
+  /* the node types share the `xml_type` values of the tree classes */
+  for (i = 0; i <= FROZEN_PROCESSING_INSTRUCTION; i++) {
+    node_types[i] = PyDict_GetItemString(types[i]->tp_dict, "xml_type");
+    if (node_types[i] == NULL) {
+      PyErr_SetString(PyExc_SystemError, "node types not initialized");
+      return -1;
+    }
+    Py_INCREF(node_types[i]);
+    kind_names[i] = node_types[i];
+  }
+
+  xml_string = XmlString_FromASCII("xml");
+  if (xml_string == NULL) return -1;
+  empty_string = XmlString_FromASCII("");
+  if (empty_string == NULL) return -1;
+  import = PyImport_ImportModule("amara.namespaces");
+  if (import == NULL) return -1;
+  xml_namespace = PyObject_GetAttrString(import, "XML_NAMESPACE");
+  xml_namespace = XmlString_FromObjectInPlace(xml_namespace);
+  Py_DECREF(import);
+  if (xml_namespace == NULL) return -1;
+
+  Py_INCREF(&DomletteFrozenNode_Type);
+  return PyModule_AddObject(module, "frozen_node",
+                            (PyObject *)&DomletteFrozenNode_Type);
+}
+
+void DomletteFrozen_Fini(void)
+{
+  int i;
+
+  for (i = 0; i <= FROZEN_PROCESSING_INSTRUCTION; i++)
+    Py_CLEAR(node_types[i]);
+  Py_CLEAR(xml_string);
+  Py_CLEAR(xml_namespace);
+  Py_CLEAR(empty_string);
+  Py_CLEAR(select_function);
+  Py_CLEAR(write_function);
+  Py_CLEAR(encode_function);
+}
@@ -0,0 +1,134 @@
+#ifndef DOMLETTE_FROZEN_H
+#define DOMLETTE_FROZEN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "Python.h"
+
+  /* A frozen document is a parsed tree that can no longer change.  Rather
+   * than an object per node, its nodes are rows of parallel arrays, stored
+   * in document order (each element is followed by its namespace
+   * declarations, its attributes and then its content).  Node values are
+   * kept back to back as UTF-8 in a single buffer: the value of node `i`
+   * is text[values[i]:values[i+1]].  Names are indexes into a table of
+   * (namespace, qname, local) tuples; processing instructions and
+   * namespace nodes use (None, target, target) and (None, prefix, prefix).
+   *
+   * Node objects (frozen_node) are only created as the nodes are visited
+   * and refer back to the arrays by index.
+   *
+   * The arrays are either allocated by the document itself or are part of
+   * `storage`, a buffer the document was loaded from (see snapshot.c).
+   */
+  typedef enum {
+    FROZEN_ENTITY = 0,
+    FROZEN_ELEMENT,
+    FROZEN_NAMESPACE,
+    FROZEN_ATTRIBUTE,
+    FROZEN_TEXT,
+    FROZEN_COMMENT,
+    FROZEN_PROCESSING_INSTRUCTION,
+  } FrozenKind;
+
+#define FROZEN_NONE (-1)
+
+  typedef struct {
+    PyObject_HEAD
+    PyObject *storage;          /* owner of the arrays, if not allocated here */
+    Py_ssize_t count;
+    Py_ssize_t allocated;
+    unsigned char *kinds;
+    int *parents;
+    int *first_children;        /* the first child (not attribute) */
+    int *next_siblings;
+    int *names;
+    Py_ssize_t *values;         /* `count` + 1 offsets into `text` */
+    char *text;
+    Py_ssize_t text_size;
+    Py_ssize_t text_allocated;
+    PyObject *names_table;      /* list of name tuples */
+    PyObject *ids;              /* ID -> attribute index (NULL if none) */
+    PyObject *documentURI;
+    PyObject *publicId;
+    PyObject *systemId;
+  } FrozenDocumentObject;
+
+  /* A node of a frozen document.  `owner` is the parent, except for
+   * namespace nodes, which are in scope for (and belong to) every
+   * descendant element of the element declaring them.
+   */
+  typedef struct {
+    PyObject_HEAD
+    FrozenDocumentObject *document;
+    int index;
+    int owner;
+  } FrozenNodeObject;
+
+  /* The axes that are walked directly on the arrays */
+  typedef enum {
+    FROZEN_AXIS_ANCESTOR = 0,
+    FROZEN_AXIS_ANCESTOR_OR_SELF,
+    FROZEN_AXIS_ATTRIBUTE,
+    FROZEN_AXIS_CHILD,
+    FROZEN_AXIS_DESCENDANT,
+    FROZEN_AXIS_DESCENDANT_OR_SELF,
+    FROZEN_AXIS_FOLLOWING_SIBLING,
+    FROZEN_AXIS_NAMESPACE,
+  } FrozenAxis;
+
+#define Frozen(op) ((FrozenDocumentObject *)(op))
+#define Frozen_GET_KIND(op, i) (Frozen(op)->kinds[i])
+#define Frozen_GET_PARENT(op, i) (Frozen(op)->parents[i])
+#define Frozen_GET_FIRST_CHILD(op, i) (Frozen(op)->first_children[i])
+#define Frozen_GET_NEXT_SIBLING(op, i) (Frozen(op)->next_siblings[i])
+#define Frozen_GET_NAME(op, i) \
+  PyList_GET_ITEM(Frozen(op)->names_table, Frozen(op)->names[i])
+#define Frozen_GET_NAMESPACE_URI(op, i) \
+  PyTuple_GET_ITEM(Frozen_GET_NAME(op, i), 0)
+#define Frozen_GET_QNAME(op, i) PyTuple_GET_ITEM(Frozen_GET_NAME(op, i), 1)
+#define Frozen_GET_LOCAL_NAME(op, i) \
+  PyTuple_GET_ITEM(Frozen_GET_NAME(op, i), 2)
+#define Frozen_GET_SYSTEM_ID(op) (Frozen(op)->systemId)
+#define Frozen_GET_PUBLIC_ID(op) (Frozen(op)->publicId)
+
+#define FrozenNode(op) ((FrozenNodeObject *)(op))
+#define FrozenNode_GET_DOCUMENT(op) (FrozenNode(op)->document)
+#define FrozenNode_GET_INDEX(op) (FrozenNode(op)->index)
+#define FrozenNode_GET_KIND(op) \
+  Frozen_GET_KIND(FrozenNode(op)->document, FrozenNode(op)->index)
+
+#ifdef Domlette_BUILDING_MODULE
+
+  extern PyTypeObject DomletteFrozenDocument_Type;
+  extern PyTypeObject DomletteFrozenNode_Type;
+
+#define FrozenNode_Check(op) ((op)->ob_type == &DomletteFrozenNode_Type)
+
+  /* Module Methods */
+  int DomletteFrozen_Init(PyObject *module);
+  void DomletteFrozen_Fini(void);
+
+  PyObject *Domlette_ParseFrozen(PyObject *self, PyObject *args, PyObject *kw);
+
+  /* Frozen Node Methods */
+  PyObject *FrozenNode_New(FrozenDocumentObject *document, int index,
+                           int owner);
+  PyObject *FrozenNode_Axis(FrozenNodeObject *node, FrozenAxis axis);
+  PyObject *FrozenNode_StringValue(FrozenNodeObject *node);
+  PyObject *Frozen_GetValue(FrozenDocumentObject *document, int index);
+  PyObject *Frozen_InscopeNamespaces(FrozenDocumentObject *document,
+                                     int index);
+
+  /* Conversion from and to Domlette trees */
+  FrozenDocumentObject *Frozen_FromTree(EntityObject *entity);
+  EntityObject *Frozen_ToTree(FrozenDocumentObject *document);
+
+#endif /* Domlette_BUILDING_MODULE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DOMLETTE_FROZEN_H */
@@ -12,6 +12,8 @@ static PyTypeObject NodeIter_Type;
 #define NamespaceMap_Check(op) PyObject_TypeCheck(op, &NamespaceMap_Type)
 #define NamespaceMap_CheckExact(op) ((op)->ob_type == &NamespaceMap_Type)
 
+#define NamespaceMap_IS_SMALL(op) ((op)->nm_table == (op)->nm_smalltable)
+
 #define INIT_MINSIZE(op) do {                                       \
   (op)->nm_used = 0;                                                \
   (op)->nm_mask = NamespaceMap_MINSIZE - 1;                         \
@@ -46,7 +48,12 @@ key_eq(NamespaceObject *node, Py_ssize_t hash, register PyObject *name)
   return node_name == name || (node->hash == hash && NAME_EQ(node_name, name));
 }
 
-Py_LOCAL_INLINE(size_t)
+/* Returns the slot holding the node for the key, or else the slot a node
+ * with that key is to be stored in.  Small maps are searched linearly (see
+ * NamespaceMap_MINSIZE); NULL is returned if such a map is full and the key
+ * is not found.
+ */
+Py_LOCAL_INLINE(NamespaceObject **)
 get_entry(NamespaceMapObject *nm, Py_ssize_t hash, PyObject *name)
 {
   register size_t perturb = hash;
@@ -55,12 +62,20 @@ get_entry(NamespaceMapObject *nm, Py_ssize_t hash, PyObject *name)
   register size_t entry = i;
   NamespaceObject **table = nm->nm_table;
 
+  if (NamespaceMap_IS_SMALL(nm)) {
+    NamespaceObject **end = table + nm->nm_used;
+    for (; table < end; table++) {
+      if (key_eq(*table, hash, name))
+        return table;
+    }
+    return (nm->nm_used < NamespaceMap_MINSIZE) ? table : NULL;
+  }
   while (table[entry] && !key_eq(table[entry], hash, name)) {
     i = (i << 2) + i + perturb + 1;
     perturb >>= 5;
     entry = i & mask;
   }
-  return entry;
+  return table + entry;
 }
 
 Py_LOCAL_INLINE(void)
@@ -98,8 +113,7 @@ next_entry(NamespaceMapObject *nm, Py_ssize_t *ppos)
 
 /*
 Restructure the table by allocating a new table and reinserting all
-items again.  When entries have been deleted, the new table may
-actually be smaller than the old one.
+items again.  A full small map is turned into a hash table this way.
 */
 Py_LOCAL(int)
 resize_table(NamespaceMapObject *self)
@@ -110,17 +124,10 @@ resize_table(NamespaceMapObject *self)
   /* Get space for a new table. */
   oldtable = self->nm_table;
   size = (self->nm_mask + 1) << 1;
-  if (size <= NamespaceMap_MINSIZE) {
-    size = NamespaceMap_MINSIZE;
-    newtable = self->nm_smalltable;
-    if (oldtable == newtable)
-      return 0;
-  } else {
-    newtable = PyMem_New(NamespaceObject *, size);
-    if (newtable == NULL) {
-      PyErr_NoMemory();
-      return -1;
-    }
+  newtable = PyMem_New(NamespaceObject *, size);
+  if (newtable == NULL) {
+    PyErr_NoMemory();
+    return -1;
   }
 
   /* Make the dict empty, using the new table. */
@@ -227,7 +234,7 @@ NamespaceObject *
 NamespaceMap_GetNode(PyObject *self, PyObject *name)
 {
   NamespaceMapObject *nm = (NamespaceMapObject *)self;
-  size_t entry;
+  NamespaceObject **entry;
   long hash;
 
   if (!NamespaceMap_Check(nm)) {
@@ -248,14 +255,14 @@ NamespaceMap_GetNode(PyObject *self, PyObject *name)
   }
   entry = get_entry(nm, hash, name);
   Py_DECREF(name);
-  return nm->nm_table[entry];
+  return entry ? *entry : NULL;
 }
 
 int
 NamespaceMap_SetNode(PyObject *self, NamespaceObject *node)
 {
   NamespaceMapObject *nm = (NamespaceMapObject *)self;
-  size_t entry;
+  NamespaceObject **entry;
   PyObject *name;
   long hash;
   NamespaceObject *old_node;
@@ -268,7 +275,13 @@ NamespaceMap_SetNode(PyObject *self, NamespaceObject *node)
   hash = (long)Namespace_GET_HASH(node);
   name = Namespace_GET_NAME(node);
   entry = get_entry(nm, hash, name);
-  old_node = nm->nm_table[entry];
+  if (entry == NULL) {
+    /* the small map is full, switch to a hash table */
+    if (resize_table(nm) < 0)
+      return -1;
+    entry = get_entry(nm, hash, name);
+  }
+  old_node = *entry;
   if (old_node == NULL) {
     /* adding the namespace to the table */
     nm->nm_used++;
@@ -277,16 +290,15 @@ NamespaceMap_SetNode(PyObject *self, NamespaceObject *node)
     Py_DECREF(old_node);
   }
   /* store the namespace in the table */
-  nm->nm_table[entry] = node;
+  *entry = node;
   Py_INCREF(node);
   /* update the naespace's owner */
   temp = Node_GET_PARENT(node);
   Node_SET_PARENT(node, (NodeObject *)nm->nm_owner);
   Py_INCREF(nm->nm_owner);
   Py_XDECREF(temp);
-  /* If fill >= 2/3 size, adjust size.  Normally, this doubles the size, but
-   * it's also possible for the dict to shrink. */
-  if (nm->nm_used*3 >= (nm->nm_mask+1)*2) {
+  /* If fill >= 2/3 size, adjust size. */
+  if (!NamespaceMap_IS_SMALL(nm) && nm->nm_used*3 >= (nm->nm_mask+1)*2) {
     if (resize_table(nm) < 0)
       return -1;
   }
@@ -346,6 +358,8 @@ static PyObject *namespacemap_setnode(PyObject *self, PyObject *args)
 
   if (NamespaceMap_SetNode(self, node) < 0)
     return NULL;
+  Element_InvalidateNamespaces(
+    (NodeObject *)((NamespaceMapObject *)self)->nm_owner);
 
   Py_INCREF(Py_None);
   return Py_None;
@@ -586,6 +600,7 @@ namespacemap_ass_subscript(PyObject *op, PyObject *key, PyObject *value)
      * `key` can be tuple of (namespace, name) or just name
      */
     NamespaceObject *node;
+    PyObject *declared;
     name = parse_key(key, 0);
     if (name == NULL)
       return -1;
@@ -595,7 +610,10 @@ namespacemap_ass_subscript(PyObject *op, PyObject *key, PyObject *value)
       Py_DECREF(name);
       return -1;
     }
-    node = NamespaceMap_GetNode(op, name);
+    /* The in-scope namespaces of an element hold copies of those declared
+     * by its ancestors; bindings are always made on the owner itself. */
+    declared = Element_NAMESPACES(self->nm_owner);
+    node = declared ? NamespaceMap_GetNode(declared, name) : NULL;
     if (node == NULL) {
       if (PyErr_Occurred()) {
         result = -1;
@@ -604,8 +622,10 @@ namespacemap_ass_subscript(PyObject *op, PyObject *key, PyObject *value)
         if (node == NULL) {
           result = -1;
         } else {
-          Py_DECREF(node);
           result = 0;
+          if (op != Element_NAMESPACES(self->nm_owner))
+            result = NamespaceMap_SetNode(op, node);
+          Py_DECREF(node);
         }
       }
       Py_DECREF(value);
@@ -613,6 +633,7 @@ namespacemap_ass_subscript(PyObject *op, PyObject *key, PyObject *value)
       /* just update the node value */
      Py_DECREF(Namespace_GET_VALUE(node));
      Namespace_SET_VALUE(node, value);
+     Element_InvalidateNamespaces((NodeObject *)self->nm_owner);
      result = 0;
     }
   }
@@ -628,12 +649,13 @@ static PyMappingMethods namespacemap_as_mapping = {
 
 static int namespacemap_contains(NamespaceMapObject *self, PyObject *key)
 {
-  Py_ssize_t entry, hash;
+  Py_ssize_t pos, hash;
+  NamespaceObject **entry;
 
   if (Namespace_Check(key)) {
     NamespaceObject *node;
-    entry = 0;
-    while ((node = next_entry(self, &entry))) {
+    pos = 0;
+    while ((node = next_entry(self, &pos))) {
       switch (PyObject_RichCompareBool(key, (PyObject *)node, Py_EQ)) {
         case 1:
           return 1;
@@ -659,7 +681,7 @@ static int namespacemap_contains(NamespaceMapObject *self, PyObject *key)
   }
   entry = get_entry(self, hash, key);
   Py_DECREF(key);
-  return self->nm_table[entry] != NULL;
+  return entry != NULL && *entry != NULL;
 }
 
 static PySequenceMethods namespacemap_as_sequence = {
@@ -9,13 +9,11 @@ extern "C" {
 #include "element.h"
 #include "namespace.h"
 
-/* NamespaceMap_MINSIZE is the minimum size of a dictionary.  This many slots
- * are allocated directly in the dict object (in the ma_smalltable member).
- * It must be a power of 2, and at least 4.  8 allows dicts with no more
- * than 5 active entries to live in `nm_smalltable` (and so avoid an
- * additional malloc); instrumentation suggested this suffices for the
- * majority of dicts (consisting mostly of usually-small instance dicts and
- * usually-small dicts created to pass keyword arguments).
+/* NamespaceMap_MINSIZE is the number of slots allocated directly in the
+ * map object (in the `nm_smalltable` member).  Up to this many nodes are
+ * kept there, packed in insertion order and found by a linear scan.  8
+ * avoids an additional malloc for nearly every element.  Larger maps switch
+ * to an open-addressing hash table, so it must be a power of 2.
  */
 #define NamespaceMap_MINSIZE 8
 
@@ -11,31 +11,498 @@ static PyObject *is_absolute_function;
 static PyObject *absolutize_function;
 static PyObject *deepcopy_function;
 
+/* assigns document order keys to `node` and its namespace and attribute
+ * nodes, returning the next unused key */
+Py_LOCAL_INLINE(Py_ssize_t)
+number_node(NodeObject *node, Py_ssize_t stamp, Py_ssize_t key)
+{
+  Node_SET_DOCORDER(node, stamp, key++);
+  if (Element_Check(node)) {
+    PyObject *nodemap;
+    Py_ssize_t pos;
+    /* namespace and attribute nodes follow their element and precede
+     * its children */
+    nodemap = Element_NAMESPACES(node);
+    if (nodemap != NULL) {
+      NamespaceObject *decl;
+      pos = 0;
+      while ((decl = NamespaceMap_Next(nodemap, &pos)) != NULL) {
+        Node_SET_DOCORDER(decl, stamp, key++);
+      }
+    }
+    nodemap = Element_ATTRIBUTES(node);
+    if (nodemap != NULL) {
+      AttrObject *attr;
+      pos = 0;
+      while ((attr = AttributeMap_Next(nodemap, &pos)) != NULL) {
+        Node_SET_DOCORDER(attr, stamp, key++);
+      }
+    }
+  }
+  return key;
+}
+
+/* The containers being numbered by number_subtree(), with the index of the
+ * next child of each.  The walk keeps its own stack rather than recursing
+ * as documents can be nested deeper than the C stack allows. */
+#define NUMBER_STACK_SIZE 64
+typedef struct {
+  NodeObject *container;
+  Py_ssize_t next;
+} number_frame;
+
+/* assigns document order keys to `root` and its descendants */
+static int number_subtree(NodeObject *root, Py_ssize_t stamp)
+{
+  number_frame small_stack[NUMBER_STACK_SIZE];
+  number_frame *stack = small_stack, *frame;
+  Py_ssize_t depth = 0, allocated = NUMBER_STACK_SIZE, key = 0;
+  NodeObject *node = root;
+
+  while (1) {
+    key = number_node(node, stamp, key);
+    if (Container_Check(node) && Container_GET_COUNT(node) > 0) {
+      if (depth == allocated) {
+        number_frame *larger = PyMem_New(number_frame, allocated * 2);
+        if (larger == NULL) {
+          if (stack != small_stack)
+            PyMem_Free(stack);
+          PyErr_NoMemory();
+          return -1;
+        }
+        memcpy(larger, stack, allocated * sizeof(number_frame));
+        if (stack != small_stack)
+          PyMem_Free(stack);
+        stack = larger;
+        allocated *= 2;
+      }
+      stack[depth].container = node;
+      stack[depth].next = 0;
+      depth++;
+    }
+    /* continue with the next child of the innermost container that still
+     * has some */
+    while (depth > 0 && stack[depth - 1].next ==
+           Container_GET_COUNT(stack[depth - 1].container))
+      depth--;
+    if (depth == 0)
+      break;
+    frame = &stack[depth - 1];
+    node = Container_GET_CHILD(frame->container, frame->next++);
+  }
+  if (stack != small_stack)
+    PyMem_Free(stack);
+  return 0;
+}
+
+/* Nodes which claim a parent but are not reachable from it (the synthesized
+ * `xml` namespace node of `xml_namespaces`, for example) are not reached by
+ * number_subtree(); they share the key of their nearest numbered ancestor.
+ */
+Py_LOCAL_INLINE(Py_ssize_t)
+inherit_docorder(NodeObject *node)
+{
+  NodeObject *ancestor = node;
+  while (!Node_ORDER_VALID(ancestor)) {
+    ancestor = Node_GET_PARENT(ancestor);
+    assert(ancestor != NULL);
+  }
+  if (ancestor != node) {
+    Node_SET_DOCORDER(node, Node_GET_DOCORDER_STAMP(ancestor),
+                      Node_GET_DOCORDER(ancestor));
+  }
+  return Node_GET_DOCORDER(node);
+}
+
+/** XPath Selection **************************************************/
+
+/* `xml_select` evaluates expressions without going through
+ * `amara.xpath.util.simple_evaluate` when possible: the in-scope namespaces
+ * are gathered directly from the tree, an idle context object is reused
+ * and the expression comes from the shared `amara.xpath.cache`.
+ * The `amara.xpath` objects are imported on first use as that package
+ * depends on this module. */
+static PyObject *select_fallback;
+static PyObject *context_class;
+static PyObject *expression_cache;
+static PyObject *pooled_context;
+static PyObject *native_namespaces;
+static PyObject *xml_prefix_string;
+static PyObject *xml_namespaces_string;
+static PyObject *get_string;
+static PyObject *evaluate_string;
+static PyObject *node_string;
+static PyObject *position_string;
+static PyObject *size_string;
+static PyObject *namespaces_string;
+static PyObject *zero;
+
+static int select_init(void)
+{
+  PyObject *module;
+
+  module = PyImport_ImportModule("amara.xpath");
+  if (module == NULL)
+    return -1;
+  context_class = PyObject_GetAttrString(module, "context");
+  Py_DECREF(module);
+  if (context_class == NULL)
+    return -1;
+
+  module = PyImport_ImportModule("amara.xpath.cache");
+  if (module == NULL)
+    return -1;
+  expression_cache = PyObject_GetAttrString(module, "expressions");
+  Py_DECREF(module);
+  if (expression_cache == NULL)
+    return -1;
+
+  module = PyImport_ImportModule("amara.xpath.util");
+  if (module == NULL)
+    return -1;
+  select_fallback = PyObject_GetAttrString(module, "simple_evaluate");
+  Py_DECREF(module);
+  if (select_fallback == NULL)
+    return -1;
+
+  native_namespaces = PyDict_GetItem(DomletteElement_Type.tp_dict,
+                                     xml_namespaces_string);
+  Py_XINCREF(native_namespaces);
+  return 0;
+}
+
+/* Extension functions are resolved against the context they are called
+ * with, so expressions which might call them (a prefixed name followed by
+ * a parenthesis somewhere) are left to the Python implementation. */
+#define SELECT_SCAN(p, end) \
+  for (; p < end; p++) { \
+    if (*p == ':') { \
+      if (p + 1 < end && p[1] == ':') \
+        p++; \
+      else \
+        prefixed = 1; \
+    } else if (*p == '(') { \
+      call = 1; \
+    } \
+  }
+
+Py_LOCAL_INLINE(int)
+select_is_simple(PyObject *expr)
+{
+  int prefixed = 0, call = 0;
+
+  if (PyUnicode_CheckExact(expr)) {
+    Py_UNICODE *p = PyUnicode_AS_UNICODE(expr);
+    Py_UNICODE *end = p + PyUnicode_GET_SIZE(expr);
+    SELECT_SCAN(p, end);
+  } else if (PyString_CheckExact(expr)) {
+    char *p = PyString_AS_STRING(expr);
+    char *end = p + PyString_GET_SIZE(expr);
+    SELECT_SCAN(p, end);
+  } else {
+    return 0;
+  }
+  return !(prefixed && call);
+}
+#undef SELECT_SCAN
+
+/* Returns 1 if `node` uses the built-in `element.xml_namespaces`, 0 if it
+ * has no such attribute and -1 if it provides its own. */
+Py_LOCAL_INLINE(int)
+select_namespaces_kind(NodeObject *node)
+{
+  PyObject *descr = _PyType_Lookup(node->ob_type, xml_namespaces_string);
+  if (descr == native_namespaces)
+    return 1;
+  if (descr == NULL && node->ob_type->tp_getattro == PyObject_GenericGetAttr)
+    return 0;
+  return -1;
+}
+
+/* Adds the namespaces in scope for `element` which are not already bound */
+Py_LOCAL_INLINE(int)
+select_add_inscope(PyObject *namespaces, NodeObject *element)
+{
+  PyObject *inscope;
+  NamespaceObject *decl;
+  Py_ssize_t pos = 0;
+  int result = 0;
+
+  inscope = Element_InscopeBindings(Element(element));
+  if (inscope == NULL)
+    return -1;
+  while ((decl = NamespaceMap_Next(inscope, &pos))) {
+    PyObject *name = Namespace_GET_NAME(decl);
+    if (PyDict_GetItem(namespaces, name) == NULL &&
+        PyDict_SetItem(namespaces, name, Namespace_GET_VALUE(decl)) < 0) {
+      result = -1;
+      break;
+    }
+  }
+  Py_DECREF(inscope);
+  return result;
+}
+
+/* Returns a new dictionary of the namespaces in scope for `node` or NULL
+ * (without an exception) if the node defines its own `xml_namespaces`. */
+Py_LOCAL(PyObject *)
+select_namespaces(NodeObject *node)
+{
+  PyObject *namespaces;
+  NodeObject *root;
+  Py_ssize_t i;
+
+  switch (select_namespaces_kind(node)) {
+  case 1:
+    root = NULL;
+    break;
+  case 0:
+    /* like amara.lib.util.top_namespaces(node.xml_root) */
+    for (root = node; Node_GET_PARENT(root); root = Node_GET_PARENT(root));
+    if (!Container_Check(root))
+      return NULL;
+    for (i = 0; i < Container_GET_COUNT(root); i++) {
+      if (select_namespaces_kind(Container_GET_CHILD(root, i)) < 0)
+        return NULL;
+    }
+    break;
+  default:
+    return NULL;
+  }
+
+  namespaces = PyDict_New();
+  if (namespaces == NULL)
+    return NULL;
+  if (PyDict_SetItem(namespaces, xml_prefix_string, xml_namespace_string) < 0)
+    goto error;
+  if (root == NULL) {
+    if (select_add_inscope(namespaces, node) < 0)
+      goto error;
+  } else {
+    for (i = 0; i < Container_GET_COUNT(root); i++) {
+      NodeObject *child = Container_GET_CHILD(root, i);
+      if (Element_Check(child) && select_add_inscope(namespaces, child) < 0)
+        goto error;
+    }
+  }
+  return namespaces;
+
+error:
+  Py_DECREF(namespaces);
+  return NULL;
+}
+
+/* Returns a context for evaluating at `node`, reusing the idle one when it
+ * is available (it is not when xml_select is re-entered). */
+Py_LOCAL(PyObject *)
+select_context(NodeObject *node, PyObject *namespaces)
+{
+  PyObject *context = pooled_context;
+
+  if (context == NULL) {
+    return PyObject_CallFunctionObjArgs(context_class, node, zero, zero,
+                                        Py_None, namespaces, NULL);
+  }
+  pooled_context = NULL;
+  if (PyObject_SetAttr(context, node_string, (PyObject *)node) < 0 ||
+      PyObject_SetAttr(context, position_string, zero) < 0 ||
+      PyObject_SetAttr(context, size_string, zero) < 0 ||
+      PyObject_SetAttr(context, namespaces_string, namespaces) < 0) {
+    Py_DECREF(context);
+    return NULL;
+  }
+  return context;
+}
+
+Py_LOCAL(void)
+select_release(PyObject *context)
+{
+  PyObject *exc, *val, *tb;
+
+  if (pooled_context == NULL) {
+    /* don't keep the tree alive through the idle context */
+    PyErr_Fetch(&exc, &val, &tb);
+    if (PyObject_SetAttr(context, node_string, Py_None) == 0) {
+      pooled_context = context;
+      context = NULL;
+    } else {
+      PyErr_Clear();
+    }
+    PyErr_Restore(exc, val, tb);
+  }
+  Py_XDECREF(context);
+}
+
 /** Public C API ******************************************************/
 
+Py_ssize_t _Node_OrderEpoch = 0;
+
+/* The stamp last found current, until the next mutation of any tree.  Every
+ * node carrying it is then known to be in the tree numbered with it, so the
+ * comparisons of a sort (or union) walk to the root only once. */
+static Py_ssize_t validated_stamp = 0;
+
+/* Returns true if the document order key of `node` is current */
+int Node_OrderValid(NodeObject *node)
+{
+  Py_ssize_t stamp = Node_GET_DOCORDER_STAMP(node);
+
+  if (stamp == 0)
+    return 0;
+  if (stamp == validated_stamp)
+    return 1;
+  while (Node_GET_PARENT(node) != NULL)
+    node = Node_GET_PARENT(node);
+  if (Node_GET_DOCORDER_STAMP(node) != stamp)
+    return 0;
+  validated_stamp = stamp;
+  return 1;
+}
+
+/* Discards the document order keys of the tree containing `node` */
+void Node_InvalidateOrder(NodeObject *node)
+{
+  validated_stamp = 0;
+  while (Node_GET_PARENT(node) != NULL)
+    node = Node_GET_PARENT(node);
+  Node_GET_DOCORDER_STAMP(node) = 0;
+}
+
+/* (Re)assigns document order keys to the entire tree rooted at `root`.
+ * Returns the stamp shared by all the nodes of the tree, or -1 on error.
+ */
+Py_ssize_t Node_NumberTree(NodeObject *root)
+{
+  Py_ssize_t stamp = Node_NewOrderStamp();
+  if (number_subtree(root, stamp) < 0) {
+    Node_GET_DOCORDER_STAMP(root) = 0;
+    return -1;
+  }
+  validated_stamp = stamp;
+  return stamp;
+}
+
+/* Node freelists
+ *
+ * Deallocated nodes of the concrete node types (not of subclasses, whose
+ * instances vary in size) are kept on a per-type freelist, chained through
+ * their parent pointer, and reused by _Node_New.  The limit is kept small:
+ * it lets repeated parses of small documents reuse their memory without
+ * holding on to the memory of a large document once it is released.
+ * Large trees still allocate (and GC-track) every node individually; the
+ * allocated/reused counts show how much of a workload the freelists cover.
+ */
+typedef struct {
+  PyTypeObject *type;
+  NodeObject *free;
+  Py_ssize_t numfree;
+  Py_ssize_t allocated;   /* nodes obtained from the allocator */
+  Py_ssize_t reused;      /* nodes taken from the freelist */
+} node_freelist;
+
+#define NODE_FREELIST_LIMIT 1024
+
+static node_freelist freelists[] = {
+  { &DomletteElement_Type },
+  { &DomletteText_Type },
+  { &DomletteAttr_Type },
+  { &DomletteNamespace_Type },
+  { &DomletteComment_Type },
+  { &DomletteProcessingInstruction_Type },
+  { NULL }
+};
+
+Py_LOCAL_INLINE(node_freelist *) get_freelist(PyTypeObject *type)
+{
+  node_freelist *freelist;
+  for (freelist = freelists; freelist->type; freelist++) {
+    if (freelist->type == type)
+      return freelist;
+  }
+  return NULL;
+}
+
 /* Allocates memory for a new node object of the given type and initializes
  * part of it.
  */
 NodeObject *_Node_New(PyTypeObject *type)
 {
   const size_t size = _PyObject_SIZE(type);
-  PyObject *obj = _PyObject_GC_Malloc(size);
-  if (obj == NULL)
-    PyErr_NoMemory();
-  else {
-    memset(obj, '\0', size);
-    PyObject_INIT(obj, type);
-    PyObject_GC_Track(obj);
+  node_freelist *freelist = get_freelist(type);
+  PyObject *obj;
+
+  if (freelist && freelist->free) {
+    obj = (PyObject *)freelist->free;
+    freelist->free = Node_GET_PARENT(obj);
+    freelist->numfree--;
+    freelist->reused++;
+  } else {
+    obj = _PyObject_GC_Malloc(size);
+    if (obj == NULL)
+      return (NodeObject *)PyErr_NoMemory();
+    if (freelist)
+      freelist->allocated++;
   }
+  memset(obj, '\0', size);
+  PyObject_INIT(obj, type);
+  PyObject_GC_Track(obj);
   return (NodeObject *)obj;
 }
 
 void _Node_Del(NodeObject *node)
 {
+  node_freelist *freelist;
+
   PyObject_GC_UnTrack(node);
 
   Py_CLEAR(node->parent);
-  PyObject_GC_Del((PyObject *) node);
+  freelist = get_freelist(node->ob_type);
+  if (freelist && freelist->numfree < NODE_FREELIST_LIMIT) {
+    Node_SET_PARENT(node, freelist->free);
+    freelist->free = node;
+    freelist->numfree++;
+  } else {
+    PyObject_GC_Del((PyObject *) node);
+  }
+}
+
+/* Releases the nodes kept on the freelists. */
+static void clear_freelists(void)
+{
+  node_freelist *freelist;
+  NodeObject *node;
+
+  for (freelist = freelists; freelist->type; freelist++) {
+    while ((node = freelist->free) != NULL) {
+      freelist->free = Node_GET_PARENT(node);
+      PyObject_GC_Del((PyObject *) node);
+    }
+    freelist->numfree = 0;
+  }
+}
+
+/* Returns a dictionary mapping the name of each node type to a tuple of
+ * (free, allocated, reused) counts. */
+PyObject *Node_FreelistStats(void)
+{
+  node_freelist *freelist;
+  PyObject *stats, *item;
+
+  stats = PyDict_New();
+  if (stats == NULL)
+    return NULL;
+  for (freelist = freelists; freelist->type; freelist++) {
+    item = Py_BuildValue("nnn", freelist->numfree, freelist->allocated,
+                         freelist->reused);
+    if (item == NULL ||
+        PyDict_SetItemString(stats, freelist->type->tp_name, item) < 0) {
+      Py_XDECREF(item);
+      Py_DECREF(stats);
+      return NULL;
+    }
+    Py_DECREF(item);
+  }
+  return stats;
 }
 
 /* For debugging convenience. */
@@ -98,18 +565,49 @@ Evaluates the XPath expression `expr` using this node as context.";
 static PyObject *xml_select(NodeObject *self, PyObject *args, PyObject *kw)
 {
   PyObject *expr, *explicit_nss = Py_None;
-  PyObject *module, *result;
+  PyObject *namespaces, *context, *parsed, *result;
   static char *kwlist[] = { "expr", "prefixes", NULL };
 
   if (!PyArg_ParseTupleAndKeywords(args, kw, "O|O:xml_select", kwlist,
                                    &expr, &explicit_nss))
     return NULL;
 
-  module = PyImport_ImportModule("amara.xpath.util");
-  if (module == NULL) return NULL;
-  result = PyObject_CallMethod(module, "SimpleEvaluate", "OOO",
-                               expr, self, explicit_nss);
-  Py_DECREF(module);
+  if (select_fallback == NULL && select_init() < 0)
+    return NULL;
+
+  /* Build the namespace mapping; a NULL result without an exception set
+   * means that the fast path cannot handle this node. */
+  namespaces = NULL;
+  if (select_is_simple(expr) &&
+      (explicit_nss == Py_None || PyDict_CheckExact(explicit_nss))) {
+    namespaces = select_namespaces(self);
+    if (namespaces == NULL && PyErr_Occurred())
+      return NULL;
+  }
+  if (namespaces == NULL) {
+    return PyObject_CallFunctionObjArgs(select_fallback, expr, self,
+                                        explicit_nss, NULL);
+  }
+  if (explicit_nss != Py_None) {
+    if (PyDict_Update(namespaces, explicit_nss) < 0) {
+      Py_DECREF(namespaces);
+      return NULL;
+    }
+  }
+
+  context = select_context(self, namespaces);
+  Py_DECREF(namespaces);
+  if (context == NULL)
+    return NULL;
+  parsed = PyObject_CallMethodObjArgs(expression_cache, get_string,
+                                      expr, context, NULL);
+  if (parsed == NULL) {
+    select_release(context);
+    return NULL;
+  }
+  result = PyObject_CallMethodObjArgs(parsed, evaluate_string, context, NULL);
+  Py_DECREF(parsed);
+  select_release(context);
   return result;
 }
 
@@ -797,71 +1295,38 @@ static PyObject *node_richcompare(NodeObject *a, NodeObject *b, int op)
     return result;
   }
 
-  /* traverse to the top of each tree (document, element or the node itself)
-  */
-  parent_a = a;
-  depth_a = 0;
-  while (Node_GET_PARENT(parent_a)) {
-    parent_a = Node_GET_PARENT(parent_a);
-    depth_a++;
-  }
-
-  parent_b = b;
-  depth_b = 0;
-  while (Node_GET_PARENT(parent_b)) {
-    parent_b = Node_GET_PARENT(parent_b);
-    depth_b++;
-  }
-
-  /* compare the top of each tree; for entities use the creation index,
-   * otherwise None for trees not rooted in an `entity`. If both trees do
-   * not have an `entity` root, fall back to default Python comparison. */
-  doc_a = Entity_Check(parent_a) ? Entity_GET_INDEX(parent_a) : Py_None;
-  doc_b = Entity_Check(parent_b) ? Entity_GET_INDEX(parent_b) : Py_None;
-  if (doc_a != doc_b) {
-    return PyObject_RichCompare(doc_a, doc_b, op);
-  }
-  else if (parent_a != parent_b) {
-    Py_INCREF(Py_NotImplemented);
-    return Py_NotImplemented;
-  }
-
-  /* if neither node is a document (depth>0), find the nodes common ancestor */
-  if (depth_a > 0 && depth_b > 0) {
-    NodeObject **nodes;
-    Py_ssize_t i, count;
-
-    /* traverse to the same depth in the tree for both nodes */
-    for (i = depth_a; i > depth_b; i--) {
-      a = Node_GET_PARENT(a);
+  /* nodes numbered in the same pass are in the same tree; the common case
+   * is just an integer compare */
+  if (Node_GET_DOCORDER_STAMP(a) == Node_GET_DOCORDER_STAMP(b) &&
+      Node_ORDER_VALID(a)) {
+    depth_a = Node_GET_DOCORDER(a);
+    depth_b = Node_GET_DOCORDER(b);
+  } else {
+    /* traverse to the top of each tree (document, element or the node
+     * itself) */
+    for (parent_a = a; Node_GET_PARENT(parent_a); )
+      parent_a = Node_GET_PARENT(parent_a);
+    for (parent_b = b; Node_GET_PARENT(parent_b); )
+      parent_b = Node_GET_PARENT(parent_b);
+
+    /* compare the top of each tree; for entities use the creation index,
+     * otherwise None for trees not rooted in an `entity`. If both trees do
+     * not have an `entity` root, fall back to default Python comparison. */
+    doc_a = Entity_Check(parent_a) ? Entity_GET_INDEX(parent_a) : Py_None;
+    doc_b = Entity_Check(parent_b) ? Entity_GET_INDEX(parent_b) : Py_None;
+    if (doc_a != doc_b) {
+      return PyObject_RichCompare(doc_a, doc_b, op);
     }
-
-    for (i = depth_b; i > depth_a; i--) {
-      b = Node_GET_PARENT(b);
+    else if (parent_a != parent_b) {
+      Py_INCREF(Py_NotImplemented);
+      return Py_NotImplemented;
     }
 
-    /* find the nodes common parent */
-    if (a != b) {
-      parent_a = Node_GET_PARENT(a);
-      parent_b = Node_GET_PARENT(b);
-      while (parent_a != parent_b) {
-        a = parent_a;
-        parent_a = Node_GET_PARENT(parent_a);
-        b = parent_b;
-        parent_b = Node_GET_PARENT(parent_b);
-      }
-
-      /* get the nodes position in the child list */
-      depth_a = depth_b = -1;
-      nodes = Container_GET_NODES(parent_a);
-      count = Container_GET_COUNT(parent_a);
-      for (i = 0; i < count; i++) {
-        if (nodes[i] == a)
-          depth_a = i;
-        else if (nodes[i] == b)
-          depth_b = i;
-      }
-    }
+    /* same tree, but the keys are stale (or were never assigned) */
+    if (Node_NumberTree(parent_a) < 0)
+      return NULL;
+    depth_a = inherit_docorder(a);
+    depth_b = inherit_docorder(b);
   }
 
   switch (op) {
@@ -1085,6 +1550,34 @@ int DomletteNode_Init(PyObject *module)
   if (base_string == NULL)
     return -1;
 
+  xml_prefix_string = XmlString_FromASCII("xml");
+  if (xml_prefix_string == NULL)
+    return -1;
+  xml_namespaces_string = PyString_InternFromString("xml_namespaces");
+  if (xml_namespaces_string == NULL)
+    return -1;
+  get_string = PyString_InternFromString("get");
+  if (get_string == NULL)
+    return -1;
+  evaluate_string = PyString_InternFromString("evaluate");
+  if (evaluate_string == NULL)
+    return -1;
+  node_string = PyString_InternFromString("node");
+  if (node_string == NULL)
+    return -1;
+  position_string = PyString_InternFromString("position");
+  if (position_string == NULL)
+    return -1;
+  size_string = PyString_InternFromString("size");
+  if (size_string == NULL)
+    return -1;
+  namespaces_string = PyString_InternFromString("namespaces");
+  if (namespaces_string == NULL)
+    return -1;
+  zero = PyInt_FromLong(0L);
+  if (zero == NULL)
+    return -1;
+
   Py_INCREF(&DomletteNode_Type);
   return PyModule_AddObject(module, "node", (PyObject*)&DomletteNode_Type);
 }
@@ -1098,6 +1591,21 @@ void DomletteNode_Fini(void)
   Py_DECREF(is_absolute_function);
   Py_DECREF(absolutize_function);
   Py_DECREF(deepcopy_function);
+  Py_DECREF(xml_prefix_string);
+  Py_DECREF(xml_namespaces_string);
+  Py_DECREF(get_string);
+  Py_DECREF(evaluate_string);
+  Py_DECREF(node_string);
+  Py_DECREF(position_string);
+  Py_DECREF(size_string);
+  Py_DECREF(namespaces_string);
+  Py_DECREF(zero);
+  Py_CLEAR(select_fallback);
+  Py_CLEAR(context_class);
+  Py_CLEAR(expression_cache);
+  Py_CLEAR(pooled_context);
+  Py_CLEAR(native_namespaces);
+  clear_freelists();
 
   PyType_CLEAR(&DomletteNode_Type);
 }
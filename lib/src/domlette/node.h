@@ -7,10 +7,15 @@ extern "C" {
 
 #include "Python.h"
 
-  /* Node_HEAD defines the initial segment of every Domlette node. */
+  /* Node_HEAD defines the initial segment of every Domlette node.
+   * `docorder` is the node's position in document order; it is only
+   * meaningful while `docorder_stamp` is current (see Node_ORDER_VALID).
+   */
 #define Node_HEAD                      \
     PyObject_HEAD                      \
-    struct NodeObject *parent;
+    struct NodeObject *parent;         \
+    Py_ssize_t docorder;               \
+    Py_ssize_t docorder_stamp;
 
   /* Nothing is actually declared to be a NodeObject, but every pointer to
    * a Domlette object can be cast to a NodeObject*.  This is inheritance
@@ -23,6 +28,8 @@ extern "C" {
 #define Node(op) ((NodeObject *)(op))
 #define Node_GET_PARENT(op) (Node(op)->parent)
 #define Node_SET_PARENT(op, v) (Node_GET_PARENT(op) = (v))
+#define Node_GET_DOCORDER(op) (Node(op)->docorder)
+#define Node_GET_DOCORDER_STAMP(op) (Node(op)->docorder_stamp)
 
 #ifdef Domlette_BUILDING_MODULE
 
@@ -40,8 +47,30 @@ extern "C" {
   void _Node_Del(NodeObject *node);
 #define Node_Del(obj) _Node_Del((NodeObject *)(obj))
 
+  PyObject *Node_FreelistStats(void);
+
   int Node_DispatchEvent(NodeObject *self, PyObject *event, NodeObject *target);
 
+  /* Document order keys
+   *
+   * Every node numbered in the same pass shares a stamp, which the root of
+   * the numbered tree carries as well.  The keys of a node are only trusted
+   * while its stamp is that of its root.  A mutation clears the stamp of
+   * the roots of the trees it changes, which causes the keys of those trees
+   * (and only those) to be rebuilt lazily the next time their nodes are
+   * compared.
+   */
+  extern Py_ssize_t _Node_OrderEpoch;
+
+#define Node_ORDER_VALID(op) Node_OrderValid(Node(op))
+#define Node_NewOrderStamp() (++_Node_OrderEpoch)
+#define Node_SET_DOCORDER(op, stamp, key) \
+  (Node_GET_DOCORDER_STAMP(op) = (stamp), Node_GET_DOCORDER(op) = (key))
+
+  int Node_OrderValid(NodeObject *node);
+  void Node_InvalidateOrder(NodeObject *node);
+  Py_ssize_t Node_NumberTree(NodeObject *root);
+
 #endif /* Domlette_BUILDING_MODULE */
 
 #include "container.h"
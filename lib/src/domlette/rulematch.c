@@ -80,8 +80,10 @@ RuleMatchObject_New(PyObject *contenthandler) {
 
   /* Copy selected handlers of interest */
 
+  /* a handler need not have them all */
 #define GET_CALLBACK(TYPE, NAME)                                        \
-  self->handlers[Handler_##TYPE] = PyObject_GetAttrString(contenthandler, NAME); 
+  self->handlers[Handler_##TYPE] = PyObject_GetAttrString(contenthandler, NAME); \
+  if (self->handlers[Handler_##TYPE] == NULL) PyErr_Clear();
 
   GET_CALLBACK(StartDocument, "startDocument");
   GET_CALLBACK(StartElement, "startElementNS");
@@ -98,9 +100,12 @@ void RuleMatchObject_Del(RuleMatchObject *self) {
       Py_DECREF(self->handlers[i]);
     }
   }
+  Py_DECREF(self->content_handler);
   PyMem_Free(self);
 }
 
+/* Returns 1 if the handler reports that the element matched (by returning
+ * a true value), 0 if not and -1 on error. */
 int RuleMatch_StartElement(RuleMatchObject *self,
 			      PyObject *node,
 			      ExpatName *name,
@@ -108,6 +113,7 @@ int RuleMatch_StartElement(RuleMatchObject *self,
 			      size_t natts) {
   PyObject *handler = self->handlers[Handler_StartElement];
   PyObject *args, *result;
+  int matched = 0;
 
   if (handler != NULL) {
     /* handler.startElement((namespaceURI, localName), tagName, attributes) */
@@ -119,9 +125,10 @@ int RuleMatch_StartElement(RuleMatchObject *self,
     Py_DECREF(args);
     if (result == NULL)
       return -1;
+    matched = PyObject_IsTrue(result);
     Py_DECREF(result);
   }
-  return 0;
+  return matched;
 }
 
 int RuleMatch_EndElement(RuleMatchObject *self, PyObject *node, ExpatName *name)
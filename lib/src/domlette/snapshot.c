@@ -0,0 +1,702 @@
+#define PY_SSIZE_T_CLEAN
+#include "domlette_interface.h"
+#include "snapshot.h"
+
+/* A snapshot is a frozen document written out as is: a header, the node
+ * arrays, the IDs, the text and then the strings (the document URIs and
+ * the names), each section starting on an 8 byte boundary.  As the arrays
+ * are stored in the byte order and word sizes of the machine writing them,
+ * loading a snapshot does not decode them, and a snapshot mapped into
+ * memory is used in place.  This makes it a cache of parsed documents,
+ * which can only be read back on the same kind of platform.
+ *
+ * The strings are each stored as an int length (-1 for None) followed by
+ * that many bytes of UTF-8.
+ */
+
+#define SNAPSHOT_MAGIC "amaradom"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+#define SNAPSHOT_ALIGN(n) (((n) + 7) & ~(PY_LONG_LONG)7)
+
+typedef struct {
+  char magic[8];
+  int byte_order;
+  int version;
+  int offset_size;              /* sizeof(Py_ssize_t) */
+  int reserved;
+  PY_LONG_LONG count;
+  PY_LONG_LONG text_size;
+  PY_LONG_LONG names_count;
+  PY_LONG_LONG ids_count;
+  PY_LONG_LONG strings_size;
+} SnapshotHeader;
+
+/* The offsets of the sections from the start of the snapshot */
+typedef struct {
+  PY_LONG_LONG kinds;
+  PY_LONG_LONG parents;
+  PY_LONG_LONG first_children;
+  PY_LONG_LONG next_siblings;
+  PY_LONG_LONG names;
+  PY_LONG_LONG values;
+  PY_LONG_LONG ids;
+  PY_LONG_LONG text;
+  PY_LONG_LONG strings;
+  PY_LONG_LONG end;
+} SnapshotLayout;
+
+static void snapshot_layout(SnapshotHeader *header, SnapshotLayout *layout)
+{
+  PY_LONG_LONG count = header->count;
+
+  layout->kinds = SNAPSHOT_ALIGN(sizeof(SnapshotHeader));
+  layout->parents = SNAPSHOT_ALIGN(layout->kinds + count);
+  layout->first_children = SNAPSHOT_ALIGN(layout->parents +
+                                          count * sizeof(int));
+  layout->next_siblings = SNAPSHOT_ALIGN(layout->first_children +
+                                         count * sizeof(int));
+  layout->names = SNAPSHOT_ALIGN(layout->next_siblings + count * sizeof(int));
+  layout->values = SNAPSHOT_ALIGN(layout->names + count * sizeof(int));
+  layout->ids = SNAPSHOT_ALIGN(layout->values +
+                               (count + 1) * sizeof(Py_ssize_t));
+  layout->text = SNAPSHOT_ALIGN(layout->ids +
+                                header->ids_count * sizeof(int));
+  layout->strings = SNAPSHOT_ALIGN(layout->text + header->text_size);
+  layout->end = layout->strings + header->strings_size;
+}
+
+/** Writing ***********************************************************/
+
+/* Adds `string` (None or unicode) to the strings section */
+static int strings_append(PyObject *strings, PyObject *string)
+{
+  PyObject *utf8, *item;
+  int size;
+
+  if (string == Py_None) {
+    size = -1;
+    item = PyString_FromStringAndSize((char *)&size, sizeof(int));
+  } else {
+    utf8 = PyUnicode_AsUTF8String(string);
+    if (utf8 == NULL)
+      return -1;
+    if (PyString_GET_SIZE(utf8) > INT_MAX) {
+      PyErr_SetString(PyExc_OverflowError, "string too long for a snapshot");
+      Py_DECREF(utf8);
+      return -1;
+    }
+    size = (int)PyString_GET_SIZE(utf8);
+    item = PyString_FromStringAndSize(NULL, sizeof(int) + size);
+    if (item != NULL) {
+      memcpy(PyString_AS_STRING(item), &size, sizeof(int));
+      memcpy(PyString_AS_STRING(item) + sizeof(int),
+             PyString_AS_STRING(utf8), size);
+    }
+    Py_DECREF(utf8);
+  }
+  if (item == NULL)
+    return -1;
+  size = PyList_Append(strings, item);
+  Py_DECREF(item);
+  return size;
+}
+
+/* Returns the strings section of `document` */
+static PyObject *snapshot_strings(FrozenDocumentObject *document)
+{
+  PyObject *strings, *separator, *result;
+  Py_ssize_t i, j;
+
+  strings = PyList_New(0);
+  if (strings == NULL)
+    return NULL;
+  if (strings_append(strings, document->documentURI) < 0 ||
+      strings_append(strings, document->publicId) < 0 ||
+      strings_append(strings, document->systemId) < 0)
+    goto error;
+  for (i = 0; i < PyList_GET_SIZE(document->names_table); i++) {
+    PyObject *name = PyList_GET_ITEM(document->names_table, i);
+    for (j = 0; j < 3; j++) {
+      if (strings_append(strings, PyTuple_GET_ITEM(name, j)) < 0)
+        goto error;
+    }
+  }
+  separator = PyString_FromStringAndSize(NULL, 0);
+  if (separator == NULL)
+    goto error;
+  result = _PyString_Join(separator, strings);
+  Py_DECREF(separator);
+  Py_DECREF(strings);
+  return result;
+
+ error:
+  Py_DECREF(strings);
+  return NULL;
+}
+
+/* Writes `size` bytes and the padding to the next section, keeping track
+ * of the `offset` in the snapshot */
+static int write_section(PyObject *write, const void *data, Py_ssize_t size,
+                         PY_LONG_LONG *offset)
+{
+  static const char padding[8];
+  PyObject *buffer, *result;
+  Py_ssize_t pad;
+
+  pad = (Py_ssize_t)(SNAPSHOT_ALIGN(*offset + size) - (*offset + size));
+  /* the sections are passed as buffers to spare copying them */
+  if (size > 0) {
+    buffer = PyBuffer_FromMemory((void *)data, size);
+    if (buffer == NULL)
+      return -1;
+    result = PyObject_CallFunctionObjArgs(write, buffer, NULL);
+    Py_DECREF(buffer);
+    if (result == NULL)
+      return -1;
+    Py_DECREF(result);
+  }
+  if (pad > 0) {
+    result = PyObject_CallFunction(write, "s#", padding, pad);
+    if (result == NULL)
+      return -1;
+    Py_DECREF(result);
+  }
+  *offset += size + pad;
+  return 0;
+}
+
+static int snapshot_write(FrozenDocumentObject *document, PyObject *write)
+{
+  SnapshotHeader header;
+  PyObject *strings, *key, *value;
+  int *ids = NULL;
+  Py_ssize_t count = document->count, i, pos;
+  PY_LONG_LONG offset = 0;
+  int result = -1;
+
+  strings = snapshot_strings(document);
+  if (strings == NULL)
+    return -1;
+  if (document->ids) {
+    ids = PyMem_New(int, PyDict_Size(document->ids) + 1);
+    if (ids == NULL) {
+      PyErr_NoMemory();
+      goto finally;
+    }
+    i = pos = 0;
+    while (PyDict_Next(document->ids, &pos, &key, &value))
+      ids[i++] = (int)PyInt_AS_LONG(value);
+  }
+
+  memset(&header, 0, sizeof(SnapshotHeader));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.version = SNAPSHOT_VERSION;
+  header.offset_size = sizeof(Py_ssize_t);
+  header.count = count;
+  header.text_size = document->text_size;
+  header.names_count = PyList_GET_SIZE(document->names_table);
+  header.ids_count = document->ids ? PyDict_Size(document->ids) : 0;
+  header.strings_size = PyString_GET_SIZE(strings);
+
+  if (write_section(write, &header, sizeof(SnapshotHeader), &offset) < 0 ||
+      write_section(write, document->kinds, count, &offset) < 0 ||
+      write_section(write, document->parents, count * sizeof(int),
+                    &offset) < 0 ||
+      write_section(write, document->first_children, count * sizeof(int),
+                    &offset) < 0 ||
+      write_section(write, document->next_siblings, count * sizeof(int),
+                    &offset) < 0 ||
+      write_section(write, document->names, count * sizeof(int),
+                    &offset) < 0 ||
+      write_section(write, document->values, (count + 1) * sizeof(Py_ssize_t),
+                    &offset) < 0 ||
+      write_section(write, ids, (Py_ssize_t)header.ids_count * sizeof(int),
+                    &offset) < 0 ||
+      write_section(write, document->text, document->text_size,
+                    &offset) < 0 ||
+      write_section(write, PyString_AS_STRING(strings),
+                    PyString_GET_SIZE(strings), &offset) < 0)
+    goto finally;
+  result = 0;
+
+ finally:
+  PyMem_Free(ids);
+  Py_DECREF(strings);
+  return result;
+}
+
+PyObject *Snapshot_Dump(PyObject *node, PyObject *file)
+{
+  FrozenDocumentObject *document;
+  PyObject *stream, *write, *result;
+  int status;
+
+  if (FrozenNode_Check(node)) {
+    document = FrozenNode_GET_DOCUMENT(node);
+    Py_INCREF(document);
+  } else {
+    document = Frozen_FromTree(Entity(node));
+    if (document == NULL)
+      return NULL;
+  }
+
+  /* a file name is opened (and closed) here */
+  if (PyString_Check(file) || PyUnicode_Check(file))
+    stream = PyObject_CallFunction((PyObject *)&PyFile_Type, "Os", file, "wb");
+  else {
+    stream = file;
+    Py_INCREF(stream);
+  }
+  if (stream == NULL) {
+    Py_DECREF(document);
+    return NULL;
+  }
+  write = PyObject_GetAttrString(stream, "write");
+  if (write == NULL)
+    status = -1;
+  else {
+    status = snapshot_write(document, write);
+    Py_DECREF(write);
+  }
+  Py_DECREF(document);
+
+  if (stream != file) {
+    PyObject *type, *value, *traceback;
+    PyErr_Fetch(&type, &value, &traceback);
+    result = PyObject_CallMethod(stream, "close", NULL);
+    if (result == NULL)
+      status = -1;
+    Py_XDECREF(result);
+    if (type)
+      PyErr_Restore(type, value, traceback);
+  }
+  Py_DECREF(stream);
+  if (status < 0)
+    return NULL;
+  Py_RETURN_NONE;
+}
+
+/** Loading ***********************************************************/
+
+static PyObject *snapshot_error(const char *reason)
+{
+  PyErr_Format(PyExc_ValueError, "invalid snapshot: %s", reason);
+  return NULL;
+}
+
+/* Reads the next string of the strings section into `*result` (a new
+ * reference), sharing equal strings through `strings` */
+static const char *read_string(const char *p, const char *end,
+                               PyObject *strings, PyObject **result)
+{
+  PyObject *string, *shared;
+  int size;
+
+  if (end - p < (Py_ssize_t)sizeof(int)) {
+    snapshot_error("truncated strings");
+    return NULL;
+  }
+  memcpy(&size, p, sizeof(int));
+  p += sizeof(int);
+  if (size == -1) {
+    Py_INCREF(Py_None);
+    *result = Py_None;
+    return p;
+  }
+  if (size < 0 || end - p < size) {
+    snapshot_error("truncated strings");
+    return NULL;
+  }
+  string = PyUnicode_DecodeUTF8(p, size, "strict");
+  if (string == NULL)
+    return NULL;
+  shared = PyDict_GetItem(strings, string);
+  if (shared) {
+    Py_DECREF(string);
+    Py_INCREF(shared);
+    string = shared;
+  } else if (PyDict_SetItem(strings, string, string) < 0) {
+    Py_DECREF(string);
+    return NULL;
+  }
+  *result = string;
+  return p + size;
+}
+
+static int snapshot_read_strings(FrozenDocumentObject *document,
+                                 const char *p, const char *end,
+                                 Py_ssize_t names_count)
+{
+  PyObject *strings, *name, *item;
+  Py_ssize_t i, j;
+
+  strings = PyDict_New();
+  if (strings == NULL)
+    return -1;
+  if ((p = read_string(p, end, strings, &document->documentURI)) == NULL ||
+      (p = read_string(p, end, strings, &document->publicId)) == NULL ||
+      (p = read_string(p, end, strings, &document->systemId)) == NULL)
+    goto error;
+  document->names_table = PyList_New(names_count);
+  if (document->names_table == NULL)
+    goto error;
+  for (i = 0; i < names_count; i++) {
+    name = PyTuple_New(3);
+    if (name == NULL)
+      goto error;
+    PyList_SET_ITEM(document->names_table, i, name);
+    for (j = 0; j < 3; j++) {
+      if ((p = read_string(p, end, strings, &item)) == NULL)
+        goto error;
+      PyTuple_SET_ITEM(name, j, item);
+    }
+  }
+  Py_DECREF(strings);
+  return 0;
+
+ error:
+  Py_DECREF(strings);
+  return -1;
+}
+
+#define CHILD_KINDS ((1 << FROZEN_ELEMENT) | (1 << FROZEN_TEXT) | \
+                     (1 << FROZEN_COMMENT) | \
+                     (1 << FROZEN_PROCESSING_INSTRUCTION))
+
+/* Verifies that the arrays describe a document as built by the parser:
+ * rows in document order, an element's namespaces and then attributes
+ * right after it, and sibling links that agree with the parents.  Nothing
+ * else is needed for the indexes in a loaded document to be safe to use.
+ */
+static int snapshot_check(FrozenDocumentObject *document)
+{
+  Py_ssize_t count = document->count;
+  Py_ssize_t names_count = PyList_GET_SIZE(document->names_table);
+  Py_ssize_t depth, allocated = 32;
+  int *open, *last;
+  const char *reason = NULL;
+  PyObject *prefix;
+  int i, kind, parent, name;
+
+  /* the values must be increasing offsets into the text */
+  if (document->values[0] != 0 ||
+      document->values[count] != document->text_size)
+    reason = "bad text offsets";
+  for (i = 0; i < count && reason == NULL; i++) {
+    if (document->values[i] > document->values[i + 1])
+      reason = "bad text offsets";
+  }
+  if (reason) {
+    snapshot_error(reason);
+    return -1;
+  }
+
+  /* the document node and the declaration of the `xml` prefix */
+  if (count < 2 ||
+      document->kinds[0] != FROZEN_ENTITY ||
+      document->parents[0] != FROZEN_NONE ||
+      document->next_siblings[0] != FROZEN_NONE ||
+      document->names[0] != FROZEN_NONE ||
+      document->kinds[1] != FROZEN_NAMESPACE ||
+      document->parents[1] != 0 ||
+      document->first_children[1] != FROZEN_NONE ||
+      document->next_siblings[1] != FROZEN_NONE ||
+      document->values[1] == document->values[2] ||
+      document->names[1] < 0 || document->names[1] >= names_count) {
+    snapshot_error("bad document node");
+    return -1;
+  }
+  for (name = 1; name <= 2; name++) {
+    prefix = PyTuple_GET_ITEM(Frozen_GET_NAME(document, 1), name);
+    if (prefix == Py_None || PyUnicode_GET_SIZE(prefix) != 3 ||
+        PyUnicode_AS_UNICODE(prefix)[0] != 'x' ||
+        PyUnicode_AS_UNICODE(prefix)[1] != 'm' ||
+        PyUnicode_AS_UNICODE(prefix)[2] != 'l') {
+      snapshot_error("bad document node");
+      return -1;
+    }
+  }
+
+  open = PyMem_New(int, allocated);
+  last = PyMem_New(int, allocated);
+  if (open == NULL || last == NULL) {
+    PyErr_NoMemory();
+    goto finally;
+  }
+  open[0] = 0;
+  last[0] = FROZEN_NONE;
+  depth = 1;
+
+#define CLOSE()                                                         \
+  do {                                                                  \
+    depth--;                                                            \
+    if (last[depth] == FROZEN_NONE ?                                    \
+        document->first_children[open[depth]] != FROZEN_NONE :          \
+        document->next_siblings[last[depth]] != FROZEN_NONE)            \
+      reason = "bad child links";                                       \
+  } while (0)
+
+  for (i = 2; i < count && reason == NULL; i++) {
+    kind = document->kinds[i];
+    parent = document->parents[i];
+    name = document->names[i];
+    if (kind == FROZEN_ENTITY || kind > FROZEN_PROCESSING_INSTRUCTION) {
+      reason = "bad node kind";
+      break;
+    }
+
+    /* named nodes refer to the names table, others have no name */
+    switch (kind) {
+      case FROZEN_ELEMENT:
+      case FROZEN_ATTRIBUTE:
+      case FROZEN_PROCESSING_INSTRUCTION:
+        if (name < 0 || name >= names_count ||
+            Frozen_GET_QNAME(document, i) == Py_None ||
+            Frozen_GET_LOCAL_NAME(document, i) == Py_None)
+          reason = "bad node name";
+        break;
+      case FROZEN_NAMESPACE:
+        if (name < 0 || name >= names_count)
+          reason = "bad node name";
+        break;
+      default:
+        if (name != FROZEN_NONE)
+          reason = "bad node name";
+        break;
+    }
+
+    /* the parent has to be one of the open containers */
+    while (depth > 0 && open[depth - 1] != parent && reason == NULL)
+      CLOSE();
+    if (depth == 0 || reason) {
+      if (reason == NULL)
+        reason = "bad parent";
+      break;
+    }
+
+    if (kind == FROZEN_NAMESPACE || kind == FROZEN_ATTRIBUTE) {
+      /* on elements only, before any children */
+      if (last[depth - 1] != FROZEN_NONE || parent == 0 ||
+          (kind == FROZEN_NAMESPACE &&
+           document->kinds[i - 1] == FROZEN_ATTRIBUTE) ||
+          document->first_children[i] != FROZEN_NONE ||
+          document->next_siblings[i] != FROZEN_NONE)
+        reason = "misplaced attribute or namespace";
+      continue;
+    }
+    if (last[depth - 1] == FROZEN_NONE) {
+      if (document->first_children[parent] != i)
+        reason = "bad child links";
+    } else if (document->next_siblings[last[depth - 1]] != i) {
+      reason = "bad child links";
+    }
+    last[depth - 1] = i;
+    if (kind != FROZEN_ELEMENT) {
+      if (document->first_children[i] != FROZEN_NONE)
+        reason = "bad child links";
+      continue;
+    }
+    if (depth == allocated) {
+      int *new_open = open, *new_last = last;
+      allocated <<= 1;
+      if (PyMem_Resize(new_open, int, allocated) == NULL) {
+        PyErr_NoMemory();
+        goto finally;
+      }
+      open = new_open;
+      if (PyMem_Resize(new_last, int, allocated) == NULL) {
+        PyErr_NoMemory();
+        goto finally;
+      }
+      last = new_last;
+    }
+    open[depth] = i;
+    last[depth] = FROZEN_NONE;
+    depth++;
+  }
+  while (depth > 0 && reason == NULL)
+    CLOSE();
+#undef CLOSE
+
+  PyMem_Free(open);
+  PyMem_Free(last);
+  if (reason) {
+    snapshot_error(reason);
+    return -1;
+  }
+  return 0;
+
+ finally:
+  PyMem_Free(open);
+  PyMem_Free(last);
+  return -1;
+}
+
+/* Rebuilds the ID map from the list of ID attributes */
+static int snapshot_read_ids(FrozenDocumentObject *document, const int *ids,
+                             Py_ssize_t ids_count)
+{
+  PyObject *id, *index;
+  Py_ssize_t i;
+
+  if (ids_count == 0)
+    return 0;
+  document->ids = PyDict_New();
+  if (document->ids == NULL)
+    return -1;
+  for (i = 0; i < ids_count; i++) {
+    if (ids[i] <= 0 || ids[i] >= document->count ||
+        document->kinds[ids[i]] != FROZEN_ATTRIBUTE) {
+      snapshot_error("bad ID");
+      return -1;
+    }
+    id = Frozen_GetValue(document, ids[i]);
+    if (id == NULL)
+      return -1;
+    index = PyInt_FromLong(ids[i]);
+    if (index == NULL || PyDict_SetItem(document->ids, id, index) < 0) {
+      Py_XDECREF(index);
+      Py_DECREF(id);
+      return -1;
+    }
+    Py_DECREF(index);
+    Py_DECREF(id);
+  }
+  return 0;
+}
+
+/* Returns the tree of `document` with the garbage collector disabled
+ * while it is built (as the parser does) */
+static PyObject *snapshot_thaw(FrozenDocumentObject *document)
+{
+  PyObject *gc, *enabled, *result;
+  int gc_enabled;
+
+  gc = PyImport_ImportModule("gc");
+  if (gc == NULL)
+    return NULL;
+  enabled = PyObject_CallMethod(gc, "isenabled", NULL);
+  if (enabled == NULL) {
+    Py_DECREF(gc);
+    return NULL;
+  }
+  gc_enabled = PyObject_IsTrue(enabled);
+  Py_DECREF(enabled);
+  if (gc_enabled) {
+    result = PyObject_CallMethod(gc, "disable", NULL);
+    if (result == NULL) {
+      Py_DECREF(gc);
+      return NULL;
+    }
+    Py_DECREF(result);
+  }
+  result = (PyObject *)Frozen_ToTree(document);
+  if (gc_enabled) {
+    enabled = PyObject_CallMethod(gc, "enable", NULL);
+    if (enabled == NULL)
+      Py_CLEAR(result);
+    Py_XDECREF(enabled);
+  }
+  Py_DECREF(gc);
+  return result;
+}
+
+PyObject *Domlette_LoadSnapshot(PyObject *self, PyObject *args, PyObject *kw)
+{
+  static char *kwlist[] = { "data", "readonly", NULL };
+  PyObject *data, *result;
+  int readonly = 0;
+  const void *buffer;
+  const char *base;
+  Py_ssize_t size;
+  SnapshotHeader header;
+  SnapshotLayout layout;
+  FrozenDocumentObject *document;
+
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O|i:load_snapshot", kwlist,
+                                   &data, &readonly))
+    return NULL;
+  if (PyObject_AsReadBuffer(data, &buffer, &size) < 0)
+    return NULL;
+
+  if (size < (Py_ssize_t)sizeof(SnapshotHeader))
+    return snapshot_error("truncated header");
+  memcpy(&header, buffer, sizeof(SnapshotHeader));
+  if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+    return snapshot_error("not a snapshot");
+  if (header.byte_order != SNAPSHOT_BYTE_ORDER ||
+      header.offset_size != sizeof(Py_ssize_t))
+    return snapshot_error("written on a different platform");
+  if (header.version != SNAPSHOT_VERSION)
+    return snapshot_error("unsupported version");
+  if (header.count < 1 || header.count >= INT_MAX ||
+      header.names_count < 0 || header.names_count >= INT_MAX ||
+      header.ids_count < 0 || header.ids_count > header.count ||
+      header.text_size < 0 || header.text_size > size ||
+      header.strings_size < 0 || header.strings_size > size ||
+      /* each name takes at least three lengths */
+      header.names_count > header.strings_size / (3 * sizeof(int)))
+    return snapshot_error("bad header");
+  snapshot_layout(&header, &layout);
+  if (layout.end > size)
+    return snapshot_error("truncated");
+
+  document = PyObject_New(FrozenDocumentObject, &DomletteFrozenDocument_Type);
+  if (document == NULL)
+    return NULL;
+  document->storage = NULL;
+  document->kinds = NULL;
+  document->parents = document->first_children = NULL;
+  document->next_siblings = document->names = NULL;
+  document->values = NULL;
+  document->text = NULL;
+  document->names_table = NULL;
+  document->ids = NULL;
+  document->documentURI = NULL;
+  document->publicId = NULL;
+  document->systemId = NULL;
+  /* the arrays are used in place if suitably aligned (as when the snapshot
+   * is mapped into memory), otherwise from a copy */
+  if (((Py_uintptr_t)buffer & 7) == 0) {
+    Py_INCREF(data);
+    document->storage = data;
+    base = (const char *)buffer;
+  } else {
+    document->storage = PyByteArray_FromStringAndSize(buffer, size);
+    if (document->storage == NULL) {
+      Py_DECREF(document);
+      return NULL;
+    }
+    base = PyByteArray_AS_STRING(document->storage);
+  }
+  document->count = document->allocated = (Py_ssize_t)header.count;
+  document->kinds = (unsigned char *)(base + layout.kinds);
+  document->parents = (int *)(base + layout.parents);
+  document->first_children = (int *)(base + layout.first_children);
+  document->next_siblings = (int *)(base + layout.next_siblings);
+  document->names = (int *)(base + layout.names);
+  document->values = (Py_ssize_t *)(base + layout.values);
+  document->text = (char *)(base + layout.text);
+  document->text_size = (Py_ssize_t)header.text_size;
+  document->text_allocated = document->text_size;
+
+  if (snapshot_read_strings(document, base + layout.strings,
+                            base + layout.end,
+                            (Py_ssize_t)header.names_count) < 0 ||
+      snapshot_check(document) < 0 ||
+      snapshot_read_ids(document, (const int *)(base + layout.ids),
+                        (Py_ssize_t)header.ids_count) < 0) {
+    Py_DECREF(document);
+    return NULL;
+  }
+
+  if (readonly)
+    result = FrozenNode_New(document, 0, FROZEN_NONE);
+  else
+    result = snapshot_thaw(document);
+  Py_DECREF(document);
+  return result;
+}
@@ -0,0 +1,25 @@
+#ifndef DOMLETTE_SNAPSHOT_H
+#define DOMLETTE_SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "Python.h"
+
+#ifdef Domlette_BUILDING_MODULE
+
+  /* Writes the document of `node` (an entity or a frozen entity) to
+   * `file`, a file name or an object with a `write` method */
+  PyObject *Snapshot_Dump(PyObject *node, PyObject *file);
+
+  PyObject *Domlette_LoadSnapshot(PyObject *self, PyObject *args,
+                                  PyObject *kw);
+
+#endif /* Domlette_BUILDING_MODULE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DOMLETTE_SNAPSHOT_H */
@@ -76,6 +76,11 @@ Expat wrapper library";
 #include "sax_handler.h"         /* Python SAX interface */
 #include "util.h"
 #include "debug.h"              /* debugging support */
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
 
 /** Private Interface *************************************************/
 
@@ -91,8 +96,12 @@ Expat wrapper library";
 
 /* using a 64K buffer helps read performance for large documents */
 #define EXPAT_BUFSIZ   65536
+/* zero-copy input is handed to Expat in slices of at most 1G */
+#define EXPAT_SLICESIZ (1 << 30)
 /* 8K buffer should be plenty for most documents (it does resize if needed) */
 #define XMLCHAR_BUFSIZ 8192
+/* attribute values are interned until this many distinct ones are seen */
+#define VALUE_CACHE_MAX 8192
 
 static PyObject *read_string;
 static PyObject *empty_string;
@@ -163,6 +172,42 @@ struct ExpatHandlerStruct {
   ExpatHandlerFuncs handlers;
 };
 
+/* Events recorded while Expat tokenizes a buffer without the GIL. */
+typedef enum {
+  EVENT_START_ELEMENT,
+  EVENT_END_ELEMENT,
+  EVENT_CHARACTER_DATA,
+  EVENT_PROCESSING_INSTRUCTION,
+  EVENT_COMMENT,
+  EVENT_START_NAMESPACE,
+  EVENT_END_NAMESPACE,
+  EVENT_START_CDATA,
+  EVENT_END_CDATA,
+} EventType;
+
+/* An Event is followed by its XML_Char strings, each NUL-terminated (or, for
+ * character data, `length` characters). */
+typedef struct {
+  EventType type;
+  int length;                   /* number of strings (or characters) */
+  unsigned int nulls;           /* bit N set if string N is NULL */
+  int id_index;                 /* XML_GetIdAttributeIndex() */
+  XML_Size line;                /* XML_GetCurrentLineNumber() */
+  XML_Size column;              /* XML_GetCurrentColumnNumber() */
+  size_t size;                  /* size of the record, including strings */
+} Event;
+
+typedef struct {
+  char *data;
+  size_t size;
+  size_t used;
+  size_t last;                  /* offset of the last event plus one */
+  int failed;                   /* out of memory while recording */
+  int stopped;                  /* parsing was stopped by a handler */
+  const XML_Char **atts;        /* attribute array used for replay */
+  size_t atts_size;
+} EventQueue;
+
 typedef struct Context {
   struct Context *next;
   XML_Parser parser;            /* the Expat parser */
@@ -176,6 +221,14 @@ typedef struct Context {
   PyObject *xml_lang;
   DTD *dtd;
   ExpatHandler *handler;          /* Handler object */
+  const char *input;            /* zero-copy input (mapped or borrowed) */
+  Py_ssize_t input_pos;         /* offset of the next slice in `input` */
+  Py_ssize_t input_len;         /* total length of `input` */
+  void *mapping;                /* the mmap()ed region backing `input` */
+  size_t mapping_len;
+  EventQueue *events;           /* NULL if the handlers are called directly */
+  PyThreadState *thread_state;  /* set while the GIL is released */
+  const Event *event;           /* the event being replayed */
 } Context;
 
 /* This flag marks that certain infoset properties need to be adjusted for
@@ -185,6 +238,14 @@ typedef struct Context {
 /* This flag indicates that DTD validation should be performed. */
 #define EXPAT_FLAG_VALIDATE             (1L<<1)
 
+/* This flag indicates that the input source asked for zero-copy input and
+ * it has not yet been set up. */
+#define EXPAT_FLAG_ZERO_COPY            (1L<<2)
+
+/* This flag indicates that Expat calls back into Python while tokenizing (a
+ * Python codec is used for decoding), so the GIL must be kept. */
+#define EXPAT_FLAG_HOLD_GIL             (1L<<3)
+
 #define Expat_HasFlag(p,f) (((p)->context->flags & (f)) == (f))
 #define Expat_SetFlag(p,f) ((p)->context->flags |= (f))
 #define Expat_ClearFlag(p,f) ((p)->context->flags &= ~(f))
@@ -228,10 +289,13 @@ struct ExpatReaderStruct {
   ExpatHandler handler;          /* Event handler */
 
   /* caching members */
-  HashTable *name_cache;        /* element name parts */
+  HashTable *name_cache;        /* names beyond the shared ones */
   HashTable *unicode_cache;     /* XMLChar to unicode mapping */
+  HashTable *value_cache;       /* same, for attribute values (bounded) */
   ExpatAttribute *attrs;        /* reusable attributes list */
   size_t attrs_size;            /* allocated size of attributes list */
+  XML_Parser spare_parser;      /* document parser kept for the next parse */
+  EventQueue *spare_events;     /* and its event queue */
 
   /* character data buffering */
   XML_Char *buffer;             /* buffer used for accumulating characters */
@@ -262,6 +326,7 @@ struct ExpatReaderStruct {
 #define ExpatReader_ENTITY_RESOLVER      (1L<<3)
 #define ExpatReader_ERROR_HANDLERS       (1L<<4)
 #define ExpatReader_DTD_DECLARATIONS     (1L<<5)
+#define ExpatReader_SYNCHRONOUS          (1L<<6)
 
 /** DTD ***************************************************************/
 
@@ -456,6 +521,27 @@ FUNCTION_OBJ_ARGS(FatalError, fatal_error, 1)
  * fashion.
  */
 
+/* The queue is filled without the GIL, so it uses the C library allocator. */
+Py_LOCAL_INLINE(EventQueue *) EventQueue_New(void)
+{
+  EventQueue *queue;
+
+  queue = (EventQueue *) malloc(sizeof(EventQueue));
+  if (queue == NULL) {
+    PyErr_NoMemory();
+    return NULL;
+  }
+  memset(queue, 0, sizeof(EventQueue));
+  return queue;
+}
+
+Py_LOCAL_INLINE(void) EventQueue_Del(EventQueue *queue)
+{
+  free(queue->data);
+  free((void *)queue->atts);
+  free(queue);
+}
+
 Py_LOCAL(Context *) Context_New(XML_Parser parser, PyObject *source)
 {
   Context *context;
@@ -484,6 +570,8 @@ Py_LOCAL(Context *) Context_New(XML_Parser parser, PyObject *source)
     context->uri = InputSource_GET_BASE_URI(source);
     context->stream = InputSource_GET_BYTE_STREAM(source);
     context->encoding = InputSource_GET_ENCODING(source);
+    if (InputSource_GET_ZERO_COPY(source))
+      context->flags |= EXPAT_FLAG_ZERO_COPY;
   }
   Py_INCREF(source);
   Py_INCREF(context->uri);
@@ -505,10 +593,34 @@ Context_Del(Context *context)
   Py_DECREF(context->encoding);
   if (context->dtd)
     DTD_Del(context->dtd);
+#ifdef HAVE_MMAP
+  if (context->mapping)
+    munmap(context->mapping, context->mapping_len);
+#endif
+  if (context->events)
+    EventQueue_Del(context->events);
 
   PyObject_FREE(context);
 }
 
+/* The location of the current event; for a replayed event, the location
+ * recorded when Expat reported it. */
+Py_LOCAL_INLINE(XML_Size)
+Context_GetLineNumber(Context *context)
+{
+  if (context->event)
+    return context->event->line;
+  return XML_GetCurrentLineNumber(context->parser);
+}
+
+Py_LOCAL_INLINE(XML_Size)
+Context_GetColumnNumber(Context *context)
+{
+  if (context->event)
+    return context->event->column;
+  return XML_GetCurrentColumnNumber(context->parser);
+}
+
 /* Create a new Context object and set it as the current parsing context */
 Py_LOCAL(ExpatStatus)
 begin_context(ExpatReader *reader, XML_Parser parser, PyObject *source)
@@ -521,6 +633,25 @@ begin_context(ExpatReader *reader, XML_Parser parser, PyObject *source)
 
   if (context == NULL) return EXPAT_STATUS_ERROR;
 
+  /* Expat tokenizes without the GIL unless the handlers must be called
+   * synchronously (to suspend parsing from within a handler, for example) */
+  if (!ExpatReader_HasFlag(reader, ExpatReader_SYNCHRONOUS)) {
+    if (reader->spare_events) {
+      context->events = reader->spare_events;
+      reader->spare_events = NULL;
+      context->events->used = context->events->last = 0;
+      context->events->failed = context->events->stopped = 0;
+    } else {
+      context->events = EventQueue_New();
+    }
+    if (context->events == NULL) {
+      /* the parser remains owned by the caller */
+      context->parser = NULL;
+      Context_Del(context);
+      return EXPAT_STATUS_ERROR;
+    }
+  }
+
   /* Make it the active context */
   context->next = reader->context;
   reader->context = context;
@@ -585,11 +716,27 @@ end_context(ExpatReader *reader)
     Py_DECREF(temp);
 
     reader->context = context->next;
+    /* the document parser (always from create_parser()) is kept */
+    if (reader->context == NULL && reader->spare_parser == NULL) {
+      reader->spare_parser = context->parser;
+      context->parser = NULL;
+    }
+    if (context->events && reader->spare_events == NULL) {
+      reader->spare_events = context->events;
+      context->events = NULL;
+    }
     Context_Del(context);
   }
 }
 
 
+#define Stack_TRIM(stack) do {               \
+  while ((stack)->size > 1) {                   \
+    PyObject *temp = Stack_Pop(stack);          \
+    Py_DECREF(temp);                            \
+  }                                             \
+} while (0)
+
 /* Deallocate ALL Contexts that exist */
 Py_LOCAL_INLINE(void)
 destroy_contexts(ExpatReader *reader)
@@ -599,6 +746,14 @@ destroy_contexts(ExpatReader *reader)
   while (reader->context) {
     end_context(reader);
   }
+
+  /* Drop whatever an aborted parse left behind, so that the reader starts
+   * the next parse just as a new one would. */
+  Stack_TRIM(reader->xml_base_stack);
+  Stack_TRIM(reader->xml_lang_stack);
+  Stack_TRIM(reader->xml_space_stack);
+  Stack_TRIM(reader->preserve_whitespace_stack);
+  reader->buffer_used = 0;
 }
 
 /** XML_Handlers ******************************************************/
@@ -660,6 +815,65 @@ static int expat_ExternalEntityRef(XML_Parser parser,
                                    const XML_Char *systemId,
                                    const XML_Char *publicId);
 
+/* Deferred event handlers, used while the GIL is released.  The queue_*
+ * handlers record the event for later replay, the sync_* handlers take the
+ * GIL back and replay the queue before calling the real handler. */
+static void queue_StartElement(ExpatReader *reader,
+                               const XML_Char *name,
+                               const XML_Char **atts);
+static void queue_EndElement(ExpatReader *reader, const XML_Char *name);
+static void queue_CharacterData(ExpatReader *reader,
+                                const XML_Char *s,
+                                int len);
+static void queue_ProcessingInstruction(ExpatReader *reader,
+                                        const XML_Char *target,
+                                        const XML_Char *data);
+static void queue_Comment(ExpatReader *reader, const XML_Char *data);
+static void queue_StartNamespaceDecl(ExpatReader *reader,
+                                     const XML_Char *prefix,
+                                     const XML_Char *uri);
+static void queue_EndNamespaceDecl(ExpatReader *reader,
+                                   const XML_Char *prefix);
+static void queue_StartCdataSection(ExpatReader *reader);
+static void queue_EndCdataSection(ExpatReader *reader);
+static void sync_SkippedEntity(ExpatReader *reader,
+                               const XML_Char *entityName,
+                               int is_parameter_entity);
+static void sync_StartDoctypeDecl(ExpatReader *reader,
+                                  const XML_Char *name,
+                                  const XML_Char *sysid,
+                                  const XML_Char *pubid,
+                                  int has_internal_subset);
+static void sync_EndDoctypeDecl(ExpatReader *reader);
+static void sync_ElementDecl(ExpatReader *reader,
+                             const XML_Char *name,
+                             XML_Content *content);
+static void sync_AttlistDecl(ExpatReader *reader,
+                             const XML_Char *elname,
+                             const XML_Char *attname,
+                             const XML_Char *att_type,
+                             const XML_Char *dflt,
+                             int isrequired);
+static void sync_EntityDecl(ExpatReader *reader,
+                            const XML_Char *entity_name,
+                            int is_parameter_entity,
+                            const XML_Char *value,
+                            int value_length,
+                            const XML_Char *base,
+                            const XML_Char *systemId,
+                            const XML_Char *publicId,
+                            const XML_Char *notationName);
+static void sync_NotationDecl(ExpatReader *reader,
+                              const XML_Char *notationName,
+                              const XML_Char *base,
+                              const XML_Char *systemId,
+                              const XML_Char *publicId);
+static int sync_ExternalEntityRef(XML_Parser parser,
+                                  const XML_Char *context,
+                                  const XML_Char *base,
+                                  const XML_Char *systemId,
+                                  const XML_Char *publicId);
+
 static XML_Handlers expat_handlers = {
   (XML_StartElementHandler)expat_StartElement,
   (XML_EndElementHandler)expat_EndElement,
@@ -714,9 +928,68 @@ XML_Handlers_Copy(XML_Handlers *handlers)
   return new_handlers;
 }
 
+#define DEFERRED(handlers, name, handler) \
+  ((handlers)->name ? (handler) : NULL)
+
 Py_LOCAL_INLINE(void)
-setup_handlers(XML_Parser parser, XML_Handlers *handlers)
+setup_deferred_handlers(XML_Parser parser, XML_Handlers *handlers)
 {
+  XML_SetElementHandler(parser,
+        DEFERRED(handlers, start_element,
+                 (XML_StartElementHandler) queue_StartElement),
+        DEFERRED(handlers, end_element,
+                 (XML_EndElementHandler) queue_EndElement));
+  XML_SetCharacterDataHandler(parser,
+        DEFERRED(handlers, character_data,
+                 (XML_CharacterDataHandler) queue_CharacterData));
+  XML_SetProcessingInstructionHandler(parser,
+        DEFERRED(handlers, processing_instruction,
+                 (XML_ProcessingInstructionHandler) queue_ProcessingInstruction));
+  XML_SetCommentHandler(parser,
+        DEFERRED(handlers, comment, (XML_CommentHandler) queue_Comment));
+  XML_SetNamespaceDeclHandler(parser,
+        DEFERRED(handlers, start_namespace,
+                 (XML_StartNamespaceDeclHandler) queue_StartNamespaceDecl),
+        DEFERRED(handlers, end_namespace,
+                 (XML_EndNamespaceDeclHandler) queue_EndNamespaceDecl));
+  XML_SetSkippedEntityHandler(parser,
+        DEFERRED(handlers, skipped_entity,
+                 (XML_SkippedEntityHandler) sync_SkippedEntity));
+  XML_SetDoctypeDeclHandler(parser,
+        (XML_StartDoctypeDeclHandler) sync_StartDoctypeDecl,
+        (XML_EndDoctypeDeclHandler) sync_EndDoctypeDecl);
+  XML_SetCdataSectionHandler(parser,
+        DEFERRED(handlers, start_cdata,
+                 (XML_StartCdataSectionHandler) queue_StartCdataSection),
+        DEFERRED(handlers, end_cdata,
+                 (XML_EndCdataSectionHandler) queue_EndCdataSection));
+  XML_SetElementDeclHandler(parser,
+        DEFERRED(handlers, element_decl,
+                 (XML_ElementDeclHandler) sync_ElementDecl));
+  XML_SetAttlistDeclHandler(parser,
+        DEFERRED(handlers, attlist_decl,
+                 (XML_AttlistDeclHandler) sync_AttlistDecl));
+  XML_SetEntityDeclHandler(parser,
+        DEFERRED(handlers, entity_decl,
+                 (XML_EntityDeclHandler) sync_EntityDecl));
+  XML_SetNotationDeclHandler(parser,
+        DEFERRED(handlers, notation_decl,
+                 (XML_NotationDeclHandler) sync_NotationDecl));
+  XML_SetExternalEntityRefHandler(parser, sync_ExternalEntityRef);
+}
+
+#undef DEFERRED
+
+Py_LOCAL_INLINE(void)
+setup_handlers(Context *context, XML_Handlers *handlers)
+{
+  XML_Parser parser = context->parser;
+
+  if (context->events) {
+    setup_deferred_handlers(parser, handlers);
+    return;
+  }
+
   XML_SetElementHandler(parser,
                         handlers->start_element,
                         handlers->end_element);
@@ -751,7 +1024,7 @@ begin_handlers(ExpatReader *reader, XML_Handlers *handlers)
   handlers->next = context->handlers;
   context->handlers = handlers;
 
-  setup_handlers(context->parser, handlers);
+  setup_handlers(context, handlers);
 }
 
 Py_LOCAL_INLINE(void)
@@ -766,7 +1039,7 @@ end_handlers(ExpatReader *reader)
   context->handlers = handlers->next;
   XML_Handlers_Del(handlers);
 
-  setup_handlers(context->parser, context->handlers);
+  setup_handlers(context, context->handlers);
 }
 
 /** Error Handling ****************************************************/
@@ -781,8 +1054,8 @@ create_exception(ExpatReader *reader, const char *errorCode,
   if (code == NULL)
     return NULL;
   args = Py_BuildValue("NOii", code, reader->context->uri,
-                       XML_GetCurrentLineNumber(reader->context->parser),
-                       XML_GetCurrentColumnNumber(reader->context->parser));
+                       Context_GetLineNumber(reader->context),
+                       Context_GetColumnNumber(reader->context));
   if (args == NULL)
     return NULL;
 
@@ -815,6 +1088,13 @@ _stop_parsing(ExpatReader *reader, char *filename, int lineno)
   }
 
   XML_StopParser(parser, 0);
+  if (reader->context->events) {
+    /* The queue may be replayed from within an Expat callback, which may
+     * be called again for the remainder of its data; just discard any
+     * further events. */
+    reader->context->events->stopped = 1;
+    return EXPAT_STATUS_ERROR;
+  }
   /* Clear the handlers so as to prevent inadvertant processing for some
    * callbacks, which include:
    *   - the end element handler for empty elements when stopped in the
@@ -916,6 +1196,29 @@ report_error(ExpatReader *reader, const char *error, char *argspec, ...)
 
 #define NAMESPACE_SEP ((const XML_Char)('\f'))
 
+/* Split names, and the strings they are made of, are shared by every reader
+ * so the nodes of all documents refer to the same name strings and name
+ * tests mostly succeed on identity.  Once a table holds `SHARED_NAMES_LIMIT`
+ * entries, further names are only cached for the duration of the parse.
+ */
+#define SHARED_NAMES_LIMIT 16384
+
+static HashTable *shared_names;         /* triplet -> ExpatName */
+static HashTable *shared_name_parts;    /* XML_Char -> unicode */
+
+Py_LOCAL_INLINE(PyObject *)
+intern_name_part(ExpatReader *reader, const XML_Char *str, Py_ssize_t len)
+{
+  PyObject *part;
+  if (shared_name_parts->used < SHARED_NAMES_LIMIT)
+    return LOOKUP_UNICODE(shared_name_parts, str, len);
+  /* the table is full, so any string not yet there never will be */
+  part = HashTable_Get(shared_name_parts, str, len);
+  if (part == NULL)
+    part = LOOKUP_UNICODE(reader->unicode_cache, str, len);
+  return part;
+}
+
 /* An `ExpatName` is really a PyTupleObject that is pointer adjusted
  * to point to the ob_items array. */
 #define ExpatName_FROM_OBJECT(ob) ( (ExpatName *) ( (PyVarObject *)(ob)+1 ) )
@@ -935,7 +1238,7 @@ ExpatName_New(void)
 static PyObject *
 split_triplet(const XML_Char *triplet, Py_ssize_t len, void *arg)
 {
-  HashTable *table = (HashTable *)arg;
+  ExpatReader *reader = (ExpatReader *)arg;
   ExpatName *name;
   PyObject *namespaceURI, *localName, *qualifiedName;
   register Py_ssize_t i;
@@ -950,7 +1253,7 @@ split_triplet(const XML_Char *triplet, Py_ssize_t len, void *arg)
 
   if (i == len) {
     /* no namespace-URI found; this is a null-namespace name */
-    qualifiedName = LOOKUP_UNICODE(table, triplet, len);
+    qualifiedName = intern_name_part(reader, triplet, len);
     if (qualifiedName == NULL) {
       Py_DECREF(ExpatName_AS_OBJECT(name));
       return NULL;
@@ -965,7 +1268,7 @@ split_triplet(const XML_Char *triplet, Py_ssize_t len, void *arg)
   }
 
   /* found a namespace uri */
-  if ((namespaceURI = LOOKUP_UNICODE(table, triplet, i)) == NULL) {
+  if ((namespaceURI = intern_name_part(reader, triplet, i)) == NULL) {
     Py_DECREF(ExpatName_AS_OBJECT(name));
     return NULL;
   }
@@ -973,7 +1276,7 @@ split_triplet(const XML_Char *triplet, Py_ssize_t len, void *arg)
 
   for (j = i; j < len && triplet[j] != NAMESPACE_SEP; j++);
 
-  if ((localName = LOOKUP_UNICODE(table, triplet + i, j - i)) == NULL) {
+  if ((localName = intern_name_part(reader, triplet + i, j - i)) == NULL) {
     Py_DECREF(ExpatName_AS_OBJECT(name));
     return NULL;
   }
@@ -1017,8 +1320,15 @@ Py_LOCAL_INLINE(ExpatName *)
 create_name(ExpatReader *reader, const XML_Char *triplet)
 {
   PyObject *obj;
-  obj = HashTable_Lookup(reader->name_cache, triplet, XMLChar_Len(triplet),
-                         split_triplet, reader->unicode_cache);
+  size_t len = XMLChar_Len(triplet);
+  if (shared_names->used < SHARED_NAMES_LIMIT) {
+    obj = HashTable_Lookup(shared_names, triplet, len, split_triplet, reader);
+  } else {
+    obj = HashTable_Get(shared_names, triplet, len);
+    if (obj == NULL)
+      obj = HashTable_Lookup(reader->name_cache, triplet, len,
+                             split_triplet, reader);
+  }
   if (obj == NULL) return NULL;
   return ExpatName_FROM_OBJECT(obj);
 }
@@ -1030,9 +1340,9 @@ intern_string(ExpatReader *reader, PyObject *obj)
   PyObject *result;
   if (unicode == NULL)
     return NULL;
-  result = LOOKUP_UNICODE(reader->unicode_cache,
-                          (XML_Char *)PyUnicode_AS_UNICODE(unicode),
-                          (size_t)PyUnicode_GET_SIZE(unicode));
+  result = intern_name_part(reader,
+                            (XML_Char *)PyUnicode_AS_UNICODE(unicode),
+                            PyUnicode_GET_SIZE(unicode));
   Py_DECREF(unicode);
   return result;
 }
@@ -1343,6 +1653,474 @@ charbuf_putc(ExpatReader *reader, XML_Char c)
   return EXPAT_STATUS_OK;
 }
 
+/** Deferred Events ***************************************************/
+
+/* Expat tokenizes each buffer with the GIL released.  The content events
+ * (elements, character data, and so on) are recorded in the context's event
+ * queue and replayed, in order, to the XML_Handlers once the GIL is held
+ * again; the locator reports the location recorded with each event.  The
+ * remaining callbacks (DTD declarations, external entities, encodings) are
+ * rare and need Python right away, so they take the GIL back and flush the
+ * queue before running.
+ */
+
+/* The queue is flushed while parsing once it grows beyond this size */
+#define EVENT_QUEUE_LIMIT (1 << 16)
+
+/* callback functions cannot be declared Py_LOCAL */
+static int expat_UnknownEncoding(void *arg, const XML_Char *name,
+                                 XML_Encoding *info);
+
+Py_LOCAL(ExpatStatus) replay_events(ExpatReader *reader);
+
+/* The handlers Expat calls for the current context.  The parser of an
+ * external entity inherits the handlers of its parent. */
+Py_LOCAL_INLINE(XML_Handlers *)
+current_handlers(ExpatReader *reader)
+{
+  Context *context = reader->context;
+  while (context->handlers == NULL && context->next)
+    context = context->next;
+  return context->handlers;
+}
+
+/* Take the GIL back (if it was released) and replay the queued events ahead
+ * of a callback which needs Python.  Returns 0 if parsing has been stopped
+ * (by replaying or earlier on).
+ */
+Py_LOCAL_INLINE(int)
+begin_sync(ExpatReader *reader, PyThreadState **state)
+{
+  Context *context = reader->context;
+
+  *state = context->thread_state;
+  if (*state) {
+    context->thread_state = NULL;
+    PyEval_RestoreThread(*state);
+  }
+  return (replay_events(reader) == EXPAT_STATUS_OK &&
+          !context->events->stopped);
+}
+
+/* Release the GIL again, if begin_sync() took it back */
+Py_LOCAL_INLINE(void)
+end_sync(ExpatReader *reader, PyThreadState *state)
+{
+  Context *context = reader->context;
+
+  if (state && !(context->flags & EXPAT_FLAG_HOLD_GIL))
+    context->thread_state = PyEval_SaveThread();
+}
+
+/* Append an event record with room for `length` XML_Chars of strings.
+ * Called without the GIL; on failure, parsing is stopped and the error is
+ * reported after the queue has been replayed.
+ */
+Py_LOCAL_INLINE(Event *)
+queue_event(ExpatReader *reader, EventType type, size_t length)
+{
+  Context *context = reader->context;
+  EventQueue *queue = context->events;
+  size_t size = ROUND_UP(sizeof(Event) + length * sizeof(XML_Char));
+  Event *event;
+
+  if (queue->failed || queue->stopped)
+    return NULL;
+
+  if (queue->used + size > EVENT_QUEUE_LIMIT && queue->used) {
+    PyThreadState *state;
+    int ok = begin_sync(reader, &state);
+    end_sync(reader, state);
+    if (!ok) return NULL;
+  }
+
+  if (queue->used + size > queue->size) {
+    size_t new_size = queue->size ? queue->size : 8192;
+    char *data;
+    while (new_size < queue->used + size)
+      new_size <<= 1;
+    data = (char *) realloc(queue->data, new_size);
+    if (data == NULL) {
+      queue->failed = 1;
+      XML_StopParser(context->parser, 0);
+      return NULL;
+    }
+    queue->data = data;
+    queue->size = new_size;
+  }
+
+  event = (Event *)(queue->data + queue->used);
+  event->type = type;
+  event->length = 0;
+  event->nulls = 0;
+  event->id_index = -1;
+  event->line = XML_GetCurrentLineNumber(context->parser);
+  event->column = XML_GetCurrentColumnNumber(context->parser);
+  event->size = size;
+  queue->last = queue->used + 1;
+  queue->used += size;
+  return event;
+}
+
+/* Copy the strings into the event record following `event` */
+Py_LOCAL_INLINE(void)
+queue_strings(Event *event, const XML_Char **strings, size_t *lengths,
+              int count)
+{
+  XML_Char *p = (XML_Char *)(event + 1);
+  int i;
+
+  event->length = count;
+  for (i = 0; i < count; i++) {
+    if (strings[i] == NULL) {
+      event->nulls |= (1U << i);
+      *p++ = '\0';
+    } else {
+      memcpy(p, strings[i], (lengths[i] + 1) * sizeof(XML_Char));
+      p += lengths[i] + 1;
+    }
+  }
+}
+
+/* Record an event with up to two (possibly NULL) strings */
+Py_LOCAL_INLINE(void)
+queue_simple(ExpatReader *reader, EventType type, int count,
+             const XML_Char *s1, const XML_Char *s2)
+{
+  const XML_Char *strings[2];
+  size_t lengths[2];
+  size_t total = 0;
+  Event *event;
+  int i;
+
+  strings[0] = s1;
+  strings[1] = s2;
+  for (i = 0; i < count; i++) {
+    lengths[i] = strings[i] ? XMLChar_Len(strings[i]) : 0;
+    total += lengths[i] + 1;
+  }
+  event = queue_event(reader, type, total);
+  if (event)
+    queue_strings(event, strings, lengths, count);
+}
+
+/* callback functions cannot be declared Py_LOCAL */
+static void queue_StartElement(ExpatReader *reader, const XML_Char *name,
+                               const XML_Char **atts)
+{
+  const XML_Char **ppattr;
+  size_t length, total;
+  XML_Char *p;
+  Event *event;
+
+  total = XMLChar_Len(name) + 1;
+  for (ppattr = atts; *ppattr; ppattr++)
+    total += XMLChar_Len(*ppattr) + 1;
+
+  event = queue_event(reader, EVENT_START_ELEMENT, total);
+  if (event == NULL)
+    return;
+  event->id_index = XML_GetIdAttributeIndex(reader->context->parser);
+  event->length = 1 + (int)(ppattr - atts);
+  p = (XML_Char *)(event + 1);
+  length = XMLChar_Len(name) + 1;
+  memcpy(p, name, length * sizeof(XML_Char));
+  p += length;
+  for (ppattr = atts; *ppattr; ppattr++) {
+    length = XMLChar_Len(*ppattr) + 1;
+    memcpy(p, *ppattr, length * sizeof(XML_Char));
+    p += length;
+  }
+}
+
+static void queue_EndElement(ExpatReader *reader, const XML_Char *name)
+{
+  queue_simple(reader, EVENT_END_ELEMENT, 1, name, NULL);
+}
+
+static void queue_CharacterData(ExpatReader *reader, const XML_Char *s,
+                                int len)
+{
+  EventQueue *queue = reader->context->events;
+  Event *event;
+
+  /* Expat reports character data in pieces, join them */
+  if (queue->last && !queue->failed && !queue->stopped) {
+    size_t offset = queue->last - 1;
+    event = (Event *)(queue->data + offset);
+    if (event->type == EVENT_CHARACTER_DATA) {
+      size_t size = ROUND_UP(sizeof(Event) +
+                             (event->length + len) * sizeof(XML_Char));
+      if (offset + size <= queue->size) {
+        memcpy((XML_Char *)(event + 1) + event->length, s,
+               len * sizeof(XML_Char));
+        event->length += len;
+        event->size = size;
+        queue->used = offset + size;
+        return;
+      }
+    }
+  }
+
+  event = queue_event(reader, EVENT_CHARACTER_DATA, (size_t)len);
+  if (event) {
+    memcpy(event + 1, s, len * sizeof(XML_Char));
+    event->length = len;
+  }
+}
+
+static void queue_ProcessingInstruction(ExpatReader *reader,
+                                        const XML_Char *target,
+                                        const XML_Char *data)
+{
+  queue_simple(reader, EVENT_PROCESSING_INSTRUCTION, 2, target, data);
+}
+
+static void queue_Comment(ExpatReader *reader, const XML_Char *data)
+{
+  queue_simple(reader, EVENT_COMMENT, 1, data, NULL);
+}
+
+static void queue_StartNamespaceDecl(ExpatReader *reader,
+                                     const XML_Char *prefix,
+                                     const XML_Char *uri)
+{
+  queue_simple(reader, EVENT_START_NAMESPACE, 2, prefix, uri);
+}
+
+static void queue_EndNamespaceDecl(ExpatReader *reader,
+                                   const XML_Char *prefix)
+{
+  queue_simple(reader, EVENT_END_NAMESPACE, 1, prefix, NULL);
+}
+
+static void queue_StartCdataSection(ExpatReader *reader)
+{
+  queue_simple(reader, EVENT_START_CDATA, 0, NULL, NULL);
+}
+
+static void queue_EndCdataSection(ExpatReader *reader)
+{
+  queue_simple(reader, EVENT_END_CDATA, 0, NULL, NULL);
+}
+
+/* Returns the next string of an event record, or NULL if it was NULL */
+Py_LOCAL_INLINE(const XML_Char *)
+next_string(const Event *event, const XML_Char **p, int index)
+{
+  const XML_Char *s = *p;
+  *p += XMLChar_Len(s) + 1;
+  return (event->nulls & (1U << index)) ? NULL : s;
+}
+
+/* Deliver the queued events to the current handlers (with the GIL held) */
+Py_LOCAL(ExpatStatus)
+replay_events(ExpatReader *reader)
+{
+  Context *context = reader->context;
+  EventQueue *queue = context->events;
+  size_t offset = 0;
+  ExpatStatus status = EXPAT_STATUS_OK;
+
+  if (queue == NULL)
+    return EXPAT_STATUS_OK;
+
+  while (offset < queue->used) {
+    const Event *event = (const Event *)(queue->data + offset);
+    XML_Handlers *handlers = current_handlers(reader);
+    const XML_Char *p = (const XML_Char *)(event + 1);
+    const XML_Char *s1, *s2;
+    int i;
+
+    offset += event->size;
+    context->event = event;
+    switch (event->type) {
+    case EVENT_START_ELEMENT:
+      if ((size_t)event->length > queue->atts_size) {
+        const XML_Char **atts;
+        atts = (const XML_Char **) realloc((void *)queue->atts,
+                                           event->length * sizeof(XML_Char *));
+        if (atts == NULL) {
+          PyErr_NoMemory();
+          break;
+        }
+        queue->atts = atts;
+        queue->atts_size = event->length;
+      }
+      s1 = next_string(event, &p, 0);
+      for (i = 1; i < event->length; i++)
+        queue->atts[i - 1] = next_string(event, &p, i);
+      queue->atts[event->length - 1] = NULL;
+      if (handlers->start_element)
+        handlers->start_element(reader, s1, queue->atts);
+      break;
+    case EVENT_END_ELEMENT:
+      if (handlers->end_element)
+        handlers->end_element(reader, p);
+      break;
+    case EVENT_CHARACTER_DATA:
+      if (handlers->character_data)
+        handlers->character_data(reader, p, event->length);
+      break;
+    case EVENT_PROCESSING_INSTRUCTION:
+      s1 = next_string(event, &p, 0);
+      s2 = next_string(event, &p, 1);
+      if (handlers->processing_instruction)
+        handlers->processing_instruction(reader, s1, s2);
+      break;
+    case EVENT_COMMENT:
+      if (handlers->comment)
+        handlers->comment(reader, p);
+      break;
+    case EVENT_START_NAMESPACE:
+      s1 = next_string(event, &p, 0);
+      s2 = next_string(event, &p, 1);
+      if (handlers->start_namespace)
+        handlers->start_namespace(reader, s1, s2);
+      break;
+    case EVENT_END_NAMESPACE:
+      s1 = next_string(event, &p, 0);
+      if (handlers->end_namespace)
+        handlers->end_namespace(reader, s1);
+      break;
+    case EVENT_START_CDATA:
+      if (handlers->start_cdata)
+        handlers->start_cdata(reader);
+      break;
+    case EVENT_END_CDATA:
+      if (handlers->end_cdata)
+        handlers->end_cdata(reader);
+      break;
+    }
+    if (PyErr_Occurred()) {
+      status = EXPAT_STATUS_ERROR;
+      break;
+    }
+  }
+  context->event = NULL;
+  queue->used = queue->last = 0;
+
+  if (queue->failed && status == EXPAT_STATUS_OK) {
+    queue->failed = 0;
+    PyErr_NoMemory();
+    status = EXPAT_STATUS_ERROR;
+  }
+  if (status == EXPAT_STATUS_ERROR)
+    stop_parsing(reader);
+  return status;
+}
+
+/* Parse a buffer, tokenizing without the GIL if events are deferred.
+ * `data` is NULL to parse the buffer obtained from XML_GetBuffer().
+ */
+Py_LOCAL_INLINE(enum XML_Status)
+parse_buffer(ExpatReader *reader, const char *data, int len, int is_final)
+{
+  Context *context = reader->context;
+  enum XML_Status status;
+
+  if (context->events == NULL) {
+    if (data)
+      return XML_Parse(context->parser, data, len, is_final);
+    return XML_ParseBuffer(context->parser, len, is_final);
+  }
+
+  if (!(context->flags & EXPAT_FLAG_HOLD_GIL))
+    context->thread_state = PyEval_SaveThread();
+  if (data)
+    status = XML_Parse(context->parser, data, len, is_final);
+  else
+    status = XML_ParseBuffer(context->parser, len, is_final);
+  if (context->thread_state) {
+    PyThreadState *state = context->thread_state;
+    context->thread_state = NULL;
+    PyEval_RestoreThread(state);
+  }
+
+  if (replay_events(reader) == EXPAT_STATUS_ERROR)
+    return XML_STATUS_ERROR;
+  return status;
+}
+
+#define SYNC_HANDLER(NAME, HANDLER, PROTO, ARGS) \
+static void sync_##NAME PROTO \
+{ \
+  PyThreadState *state; \
+  if (begin_sync(reader, &state)) \
+    HANDLER ARGS; \
+  end_sync(reader, state); \
+}
+
+SYNC_HANDLER(SkippedEntity, current_handlers(reader)->skipped_entity,
+             (ExpatReader *reader, const XML_Char *entityName,
+              int is_parameter_entity),
+             (reader, entityName, is_parameter_entity))
+SYNC_HANDLER(StartDoctypeDecl, expat_StartDoctypeDecl,
+             (ExpatReader *reader, const XML_Char *name,
+              const XML_Char *sysid, const XML_Char *pubid,
+              int has_internal_subset),
+             (reader, name, sysid, pubid, has_internal_subset))
+SYNC_HANDLER(EndDoctypeDecl, expat_EndDoctypeDecl,
+             (ExpatReader *reader), (reader))
+SYNC_HANDLER(ElementDecl, current_handlers(reader)->element_decl,
+             (ExpatReader *reader, const XML_Char *name,
+              XML_Content *content),
+             (reader, name, content))
+SYNC_HANDLER(AttlistDecl, current_handlers(reader)->attlist_decl,
+             (ExpatReader *reader, const XML_Char *elname,
+              const XML_Char *attname, const XML_Char *att_type,
+              const XML_Char *dflt, int isrequired),
+             (reader, elname, attname, att_type, dflt, isrequired))
+SYNC_HANDLER(EntityDecl, current_handlers(reader)->entity_decl,
+             (ExpatReader *reader, const XML_Char *entity_name,
+              int is_parameter_entity, const XML_Char *value,
+              int value_length, const XML_Char *base,
+              const XML_Char *systemId, const XML_Char *publicId,
+              const XML_Char *notationName),
+             (reader, entity_name, is_parameter_entity, value, value_length,
+              base, systemId, publicId, notationName))
+SYNC_HANDLER(NotationDecl, current_handlers(reader)->notation_decl,
+             (ExpatReader *reader, const XML_Char *notationName,
+              const XML_Char *base, const XML_Char *systemId,
+              const XML_Char *publicId),
+             (reader, notationName, base, systemId, publicId))
+
+#undef SYNC_HANDLER
+
+static int sync_ExternalEntityRef(XML_Parser parser, const XML_Char *context,
+                                  const XML_Char *base,
+                                  const XML_Char *systemId,
+                                  const XML_Char *publicId)
+{
+  ExpatReader *reader = (ExpatReader *) XML_GetUserData(parser);
+  PyThreadState *state;
+  int result = XML_STATUS_OK;
+
+  if (begin_sync(reader, &state))
+    result = expat_ExternalEntityRef(parser, context, base, systemId,
+                                     publicId);
+  end_sync(reader, state);
+  return result;
+}
+
+/* A Python codec decodes the document while it is tokenized, so the GIL is
+ * kept from here on.
+ */
+static int sync_UnknownEncoding(void *arg, const XML_Char *name,
+                                XML_Encoding *info)
+{
+  ExpatReader *reader = (ExpatReader *) arg;
+  PyThreadState *state;
+  int result = XML_STATUS_ERROR;
+
+  if (begin_sync(reader, &state)) {
+    reader->context->flags |= EXPAT_FLAG_HOLD_GIL;
+    result = expat_UnknownEncoding(arg, name, info);
+  }
+  end_sync(reader, state);
+  return result;
+}
+
 /** Parsing Routines **************************************************/
 
 static XML_Char expat_xml_namespace[] = {
@@ -1372,20 +2150,28 @@ static XML_Char expat_default_string[] = {
    ((s1)[XMLChar_STATIC_LEN(s2)] == NAMESPACE_SEP ||        \
     (s1)[XMLChar_STATIC_LEN(s2)] == '\0'))
 
-/* callback functions cannot be declared Py_LOCAL */
-static int expat_UnknownEncoding(void *arg, const XML_Char *name,
-                                 XML_Encoding *info);
-
 Py_LOCAL_INLINE(XML_Parser)
 create_parser(ExpatReader *reader)
 {
   static const XML_Char sep[] = { NAMESPACE_SEP, '\0' };
   enum XML_ParamEntityParsing parsing;
+  XML_Parser parser;
 
-  XML_Parser parser = XML_ParserCreate_MM(NULL, &expat_memsuite, sep);
+  /* A reset parser keeps the memory (buffers, pools and tables) it grew
+   * while parsing the previous document.  Resetting clears everything
+   * set up below, along with the handlers. */
+  parser = reader->spare_parser;
+  reader->spare_parser = NULL;
+  if (parser != NULL && !XML_ParserReset(parser, NULL)) {
+    XML_ParserFree(parser);
+    parser = NULL;
+  }
   if (parser == NULL) {
-    PyErr_NoMemory();
-    return NULL;
+    parser = XML_ParserCreate_MM(NULL, &expat_memsuite, sep);
+    if (parser == NULL) {
+      PyErr_NoMemory();
+      return NULL;
+    }
   }
 
   /* enable parsing of parameter entities if requested */
@@ -1401,7 +2187,12 @@ create_parser(ExpatReader *reader)
   XML_SetReturnNSTriplet(parser, 1);
 
   /* enable use of all encodings available with Python */
-  XML_SetUnknownEncodingHandler(parser, expat_UnknownEncoding, (void *)reader);
+  if (ExpatReader_HasFlag(reader, ExpatReader_SYNCHRONOUS))
+    XML_SetUnknownEncodingHandler(parser, expat_UnknownEncoding,
+                                  (void *)reader);
+  else
+    XML_SetUnknownEncodingHandler(parser, sync_UnknownEncoding,
+                                  (void *)reader);
 
   XML_SetUserData(parser, (void *)reader);
 
@@ -1463,6 +2254,58 @@ static Py_ssize_t read_object(PyObject *stream, char *buffer, int length)
   return bytes_read;
 }
 
+/* Set up zero-copy input for the current context, if possible.  Regular
+ * files are mapped into memory (from their current position to the end) and
+ * cStringIO streams lend their buffer.  Any other stream, or a file which
+ * cannot be mapped (a pipe, for example), is read in blocks as usual.
+ */
+Py_LOCAL_INLINE(int)
+setup_input(Context *context)
+{
+  PyObject *stream = context->stream;
+  Py_ssize_t length;
+
+  context->flags &= ~EXPAT_FLAG_ZERO_COPY;
+  if (PycStringIO_InputCheck(stream)) {
+    char *data;
+    length = PycStringIO->cread(stream, &data, -1);
+    if (length < 0)
+      return -1;
+    else if (length > 0) {
+      context->input = data;
+      context->input_len = length;
+    }
+  }
+#ifdef HAVE_MMAP
+  else if (PyFile_Check(stream)) {
+    FILE *fp = PyFile_AsFile(stream);
+    struct stat st;
+    long offset;
+    void *mapping;
+
+    offset = ftell(fp);
+    if (offset < 0 || fstat(fileno(fp), &st) < 0 || !S_ISREG(st.st_mode) ||
+        st.st_size <= offset || (size_t)st.st_size != st.st_size)
+      return 0;
+    length = (Py_ssize_t)(st.st_size - offset);
+    mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+                   fileno(fp), 0);
+    if (mapping == MAP_FAILED)
+      return 0;
+#ifdef MADV_SEQUENTIAL
+    (void) madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    /* the stream is consumed, just as if it had been read */
+    (void) fseek(fp, 0L, SEEK_END);
+    context->mapping = mapping;
+    context->mapping_len = (size_t)st.st_size;
+    context->input = (const char *)mapping + offset;
+    context->input_len = length;
+  }
+#endif
+  return 0;
+}
+
 /* Common handling of Expat error condition. */
 Py_LOCAL_INLINE(void)
 process_error(ExpatReader *reader)
@@ -1470,6 +2313,10 @@ process_error(ExpatReader *reader)
   int error_code = XML_GetErrorCode(reader->context->parser);
   PyObject *args, *exception;
 
+  /* an exception raised by a (replayed) handler takes precedence */
+  if (PyErr_Occurred())
+    return;
+
   switch (error_code) {
   case XML_ERROR_NONE:
     /* error handler called during non-error condition */
@@ -1524,6 +2371,58 @@ process_error(ExpatReader *reader)
   }
 }
 
+/* Parse zero-copy input.  The input is handed to Expat in place, so unless
+ * parsing is suspended, Expat never copies the data into its own buffer.
+ */
+Py_LOCAL_INLINE(ExpatStatus)
+continue_parsing_input(ExpatReader *reader)
+{
+  Context *context = reader->context;
+  enum XML_Status status;
+  ExpatStatus result = EXPAT_STATUS_OK;
+
+  XML_SetParseInPlace(context->parser, XML_TRUE);
+  while (result == EXPAT_STATUS_OK &&
+         context->input_pos < context->input_len) {
+    XML_ParsingStatus parsing_status;
+    const char *data = context->input + context->input_pos;
+    Py_ssize_t length = context->input_len - context->input_pos;
+    int is_final = 1;
+
+    if (length > EXPAT_SLICESIZ) {
+      length = EXPAT_SLICESIZ;
+      is_final = 0;
+    }
+    context->input_pos += length;
+
+    Debug_ParserFunctionCall(XML_Parse, reader);
+
+    status = parse_buffer(reader, data, (int)length, is_final);
+
+    Debug_ReturnStatus(XML_Parse, status);
+
+    switch (status) {
+    case XML_STATUS_OK:
+      /* determine if parsing was stopped prematurely */
+      XML_GetParsingStatus(context->parser, &parsing_status);
+      if (parsing_status.parsing == XML_FINISHED && !is_final)
+        result = EXPAT_STATUS_ERROR;
+      break;
+    case XML_STATUS_ERROR:
+      process_error(reader);
+      result = EXPAT_STATUS_ERROR;
+      break;
+    case XML_STATUS_SUSPENDED:
+      result = EXPAT_STATUS_SUSPENDED;
+      break;
+    }
+  }
+  /* the parser may go on to parse copied input (feed(), or the next
+   * document once it is reused), which must not be parsed in place */
+  XML_SetParseInPlace(context->parser, XML_FALSE);
+  return result;
+}
+
 /* The core of the parsing routines.  Process the input source until parsing
  * is finished (OK or ERROR) or suspended (SUSPENDED).
  */
@@ -1537,6 +2436,18 @@ continue_parsing(ExpatReader *reader)
 
   Debug_ParserFunctionCall(continue_parsing, reader);
 
+  if (Expat_HasFlag(reader, EXPAT_FLAG_ZERO_COPY)) {
+    if (setup_input(reader->context) < 0) {
+      Debug_ReturnStatus(continue_parsing, EXPAT_STATUS_ERROR);
+      return EXPAT_STATUS_ERROR;
+    }
+  }
+  if (reader->context->input) {
+    status = continue_parsing_input(reader);
+    Debug_ReturnStatus(continue_parsing, status);
+    return status;
+  }
+
   read_arg = reader->context->stream;
   if (PyFile_Check(read_arg)) {
     read_func = read_file;
@@ -1565,8 +2476,7 @@ continue_parsing(ExpatReader *reader)
 
     Debug_ParserFunctionCall(XML_ParseBuffer, reader);
 
-    status = XML_ParseBuffer(reader->context->parser, (int)bytes_read,
-                             bytes_read == 0);
+    status = parse_buffer(reader, NULL, (int)bytes_read, bytes_read == 0);
 
     Debug_ReturnStatus(XML_ParseBuffer, status);
 
@@ -1593,15 +2503,12 @@ continue_parsing(ExpatReader *reader)
   return EXPAT_STATUS_OK;
 }
 
-/* The entry point for parsing any entity, document or otherwise. */
+/* Pass the encoding and base URI of the current context on to Expat. */
 Py_LOCAL_INLINE(ExpatStatus)
-do_parsing(ExpatReader *reader)
+setup_parser(ExpatReader *reader)
 {
   XML_Char *encoding, *base;
   enum XML_Status xml_status;
-  ExpatStatus status;
-
-  Debug_ParserFunctionCall(do_parsing, reader);
 
   /* sanity check */
   if (reader->context == NULL) {
@@ -1634,8 +2541,20 @@ do_parsing(ExpatReader *reader)
     PyErr_NoMemory();
     return EXPAT_STATUS_ERROR;
   }
+  return EXPAT_STATUS_OK;
+}
+
+/* The entry point for parsing any entity, document or otherwise. */
+Py_LOCAL_INLINE(ExpatStatus)
+do_parsing(ExpatReader *reader)
+{
+  ExpatStatus status;
 
-  status = continue_parsing(reader);
+  Debug_ParserFunctionCall(do_parsing, reader);
+
+  status = setup_parser(reader);
+  if (status == EXPAT_STATUS_OK)
+    status = continue_parsing(reader);
 
   Debug_ReturnStatus(do_parsing, status);
   return status;
@@ -2025,6 +2944,16 @@ static void expat_StartElement(ExpatReader *reader, const XML_Char *expat_name,
   /* Determine how much memory is needed for the attributes array */
   for (ppattr = expat_atts, attrs_size = 0; *ppattr; ppattr += 2, attrs_size++);
 
+  /* Start over once the values seen are mostly unique (IDs, numbers...), as
+   * the cache would otherwise grow with the document */
+  if (attrs_size && reader->value_cache->used > VALUE_CACHE_MAX) {
+    HashTable_Del(reader->value_cache);
+    if ((reader->value_cache = HashTable_New()) == NULL) {
+      stop_parsing(reader);
+      return;
+    }
+  }
+
   /* get the array for storing the expanded attributes */
   if (attrs_size > reader->attrs_size) {
     if (resize_attribute_list(reader, attrs_size) == EXPAT_STATUS_ERROR) {
@@ -2033,11 +2962,14 @@ static void expat_StartElement(ExpatReader *reader, const XML_Char *expat_name,
   }
 
   attrs = attr = reader->attrs;
-  id_index = XML_GetIdAttributeIndex(reader->context->parser);
+  if (reader->context->event)
+    id_index = reader->context->event->id_index;
+  else
+    id_index = XML_GetIdAttributeIndex(reader->context->parser);
   for (ppattr = expat_atts; *ppattr; ppattr += 2, attr++, id_index -= 2) {
     ExpatName *attr_name = create_name(reader, ppattr[0]);
     PyObject *attr_value = XMLChar_DecodeInterned(ppattr[1],
-                                                  reader->unicode_cache);
+                                                  reader->value_cache);
     if (attr_name == NULL || attr_value == NULL) {
       stop_parsing(reader);
       return;
@@ -3932,6 +4864,8 @@ ExpatReader_New(ExpatHandler *handler)
   /* interning table for XML_Char -> PyUnicodeObjects */
   if ((reader->unicode_cache = HashTable_New()) == NULL)
     goto error;
+  if ((reader->value_cache = HashTable_New()) == NULL)
+    goto error;
 
   /* character data buffering */
   if ((reader->buffer = PyMem_New(XML_Char, XMLCHAR_BUFSIZ)) == NULL)
@@ -4001,6 +4935,16 @@ ExpatReader_Del(ExpatReader *reader)
     reader->xml_base_stack = NULL;
   }
 
+  if (reader->spare_parser) {
+    XML_ParserFree(reader->spare_parser);
+    reader->spare_parser = NULL;
+  }
+
+  if (reader->spare_events) {
+    EventQueue_Del(reader->spare_events);
+    reader->spare_events = NULL;
+  }
+
   if (reader->attrs) {
     PyMem_Del(reader->attrs);
     reader->attrs = NULL;
@@ -4016,6 +4960,11 @@ ExpatReader_Del(ExpatReader *reader)
     reader->unicode_cache = NULL;
   }
 
+  if (reader->value_cache) {
+    HashTable_Del(reader->value_cache);
+    reader->value_cache = NULL;
+  }
+
   if (reader->name_cache) {
     HashTable_Del(reader->name_cache);
     reader->name_cache = NULL;
@@ -4060,6 +5009,27 @@ ExpatReader_SetParamEntityParsing(ExpatReader *reader, int doParamEntityParsing)
   }
 }
 
+int
+ExpatReader_GetSynchronous(ExpatReader *reader)
+{
+  return ExpatReader_HasFlag(reader, ExpatReader_SYNCHRONOUS) ? 1 : 0;
+}
+
+/* By default, Expat tokenizes without the GIL and the handlers are called
+ * once a buffer has been tokenized.  Synchronous handlers are called while
+ * Expat tokenizes, which is required for suspending the parser. */
+void
+ExpatReader_SetSynchronous(ExpatReader *reader, int synchronous)
+{
+  /* do not allowing changing after parsing has begun */
+  if (reader->context == NULL) {
+    if (synchronous)
+      ExpatReader_SetFlag(reader, ExpatReader_SYNCHRONOUS);
+    else
+      ExpatReader_ClearFlag(reader, ExpatReader_SYNCHRONOUS);
+  }
+}
+
 PyObject *
 ExpatReader_GetWhitespaceStripping(ExpatReader *reader)
 {
@@ -4144,6 +5114,104 @@ ExpatReader_Parse(ExpatReader *reader, PyObject *source)
   return status;
 }
 
+/** ExpatReader_Feed **************************************************/
+
+/* Begins a document whose content is then passed to ExpatReader_Feed() as
+ * it arrives, rather than read from a stream.  `source` still provides the
+ * base URI and encoding and resolves external entities, but its stream is
+ * never read. */
+ExpatStatus
+ExpatReader_StartFeed(ExpatReader *reader, PyObject *source)
+{
+  XML_Parser parser;
+  ExpatStatus status;
+
+  Debug_FunctionCall(ExpatReader_StartFeed, reader);
+
+  if (reader->context != NULL) {
+    PyErr_SetString(PyExc_RuntimeError, "reader is already parsing");
+    return EXPAT_STATUS_ERROR;
+  }
+
+  parser = create_parser(reader);
+  if (parser == NULL) {
+    return EXPAT_STATUS_ERROR;
+  }
+
+  status = begin_context(reader, parser, source);
+  if (status == EXPAT_STATUS_ERROR)
+    return status;
+  begin_handlers(reader, &expat_handlers);
+
+  status = ExpatHandler_StartDocument(reader->context->handler);
+  if (status == EXPAT_STATUS_OK)
+    status = setup_parser(reader);
+  if (status == EXPAT_STATUS_ERROR)
+    destroy_contexts(reader);
+
+  Debug_ReturnStatus(ExpatReader_StartFeed, status);
+  return status;
+}
+
+/* Parses the next `length` bytes of the document begun by
+ * ExpatReader_StartFeed().  `is_final` ends the document (`data` may then
+ * be empty), so the reader is ready for the next one, as it is after any
+ * error. */
+ExpatStatus
+ExpatReader_Feed(ExpatReader *reader, const char *data, Py_ssize_t length,
+                 int is_final)
+{
+  Context *context = reader->context;
+  ExpatStatus status = EXPAT_STATUS_OK;
+
+  Debug_FunctionCall(ExpatReader_Feed, reader);
+
+  if (context == NULL) {
+    PyErr_SetString(PyExc_RuntimeError, "no document has been started");
+    return EXPAT_STATUS_ERROR;
+  }
+  /* NULL would have Expat parse its own buffer */
+  if (data == NULL)
+    data = "";
+
+  do {
+    XML_ParsingStatus parsing_status;
+    int slice = length > EXPAT_SLICESIZ ? EXPAT_SLICESIZ : (int)length;
+    int final = is_final && slice == length;
+
+    switch (parse_buffer(reader, data, slice, final)) {
+    case XML_STATUS_OK:
+      /* determine if parsing was stopped prematurely */
+      XML_GetParsingStatus(context->parser, &parsing_status);
+      if (parsing_status.parsing == XML_FINISHED && !final)
+        status = EXPAT_STATUS_ERROR;
+      break;
+    case XML_STATUS_ERROR:
+      process_error(reader);
+      status = EXPAT_STATUS_ERROR;
+      break;
+    case XML_STATUS_SUSPENDED:
+      /* a handler suspended parsing (see ExpatReader_Resume) */
+      Debug_ReturnStatus(ExpatReader_Feed, EXPAT_STATUS_SUSPENDED);
+      return EXPAT_STATUS_SUSPENDED;
+    }
+    data += slice;
+    length -= slice;
+  } while (status == EXPAT_STATUS_OK && length > 0);
+
+  if (status == EXPAT_STATUS_OK && is_final) {
+    if (reader->buffer_used)
+      status = charbuf_flush(reader);
+    if (status == EXPAT_STATUS_OK)
+      status = ExpatHandler_EndDocument(reader->context->handler);
+  }
+  if (status == EXPAT_STATUS_ERROR || is_final)
+    destroy_contexts(reader);
+
+  Debug_ReturnStatus(ExpatReader_Feed, status);
+  return status;
+}
+
 /** ExpatReader_ParseEntity *******************************************/
 
 /* copied from xmlparse.c
@@ -4373,7 +5441,7 @@ unsigned long ExpatReader_GetLineNumber(ExpatReader *reader)
 {
   Context *context = reader->context;
   if (context)
-    return XML_GetCurrentLineNumber(context->parser);
+    return Context_GetLineNumber(context);
   return 0;
 }
 
@@ -4381,7 +5449,7 @@ unsigned long ExpatReader_GetColumnNumber(ExpatReader *reader)
 {
   Context *context = reader->context;
   if (context)
-    return XML_GetCurrentColumnNumber(context->parser);
+    return Context_GetColumnNumber(context);
   return 0;
 }
 
@@ -4390,6 +5458,9 @@ int ExpatReader_GetParsingStatus(ExpatReader *reader)
   Context *context = reader->context;
   static XML_ParsingStatus status;
   if (context) {
+    /* replaying events is part of parsing, whatever Expat's state */
+    if (context->event)
+      return 1;
     XML_GetParsingStatus(context->parser, &status);
     return (status.parsing == XML_PARSING || status.parsing == XML_SUSPENDED);
   }
@@ -4413,6 +5484,8 @@ static Expat_APIObject Expat_API = {
   ExpatReader_ParseEntity,
   ExpatReader_Suspend,
   ExpatReader_Resume,
+  ExpatReader_StartFeed,
+  ExpatReader_Feed,
   ExpatReader_GetBase,
   ExpatReader_GetLineNumber,
   ExpatReader_GetColumnNumber,
@@ -4470,6 +5543,9 @@ static void fini_expat(void *capi)
 
   Py_CLEAR(absolutize_function);
 
+  HashTable_Del(shared_names);
+  HashTable_Del(shared_name_parts);
+
   Py_XDECREF(expat_library_error);
 }
 
@@ -4522,6 +5598,9 @@ PyMODINIT_FUNC init_expat(void)
   DEFINE_XMLSTRING(attribute_decl_required, "#REQUIRED");
   DEFINE_XMLSTRING(attribute_decl_fixed, "#FIXED");
 
+  if ((shared_names = HashTable_New()) == NULL) return;
+  if ((shared_name_parts = HashTable_New()) == NULL) return;
+
   import = PyImport_ImportModule("amara.lib");
   if (import == NULL) return;
   IriError = PyObject_GetAttrString(import, "IriError");
@@ -4558,13 +5637,8 @@ PyMODINIT_FUNC init_expat(void)
   }
   Py_DECREF(import);
 
-  /* Update Expat's memory allocator to use the Python object allocator
-   * if it is enabled. */
-#ifdef WITH_PYMALLOC
-  expat_memsuite.malloc_fcn = PyObject_MALLOC;
-  expat_memsuite.realloc_fcn = PyObject_REALLOC;
-  expat_memsuite.free_fcn = PyObject_FREE;
-#endif
+  /* Expat keeps the C library allocator (see expat_memsuite) as it
+   * allocates while tokenizing without the GIL. */
 
   /* verify Expat linkage due to late binding on Linux */
   expat_library_error = NULL;
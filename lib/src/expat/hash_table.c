@@ -114,24 +114,38 @@ static int table_resize(HashTable *self)
   return 0;
 }
 
-PyObject *HashTable_Lookup(HashTable *self, const XML_Char *str, size_t len,
-                           PyObject *(*buildvalue)(const XML_Char *str,
-                                                   Py_ssize_t len, void *arg),
-                           void *buildarg)
+Py_LOCAL_INLINE(long) hash_string(const XML_Char *str, size_t len)
 {
   register Py_ssize_t i = len;
   register const XML_Char *p = str;
   register long hash;
-  HashTableEntry *entry;
-  XML_Char *key;
-  PyObject *value;
 
-  /* Calcuate the hash value */
   hash = *p << 7;
   while (--i >= 0)
     hash = (1000003*hash) ^ *p++;
   hash ^= len;
+  return hash;
+}
+
+/* Returns the value stored for `str` (a borrowed reference) or NULL, without
+ * setting an exception, if there is none.
+ */
+PyObject *HashTable_Get(HashTable *self, const XML_Char *str, size_t len)
+{
+  return lookup_entry(self, str, len, hash_string(str, len))->value;
+}
+
+PyObject *HashTable_Lookup(HashTable *self, const XML_Char *str, size_t len,
+                           PyObject *(*buildvalue)(const XML_Char *str,
+                                                   Py_ssize_t len, void *arg),
+                           void *buildarg)
+{
+  register long hash;
+  HashTableEntry *entry;
+  XML_Char *key;
+  PyObject *value;
 
+  hash = hash_string(str, len);
   entry = lookup_entry(self, str, len, hash);
   if (entry->key) {
     return entry->value;
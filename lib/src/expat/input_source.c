@@ -15,17 +15,26 @@ PyObject *uri_resolver;
 /** Python Interface **************************************************/
 
 static char inputsource_doc[] =
-"InputSource(byteStream, baseURI[, encoding]) -> InputSource object";
+"InputSource(byteStream, baseURI[, encoding[, zeroCopy]]) -> InputSource object\n\
+\n\
+If zeroCopy is true, the parser maps real files into memory (or borrows the\n\
+buffer of cStringIO streams) and parses it in place instead of reading the\n\
+stream in blocks.";
 
 static PyObject *
 inputsource_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-  static char *kwlist[] = { "byteStream", "baseURI", "encoding", NULL };
-  PyObject *byte_stream, *base_uri, *encoding = Py_None;
+  static char *kwlist[] = { "byteStream", "baseURI", "encoding", "zeroCopy",
+                            NULL };
+  PyObject *byte_stream, *base_uri, *encoding = Py_None, *zero_copy = NULL;
   InputSourceObject *newobj;
+  int flag = 0;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|O:InputSource", kwlist,
-                                   &byte_stream, &base_uri, &encoding))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|OO:InputSource", kwlist,
+                                   &byte_stream, &base_uri, &encoding,
+                                   &zero_copy))
+    return NULL;
+  if (zero_copy && (flag = PyObject_IsTrue(zero_copy)) < 0)
     return NULL;
 
   base_uri = PyObject_Unicode(base_uri);
@@ -47,6 +56,7 @@ inputsource_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     newobj->byte_stream = byte_stream;
     newobj->base_uri = base_uri;
     newobj->encoding = encoding;
+    newobj->zero_copy = (char)flag;
   } else {
     Py_DECREF(base_uri);
     Py_DECREF(encoding);
@@ -156,6 +166,7 @@ static PyMemberDef inputsource_members[] = {
   { "publicId", T_OBJECT, offsetof(InputSourceObject, public_id), RO },
   { "uri", T_OBJECT, offsetof(InputSourceObject, base_uri), RO },
   { "encoding", T_OBJECT, offsetof(InputSourceObject, encoding), RO },
+  { "zeroCopy", T_BOOL, offsetof(InputSourceObject, zero_copy), RO },
   { NULL }
 };
 
@@ -16,6 +16,7 @@ extern "C" {
     PyObject *public_id;
     PyObject *base_uri;
     PyObject *encoding;
+    char zero_copy;
   } InputSourceObject;
 
 #define InputSource_GET_BYTE_STREAM(op) \
@@ -32,6 +33,8 @@ extern "C" {
   (((InputSourceObject *)(op))->base_uri)
 #define InputSource_GET_ENCODING(op) \
   (((InputSourceObject *)(op))->encoding)
+#define InputSource_GET_ZERO_COPY(op) \
+  (((InputSourceObject *)(op))->zero_copy)
 
 #ifdef Expat_BUILDING_MODULE
 
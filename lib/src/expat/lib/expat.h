@@ -755,6 +755,16 @@ XML_GetIdAttributeIndex(XML_Parser parser);
 XMLPARSEAPI(enum XML_Status)
 XML_Parse(XML_Parser parser, const char *s, int len, int isFinal);
 
+/* If inPlace is true, XML_Parse parses its input where it is rather than
+   copying it into the parser's buffer first (only the unparsed remainder
+   is copied).  The input must stay unchanged until XML_Parse returns, and
+   XML_GetInputContext returns NULL for events within it.  This is always
+   the case when XML_CONTEXT_BYTES is not defined.  XML_ParserReset
+   turns it off again.
+*/
+XMLPARSEAPI(void)
+XML_SetParseInPlace(XML_Parser parser, XML_Bool inPlace);
+
 XMLPARSEAPI(void *)
 XML_GetBuffer(XML_Parser parser, int len);
 
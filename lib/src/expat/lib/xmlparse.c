@@ -478,6 +478,8 @@ struct XML_ParserStruct {
   char *m_bufferEnd;
   /* allocated end of buffer */
   const char *m_bufferLim;
+  /* parse the input of XML_Parse in place (see XML_SetParseInPlace) */
+  XML_Bool m_parseInPlace;
   XML_Index m_parseEndByteIndex;
   const char *m_parseEndPtr;
   XML_Char *m_dataBuf;
@@ -630,6 +632,7 @@ struct XML_ParserStruct {
 #define parseEndByteIndex (parser->m_parseEndByteIndex)
 #define parseEndPtr (parser->m_parseEndPtr)
 #define bufferLim (parser->m_bufferLim)
+#define parseInPlace (parser->m_parseInPlace)
 #define dataBuf (parser->m_dataBuf)
 #define dataBufEnd (parser->m_dataBufEnd)
 #define _dtd (parser->m_dtd)
@@ -819,6 +822,7 @@ parserInit(XML_Parser parser, const XML_Char *encodingName)
                           ? poolCopyString(&tempPool, encodingName)
                           : NULL);
   curBase = NULL;
+  parseInPlace = XML_FALSE;
   XmlInitEncoding(&initEncoding, &encoding, 0);
   userData = NULL;
   handlerArg = NULL;
@@ -1183,6 +1187,12 @@ XML_SetReturnNSTriplet(XML_Parser parser, int do_nst)
   ns_triplets = do_nst ? XML_TRUE : XML_FALSE;
 }
 
+void XMLCALL
+XML_SetParseInPlace(XML_Parser parser, XML_Bool inPlace)
+{
+  parseInPlace = inPlace;
+}
+
 void XMLCALL
 XML_SetUserData(XML_Parser parser, void *p)
 {
@@ -1485,8 +1495,13 @@ XML_Parse(XML_Parser parser, const char *s, int len, int isFinal)
     processor = errorProcessor;
     return XML_STATUS_ERROR;
   }
-#ifndef XML_CONTEXT_BYTES
+#ifdef XML_CONTEXT_BYTES
+  /* the context before the current position is only kept in the buffer,
+     so the input is parsed in place only when asked to be */
+  else if (parseInPlace && bufferPtr == bufferEnd) {
+#else
   else if (bufferPtr == bufferEnd) {
+#endif
     const char *end;
     int nLeftOver;
     enum XML_Error result;
@@ -1508,11 +1523,13 @@ XML_Parse(XML_Parser parser, const char *s, int len, int isFinal)
         break;
       case XML_INITIALIZED:
       case XML_PARSING:
-        result = XML_STATUS_OK;
         if (isFinal) {
           ps_parsing = XML_FINISHED;
-          return result;
+          return XML_STATUS_OK;
         }
+      /* fall through */
+      default:
+        result = XML_STATUS_OK;
       }
     }
 
@@ -1548,7 +1565,6 @@ XML_Parse(XML_Parser parser, const char *s, int len, int isFinal)
     eventEndPtr = bufferPtr;
     return result;
   }
-#endif  /* not defined XML_CONTEXT_BYTES */
   else {
     void *buff = XML_GetBuffer(parser, len);
     if (buff == NULL)
@@ -1791,7 +1807,8 @@ const char * XMLCALL
 XML_GetInputContext(XML_Parser parser, int *offset, int *size)
 {
 #ifdef XML_CONTEXT_BYTES
-  if (eventPtr && buffer) {
+  /* input parsed in place is not in the buffer */
+  if (eventPtr && buffer && eventPtr >= buffer && eventPtr <= bufferEnd) {
     *offset = (int)(eventPtr - buffer);
     *size   = (int)(bufferEnd - buffer);
     return buffer;
@@ -1781,6 +1781,8 @@ XMLPARSER_METHOD_DEF(setFeature)
 //  }
   else if (PyObject_RichCompareBool(featurename, feature_generator, Py_EQ)) {
     self->generator = state;
+    /* yielding suspends the parser from within the handlers */
+    ExpatReader_SetSynchronous(self->reader, state);
     if (state == 0 && self->yield_result) {
       Py_DECREF(self->yield_result);
       self->yield_result = NULL;
@@ -4,11 +4,15 @@
 A very fast tree (node API) library for XML processing with sensible conventions.
 """
 
-__all__ = ["parse", 'node', 'entity', 'element', 'attribute', 'comment', 'processing_instruction', 'text']
+__all__ = ["parse", "parse_many", "parser", "incremental_parser", "load", 'node', 'entity', 'element', 'attribute', 'comment', 'processing_instruction', 'text', 'frozen_node']
 
 from amara._domlette import *
 from amara._domlette import parse as _parse
+from amara._domlette import parser as _parser
+from amara._domlette import parse_frozen as _parse_frozen
+from amara._domlette import load_snapshot as _load_snapshot
 from amara.lib import inputsource
+from cStringIO import StringIO
 
 #node = Node
 #document = Document
@@ -23,7 +27,7 @@ from amara.lib import inputsource
 
 #FIXME: and so on
 
-def parse(obj, uri=None, entity_factory=None, standalone=False, validate=False, rule_handler=None):
+def parse(obj, uri=None, entity_factory=None, standalone=False, validate=False, rule_handler=None, readonly=False, prune=False):
     '''
     Parse an XML input source and return a tree
 
@@ -47,6 +51,15 @@ def parse(obj, uri=None, entity_factory=None, standalone=False, validate=False,
                  from XML core.  In XML core that would be a fatal error)
     validate - whether or not to apply DTD validation
     rule_handler - Handler object used to perform rule matching in incremental processing.
+    prune - with rule_handler, release each node once it is complete and its handler
+            callbacks have returned, except within an element for which the handler's
+            startElementNS returned true (a match), which is kept whole until it is
+            complete.  Memory use is then bounded by the largest match rather than the
+            document, whose returned tree holds just what the callbacks left in it
+    readonly - if true, return a read-only tree of `amara.tree.frozen_node`.  Such a
+               tree is stored compactly (a few machine words per node, with the text
+               as UTF-8) and supports navigation, xml_select and serialization, but
+               cannot be modified.  Cannot be combined with entity_factory or rule_handler
 
     Examples:
 
@@ -60,13 +73,262 @@ def parse(obj, uri=None, entity_factory=None, standalone=False, validate=False,
     1
 
     '''
+    flags = _parse_flags(standalone, validate)
+    if readonly:
+        if entity_factory is not None or rule_handler is not None:
+            raise TypeError("a read-only parse takes no entity_factory or rule_handler")
+        return _parse_frozen(inputsource(obj, uri), flags)
+    return _parse(inputsource(obj, uri), flags, entity_factory=entity_factory,rule_handler=rule_handler,prune=prune)
+
+
+def _parse_flags(standalone, validate):
     if standalone:
-        flags = PARSE_FLAGS_STANDALONE
+        return PARSE_FLAGS_STANDALONE
     elif validate:
-        flags = PARSE_FLAGS_VALIDATE
+        return PARSE_FLAGS_VALIDATE
+    return PARSE_FLAGS_EXTERNAL_ENTITIES
+
+
+class parser(_parser):
+    '''
+    A parser for many documents, one after the other
+
+    :param entity_factory: as for `parse`
+    :param standalone: as for `parse`
+    :param validate: as for `parse`
+
+    `parse` creates a reader (with its own Expat parser and name caches) for
+    each document and discards it afterwards, which for small documents
+    costs more than the parsing itself.  A parser object keeps its reader,
+    resetting it between documents, so its caches stay warm.
+
+    A parser handles one document at a time; use one per thread.
+
+    >>> p = parser()
+    >>> [ p.parse('<a>%i</a>' % i).xml_first_child.xml_first_child.xml_value for i in range(3) ]
+    [u'0', u'1', u'2']
+    '''
+    __slots__ = ()
+
+    def __new__(cls, entity_factory=None, standalone=False, validate=False):
+        return _parser.__new__(cls, _parse_flags(standalone, validate), entity_factory)
+
+    def parse(self, obj, uri=None):
+        '''
+        Parse an XML input source and return a tree, as `amara.tree.parse`
+        '''
+        return _parser.parse(self, inputsource(obj, uri))
+
+
+class incremental_parser(parser):
+    '''
+    A parser for documents that arrive in parts, from the network for example
+
+    :param uri: document URI, used as for `parse`
+    :param entity_factory: as for `parse`
+    :param standalone: as for `parse`
+    :param validate: as for `parse`
+
+    Each part is parsed as it is passed to `feed`, so neither the whole
+    document nor a thread waiting on its source need be kept around, and
+    `close` returns the tree.  The parser can then be fed the next
+    document.  After an error the document is abandoned; feeding again
+    starts a new one.
+
+    >>> p = incremental_parser()
+    >>> for part in ['<a>sp', 'am</', 'a>']:
+    ...     p.feed(part)
+    >>> p.close().xml_first_child.xml_first_child.xml_value
+    u'spam'
+    '''
+    __slots__ = ('uri',)
+
+    def __new__(cls, uri=None, entity_factory=None, standalone=False, validate=False):
+        self = _parser.__new__(cls, _parse_flags(standalone, validate), entity_factory)
+        self.uri = uri
+        return self
+
+    def feed(self, data):
+        '''
+        Parse the next part of the document (a string of any length)
+        '''
+        if not self.feeding:
+            # the input source only provides the base URI (its stream is empty)
+            self.start(inputsource(StringIO(), self.uri))
+        _parser.feed(self, data)
+
+    def close(self):
+        '''
+        End the document and return its tree
+
+        :raises `amara.ReaderError`: If the document is incomplete
+        '''
+        if not self.feeding:
+            self.start(inputsource(StringIO(), self.uri))
+        return _parser.close(self)
+
+
+def load(obj, readonly=False):
+    '''
+    Load a tree from a snapshot written by its `xml_dump` method
+
+    :param obj: snapshot to load
+    :type obj: file path, file-like object (stream) or string
+    :param readonly: if true, return a read-only tree (as from
+        `parse(..., readonly=True)`), otherwise a regular one
+    :return: Loaded tree object
+    :rtype: `amara.tree.entity` or `amara.tree.frozen_node` instance
+    :raises ValueError: If the snapshot is damaged, or was written on a
+        different kind of platform (snapshots are a cache, not an exchange
+        format)
+
+    A file is mapped into memory rather than read, and a read-only tree
+    uses the mapping in place, so loading it takes little more than
+    checking its structure.
+
+    >>> import amara, cStringIO
+    >>> doc = amara.parse('<monty><python spam="eggs"/></monty>')
+    >>> f = cStringIO.StringIO()
+    >>> doc.xml_dump(f)
+    >>> load(f.getvalue()).xml_encode()
+    '<?xml version="1.0" encoding="UTF-8"?>\\n<monty><python spam="eggs"/></monty>'
+    '''
+    if isinstance(obj, basestring) and not obj.startswith(_SNAPSHOT_MAGIC):
+        # the mapping stays valid once the file is closed
+        with open(obj, 'rb') as f:
+            return load(f, readonly)
+    if hasattr(obj, 'fileno'):
+        import mmap
+        try:
+            data = mmap.mmap(obj.fileno(), 0, access=mmap.ACCESS_READ)
+        except (EnvironmentError, ValueError):
+            # not a regular file (or an empty one)
+            data = obj.read()
+    elif hasattr(obj, 'read'):
+        data = obj.read()
     else:
-        flags = PARSE_FLAGS_EXTERNAL_ENTITIES
-    return _parse(inputsource(obj, uri), flags, entity_factory=entity_factory,rule_handler=rule_handler)
+        data = obj
+    return _load_snapshot(data, readonly)
+
+_SNAPSHOT_MAGIC = 'amaradom'
+
+
+def _cpu_count():
+    try:
+        import multiprocessing
+        return multiprocessing.cpu_count()
+    except (ImportError, NotImplementedError):
+        return 1
+
+
+def parse_many(sources, workers=None, ordered=True, **kwargs):
+    '''
+    Parse a number of XML input sources using a pool of threads and
+    return an iterator over the resulting trees
+
+    :param sources: iterable of objects accepted by `parse`; it is consumed
+        lazily, as workers become free
+    :param workers: number of parsing threads, by default one per CPU
+    :type workers: int
+    :param ordered: if true, the trees are produced in the order of `sources`,
+        otherwise `(index, tree)` pairs are produced as each parse completes
+    :return: iterator over the parsed trees
+    :raises `amara.ReaderError`: (or any other exception from `parse`) when the
+        result for the failing source is reached, after which no further
+        sources are parsed
+
+    The remaining keyword arguments are passed on to `parse`.  Each parse
+    uses its own reader; the documents are tokenized without holding the GIL,
+    so that part proceeds in parallel while the trees themselves are built
+    one at a time.
+
+    >>> docs = ['<a>%i</a>' % i for i in range(10)]
+    >>> [ doc.xml_first_child.xml_first_child.xml_value for doc in parse_many(docs, workers=4) ]
+    [u'0', u'1', u'2', u'3', u'4', u'5', u'6', u'7', u'8', u'9']
+    '''
+    if workers is None:
+        workers = _cpu_count()
+    if workers <= 1:
+        for index, obj in enumerate(sources):
+            doc = parse(obj, **kwargs)
+            if ordered:
+                yield doc
+            else:
+                yield index, doc
+        return
+
+    import sys, threading, Queue
+    sources = enumerate(sources)
+    lock = threading.Lock()
+    # Bounds the number of trees parsed but not yet consumed
+    pending = threading.Semaphore(workers * 2)
+    results = Queue.Queue()
+    stopped = []
+
+    def worker():
+        while True:
+            pending.acquire()
+            lock.acquire()
+            try:
+                if stopped:
+                    break
+                try:
+                    index, obj = sources.next()
+                except StopIteration:
+                    break
+                except:
+                    stopped.append(True)
+                    results.put((None, None, sys.exc_info()))
+                    break
+            finally:
+                lock.release()
+            try:
+                results.put((index, parse(obj, **kwargs), None))
+            except:
+                results.put((index, None, sys.exc_info()))
+        results.put(None)
+        return
+
+    threads = [ threading.Thread(target=worker) for i in xrange(workers) ]
+    for thread in threads:
+        # an abandoned iterator must not keep the interpreter alive
+        thread.setDaemon(True)
+        thread.start()
+    try:
+        running = workers
+        next_index = 0
+        done = {}
+        while running:
+            result = results.get()
+            if result is None:
+                running -= 1
+                continue
+            if not ordered:
+                index, doc, error = result
+                if error:
+                    raise error[0], error[1], error[2]
+                pending.release()
+                yield index, doc
+                continue
+            done[result[0]] = result
+            while next_index in done or None in done:
+                index, doc, error = done.pop(next_index, None) or done.pop(None)
+                if error:
+                    raise error[0], error[1], error[2]
+                next_index += 1
+                pending.release()
+                yield doc
+    finally:
+        lock.acquire()
+        stopped.append(True)
+        lock.release()
+        # wake up any worker waiting for room and let the others finish
+        # the parse in progress
+        for thread in threads:
+            pending.release()
+        for thread in threads:
+            thread.join()
+    return
 
 #Rest of the functions are deprecated, and will be removed soon
 
@@ -123,15 +385,19 @@ def ParseFragment(*args, **kwds):
 # for any kind of production.  It is an experimental prototype
 # ------------------------------------------------------------
 
-def sendtree(obj, pattern, target, uri=None, entity_factory=None, standalone=False, validate=False):
-    # This callback does "pattern matching".  Nothing really implemented now--just a simple check
+def sendtree(obj, pattern, target, uri=None, entity_factory=None, standalone=False, validate=False, prune=False):
+    # This handler does "pattern matching".  Nothing really implemented now--just a simple check
     # for an element name match.  Eventually build into a pattern matching system.
-    def callback(node):
-        if node.xml_local == pattern:
-            target.send(node)
+    # With prune, each matched element is released once sent (see parse)
+    class handler(object):
+        def startElementNS(self, node, name, qname, attrs):
+            return name[1] == pattern
+        def endElementNS(self, node, name, qname):
+            if name[1] == pattern:
+                target.send(node)
 
     # Run the parser
-    return parse(obj,uri,entity_factory,standalone,validate,callback)
+    return parse(obj,uri,entity_factory,standalone,validate,handler(),prune=prune)
 
 
         
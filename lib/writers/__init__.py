@@ -41,6 +41,7 @@ Principles of redesign:
 import sys
 from amara import Error
 from amara.lib.xmlstring import *
+from amara.writers import _xmlstream
 
 __all__ = ['WriterError', 'writer', 'streamwriter',
            'HTML_W', 'XML_W', 'XHTML_W',
@@ -52,6 +53,9 @@ HTML_W = 'html'
 XML_W = 'xml'
 XHTML_W = 'xhtml'
 
+# Size of the output buffer used by xml_write() for generic file-likes
+OUTPUT_BUFFER_SIZE = 65536
+
 _lookup_table = {}
 
 class WriterError(Error):
@@ -123,7 +127,8 @@ def _xml_write(N, writer=XML_W, stream=None, encoding='UTF-8', **kwargs):
 
     Serializes an XML tree, writing it to the specified 'stream' object.
     """
-    from amara.writers import node
+    from amara import tree
+    from amara.writers import node, _xmlprinters
     if isinstance(writer, str):
         writer_class = lookup(writer)
     else:
@@ -140,8 +145,25 @@ def _xml_write(N, writer=XML_W, stream=None, encoding='UTF-8', **kwargs):
         #for example applying exclusive c14n rules
         kwargs = writer.prepare(N, kwargs)
 
-    v = node._Visitor(writer)
-    v.visit(N)
+    #The printers make many small writes; combine them for streams where
+    #each write is a Python method call
+    xs = getattr(writer, 'stream', None)
+    if isinstance(xs, _xmlstream.xmlstream):
+        xs.buffer_size = OUTPUT_BUFFER_SIZE
+    else:
+        xs = None
+
+    try:
+        if (writer.__class__ in _xmlprinters.native_printers
+            and isinstance(N, (tree.node, tree.frozen_node))
+            and N.xml_type in _xmlprinters.native_node_types):
+            writer.print_tree(N)
+        else:
+            v = node._Visitor(writer)
+            v.visit(N)
+    finally:
+        if xs is not None:
+            xs.flush()
 
 def _xml_encode(N, writer=XML_W, encoding='UTF-8', **kwargs):
     """(node, Writer): None
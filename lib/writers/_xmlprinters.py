@@ -84,6 +84,27 @@ class xmlprinter(object):
                 # No element content, use minimized form
                 self.write_ascii('/>')
             self._element_name = None
+        self.stream.flush()
+        return
+
+    def flush(self):
+        """
+        Writes any output held in the stream's buffer.
+        """
+        self.stream.flush()
+        return
+
+    def print_tree(self, node):
+        """
+        Writes the tree rooted at `node` to the stream, giving the same
+        output as the events generated by a _Visitor, without dispatching
+        an event per node.
+        """
+        entities = (self._text_entities, self._attr_entities_quot,
+                    self._attr_entities_apos)
+        _xmlstream.print_tree(self.stream, node, entities,
+                              self.omit_declaration,
+                              bool(self._canonical_form))
         return
 
     def doctype(self, name, publicid, systemid):
@@ -450,6 +471,14 @@ class xmlprettyprinter(xmlprinter):
         self._level = 0
         self._can_indent = False  # don't indent first element
 
+    def print_tree(self, node):
+        entities = (self._text_entities, self._attr_entities_quot,
+                    self._attr_entities_apos)
+        _xmlstream.print_tree(self.stream, node, entities,
+                              self.omit_declaration,
+                              bool(self._canonical_form), self.indent)
+        return
+
     def start_element(self, namespace, name, namespaces, attributes):
         if self._element_name:
             self.write_ascii('>')
@@ -505,3 +534,11 @@ class xmlprettyprinter(xmlprinter):
         # Allow indenting after comments
         self._can_indent = True
         return
+
+
+# The printers whose print_tree() matches their event handlers; subclasses
+# that override the handlers are driven by a _Visitor instead
+native_printers = (xmlprinter, xmlprettyprinter, canonicalxmlprinter)
+native_node_types = frozenset([tree.entity.xml_type, tree.element.xml_type,
+                               tree.text.xml_type, tree.comment.xml_type,
+                               tree.processing_instruction.xml_type])
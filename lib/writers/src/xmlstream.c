@@ -9,6 +9,7 @@ and unencodable characters.";
 #include "Python.h"
 #include "structmember.h"
 #include "cStringIO.h"
+#include "domlette_interface.h"
 
 #if defined(_WIN32) || defined(__WIN32__) && !defined(__CYGWIN__)
 #  define strcasecmp stricmp
@@ -38,6 +39,15 @@ typedef struct XmlStreamObject {
 
   PyObject *encode;
   unsigned long flags;
+
+  /* If non-zero, the characters below this can be written as a single
+   * byte of the same value and all others need a character reference. */
+  Py_UNICODE max_char;
+
+  /* Output buffer; NULL when writes go directly to the stream */
+  char *buffer;
+  Py_ssize_t buffer_size;
+  Py_ssize_t buffer_used;
 } XmlStreamObject;
 
 typedef struct {
@@ -49,6 +59,8 @@ typedef struct {
 
 static PyTypeObject EntityMap_Type;
 static PyObject *ascii_string;
+static PyObject *ascii_encoder;
+static PyObject *latin1_encoder;
 
 /** XmlStream internal functions **************************************/
 
@@ -99,28 +111,84 @@ write_other(XmlStreamObject *self, const char *s, Py_ssize_t n)
   return n;
 }
 
-Py_LOCAL_INLINE(PyObject *)
-encode_unicode(XmlStreamObject *self, PyObject *unicode)
+/* Writes out any buffered data */
+static int
+flush_buffer(XmlStreamObject *self)
 {
-  PyObject *args, *result, *data;
+  Py_ssize_t used = self->buffer_used;
+  if (used > 0) {
+    self->buffer_used = 0;
+    if (self->write_func(self, self->buffer, used) < 0)
+      return -1;
+  }
+  return 0;
+}
 
-  /* create the arguments tuple */
-  args = PyTuple_New((Py_ssize_t)1);
-  if (!args) {
-    Py_DECREF(unicode);
-    return NULL;
+/* Writes `n` bytes either to the buffer or, if not buffering or the data
+ * would not fit, to the stream. */
+Py_LOCAL_INLINE(Py_ssize_t)
+write_data(XmlStreamObject *self, const char *s, Py_ssize_t n)
+{
+  if (self->buffer == NULL)
+    return self->write_func(self, s, n);
+  if (self->buffer_used + n > self->buffer_size) {
+    if (flush_buffer(self) < 0)
+      return -1;
+    /* large writes go straight through */
+    if (n >= self->buffer_size)
+      return self->write_func(self, s, n);
+  }
+  memcpy(self->buffer + self->buffer_used, s, n);
+  self->buffer_used += n;
+  return n;
+}
+
+/* Changes the size of the output buffer, flushing it first; a size of 0
+ * disables buffering. */
+static int
+set_buffer_size(XmlStreamObject *self, Py_ssize_t size)
+{
+  char *buffer = NULL;
+
+  if (size < 0) {
+    PyErr_SetString(PyExc_ValueError, "buffer_size must not be negative");
+    return -1;
+  }
+  if (flush_buffer(self) < 0)
+    return -1;
+  /* buffering gives nothing for real files (stdio already buffers) nor
+   * for cStringIO objects */
+  if (size > 0 && self->write_func == write_other) {
+    buffer = PyMem_Malloc(size);
+    if (buffer == NULL) {
+      PyErr_NoMemory();
+      return -1;
+    }
   }
-  Py_INCREF(unicode);
-  PyTuple_SET_ITEM(args, 0, unicode);
+  PyMem_Free(self->buffer);
+  self->buffer = buffer;
+  self->buffer_size = size;
+  return 0;
+}
+
+Py_LOCAL_INLINE(PyObject *)
+encode_unicode_errors(XmlStreamObject *self, PyObject *unicode,
+                      const char *errors)
+{
+  PyObject *result, *data;
 
   /* call the encoder */
-  result = PyEval_CallObject(self->encode, args);
-  Py_DECREF(args);
+  if (errors == NULL)
+    result = PyObject_CallFunctionObjArgs(self->encode, unicode, NULL);
+  else
+    result = PyObject_CallFunction(self->encode, "Os", unicode, errors);
   if (!result) return NULL;
 
   if (!PyTuple_Check(result) || PyTuple_GET_SIZE(result) != 2) {
     PyErr_SetString(PyExc_TypeError,
                     "encoder must return a tuple (object,integer)");
+    Py_DECREF(result);
+    return NULL;
   }
 
   /* borrowed reference */
@@ -138,6 +206,81 @@ encode_unicode(XmlStreamObject *self, PyObject *unicode)
   return data;
 }
 
+#define encode_unicode(self, unicode) \
+  encode_unicode_errors((self), (unicode), NULL)
+
+/* Number of bytes needed for the "&#N;" form of `ch` */
+Py_LOCAL_INLINE(Py_ssize_t)
+charref_size(unsigned long ch)
+{
+  Py_ssize_t size = 4;
+  while (ch >= 10) {
+    ch /= 10;
+    size++;
+  }
+  return size;
+}
+
+/* Narrow builds store characters beyond the BMP as surrogate pairs */
+#define IS_HIGH_SURROGATE(c) (((c) >= 0xD800) && ((c) <= 0xDBFF))
+#define IS_LOW_SURROGATE(c) (((c) >= 0xDC00) && ((c) <= 0xDFFF))
+#define IS_SURROGATE_PAIR(s, i, n) \
+  (IS_HIGH_SURROGATE((s)[i]) && (i) + 1 < (n) && IS_LOW_SURROGATE((s)[(i)+1]))
+#define JOIN_SURROGATES(hi, lo) \
+  (0x10000 + ((((unsigned long) (hi)) - 0xD800) << 10) + ((lo) - 0xDC00))
+
+/* Encodes `unicode` for streams whose encoding maps the characters below
+ * `self->max_char` to a byte of the same value (ASCII and Latin-1),
+ * replacing all others with their numerical character entity. */
+Py_LOCAL_INLINE(PyObject *)
+encode_charrefs(XmlStreamObject *self, PyObject *unicode)
+{
+  const Py_UNICODE max_char = self->max_char;
+  Py_UNICODE *unistr = PyUnicode_AS_UNICODE(unicode);
+  Py_ssize_t size = PyUnicode_GET_SIZE(unicode);
+  Py_ssize_t i, nbytes;
+  PyObject *data;
+  char *p;
+
+  /* find the size of the encoded string; most of the time it is simply
+   * the number of characters */
+  nbytes = size;
+  for (i = 0; i < size; i++) {
+    if (unistr[i] >= max_char) {
+      if (IS_SURROGATE_PAIR(unistr, i, size)) {
+        nbytes += charref_size(JOIN_SURROGATES(unistr[i], unistr[i+1])) - 2;
+        i++;
+      } else
+        nbytes += charref_size(unistr[i]) - 1;
+    }
+  }
+
+  data = PyString_FromStringAndSize(NULL, nbytes);
+  if (data == NULL)
+    return NULL;
+  p = PyString_AS_STRING(data);
+  if (nbytes == size) {
+    for (i = 0; i < size; i++)
+      p[i] = (char) unistr[i];
+  } else {
+    for (i = 0; i < size; i++) {
+      /* copy the run of encodable characters */
+      while (i < size && unistr[i] < max_char)
+        *p++ = (char) unistr[i++];
+      if (i < size) {
+        unsigned long ch = unistr[i];
+        if (IS_SURROGATE_PAIR(unistr, i, size)) {
+          ch = JOIN_SURROGATES(ch, unistr[i+1]);
+          i++;
+        }
+        /* Note: use decimal form due to some broken browsers. */
+        p += sprintf(p, "&#%lu;", ch);
+      }
+    }
+  }
+  return data;
+}
+
 Py_LOCAL_INLINE(Py_ssize_t)
 write_encode(XmlStreamObject *self, PyObject *string, PyObject *where)
 {
@@ -171,7 +314,7 @@ write_encode(XmlStreamObject *self, PyObject *string, PyObject *where)
     return -1;
   }
 
-  result = self->write_func(self, PyString_AS_STRING(data),
+  result = write_data(self, PyString_AS_STRING(data),
                             PyString_GET_SIZE(data));
   Py_DECREF(data);
   return result;
@@ -181,50 +324,29 @@ Py_LOCAL_INLINE(int)
 write_escaped(XmlStreamObject *self, PyObject *unicode)
 {
   PyObject *data;
-  Py_UNICODE *unistr;
-  Py_ssize_t size;
-  char charref[14]; /* charref: 10 digits (32-bits) plus '&#' and ';\0' */
+  Py_ssize_t result;
 
-  data = encode_unicode(self, unicode);
-  if (!data) {
-    /* Replace any characters not representable in this encoding with
-     * their numerical character entity.
-     */
-    PyErr_Clear();
-    size = PyUnicode_GET_SIZE(unicode);
-    unistr = PyUnicode_AS_UNICODE(unicode);
-    while (size-- > 0) {
-      PyObject *unichar = PyUnicode_FromUnicode(unistr, (Py_ssize_t)1);
-      data = encode_unicode(self, unichar);
-      Py_DECREF(unichar);
-      if (!data) {
-        /* Found an offending character */
-        PyErr_Clear();
-        /* Note: use decimal form due to some broken browsers. */
-        sprintf(charref, "&#%ld;", (long) *unistr);
-        data = PyString_FromString(charref);
-        if (!data) {
-          return -1;
-        }
-      }
-      if (self->write_func(self, PyString_AS_STRING(data),
-                           PyString_GET_SIZE(data)) < 0) {
-        Py_DECREF(data);
-        return -1;
-      }
-      Py_DECREF(data);
-      unistr++;
-    }
-  } else {
-    if (self->write_func(self, PyString_AS_STRING(data),
-                         PyString_GET_SIZE(data)) < 0) {
-      Py_DECREF(data);
+  if (self->max_char) {
+    data = encode_charrefs(self, unicode);
+    if (!data)
       return -1;
+  } else {
+    data = encode_unicode(self, unicode);
+    if (!data) {
+      /* Replace any characters not representable in this encoding with
+       * their numerical character entity.
+       */
+      PyErr_Clear();
+      data = encode_unicode_errors(self, unicode, "xmlcharrefreplace");
+      if (!data)
+        return -1;
     }
-    Py_DECREF(data);
   }
 
-  return 0;
+  result = write_data(self, PyString_AS_STRING(data),
+                            PyString_GET_SIZE(data));
+  Py_DECREF(data);
+  return result < 0 ? -1 : 0;
 }
 
 Py_LOCAL_INLINE(Py_ssize_t)
@@ -235,7 +357,7 @@ write_ascii(XmlStreamObject *self, PyObject *string)
 
   if (self->flags & XMLSTREAM_FLAGS_ASCII_SAFE)
     /* shortcut, write it directly */
-    return self->write_func(self, PyString_AS_STRING(string),
+    return write_data(self, PyString_AS_STRING(string),
                             PyString_GET_SIZE(string));
 
   /* ASCII must be encoded before writing it to the stream */
@@ -249,13 +371,161 @@ write_ascii(XmlStreamObject *self, PyObject *string)
   return result;
 }
 
+/* Legal XML characters are:
+ *   0x09 0x0A 0x0D 0x20-0xD7FF 0xE000-0xFFFD 0x10000-0x10FFFF */
+#define LEGAL_UCS2(c) ((c) == 0x09 || (c) == 0x0A || (c) == 0x0D || \
+                       (((c) >= 0x20) && ((c) <= 0xD7FF)) || \
+                       (((c) >= 0xE000) && ((c) <= 0xFFFD)))
+#define LEGAL_UCS4(c) (((c) >= 0x10000) && ((c) <= 0x10FFFF))
+
+#ifdef Py_UNICODE_WIDE
+#define LEGAL_XML_CHAR(c) (LEGAL_UCS2(c) || LEGAL_UCS4(c))
+#else
+#define LEGAL_XML_CHAR LEGAL_UCS2
+#endif
+
+/* Writes `string` replacing the characters given by `entities` */
+static int
+write_escape(XmlStreamObject *self, PyObject *string,
+             EntityMapObject *entities)
+{
+  PyObject *newstr = NULL;
+  Py_UNICODE *p, *chunk_start;
+  Py_ssize_t size;
+  Py_ssize_t chunk_size;
+
+  /* this might get replaced */
+  Py_INCREF(string);
+
+  /* Replace any illegal characters with '?' */
+  size = PyUnicode_GET_SIZE(string);
+  p = PyUnicode_AS_UNICODE(string);
+  while (size-- > 0) {
+    if (!LEGAL_XML_CHAR(*p)) {
+#ifndef Py_UNICODE_WIDE
+      /* keep well-formed surrogate pairs; they are a single character */
+      if (size > 0 && IS_HIGH_SURROGATE(p[0]) && IS_LOW_SURROGATE(p[1])) {
+        p += 2;
+        size--;
+        continue;
+      }
+#endif
+      /* replace it */
+      if (newstr == NULL) {
+        /* create a copy to work with */
+        newstr = PyUnicode_FromUnicode(PyUnicode_AS_UNICODE(string),
+                                       PyUnicode_GET_SIZE(string));
+        if (newstr == NULL) {
+          Py_DECREF(string);
+          return -1;
+        }
+
+        /* move pointer to the correct location in the copy */
+        p = PyUnicode_AS_UNICODE(newstr) + (p - PyUnicode_AS_UNICODE(string));
+
+        /* replaced passed in unicode object with the copy */
+        Py_DECREF(string);
+        string = newstr;
+      }
+      *p = '?';
+    }
+    p++;
+  }
+
+  /* Write out the string replacing the entities given by EntityMap as we go */
+  size = PyUnicode_GET_SIZE(string);
+  p = chunk_start = PyUnicode_AS_UNICODE(string);
+  while (size-- > 0) {
+    if (*p <= entities->max_entity && entities->entity_table[*p]) {
+      PyObject *repl = entities->entity_table[*p];
+
+      /* write out everything up to the character to replace */
+      chunk_size = p - chunk_start;
+      if (chunk_size > 0) {
+        newstr = PyUnicode_FromUnicode(chunk_start, chunk_size);
+        if (write_escaped(self, newstr) < 0) {
+          Py_DECREF(newstr);
+          Py_DECREF(string);
+          return -1;
+        }
+        Py_DECREF(newstr);
+      }
+
+      /* the entities are stored as PyStrings or callable objects */
+      if (PyString_Check(repl)) {
+        /* a direct string replacement */
+        Py_INCREF(repl);
+      } else {
+        /* a callable that generates the replacement string */
+        repl = PyObject_CallFunction(repl, "Oi", string,
+                                     (p - PyUnicode_AS_UNICODE(string)));
+        if (repl == NULL) {
+          Py_DECREF(string);
+          return -1;
+        } else if (!PyString_Check(repl)) {
+          PyErr_Format(PyExc_TypeError,
+                       "expected string, but %.200s found",
+                       repl->ob_type->tp_name);
+          Py_DECREF(repl);
+          Py_DECREF(string);
+          return -1;
+        }
+      }
+
+      /* write the replacement string */
+      if (write_ascii(self, repl) < 0) {
+        Py_DECREF(string);
+        Py_DECREF(repl);
+        return -1;
+      }
+      Py_DECREF(repl);
+
+      /* skip over the replaced character */
+      chunk_start = p + 1;
+    }
+    p++;
+  }
+
+  chunk_size = p - chunk_start;
+  /* write out remaining text */
+  if (chunk_size > 0) {
+    newstr = PyUnicode_FromUnicode(chunk_start, chunk_size);
+    if (write_escaped(self, newstr) < 0) {
+      Py_DECREF(newstr);
+      Py_DECREF(string);
+      return -1;
+    }
+    Py_DECREF(newstr);
+  }
+
+  Py_DECREF(string);
+  return 0;
+}
+
+/* Writes the UTF-16 byte order mark ahead of the first output */
+Py_LOCAL_INLINE(int)
+write_bom(XmlStreamObject *self)
+{
+  if (self->flags & XMLSTREAM_FLAGS_BOM) {
+    char *bom = (self->flags & XMLSTREAM_FLAGS_BOM_LE)
+                ? "\xFF\xFE" : "\xFE\xFF";
+    if (write_data(self, bom, 2) < 0)
+      return -1;
+    /* clear the flag */
+    self->flags &= ~XMLSTREAM_FLAGS_BOM;
+  }
+  return 0;
+}
+
 /** XmlStream Object *************************************************/
 
 static char xmlstream_doc[] = \
-"xmlstream(stream, encoding)\n\
+"xmlstream(stream, encoding[, buffer_size])\n\
 \n\
 `stream` must be a file-like object open for writing (binary) data.\n\
 `encoding` specifies the encoding which is to be used for the stream.\n\
+`buffer_size`, if given and not zero, is the size of the buffer used to\n\
+combine small writes; buffered data is written by `flush()`.\n\
 ";
 
 static PyObject *
@@ -263,11 +533,12 @@ xmlstream_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
   XmlStreamObject *self;
   PyObject *stream, *encoding;
-  static char *kwlist[] = { "stream", "encoding", NULL };
+  Py_ssize_t buffer_size = 0;
+  static char *kwlist[] = { "stream", "encoding", "buffer_size", NULL };
   PyObject *test;
 
-  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OS:xmlstream", kwlist,
-                                   &stream, &encoding))
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "OS|n:xmlstream", kwlist,
+                                   &stream, &encoding, &buffer_size))
     return NULL;
 
   self = (XmlStreamObject *)type->tp_alloc(type, 1);
@@ -321,6 +592,10 @@ xmlstream_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     Py_DECREF(self);
     return NULL;
   }
+  if (self->encode == ascii_encoder)
+    self->max_char = 0x80;
+  else if (self->encode == latin1_encoder)
+    self->max_char = 0x100;
 
   Py_INCREF(stream);
   self->stream = stream;
@@ -338,6 +613,11 @@ xmlstream_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
     Py_DECREF(test);
   }
 
+  if (buffer_size && set_buffer_size(self, buffer_size) < 0) {
+    Py_DECREF(self);
+    return NULL;
+  }
+
   return (PyObject *)self;
 }
 
@@ -353,14 +633,8 @@ static PyObject *xmlstream_write_ascii(XmlStreamObject *self, PyObject *args)
   if (!PyArg_ParseTuple(args, "S:write_ascii", &data))
     return NULL;
 
-  if (self->flags & XMLSTREAM_FLAGS_BOM) {
-    char *bom = (self->flags & XMLSTREAM_FLAGS_BOM_LE)
-                ? "\xFF\xFE" : "\xFE\xFF";
-    if (self->write_func(self, bom, 2) < 0)
-      return NULL;
-    /* clear the flag */
-    self->flags &= ~XMLSTREAM_FLAGS_BOM;
-  }
+  if (write_bom(self) < 0)
+    return NULL;
 
   if (write_ascii(self, data) < 0)
     return NULL;
@@ -384,14 +658,8 @@ static PyObject *xmlstream_write_encode(XmlStreamObject *self, PyObject *args)
   if (!PyArg_ParseTuple(args, "U|O:writeEncode", &string, &where))
     return NULL;
 
-  if (self->flags & XMLSTREAM_FLAGS_BOM) {
-    char *bom = (self->flags & XMLSTREAM_FLAGS_BOM_LE)
-                ? "\xFF\xFE" : "\xFE\xFF";
-    if (self->write_func(self, bom, 2) < 0)
-      return NULL;
-    /* clear the flag */
-    self->flags &= ~XMLSTREAM_FLAGS_BOM;
-  }
+  if (write_bom(self) < 0)
+    return NULL;
 
   if (write_encode(self, string, where) < 0)
     return NULL;
@@ -409,141 +677,46 @@ Writes the unicode string encoded to the stream.\n\
 Additional, any character that cannot be encoded is replaced with its\n\
 numerical character entity.  Illegal XML characters are replaced by '?'.";
 
-/* Legal XML characters are:
- *   0x09 0x0A 0x0D 0x20-0xD7FF 0xE000-0xFFFD 0x10000-0x10FFFF */
-#define LEGAL_UCS2(c) ((c) == 0x09 || (c) == 0x0A || (c) == 0x0D || \
-                       (((c) >= 0x20) && ((c) <= 0xD7FF)) || \
-                       (((c) >= 0xE000) && ((c) <= 0xFFFD)))
-#define LEGAL_UCS4(c) (((c) >= 0x10000) && ((c) <= 0x10FFFF))
-
-#ifdef Py_UNICODE_WIDE
-#define LEGAL_XML_CHAR(c) (LEGAL_UCS2(c) || LEGAL_UCS4(c))
-#else
-#define LEGAL_XML_CHAR LEGAL_UCS2
-#endif
-
 static PyObject *xmlstream_write_escape(XmlStreamObject *self, PyObject *args)
 {
   PyObject *string;
   EntityMapObject *entities;
-  PyObject *newstr = NULL;
-  Py_UNICODE *p, *chunk_start;
-  Py_ssize_t size;
-  Py_ssize_t chunk_size;
 
   if (!PyArg_ParseTuple(args, "UO!:writeEscape", &string,
                         &EntityMap_Type, &entities))
     return NULL;
 
-  if (self->flags & XMLSTREAM_FLAGS_BOM) {
-    char *bom = (self->flags & XMLSTREAM_FLAGS_BOM_LE)
-                ? "\xFF\xFE" : "\xFE\xFF";
-    if (self->write_func(self, bom, 2) < 0)
-      return NULL;
-    /* clear the flag */
-    self->flags &= ~XMLSTREAM_FLAGS_BOM;
-  }
+  if (write_bom(self) < 0)
+    return NULL;
 
-  /* this might get replaced */
-  Py_INCREF(string);
+  if (write_escape(self, string, entities) < 0)
+    return NULL;
 
-  /* Replace any illegal characters with '?' */
-  size = PyUnicode_GET_SIZE(string);
-  p = PyUnicode_AS_UNICODE(string);
-  while (size-- > 0) {
-    if (!LEGAL_XML_CHAR(*p)) {
-      /* replace it */
-      if (newstr == NULL) {
-        /* create a copy to work with */
-        newstr = PyUnicode_FromUnicode(PyUnicode_AS_UNICODE(string),
-                                       PyUnicode_GET_SIZE(string));
-        if (newstr == NULL) return NULL;
-
-        /* move pointer to the correct location in the copy */
-        p = PyUnicode_AS_UNICODE(newstr) + (p - PyUnicode_AS_UNICODE(string));
-
-        /* replaced passed in unicode object with the copy */
-        Py_DECREF(string);
-        string = newstr;
-      }
-      *p = '?';
-    }
-    p++;
-  }
-
-  /* Write out the string replacing the entities given by EntityMap as we go */
-  size = PyUnicode_GET_SIZE(string);
-  p = chunk_start = PyUnicode_AS_UNICODE(string);
-  while (size-- > 0) {
-    if (*p <= entities->max_entity && entities->entity_table[*p]) {
-      PyObject *repl = entities->entity_table[*p];
-
-      /* write out everything up to the character to replace */
-      chunk_size = p - chunk_start;
-      if (chunk_size > 0) {
-        newstr = PyUnicode_FromUnicode(chunk_start, chunk_size);
-        if (write_escaped(self, newstr) < 0) {
-          Py_DECREF(newstr);
-          Py_DECREF(string);
-          return NULL;
-        }
-        Py_DECREF(newstr);
-      }
-
-      /* the entities are stored as PyStrings or callable objects */
-      if (PyString_Check(repl)) {
-        /* a direct string replacement */
-        Py_INCREF(repl);
-      } else {
-        /* a callable that generates the replacement string */
-        repl = PyObject_CallFunction(repl, "Oi", string,
-                                     (p - PyUnicode_AS_UNICODE(string)));
-        if (repl == NULL) {
-          Py_DECREF(string);
-          return NULL;
-        } else if (!PyString_Check(repl)) {
-          PyErr_Format(PyExc_TypeError,
-                       "expected string, but %.200s found",
-                       repl->ob_type->tp_name);
-          Py_DECREF(repl);
-          Py_DECREF(string);
-          return NULL;
-        }
-      }
-
-      /* write the replacement string */
-      if (write_ascii(self, repl) < 0) {
-        Py_DECREF(string);
-        Py_DECREF(repl);
-        return NULL;
-      }
-      Py_DECREF(repl);
+  Py_INCREF(Py_None);
+  return Py_None;
+}
 
-      /* skip over the replaced character */
-      chunk_start = p + 1;
-    }
-    p++;
-  }
+static char flush_doc[] =
+"flush()\n\
+\n\
+Writes any buffered data to the stream.";
 
-  chunk_size = p - chunk_start;
-  /* write out remaining text */
-  if (chunk_size > 0) {
-    newstr = PyUnicode_FromUnicode(chunk_start, chunk_size);
-    if (write_escaped(self, newstr) < 0) {
-      Py_DECREF(newstr);
-      Py_DECREF(string);
-      return NULL;
-    }
-    Py_DECREF(newstr);
-  }
+static PyObject *xmlstream_flush(XmlStreamObject *self, PyObject *noargs)
+{
+  if (flush_buffer(self) < 0)
+    return NULL;
 
-  Py_DECREF(string);
   Py_INCREF(Py_None);
   return Py_None;
 }
 
 static void xmlstream_dealloc(XmlStreamObject *self)
 {
+  if (self->buffer) {
+    if (flush_buffer(self) < 0)
+      PyErr_WriteUnraisable((PyObject *)self);
+    PyMem_Free(self->buffer);
+  }
   Py_XDECREF(self->write);
   Py_XDECREF(self->encode);
   Py_XDECREF(self->stream);
@@ -576,6 +749,8 @@ static PyMethodDef xmlstream_methods[] = {
     write_encode_doc },
   { "write_escape", (PyCFunction)xmlstream_write_escape, METH_VARARGS,
     write_escape_doc },
+  { "flush",        (PyCFunction)xmlstream_flush,        METH_NOARGS,
+    flush_doc },
   { NULL }
 };
 
@@ -589,7 +764,27 @@ static PyMemberDef xmlstream_members[] = {
 
 /** Python Computed Members *******************************************/
 
+static PyObject *get_buffer_size(XmlStreamObject *self, void *arg)
+{
+  return PyInt_FromSsize_t(self->buffer_size);
+}
+
+static int set_buffer_size_attr(XmlStreamObject *self, PyObject *v, void *arg)
+{
+  Py_ssize_t size;
+
+  if (v == NULL) {
+    PyErr_SetString(PyExc_TypeError, "cannot delete buffer_size");
+    return -1;
+  }
+  size = PyInt_AsSsize_t(v);
+  if (size == -1 && PyErr_Occurred())
+    return -1;
+  return set_buffer_size(self, size);
+}
+
 static PyGetSetDef xmlstream_getsets[] = {
+  { "buffer_size", (getter)get_buffer_size, (setter)set_buffer_size_attr },
   { NULL }
 };
 
@@ -869,9 +1064,915 @@ static PyTypeObject EntityMap_Type = {
   /* tp_free           */ 0,
 };
 
+/** Tree Printer ******************************************************/
+
+/* The Domlette C API is imported on first use, as `amara.tree` itself
+ * imports the writers. */
+static PyObject *xml_string;
+static PyObject *xmlns_string;
+static PyObject *xmlns_colon_string;
+static PyObject *xml_namespace;
+static PyObject *xmlns_namespace;
+static PyObject *empty_string;
+static PyObject *xml_declaration;
+
+/* The error locations passed to write_encode() by the printers */
+static PyObject *start_tag_where;
+static PyObject *end_tag_where;
+static PyObject *attribute_where;
+static PyObject *comment_where;
+static PyObject *pi_target_where;
+static PyObject *pi_data_where;
+static PyObject *doctype_name_where;
+static PyObject *doctype_public_where;
+static PyObject *doctype_system_where;
+
+typedef struct {
+  XmlStreamObject *stream;
+  EntityMapObject *text_entities;
+  EntityMapObject *attr_entities_quot;
+  EntityMapObject *attr_entities_apos;
+  int omit_declaration;
+  int canonical;
+  /* NULL unless pretty-printing */
+  PyObject *indent;
+  Py_ssize_t level;
+  int can_indent;
+  /* the qualified name of the element whose start-tag is still open */
+  PyObject *element_name;
+} PrinterState;
+
+#define write_literal(self, s) write_chars((self), (s), sizeof(s) - 1)
+
+/* Writes the ASCII characters `s` to the stream */
+Py_LOCAL_INLINE(Py_ssize_t)
+write_chars(XmlStreamObject *self, const char *s, Py_ssize_t n)
+{
+  PyObject *string;
+  Py_ssize_t result;
+
+  if (self->flags & XMLSTREAM_FLAGS_ASCII_SAFE)
+    return write_data(self, s, n);
+
+  string = PyString_FromStringAndSize(s, n);
+  if (string == NULL)
+    return -1;
+  result = write_ascii(self, string);
+  Py_DECREF(string);
+  return result;
+}
+
+static int printer_init(void)
+{
+  PyObject *module;
+
+  Domlette_IMPORT;
+  if (Domlette == NULL)
+    return -1;
+
+  module = PyImport_ImportModule("amara.namespaces");
+  if (module == NULL)
+    return -1;
+  xml_namespace = PyObject_GetAttrString(module, "XML_NAMESPACE");
+  xmlns_namespace = PyObject_GetAttrString(module, "XMLNS_NAMESPACE");
+  Py_DECREF(module);
+  if (xml_namespace == NULL || xmlns_namespace == NULL)
+    return -1;
+
+#define INIT_STRING(var, s) \
+  if (((var) = PyUnicode_DecodeASCII((s), sizeof(s) - 1, NULL)) == NULL) \
+    return -1
+  INIT_STRING(xml_string, "xml");
+  INIT_STRING(xmlns_string, "xmlns");
+  INIT_STRING(xmlns_colon_string, "xmlns:");
+  INIT_STRING(empty_string, "");
+#undef INIT_STRING
+
+#define INIT_STRING(var, s) \
+  if (((var) = PyString_FromString(s)) == NULL) return -1
+  INIT_STRING(start_tag_where, "start-tag name");
+  INIT_STRING(end_tag_where, "end-tag name");
+  INIT_STRING(attribute_where, "attribute name");
+  INIT_STRING(comment_where, "comment");
+  INIT_STRING(pi_target_where, "processing instruction target");
+  INIT_STRING(pi_data_where, "processing instruction data");
+  INIT_STRING(doctype_name_where, "document type name");
+  INIT_STRING(doctype_public_where, "document type public-id");
+  INIT_STRING(doctype_system_where, "document type system-id");
+#undef INIT_STRING
+
+  /* set last; it marks the printer as initialized */
+  xml_declaration = PyString_FromString("<?xml version=\"1.0\" encoding=\"");
+  if (xml_declaration == NULL)
+    return -1;
+  return 0;
+}
+
+/* Returns the prefix of the qualified name `qname` as a new reference,
+ * or None if it is unprefixed. */
+Py_LOCAL_INLINE(PyObject *)
+qname_prefix(PyObject *qname)
+{
+  Py_UNICODE *p = PyUnicode_AS_UNICODE(qname);
+  Py_ssize_t i, size = PyUnicode_GET_SIZE(qname);
+
+  for (i = 0; i < size; i++) {
+    if (p[i] == ':')
+      return PyUnicode_FromUnicode(p, i);
+  }
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
+/* Returns 1 if the `mapping[key]` differs from `value` (or `key` is missing),
+ * 0 if not, -1 on error.  This is `mapping.get(key, 0) != value`. */
+Py_LOCAL_INLINE(int)
+binding_differs(PyObject *mapping, PyObject *key, PyObject *value)
+{
+  PyObject *current = PyDict_GetItem(mapping, key);
+  if (current == NULL)
+    return 1;
+  return PyObject_RichCompareBool(current, value, Py_NE);
+}
+
+/* Ends the start-tag left open by the previous element, if any */
+Py_LOCAL_INLINE(int)
+printer_close_tag(PrinterState *state)
+{
+  if (state->element_name) {
+    state->element_name = NULL;
+    if (write_literal(state->stream, ">") < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/* Starts a new line at the current nesting level when pretty-printing */
+static int printer_newline(PrinterState *state)
+{
+  Py_ssize_t i;
+
+  if (state->indent && state->can_indent) {
+    if (write_literal(state->stream, "\n") < 0)
+      return -1;
+    for (i = 0; i < state->level; i++) {
+      if (write_ascii(state->stream, state->indent) < 0)
+        return -1;
+    }
+  }
+  return 0;
+}
+
+static int
+printer_attribute(PrinterState *state, PyObject *name, PyObject *value)
+{
+  XmlStreamObject *stream = state->stream;
+  EntityMapObject *entities = state->attr_entities_quot;
+  Py_UNICODE *p, *end;
+  int quot = 0, apos = 0;
+
+  if (write_literal(stream, " ") < 0)
+    return -1;
+  if (write_encode(stream, name, attribute_where) < 0)
+    return -1;
+  if (value == Py_None)
+    return 0;
+  if (!PyUnicode_Check(value)) {
+    PyErr_Format(PyExc_TypeError, "attribute value must be unicode, not %.200s",
+                 value->ob_type->tp_name);
+    return -1;
+  }
+  /* Values are delimited by quotes unless they contain quotes but no
+   * apostrophes (as in DOM Level 3 Load and Save); Canonical XML always
+   * uses quotes. */
+  if (!state->canonical) {
+    p = PyUnicode_AS_UNICODE(value);
+    end = p + PyUnicode_GET_SIZE(value);
+    for (; p < end; p++) {
+      if (*p == '"')
+        quot = 1;
+      else if (*p == '\'')
+        apos = 1;
+    }
+  }
+  if (quot && !apos) {
+    if (write_literal(stream, "='") < 0)
+      return -1;
+    if (write_escape(stream, value, state->attr_entities_apos) < 0)
+      return -1;
+    return write_literal(stream, "'") < 0 ? -1 : 0;
+  }
+  if (write_literal(stream, "=\"") < 0)
+    return -1;
+  if (write_escape(stream, value, entities) < 0)
+    return -1;
+  return write_literal(stream, "\"") < 0 ? -1 : 0;
+}
+
+/* Returns the xmlns attribute name for the namespace declaration */
+Py_LOCAL_INLINE(PyObject *)
+namespace_attribute_name(PyObject *prefix)
+{
+  int truth = PyObject_IsTrue(prefix);
+  if (truth < 0)
+    return NULL;
+  if (truth)
+    return PyUnicode_Concat(xmlns_colon_string, prefix);
+  Py_INCREF(xmlns_string);
+  return xmlns_string;
+}
+
+/* Writes the namespace declarations and attributes of a start-tag */
+static int
+printer_attributes(PrinterState *state, PyObject *namespaces,
+                   PyObject *attributes)
+{
+  PyObject *prefix, *name, *value, *items;
+  Py_ssize_t pos, i;
+
+  if (state->canonical) {
+    /* namespace declarations then attributes, each in sorted order */
+    items = PyList_New(0);
+    if (items == NULL)
+      return -1;
+    pos = 0;
+    while (PyDict_Next(namespaces, &pos, &prefix, &value)) {
+      PyObject *item;
+      name = namespace_attribute_name(prefix);
+      if (name == NULL) {
+        Py_DECREF(items);
+        return -1;
+      }
+      item = PyTuple_Pack(2, name, value);
+      Py_DECREF(name);
+      if (item == NULL || PyList_Append(items, item) < 0) {
+        Py_XDECREF(item);
+        Py_DECREF(items);
+        return -1;
+      }
+      Py_DECREF(item);
+    }
+    for (pos = 0; pos < 2; pos++) {
+      if (pos == 1) {
+        Py_DECREF(items);
+        items = PyDict_Items(attributes);
+        if (items == NULL)
+          return -1;
+      }
+      if (PyList_Sort(items) < 0) {
+        Py_DECREF(items);
+        return -1;
+      }
+      for (i = 0; i < PyList_GET_SIZE(items); i++) {
+        PyObject *item = PyList_GET_ITEM(items, i);
+        if (printer_attribute(state, PyTuple_GET_ITEM(item, 0),
+                              PyTuple_GET_ITEM(item, 1)) < 0) {
+          Py_DECREF(items);
+          return -1;
+        }
+      }
+    }
+    Py_DECREF(items);
+    return 0;
+  }
+
+  pos = 0;
+  while (PyDict_Next(namespaces, &pos, &prefix, &value)) {
+    int result;
+    name = namespace_attribute_name(prefix);
+    if (name == NULL)
+      return -1;
+    result = printer_attribute(state, name, value);
+    Py_DECREF(name);
+    if (result < 0)
+      return -1;
+  }
+  pos = 0;
+  while (PyDict_Next(attributes, &pos, &name, &value)) {
+    if (printer_attribute(state, name, value) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+/* Completes the declarations of an element named `qname` in `namespace` */
+static int
+element_declarations(PyObject *namespace, PyObject *qname, PyObject *inscope,
+                     PyObject *namespaces)
+{
+  PyObject *prefix, *value, *remove;
+  Py_ssize_t pos, i;
+  int result;
+
+  /* The element's namespaceURI/prefix mapping takes precedence */
+  value = namespace;
+  result = PyObject_IsTrue(value);
+  if (result == 0) {
+    PyObject *default_uri = PyDict_GetItem(namespaces, Py_None);
+    if (default_uri)
+      result = PyObject_IsTrue(default_uri);
+  }
+  if (result < 0)
+    return -1;
+  if (result) {
+    prefix = qname_prefix(qname);
+    if (prefix == NULL)
+      return -1;
+    if (prefix != Py_None && PyUnicode_GET_SIZE(prefix) == 0) {
+      Py_DECREF(prefix);
+      Py_INCREF(Py_None);
+      prefix = Py_None;
+    }
+    result = binding_differs(namespaces, prefix, value);
+    if (result > 0) {
+      result = PyObject_IsTrue(value);
+      if (result >= 0)
+        result = PyDict_SetItem(namespaces, prefix,
+                                result ? value : empty_string);
+    }
+    Py_DECREF(prefix);
+    if (result < 0)
+      return -1;
+  }
+
+  /* Drop the declarations that are already in scope */
+  if (PyDict_Size(namespaces)) {
+    remove = PyList_New(0);
+    if (remove == NULL)
+      return -1;
+    pos = 0;
+    while (PyDict_Next(namespaces, &pos, &prefix, &value)) {
+      PyObject *current = PyDict_GetItem(inscope, prefix);
+      if (current) {
+        result = PyObject_RichCompareBool(current, value, Py_EQ);
+        if (result > 0)
+          result = PyList_Append(remove, prefix);
+        if (result < 0) {
+          Py_DECREF(remove);
+          return -1;
+        }
+      }
+    }
+    for (i = 0; i < PyList_GET_SIZE(remove); i++) {
+      if (PyDict_DelItem(namespaces, PyList_GET_ITEM(remove, i)) < 0) {
+        Py_DECREF(remove);
+        return -1;
+      }
+    }
+    Py_DECREF(remove);
+  }
+  return 0;
+}
+
+/* Determines the namespace declarations and attributes to write for
+ * `element` given the declarations already in scope (`inscope`).  The
+ * dictionaries are built by the same steps as those of
+ * amara.writers.node._Visitor so that they iterate in the same order. */
+static int
+element_bindings(ElementObject *element, PyObject *inscope,
+                 PyObject *namespaces, PyObject *attributes)
+{
+  PyObject *nodemap, *prefix, *value;
+  NamespaceObject *nsnode;
+  AttrObject *attr;
+  Py_ssize_t pos;
+  int result;
+
+  nodemap = Element_InscopeBindings(element);
+  if (nodemap == NULL)
+    return -1;
+  pos = 0;
+  while ((nsnode = NamespaceMap_Next(nodemap, &pos))) {
+    if (PyDict_SetItem(namespaces, Namespace_GET_NAME(nsnode),
+                       Namespace_GET_VALUE(nsnode)) < 0) {
+      Py_DECREF(nodemap);
+      return -1;
+    }
+  }
+  Py_DECREF(nodemap);
+  if (PyDict_DelItem(namespaces, xml_string) < 0)
+    return -1;
+
+  nodemap = Element_ATTRIBUTES(element);
+  if (nodemap) {
+    pos = 0;
+    while ((attr = AttributeMap_Next(nodemap, &pos))) {
+      value = Attr_GET_VALUE(attr);
+      result = PyObject_RichCompareBool(Attr_GET_NAMESPACE_URI(attr),
+                                        xmlns_namespace, Py_EQ);
+      if (result < 0)
+        return -1;
+      if (result == 0) {
+        if (PyDict_SetItem(attributes, Attr_GET_QNAME(attr), value) < 0)
+          return -1;
+        continue;
+      }
+      /* xmlns="uri" or xmlns:foo="uri" */
+      prefix = qname_prefix(Attr_GET_QNAME(attr));
+      if (prefix == NULL)
+        return -1;
+      if (prefix != Py_None && PyUnicode_GET_SIZE(prefix)) {
+        Py_DECREF(prefix);
+        prefix = Attr_GET_LOCAL_NAME(attr);
+      } else {
+        Py_DECREF(prefix);
+        prefix = Py_None;
+      }
+      result = binding_differs(inscope, prefix, value);
+      if (result > 0)
+        result = PyDict_SetItem(namespaces, prefix, value);
+      if (result < 0)
+        return -1;
+    }
+  }
+
+  return element_declarations(Element_NAMESPACE_URI(element),
+                              Element_QNAME(element), inscope, namespaces);
+}
+
+/* Determines the namespace declarations and attributes to write for the
+ * element of a read-only document, as element_bindings() does. */
+static int
+frozen_bindings(FrozenNodeObject *element, PyObject *inscope,
+                PyObject *namespaces, PyObject *attributes)
+{
+  FrozenDocumentObject *document = FrozenNode_GET_DOCUMENT(element);
+  int i, index = FrozenNode_GET_INDEX(element);
+  PyObject *declared;
+
+  declared = Frozen_InscopeNamespaces(document, index);
+  if (declared == NULL)
+    return -1;
+  if (PyDict_Update(namespaces, declared) < 0) {
+    Py_DECREF(declared);
+    return -1;
+  }
+  Py_DECREF(declared);
+  if (PyDict_DelItem(namespaces, xml_string) < 0)
+    return -1;
+
+  /* the attributes follow the namespace nodes of the element */
+  for (i = index + 1; i < document->count &&
+         Frozen_GET_PARENT(document, i) == index; i++) {
+    PyObject *value;
+    int result;
+    if (Frozen_GET_KIND(document, i) == FROZEN_NAMESPACE) {
+      /* undeclarations are not in scope, but still have to be written */
+      if (document->values[i] == document->values[i + 1] &&
+          PyDict_SetItem(namespaces, Frozen_GET_QNAME(document, i),
+                         empty_string) < 0)
+        return -1;
+      continue;
+    }
+    if (Frozen_GET_KIND(document, i) != FROZEN_ATTRIBUTE)
+      break;
+    value = Frozen_GetValue(document, i);
+    if (value == NULL)
+      return -1;
+    result = PyDict_SetItem(attributes, Frozen_GET_QNAME(document, i), value);
+    Py_DECREF(value);
+    if (result < 0)
+      return -1;
+  }
+  return element_declarations(Frozen_GET_NAMESPACE_URI(document, index),
+                              Frozen_GET_QNAME(document, index), inscope,
+                              namespaces);
+}
+
+static int printer_node(PrinterState *state, PyObject *node,
+                        PyObject *inscope);
+
+static int
+printer_children(PrinterState *state, PyObject *node, PyObject *inscope)
+{
+  Py_ssize_t i;
+  PyObject *child;
+  int result;
+
+  if (FrozenNode_Check(node)) {
+    FrozenDocumentObject *document = FrozenNode_GET_DOCUMENT(node);
+    int index = FrozenNode_GET_INDEX(node);
+    for (i = Frozen_GET_FIRST_CHILD(document, index); i != FROZEN_NONE;
+         i = Frozen_GET_NEXT_SIBLING(document, i)) {
+      child = FrozenNode_New(document, (int)i, index);
+      if (child == NULL)
+        return -1;
+      result = printer_node(state, child, inscope);
+      Py_DECREF(child);
+      if (result < 0)
+        return -1;
+    }
+    return 0;
+  }
+
+  for (i = 0; i < Container_GET_COUNT(node); i++) {
+    child = (PyObject *)Container_GET_CHILD(node, i);
+    Py_INCREF(child);
+    result = printer_node(state, child, inscope);
+    Py_DECREF(child);
+    if (result < 0)
+      return -1;
+  }
+  return 0;
+}
+
+static int
+printer_element(PrinterState *state, PyObject *element, PyObject *inscope)
+{
+  XmlStreamObject *stream = state->stream;
+  PyObject *namespaces, *attributes, *qname;
+  int result;
+
+  namespaces = PyDict_New();
+  if (namespaces == NULL)
+    return -1;
+  attributes = PyDict_New();
+  if (attributes == NULL) {
+    Py_DECREF(namespaces);
+    return -1;
+  }
+  if (FrozenNode_Check(element)) {
+    if (frozen_bindings(FrozenNode(element), inscope, namespaces,
+                        attributes) < 0)
+      goto error;
+    qname = Frozen_GET_QNAME(FrozenNode_GET_DOCUMENT(element),
+                             FrozenNode_GET_INDEX(element));
+  } else {
+    if (element_bindings(Element(element), inscope, namespaces,
+                         attributes) < 0)
+      goto error;
+    qname = Element_QNAME(element);
+  }
+
+  /* start-tag */
+  if (printer_close_tag(state) < 0 || printer_newline(state) < 0)
+    goto error;
+  state->element_name = qname;
+  if (write_literal(stream, "<") < 0)
+    goto error;
+  if (write_encode(stream, qname, start_tag_where) < 0)
+    goto error;
+  if (printer_attributes(state, namespaces, attributes) < 0)
+    goto error;
+  Py_DECREF(attributes);
+  state->level++;
+  state->can_indent = 1;
+
+  /* content, with the emitted declarations now in scope */
+  if (PyDict_Size(namespaces)) {
+    PyObject *scope = PyDict_Copy(inscope);
+    if (scope == NULL || PyDict_Update(scope, namespaces) < 0) {
+      Py_XDECREF(scope);
+      Py_DECREF(namespaces);
+      return -1;
+    }
+    Py_DECREF(namespaces);
+    inscope = scope;
+  } else {
+    Py_DECREF(namespaces);
+    Py_INCREF(inscope);
+  }
+  result = printer_children(state, element, inscope);
+  Py_DECREF(inscope);
+  if (result < 0)
+    return -1;
+
+  /* end-tag */
+  state->level--;
+  if (state->element_name == NULL && printer_newline(state) < 0)
+    return -1;
+  state->can_indent = 1;
+  if (state->element_name) {
+    state->element_name = NULL;
+    if (!state->canonical)
+      /* No element content, use minimized form */
+      return write_literal(stream, "/>") < 0 ? -1 : 0;
+    if (write_literal(stream, ">") < 0)
+      return -1;
+  }
+  if (write_literal(stream, "</") < 0)
+    return -1;
+  if (write_encode(stream, qname, end_tag_where) < 0)
+    return -1;
+  return write_literal(stream, ">") < 0 ? -1 : 0;
+
+ error:
+  Py_DECREF(namespaces);
+  Py_DECREF(attributes);
+  return -1;
+}
+
+static int
+printer_doctype(PrinterState *state, PyObject *entity)
+{
+  XmlStreamObject *stream = state->stream;
+  PyObject *public_id, *system_id, *name = NULL;
+  Py_ssize_t i;
+  int result;
+
+  /* the document element names the document type */
+  if (FrozenNode_Check(entity)) {
+    FrozenDocumentObject *document = FrozenNode_GET_DOCUMENT(entity);
+    system_id = Frozen_GET_SYSTEM_ID(document);
+    public_id = Frozen_GET_PUBLIC_ID(document);
+    for (i = Frozen_GET_FIRST_CHILD(document, 0); i != FROZEN_NONE;
+         i = Frozen_GET_NEXT_SIBLING(document, i)) {
+      if (Frozen_GET_KIND(document, i) == FROZEN_ELEMENT) {
+        name = Frozen_GET_QNAME(document, i);
+        break;
+      }
+    }
+  } else {
+    system_id = Entity_GET_SYSTEM_ID(entity);
+    public_id = Entity_GET_PUBLIC_ID(entity);
+    for (i = 0; i < Container_GET_COUNT(entity); i++) {
+      NodeObject *child = Container_GET_CHILD(entity, i);
+      if (Element_Check(child)) {
+        name = Element_QNAME(child);
+        break;
+      }
+    }
+  }
+  result = PyObject_IsTrue(system_id);
+  if (result <= 0)
+    return result;
+  if (name == NULL || state->canonical)
+    return 0;
+  if (printer_close_tag(state) < 0)
+    return -1;
+
+  if (write_literal(stream, "<!DOCTYPE ") < 0)
+    return -1;
+  if (write_encode(stream, name, doctype_name_where) < 0)
+    return -1;
+  result = PyObject_IsTrue(public_id);
+  if (result < 0)
+    return -1;
+  if (result) {
+    if (write_literal(stream, " PUBLIC \"") < 0)
+      return -1;
+    if (write_encode(stream, public_id, doctype_public_where) < 0)
+      return -1;
+    if (write_literal(stream, "\" \"") < 0)
+      return -1;
+  } else {
+    if (write_literal(stream, " SYSTEM \"") < 0)
+      return -1;
+  }
+  if (write_encode(stream, system_id, doctype_system_where) < 0)
+    return -1;
+  return write_literal(stream, "\">\n") < 0 ? -1 : 0;
+}
+
+static int
+printer_entity(PrinterState *state, PyObject *entity, PyObject *inscope)
+{
+  XmlStreamObject *stream = state->stream;
+
+  if (!state->omit_declaration) {
+    if (write_ascii(stream, xml_declaration) < 0)
+      return -1;
+    if (write_ascii(stream, stream->encoding) < 0)
+      return -1;
+    if (write_literal(stream, "\"?>\n") < 0)
+      return -1;
+  }
+  if (printer_doctype(state, entity) < 0)
+    return -1;
+  if (printer_children(state, entity, inscope) < 0)
+    return -1;
+  if (state->element_name) {
+    if (state->canonical) {
+      if (write_literal(stream, "</") < 0)
+        return -1;
+      if (write_encode(stream, state->element_name, end_tag_where) < 0)
+        return -1;
+      if (write_literal(stream, ">") < 0)
+        return -1;
+    } else {
+      if (write_literal(stream, "/>") < 0)
+        return -1;
+    }
+    state->element_name = NULL;
+  }
+  return flush_buffer(stream);
+}
+
+static int printer_text(PrinterState *state, PyObject *value)
+{
+  if (printer_close_tag(state) < 0)
+    return -1;
+  if (write_escape(state->stream, value, state->text_entities) < 0)
+    return -1;
+  /* Do not allow indenting for elements with mixed content */
+  state->can_indent = 0;
+  return 0;
+}
+
+static int printer_comment(PrinterState *state, PyObject *value)
+{
+  XmlStreamObject *stream = state->stream;
+
+  if (printer_close_tag(state) < 0 || printer_newline(state) < 0)
+    return -1;
+  if (write_literal(stream, "<!--") < 0)
+    return -1;
+  if (write_encode(stream, value, comment_where) < 0)
+    return -1;
+  if (write_literal(stream, "-->") < 0)
+    return -1;
+  state->can_indent = 1;
+  return 0;
+}
+
+static int
+printer_processing_instruction(PrinterState *state, PyObject *target,
+                               PyObject *data)
+{
+  XmlStreamObject *stream = state->stream;
+  int result;
+
+  if (printer_close_tag(state) < 0 || printer_newline(state) < 0)
+    return -1;
+  if (write_literal(stream, "<?") < 0)
+    return -1;
+  if (write_encode(stream, target, pi_target_where) < 0)
+    return -1;
+  result = PyObject_IsTrue(data);
+  if (result < 0)
+    return -1;
+  if (result) {
+    if (write_literal(stream, " ") < 0)
+      return -1;
+    if (write_encode(stream, data, pi_data_where) < 0)
+      return -1;
+  }
+  if (write_literal(stream, "?>") < 0)
+    return -1;
+  state->can_indent = 1;
+  return 0;
+}
+
+/* Prints the node of a read-only document */
+static int
+printer_frozen_node(PrinterState *state, PyObject *node, PyObject *inscope)
+{
+  FrozenDocumentObject *document = FrozenNode_GET_DOCUMENT(node);
+  int index = FrozenNode_GET_INDEX(node);
+  PyObject *value;
+  int result;
+
+  switch (FrozenNode_GET_KIND(node)) {
+  case FROZEN_ELEMENT:
+    if (Py_EnterRecursiveCall(" while printing a tree"))
+      return -1;
+    result = printer_element(state, node, inscope);
+    Py_LeaveRecursiveCall();
+    return result;
+  case FROZEN_ENTITY:
+    return printer_entity(state, node, inscope);
+  case FROZEN_TEXT:
+  case FROZEN_COMMENT:
+  case FROZEN_PROCESSING_INSTRUCTION:
+    value = Frozen_GetValue(document, index);
+    if (value == NULL)
+      return -1;
+    if (FrozenNode_GET_KIND(node) == FROZEN_TEXT)
+      result = printer_text(state, value);
+    else if (FrozenNode_GET_KIND(node) == FROZEN_COMMENT)
+      result = printer_comment(state, value);
+    else
+      result = printer_processing_instruction(
+                 state, Frozen_GET_LOCAL_NAME(document, index), value);
+    Py_DECREF(value);
+    return result;
+  default:
+    PyErr_Format(PyExc_TypeError, "cannot print %.200s nodes",
+                 node->ob_type->tp_name);
+    return -1;
+  }
+}
+
+static int
+printer_node(PrinterState *state, PyObject *node, PyObject *inscope)
+{
+  int result;
+
+  if (FrozenNode_Check(node)) {
+    return printer_frozen_node(state, node, inscope);
+  }
+  else if (Element_Check(node)) {
+    if (Py_EnterRecursiveCall(" while printing a tree"))
+      return -1;
+    result = printer_element(state, node, inscope);
+    Py_LeaveRecursiveCall();
+    return result;
+  }
+  else if (Text_Check(node)) {
+    return printer_text(state, Text_GET_VALUE(node));
+  }
+  else if (Comment_Check(node)) {
+    return printer_comment(state, Comment_GET_VALUE(node));
+  }
+  else if (ProcessingInstruction_Check(node)) {
+    return printer_processing_instruction(
+             state, ProcessingInstruction_GET_TARGET(node),
+             ProcessingInstruction_GET_DATA(node));
+  }
+  else if (Entity_Check(node)) {
+    return printer_entity(state, node, inscope);
+  }
+  PyErr_Format(PyExc_TypeError, "cannot print %.200s nodes",
+               node->ob_type->tp_name);
+  return -1;
+}
+
+static char print_tree_doc[] =
+"print_tree(stream, node, entities[, omit_declaration[, canonical[, indent]]])\n\
+\n\
+Writes the XML serialization of the tree rooted at `node` to the xmlstream\n\
+`stream`.  `node` must be an entity, element, text, comment or processing\n\
+instruction node.  `entities` is the tuple of entitymaps for text, and for\n\
+attribute values delimited by quotes and by apostrophes.  If `indent` is\n\
+given, the output is pretty-printed with that string per nesting level.\n\
+\n\
+The output is the same as that of visiting the tree with an xmlprinter,\n\
+xmlprettyprinter (given `indent`) or canonicalxmlprinter (given\n\
+`canonical`).";
+
+static PyObject *print_tree(PyObject *module, PyObject *args, PyObject *kw)
+{
+  static char *kwlist[] = { "stream", "node", "entities", "omit_declaration",
+                            "canonical", "indent", NULL };
+  PrinterState state;
+  PyObject *node, *entities, *indent = Py_None, *inscope;
+  int i, empty, result;
+
+  if (xml_declaration == NULL && printer_init() < 0)
+    return NULL;
+
+  memset(&state, 0, sizeof(state));
+  if (!PyArg_ParseTupleAndKeywords(args, kw, "O!OO!|iiO:print_tree", kwlist,
+                                   &XmlStream_Type, &state.stream, &node,
+                                   &PyTuple_Type, &entities,
+                                   &state.omit_declaration, &state.canonical,
+                                   &indent))
+    return NULL;
+  if (!Node_Check(node) && !FrozenNode_Check(node)) {
+    PyErr_Format(PyExc_TypeError, "node must be a tree node, not %.200s",
+                 node->ob_type->tp_name);
+    return NULL;
+  }
+  if (PyTuple_GET_SIZE(entities) != 3) {
+    PyErr_SetString(PyExc_TypeError, "entities must be a 3-tuple");
+    return NULL;
+  }
+  for (i = 0; i < 3; i++) {
+    if (PyTuple_GET_ITEM(entities, i)->ob_type != &EntityMap_Type) {
+      PyErr_SetString(PyExc_TypeError, "entities must be entitymaps");
+      return NULL;
+    }
+  }
+  state.text_entities = (EntityMapObject *)PyTuple_GET_ITEM(entities, 0);
+  state.attr_entities_quot = (EntityMapObject *)PyTuple_GET_ITEM(entities, 1);
+  state.attr_entities_apos = (EntityMapObject *)PyTuple_GET_ITEM(entities, 2);
+  if (indent != Py_None) {
+    if (!PyString_Check(indent)) {
+      PyErr_SetString(PyExc_TypeError, "indent must be a string");
+      return NULL;
+    }
+    state.indent = indent;
+  }
+
+  /* The byte order mark precedes anything written (which is nothing only
+   * for an empty entity without the XML declaration) */
+  if (FrozenNode_Check(node))
+    empty = (FrozenNode_GET_KIND(node) == FROZEN_ENTITY &&
+             Frozen_GET_FIRST_CHILD(FrozenNode_GET_DOCUMENT(node), 0)
+             == FROZEN_NONE);
+  else
+    empty = Entity_Check(node) && Container_GET_COUNT(node) == 0;
+  if (!(empty && state.omit_declaration)) {
+    if (write_bom(state.stream) < 0)
+      return NULL;
+  }
+
+  inscope = Py_BuildValue("{sO}", "xml", xml_namespace);
+  if (inscope == NULL)
+    return NULL;
+  result = printer_node(&state, node, inscope);
+  Py_DECREF(inscope);
+  if (result < 0)
+    return NULL;
+  Py_INCREF(Py_None);
+  return Py_None;
+}
+
 /** Module Interface **************************************************/
 
 static PyMethodDef module_methods[] = {
+  { "print_tree", (PyCFunction)print_tree, METH_VARARGS|METH_KEYWORDS,
+    print_tree_doc },
   { NULL }
 };
 
@@ -906,5 +2007,12 @@ PyMODINIT_FUNC MODULE_INITFUNC(void)
   if (ascii_string == NULL)
     return;
 
+  ascii_encoder = PyCodec_Encoder("ascii");
+  if (ascii_encoder == NULL)
+    return;
+  latin1_encoder = PyCodec_Encoder("latin-1");
+  if (latin1_encoder == NULL)
+    return;
+
   return;
 }
@@ -96,7 +96,7 @@ import operator
 from amara import tree
 from amara.namespaces import XML_NAMESPACE
 from amara.writers import writer, treewriter, stringwriter
-from amara.xpath import extensions, parser
+from amara.xpath import cache, extensions, parser
 
 _writer_methods = operator.attrgetter(
     'start_document', 'end_document', 'start_element', 'end_element',
@@ -108,6 +108,8 @@ class context(writer):
     """
     functions = extensions.extension_functions
     current_instruction = None
+    # the values of hoisted subexpressions of the predicate being evaluated
+    hoisted = None
 
     def __init__(self, node, position=1, size=1,
                  variables=None, namespaces=None,
@@ -218,10 +220,12 @@ class context(writer):
     def evaluate(self, expr):
         """
         The main entry point for evaluating an XPath expression, using self as context
-        expr - a unicode object with the XPath expression
+        expr - a unicode object with the XPath expression, or an
+               already parsed expression object
         """
-        parsed = parser.parse(expr)
-        return parsed.evaluate(self)
+        if isinstance(expr, basestring):
+            expr = cache.expressions.get(expr, self)
+        return expr.evaluate(self)
 
     def __repr__(self):
         ptr = id(self)
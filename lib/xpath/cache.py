@@ -0,0 +1,161 @@
+########################################################################
+# amara/xpath/cache.py
+"""
+Cache of parsed and optimized (and, once evaluated, compiled) XPath
+expressions.
+
+An expression object compiles itself the first time it is evaluated,
+resolving namespace prefixes, extension functions and variable names
+against the context it is evaluated in.  Therefore the cache key is made
+up of the expression string plus every binding the expression refers to,
+so that an expression is only shared between contexts that would compile
+it identically.
+"""
+
+import re
+import threading
+
+from amara.xpath import parser, optimizer
+
+__all__ = ['expression_cache', 'expressions']
+
+# A namespace prefix is an NCName immediately followed by a single ':'.
+# Matches within string literals only make the key more specific.
+_prefix_pattern = re.compile(r'(?<![\w.\-])([^\W\d][\w.\-]*):(?![:])', re.U)
+_variable_pattern = re.compile(r'\$((?:[^\W\d][\w.\-]*:)?[^\W\d][\w.\-]*)',
+                               re.U)
+_function_pattern = re.compile(
+    r'(?<![\w.\-])([^\W\d][\w.\-]*):([^\W\d][\w.\-]*)\s*\(', re.U)
+
+# Maximum number of binding variants kept per expression string
+_MAX_VARIANTS = 8
+
+def _scan(expr):
+    prefixes = tuple(sorted(set(_prefix_pattern.findall(expr))))
+    variables = []
+    for qname in set(_variable_pattern.findall(expr)):
+        if ':' in qname:
+            prefix, local = qname.split(':', 1)
+        else:
+            prefix, local = None, qname
+        variables.append((prefix, local))
+    functions = tuple(set(_function_pattern.findall(expr)))
+    return prefixes, tuple(variables), functions
+
+
+class expression_cache(object):
+    """
+    A bounded, thread-safe LRU mapping of XPath expression strings to
+    parsed expression objects.
+
+    `hits` and `misses` count the lookups that did and did not find a
+    reusable expression.
+    """
+
+    def __init__(self, maxsize=512):
+        self.maxsize = maxsize
+        self.hits = self.misses = 0
+        self._lock = threading.Lock()
+        self._entries = {}
+        # circular doubly linked list of [prev, next, expr, entry]
+        self._root = root = []
+        root[:] = [root, root, None, None]
+        return
+
+    def __len__(self):
+        return len(self._entries)
+
+    def stats(self):
+        """Returns a dictionary of the cache counters."""
+        return {'hits': self.hits, 'misses': self.misses,
+                'size': len(self._entries), 'maxsize': self.maxsize}
+
+    def clear(self):
+        self._lock.acquire()
+        try:
+            self._entries.clear()
+            root = self._root
+            root[:] = [root, root, None, None]
+            self.hits = self.misses = 0
+        finally:
+            self._lock.release()
+        return
+
+    def _variant(self, scan, context):
+        prefixes, variables, functions = scan
+        namespaces = context.namespaces
+        key = [ namespaces.get(prefix) for prefix in prefixes ]
+        if variables:
+            names = context.variables
+            for prefix, local in variables:
+                if prefix is not None:
+                    prefix = namespaces.get(prefix)
+                key.append((prefix, local) in names)
+        if functions:
+            table = context.functions
+            for prefix, local in functions:
+                key.append(table.get((namespaces.get(prefix), local)))
+        return tuple(key)
+
+    def get(self, expr, context):
+        """
+        Returns the expression object for `expr` suitable for evaluation
+        within `context`, parsing it if needed.
+        """
+        lock = self._lock
+        lock.acquire()
+        try:
+            link = self._entries.get(expr)
+            if link is not None:
+                # move to the most recently used position
+                prev, next = link[0], link[1]
+                prev[1] = next
+                next[0] = prev
+                root = self._root
+                last = root[0]
+                last[1] = root[0] = link
+                link[0], link[1] = last, root
+                scan = link[3][0]
+                key = self._variant(scan, context)
+                parsed = link[3][1].get(key)
+                if parsed is not None:
+                    self.hits += 1
+                    return parsed
+            else:
+                scan = key = None
+            self.misses += 1
+        finally:
+            lock.release()
+
+        if scan is None:
+            scan = _scan(expr)
+            key = self._variant(scan, context)
+        parsed = optimizer.optimize(parser.parse(expr))
+
+        lock.acquire()
+        try:
+            link = self._entries.get(expr)
+            if link is None:
+                root = self._root
+                last = root[0]
+                link = [last, root, expr, (scan, {})]
+                last[1] = root[0] = link
+                self._entries[expr] = link
+                if len(self._entries) > self.maxsize:
+                    # evict the least recently used expression
+                    oldest = root[1]
+                    root[1] = oldest[1]
+                    oldest[1][0] = root
+                    del self._entries[oldest[2]]
+            variants = link[3][1]
+            if len(variants) >= _MAX_VARIANTS:
+                variants.clear()
+            variants[key] = parsed
+        finally:
+            lock.release()
+        return parsed
+
+
+#: The cache shared by `amara.xpath.context.evaluate` (and, by extension,
+#: `xml_select`)
+expressions = expression_cache()
@@ -74,6 +74,12 @@ class number_literal(literal):
 
     return_type = datatypes.number
 
+    def compile_as_boolean(self, compiler):
+        # zero and NaN are false
+        value = datatypes.boolean(datatypes.number(self._literal))
+        compiler.emit('LOAD_CONST', value)
+        return
+
     compile = literal.compile_as_number
 
     def __unicode__(self):
@@ -12,6 +12,10 @@ __all__ = ('nodeset_expression',
 class nodeset_expression(expressions.expression):
 
     return_type = datatypes.nodeset
+    # True if `compile_iterable` yields the nodes in document order
+    ordered = False
+    # True if, as well, none of the nodes is an ancestor of another
+    flat = False
 
     def _make_block(self, compiler):
         compiler.emit(
@@ -77,35 +81,76 @@ class nodeset_expression(expressions.expression):
         empty = ('LOAD_CONST', datatypes.boolean.FALSE)
         return self._make_loop(compiler, found, empty)
 
+    def _make_first(self, compiler, convert, emptyops):
+        if self.ordered:
+            # the first node yielded is the result
+            found = ('LOAD_CONST', convert,
+                     'ROT_TWO',
+                     'CALL_FUNCTION', 1)
+            return self._make_loop(compiler, found, emptyops)
+        from amara.xpath.locationpaths import _paths
+        for block in self._make_block(compiler):
+            compiler.emit('LOAD_CONST', convert,
+                          'LOAD_CONST', _paths.first,
+                          'LOAD_FAST', 'context',
+                          'LOAD_ATTR', 'node',
+                          'BUILD_TUPLE', 1,
+                          )
+            self.compile_iterable(compiler)
+            compiler.emit(*emptyops)
+            compiler.emit('CALL_FUNCTION', 2,
+                          'CALL_FUNCTION', 1,
+                          )
+        return
+
     def compile_as_number(self, compiler):
-        # Call number() on the matched object
-        found = ('LOAD_CONST', datatypes.number,
-                 'ROT_TWO',
-                 'CALL_FUNCTION', 1)
         # Use number.NaN as the result. We cannot use this value directly
         # as the assembler needs to be able to use equality testing.
         empty = ('LOAD_CONST', datatypes.number,
                  'LOAD_ATTR', 'NaN')
-        return self._make_loop(compiler, found, empty)
+        return self._make_first(compiler, datatypes.number, empty)
 
     def compile_as_string(self, compiler):
-        # Call string() on the matched object
-        found = ('LOAD_CONST', datatypes.string,
-                 'ROT_TWO',
-                 'CALL_FUNCTION', 1)
         empty = ('LOAD_CONST', datatypes.string.EMPTY)
-        return self._make_loop(compiler, found, empty)
+        return self._make_first(compiler, datatypes.string, empty)
+
+    def compile_as_count(self, compiler):
+        """Compiles the expression into the number of nodes it selects."""
+        from amara.xpath.locationpaths import _paths
+        for block in self._make_block(compiler):
+            compiler.emit('LOAD_CONST', datatypes.number,
+                          'LOAD_CONST', _paths.count,
+                          'LOAD_FAST', 'context',
+                          'LOAD_ATTR', 'node',
+                          'BUILD_TUPLE', 1,
+                          )
+            self.compile_iterable(compiler)
+            compiler.emit('CALL_FUNCTION', 1,
+                          'CALL_FUNCTION', 1,
+                          )
+        return
 
     def compile_as_nodeset(self, compiler):
         for block in self._make_block(compiler):
-            compiler.emit('LOAD_CONST', datatypes.nodeset,
-                          # add context node to the stack
+            if self.ordered:
+                # The nodes need not be sorted; extend an empty node-set
+                compiler.emit('LOAD_CONST', datatypes.nodeset,
+                              'CALL_FUNCTION', 0,
+                              'DUP_TOP',
+                              'LOAD_ATTR', 'extend',
+                              )
+            else:
+                compiler.emit('LOAD_CONST', datatypes.nodeset)
+            compiler.emit(# add context node to the stack
                           'LOAD_FAST', 'context',
                           'LOAD_ATTR', 'node',
                           'BUILD_TUPLE', 1,
                           )
             self.compile_iterable(compiler)
             compiler.emit('CALL_FUNCTION', 1)
+            if self.ordered:
+                # discard the result of `extend`
+                compiler.emit('POP_TOP')
         return
     compile = compile_as_nodeset
 
@@ -121,6 +166,9 @@ class union_expr(nodeset_expression):
     An object representing a union expression
     (XPath 1.0 grammar production 18: UnionExpr)
     """
+    # the combined node-set is sorted
+    ordered = True
+
     def __init__(self, left, right):
         if isinstance(left, union_expr):
             self._paths = left._paths
@@ -193,6 +241,18 @@ class path_expr(nodeset_expression):
         self._path = path
         return
 
+    @property
+    def ordered(self):
+        from amara.xpath.locationpaths import _ordered_steps
+        return (getattr(self._expression, 'flat', False) and
+                _ordered_steps(self._path._steps, False))
+
+    @property
+    def flat(self):
+        from amara.xpath.locationpaths import _flat_steps
+        return (getattr(self._expression, 'flat', False) and
+                _flat_steps(self._path._steps, False))
+
     def compile_iterable(self, compiler):
         if isinstance(self._expression, nodeset_expression):
             self._expression.compile_iterable(compiler)
@@ -217,11 +277,18 @@ class filter_expr(nodeset_expression):
     An object representing a filter expression
     (XPath 1.0 grammar production 20: FilterExpr)
     """
+    # the predicates filter a sorted node-set
+    ordered = True
+
     def __init__(self, expression, predicates):
         self._expression = expression
         self._predicates = predicates
         return
 
+    @property
+    def flat(self):
+        return getattr(self._expression, 'flat', False)
+
     def compile_iterable(self, compiler):
         # discard context node from the stack
         from amara.xpath.locationpaths import _paths
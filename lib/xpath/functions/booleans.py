@@ -17,6 +17,12 @@ class boolean_function(builtin_function):
     arguments = (datatypes.xpathobject,)
     return_type = datatypes.boolean
 
+    def compile_as_boolean(self, compiler):
+        arg, = self._args
+        arg.compile_as_boolean(compiler)
+        return
+    compile = compile_as_boolean
+
     def evaluate_as_boolean(self, context):
         arg, = self._args
         return arg.evaluate_as_boolean(context)
@@ -29,6 +35,15 @@ class not_function(builtin_function):
     arguments = (datatypes.boolean,)
     return_type = datatypes.boolean
 
+    def compile_as_boolean(self, compiler):
+        arg, = self._args
+        compiler.emit('LOAD_CONST', datatypes.boolean)
+        arg.compile_as_boolean(compiler)
+        compiler.emit('UNARY_NOT',
+                      'CALL_FUNCTION', 1)
+        return
+    compile = compile_as_boolean
+
     def evaluate_as_boolean(self, context):
         arg, = self._args
         if arg.evaluate_as_boolean(context):
@@ -80,22 +95,23 @@ class lang_function(builtin_function):
         lang = arg.evaluate_as_string(context).lower()
         node = context.node
         while node.xml_parent:
-            for attr in node.xml_attributes.nodes():
-                # Search for xml:lang attribute
-                if attr.xml_name == (XML_NAMESPACE, 'lang'):
-                    value = attr.xml_value.lower()
-                    # Exact match (PrimaryPart and possible SubPart)
-                    if value == lang:
+            # Search for xml:lang attribute (by key, as read-only elements
+            # map their attributes in a plain dictionary)
+            value = node.xml_attributes.get((XML_NAMESPACE, u'lang'))
+            if value is not None:
+                value = value.lower()
+                # Exact match (PrimaryPart and possible SubPart)
+                if value == lang:
+                    return datatypes.TRUE
+
+                # Just PrimaryPart (ignore '-' SubPart)
+                if '-' in value:
+                    primary, sub = value.split('-', 1)
+                    if lang == primary:
                         return datatypes.TRUE
 
-                    # Just PrimaryPart (ignore '-' SubPart)
-                    if '-' in value:
-                        primary, sub = value.split('-', 1)
-                        if lang == primary:
-                            return datatypes.TRUE
-
-                    # Language doesn't match
-                    return datatypes.FALSE
+                # Language doesn't match
+                return datatypes.FALSE
 
             # Continue to next ancestor
             node = node.xml_parent
@@ -6,6 +6,7 @@ The implementation of the core node-set functions from XPath 1.0.
 from amara import tree
 from amara.xpath import datatypes
 from amara.xpath.functions import builtin_function
+from amara.xpath.expressions.nodesets import nodeset_expression
 from amara.xpath.locationpaths import relative_location_path
 
 __all__ = ('last_function', 'position_function', 'count_function',
@@ -42,6 +43,16 @@ class count_function(builtin_function):
     arguments = (datatypes.nodeset,)
     return_type = datatypes.number
 
+    def compile_as_number(self, compiler):
+        arg0, = self._args
+        if isinstance(arg0, nodeset_expression):
+            # count the nodes as they are selected
+            arg0.compile_as_count(compiler)
+        else:
+            builtin_function.compile_as_number(self, compiler)
+        return
+    compile = compile_as_number
+
     def evaluate_as_number(self, context):
         arg0, = self._args
         arg0 = arg0.evaluate_as_nodeset(context)
@@ -106,11 +117,13 @@ class name_function(builtin_function):
                 return datatypes.EMPTY_STRING
             node = arg0[0]
 
-        if isinstance(node, (tree.element, tree.attribute)):
+        # `xml_type` also identifies the nodes of read-only documents
+        xml_type = node.xml_type
+        if xml_type in (tree.element.xml_type, tree.attribute.xml_type):
             return datatypes.string(node.xml_qname)
-        elif isinstance(node, tree.processing_instruction):
+        elif xml_type == tree.processing_instruction.xml_type:
             return datatypes.string(node.xml_target)
-        elif isinstance(node, tree.namespace):
+        elif xml_type == tree.namespace.xml_type:
             return datatypes.string(node.xml_name)
         return datatypes.EMPTY_STRING
     evaluate = evaluate_as_string
@@ -133,11 +146,13 @@ class local_name_function(name_function):
                 return datatypes.EMPTY_STRING
             node = arg0[0]
 
-        if isinstance(node, (tree.element, tree.attribute)):
+        # `xml_type` also identifies the nodes of read-only documents
+        xml_type = node.xml_type
+        if xml_type in (tree.element.xml_type, tree.attribute.xml_type):
             return datatypes.string(node.xml_local)
-        elif isinstance(node, tree.processing_instruction):
+        elif xml_type == tree.processing_instruction.xml_type:
             return datatypes.string(node.xml_target)
-        elif isinstance(node, tree.namespace):
+        elif xml_type == tree.namespace.xml_type:
             return datatypes.string(node.xml_name)
         return datatypes.EMPTY_STRING
     evaluate = evaluate_as_string
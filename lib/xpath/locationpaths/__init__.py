@@ -4,10 +4,82 @@
 XPath location path expressions.
 """
 
+from amara import tree
 from amara.xpath import XPathError
 from amara.xpath.expressions import nodesets
 from amara.xpath.locationpaths import axisspecifiers, nodetests
 from amara.xpath.locationpaths import _paths #i.e. lib/xpath/src/paths.c
+from amara.xpath.locationpaths._nodetests import positionfilter, lastfilter
+
+# The axes whose steps the step iterator can walk itself
+_WALKED_AXES = frozenset(('child', 'descendant', 'attribute'))
+
+# The axes that select, from a single node, nodes none of which contains
+# another, and those that keep such a set of nodes in document order
+_FLAT_AXES = frozenset(('child', 'attribute', 'namespace', 'self', 'parent',
+                        'following-sibling', 'preceding-sibling'))
+_ORDERED_AXES = frozenset(('child', 'attribute', 'namespace', 'self'))
+_DESCENDANT_AXES = frozenset(('descendant', 'descendant-or-self'))
+
+def _flat_steps(steps, single):
+    """
+    Returns true if the location steps `steps`, applied to a single node (if
+    `single` is true) or to a node-set in document order none of whose nodes
+    is an ancestor of another, select such a node-set in turn.
+    """
+    for step in steps:
+        if step.axis.name not in (single and _FLAT_AXES or _ORDERED_AXES):
+            return False
+        single = False
+    return True
+
+def _ordered_steps(steps, single):
+    """
+    Returns true if the location steps `steps`, applied as for `_flat_steps`,
+    yield their nodes in document order.  That holds for a single step from
+    a single node, and for a last step selecting the descendants of a flat
+    node-set.
+    """
+    if not steps:
+        return True
+    if len(steps) == 1 and single:
+        return True
+    axis = steps[-1].axis.name
+    return ((axis in _ORDERED_AXES or axis in _DESCENDANT_AXES) and
+            _flat_steps(steps[:-1], single))
+
+def _step_walk(axis, node_filter, predicates):
+    """
+    Returns the description of the walk that performs a location step, or
+    None if the step has to be evaluated by calling its axis, node test and
+    predicates in turn.  A step can be walked when it tests only the type or
+    name of the nodes, optionally selecting a constant position or the last
+    node, on the child, descendant or attribute axis.
+    """
+    if axis.name not in _WALKED_AXES:
+        return None
+    position = 0
+    if predicates:
+        if len(predicates) > 1:
+            return None
+        if isinstance(predicates[0], positionfilter):
+            position = predicates[0].position
+        elif isinstance(predicates[0], lastfilter):
+            position = -1
+        else:
+            return None
+    if node_filter is None:
+        return (axis.name, tree.node, None, position)
+    if node_filter.node_type is tree.processing_instruction:
+        if node_filter.name is not None:
+            # the target of a processing instruction is not walked
+            return None
+        names = None
+    elif node_filter.namespace is None and node_filter.name is None:
+        names = None
+    else:
+        names = (node_filter.namespace, node_filter.name)
+    return (axis.name, node_filter.node_type, names, position)
 
 class location_path(nodesets.nodeset_expression):
     """
@@ -16,6 +88,14 @@ class location_path(nodesets.nodeset_expression):
     """
     _steps = ()
 
+    @property
+    def ordered(self):
+        return _ordered_steps(self._steps, True)
+
+    @property
+    def flat(self):
+        return _flat_steps(self._steps, True)
+
     def compile_iterable(self, compiler):
         emit = compiler.emit
         if self.absolute:
@@ -33,14 +113,15 @@ class location_path(nodesets.nodeset_expression):
             axis, node_test = step.axis, step.node_test
             # get the node filter to use for the node iterator
             node_filter = node_test.get_filter(compiler, axis.principal_type)
-            if node_filter:
-                node_filter = node_filter.select
             predicates = step.predicates
             if predicates:
                 predicates = [ predicate.select for predicate in predicates ]
+            walk = _step_walk(axis, node_filter, predicates)
+            if node_filter:
+                node_filter = node_filter.select
             # create the node iterator for this step
             step = _paths.stepiter(axis.select, axis.reverse, node_filter,
-                                   predicates)
+                                   predicates, walk)
             # add the opcodes for calling `step.select(context, nodes)`
             emit('LOAD_CONST', step.select,
                  'LOAD_FAST', 'context',
@@ -209,7 +209,7 @@ class preceding_axis(axis_specifier):
         """
         def preceding(node):
             while node:
-                if isinstance(node, tree.element):
+                if node.xml_type == tree.element.xml_type:
                     child = node.xml_last_child
                     if child:
                         for x in preceding(child): yield x
@@ -4,14 +4,15 @@
 A parsed token that represents a predicate list.
 """
 from __future__ import absolute_import
-from itertools import count, izip
+from itertools import count
 
 from amara.xpath import datatypes
 from amara.xpath.expressions.basics import literal, variable_reference
 from amara.xpath.expressions.booleans import equality_expr, relational_expr
-from amara.xpath.functions import position_function
+from amara.xpath.expressions.nodesets import nodeset_expression
+from amara.xpath.functions import position_function, last_function
 
-from ._nodetests import positionfilter
+from ._nodetests import positionfilter, lastfilter
 from ._paths import pathiter
 
 __all__ = ['predicates', 'predicate']
@@ -51,11 +52,73 @@ class predicates(tuple):
 
 
 #FIXME: should this derive from boolean_expression?
-class predicate:
+def _uses_last(expression):
+    """
+    Returns true if `expression` calls last() on its own context (rather than
+    within a node-set expression, which has a context of its own).
+    """
+    if isinstance(expression, last_function):
+        return True
+    if isinstance(expression, nodeset_expression):
+        return False
+    for value in getattr(expression, '__dict__', {}).itervalues():
+        if not isinstance(value, (list, tuple)):
+            value = (value,)
+        for item in value:
+            if hasattr(item, 'evaluate') and _uses_last(item):
+                return True
+    return False
+
+
+class _hoisting(object):
+    """
+    Evaluates the expression of a predicate for each of the nodes it filters,
+    sharing the values of its hoisted subexpressions between the nodes (see
+    `amara.xpath.optimizer.hoisted_expr`).
+    """
+    __slots__ = ('_expr', '_values')
+
     def __init__(self, expression):
         self._expr = expression
-        self._provide_context_size = False #See http://trac.xml3k.org/ticket/62
-        #FIXME: There are probably many code paths which need self._provide_context_size set
+        self._values = {}
+
+    def evaluate(self, context):
+        saved, context.hoisted = context.hoisted, self._values
+        try:
+            return self._expr.evaluate(context)
+        finally:
+            context.hoisted = saved
+
+    def evaluate_as_boolean(self, context):
+        saved, context.hoisted = context.hoisted, self._values
+        try:
+            return self._expr.evaluate_as_boolean(context)
+        finally:
+            context.hoisted = saved
+
+    def evaluate_as_number(self, context):
+        saved, context.hoisted = context.hoisted, self._values
+        try:
+            return self._expr.evaluate_as_number(context)
+        finally:
+            context.hoisted = saved
+
+
+class predicate:
+    # True if the expression has hoisted subexpressions
+    _hoisted = False
+
+    def __init__(self, expression):
+        # `_expr` is the part of `expression` evaluated for each node
+        self._expression = self._expr = expression
+        #See http://trac.xml3k.org/ticket/62
+        self._provide_context_size = _uses_last(expression)
+        # Check for just "last()", which needs the last node rather than a
+        # list of all of them
+        if isinstance(expression, last_function):
+            self.select = lastfilter()
+            return
+
         # Check for just "Number"
         if isinstance(expression, literal):
             const = datatypes.number(expression._literal)
@@ -64,11 +127,17 @@ class predicate:
                 self.select = positionfilter(index)
             else:
                 # FIXME: add warning that expression will not select anything
-                self.select = izip()
+                self.select = self._nothing
             return
 
         # Check for "position() = Expr"
         elif isinstance(expression, equality_expr) and expression._op == '=':
+            if (isinstance(expression._left, position_function) and
+                isinstance(expression._right, last_function) or
+                isinstance(expression._left, last_function) and
+                isinstance(expression._right, position_function)):
+                self.select = lastfilter()
+                return
             if isinstance(expression._left, position_function):
                 expression = expression._right
                 if isinstance(expression, literal):
@@ -77,11 +146,8 @@ class predicate:
                     if index == const and index >= 1:
                         self.select = positionfilter(index)
                     else:
-                        self.select = izip()
+                        self.select = self._nothing
                 else:
-                    #FIXME: This will kick in the non-lazy behavior too broadly, e.g. in the case of [position = 1+1]
-                    #See: http://trac.xml3k.org/ticket/62
-                    self._provide_context_size = True
                     self._expr = expression
                     self.select = self._number
                 return
@@ -93,7 +159,7 @@ class predicate:
                     if index == const and index >= 1:
                         self.select = positionfilter(index)
                     else:
-                        self.select = izip()
+                        self.select = self._nothing
                 else:
                     self._expr = expression
                     self.select = self._number
@@ -125,6 +191,10 @@ class predicate:
             self.select = self._boolean
         return
 
+    def _nothing(self, context, nodes):
+        # the position is not a positive integer, so no node is selected
+        return iter(())
+
     def _slice(self, context, nodes):
         start = self._start.evaluate_as_number(context)
         position = self._position
@@ -145,6 +215,8 @@ class predicate:
             nodes = list(nodes)
             context.size = len(nodes)
         context.current_node = context.node
+        if self._hoisted:
+            expr = _hoisting(expr)
         for node in nodes:
             context.node, context.position = node, position
             if expr.evaluate_as_number(context) == position:
@@ -155,7 +227,12 @@ class predicate:
     def _boolean(self, context, nodes):
         expr = self._expr
         position = 1
+        if self._provide_context_size:
+            nodes = list(nodes)
+            context.size = len(nodes)
         context.current_node = context.node
+        if self._hoisted:
+            expr = _hoisting(expr)
         for node in nodes:
             context.node, context.position = node, position
             if expr.evaluate_as_boolean(context):
@@ -166,7 +243,12 @@ class predicate:
     def select(self, context, nodes):
         expr = self._expr
         position = 1
+        if self._provide_context_size:
+            nodes = list(nodes)
+            context.size = len(nodes)
         context.current_node = context.node
+        if self._hoisted:
+            expr = _hoisting(expr)
         for node in nodes:
             context.node, context.position = node, position
             result = expr.evaluate(context)
@@ -0,0 +1,582 @@
+########################################################################
+# amara/xpath/optimizer.py
+"""
+Rewriting of parsed XPath expressions, before they are compiled, into
+equivalent expressions that are cheaper to evaluate.
+
+`optimize` takes the tree returned by `amara.xpath.parser.parse` and
+rewrites it in place:
+
+  * operators and core functions whose operands are all literals are
+    folded into a literal;
+  * `descendant-or-self::node()/child::x` becomes `descendant::x` when the
+    predicates of `x` (if any) do not depend on the position of the node;
+  * in a predicate, each largest subexpression that depends on neither the
+    context node, position nor size (e.g. `concat($a, 'b')` or `/doc/@v`)
+    is evaluated once for all of the nodes the predicate filters, instead
+    of once per node;
+  * comparisons of `count(x)` with 0 (or 1) become tests of whether `x`
+    selects any node.
+
+The document order sorts that are redundant are dropped when the expressions
+are compiled (see the `ordered` attribute of node-set expressions), and
+`explain` prints the optimized tree with notes on how each part of it will
+be evaluated.
+"""
+
+import sys
+from itertools import izip
+
+from amara.xpath import parser
+from amara.xpath import datatypes
+from amara.xpath.compiler import xpathcompiler
+from amara.xpath.expressions import expression
+from amara.xpath.expressions.basics import (literal, number_literal,
+                                            string_literal, variable_reference)
+from amara.xpath.expressions.booleans import (_logical_expr, or_expr,
+                                              _comparison_expr)
+from amara.xpath.expressions.numbers import _binary_expr, unary_expr
+from amara.xpath.expressions.nodesets import (nodeset_expression, union_expr,
+                                              path_expr, filter_expr)
+from amara.xpath.expressions.functioncalls import function_call
+from amara.xpath.functions.nodesets import (
+    last_function, position_function, count_function, id_function,
+    local_name_function, namespace_uri_function, name_function)
+from amara.xpath.functions.strings import (
+    string_function, concat_function, starts_with_function,
+    contains_function, substring_before_function, substring_after_function,
+    substring_function, string_length_function, normalize_space_function,
+    translate_function)
+from amara.xpath.functions.booleans import (
+    boolean_function, not_function, true_function, false_function,
+    lang_function)
+from amara.xpath.functions.numbers import (
+    number_function, sum_function, floor_function, ceiling_function,
+    round_function)
+from amara.xpath.locationpaths import (location_path, location_step,
+                                       _step_walk)
+from amara.xpath.locationpaths.axisspecifiers import axis_specifier
+from amara.xpath.locationpaths.nodetests import any_node_test
+from amara.xpath.locationpaths.predicates import predicates, predicate
+from amara.xpath.locationpaths._nodetests import positionfilter, lastfilter
+
+__all__ = ['optimize', 'explain', 'hoisted_expr']
+
+# The core functions whose result depends only on their arguments
+_PURE_FUNCTIONS = frozenset([
+    string_function, concat_function, starts_with_function,
+    contains_function, substring_before_function, substring_after_function,
+    substring_function, string_length_function, normalize_space_function,
+    translate_function, boolean_function, not_function, true_function,
+    false_function, number_function, sum_function, floor_function,
+    ceiling_function, round_function, count_function, name_function,
+    local_name_function, namespace_uri_function,
+    ])
+
+# The functions whose omitted argument stands for the context node
+_CONTEXT_DEFAULTS = frozenset([
+    string_function, string_length_function, normalize_space_function,
+    number_function, name_function, local_name_function,
+    namespace_uri_function,
+    ])
+
+# All of the XPath core functions (rather than those added by XSLT)
+_CORE_FUNCTIONS = _PURE_FUNCTIONS | frozenset([
+    last_function, position_function, id_function, lang_function,
+    ])
+
+# count(x) `op` n, for the `(op, n)` that only test whether `x` is empty
+_EXISTENCE_TESTS = {
+    ('>', 0): True, ('!=', 0): True, ('>=', 1): True,
+    ('=', 0): False, ('<=', 0): False, ('<', 1): False,
+    }
+_FLIPPED = {'=': '=', '!=': '!=', '<': '>', '>': '<', '<=': '>=', '>=': '<='}
+
+
+class hoisted_expr(expression):
+    """
+    A subexpression of a predicate that depends on neither the context node,
+    position nor size, and so need only be evaluated once for all of the
+    nodes filtered by the predicate.  The value is kept in `context.hoisted`
+    while the predicate is evaluated; if `rooted`, the value depends on the
+    document of the context node as well.
+    """
+
+    def __init__(self, expression, rooted):
+        self._expr = expression
+        self._rooted = rooted
+        self.return_type = expression.return_type
+
+    def value(self, context):
+        values = context.hoisted
+        if values is None:
+            return self._expr.evaluate(context)
+        if self._rooted:
+            key = (self, context.node.xml_root)
+        else:
+            key = self
+        try:
+            return values[key]
+        except KeyError:
+            value = values[key] = self._expr.evaluate(context)
+            return value
+
+    def compile(self, compiler):
+        compiler.emit('LOAD_CONST', self.value,
+                      'LOAD_FAST', 'context',
+                      'CALL_FUNCTION', 1)
+        return
+
+    def _compile_as(self, compiler, datatype):
+        compiler.emit('LOAD_CONST', datatype)
+        self.compile(compiler)
+        compiler.emit('CALL_FUNCTION', 1)
+        return
+
+    def compile_as_boolean(self, compiler):
+        return self._compile_as(compiler, datatypes.boolean)
+
+    def compile_as_number(self, compiler):
+        return self._compile_as(compiler, datatypes.number)
+
+    def compile_as_string(self, compiler):
+        return self._compile_as(compiler, datatypes.string)
+
+    def compile_as_nodeset(self, compiler):
+        return self._compile_as(compiler, datatypes.nodeset)
+
+    def compile_iterable(self, compiler):
+        # Discard the context node
+        compiler.emit('POP_TOP')
+        self.compile_as_nodeset(compiler)
+        compiler.emit('GET_ITER')
+        return
+
+    def pprint(self, indent='', stream=None):
+        print >> stream, indent + repr(self)
+        self._expr.pprint(indent + '  ', stream)
+
+    def __unicode__(self):
+        return unicode(self._expr)
+
+
+def _is_constant(node):
+    return isinstance(node, (literal, true_function, false_function))
+
+
+def _operands(node):
+    """
+    Returns the subexpressions of `node` that are evaluated with the same
+    context as `node`, or None if `node` is not a known expression.
+    """
+    if isinstance(node, (_binary_expr, _logical_expr, _comparison_expr)):
+        return [node._left, node._right]
+    if isinstance(node, (unary_expr, hoisted_expr)):
+        return [node._expr]
+    if isinstance(node, function_call):
+        return [ arg for arg in node._args if arg is not None ]
+    if isinstance(node, union_expr):
+        return list(node._paths)
+    if isinstance(node, (path_expr, filter_expr)):
+        return [node._expression]
+    if isinstance(node, (location_path, literal, variable_reference)):
+        return []
+    return None
+
+
+def _steps_of(node):
+    """Returns the location steps of `node` (with contexts of their own)"""
+    if isinstance(node, location_path):
+        return node._steps
+    if isinstance(node, path_expr):
+        return node._path._steps
+    return ()
+
+
+def _predicates_of(node):
+    """Returns the predicates of `node` and of its location steps"""
+    result = []
+    for step in _steps_of(node):
+        if step.predicates:
+            result.extend(step.predicates)
+    if isinstance(node, filter_expr) and node._predicates:
+        result.extend(node._predicates)
+    return result
+
+
+def _uses_position(node):
+    """
+    Returns true if `node` calls position() or last() on its own context.
+    """
+    if isinstance(node, (position_function, last_function)):
+        return True
+    operands = _operands(node)
+    if operands is None:
+        return True
+    for operand in operands:
+        if _uses_position(operand):
+            return True
+    return False
+
+
+def _positional(preds):
+    """
+    Returns true if the result of the predicates `preds` depends on the
+    positions of the nodes they filter.
+    """
+    for pred in preds or ():
+        expr = pred._expression
+        if expr.return_type not in (datatypes.boolean, datatypes.string,
+                                    datatypes.nodeset):
+            # a number (or, for all we know, a number) selects a position
+            return True
+        if _uses_position(expr):
+            return True
+    return False
+
+
+def _core(node):
+    """
+    Returns true if `node`, including its predicates, only calls XPath core
+    functions (and so depends on nothing but the nodes and variables).
+    """
+    if isinstance(node, function_call) and type(node) not in _CORE_FUNCTIONS:
+        return False
+    operands = _operands(node)
+    if operands is None:
+        return False
+    for operand in operands:
+        if not _core(operand):
+            return False
+    for pred in _predicates_of(node):
+        if not _core(pred._expression):
+            return False
+    return True
+
+
+def _independent(node):
+    """
+    Returns true if the value of `node` depends on neither the context node,
+    position nor size (other than the document of the context node).
+    """
+    if isinstance(node, (literal, variable_reference)):
+        return True
+    if isinstance(node, location_path):
+        return node.absolute and _core(node)
+    if isinstance(node, function_call):
+        cls = type(node)
+        if cls not in _PURE_FUNCTIONS:
+            return False
+        if cls in _CONTEXT_DEFAULTS and None in node._args:
+            return False
+    operands = _operands(node)
+    if operands is None:
+        return False
+    for operand in operands:
+        if not _independent(operand):
+            return False
+    for pred in _predicates_of(node):
+        if not _core(pred._expression):
+            return False
+    return True
+
+
+def _rooted(node):
+    """Returns true if `node` refers to the root of the context node"""
+    if isinstance(node, location_path):
+        return node.absolute
+    for operand in _operands(node) or ():
+        if _rooted(operand):
+            return True
+    return False
+
+
+def _boolean_literal(value):
+    if value:
+        return function_call(u'true', ())
+    return function_call(u'false', ())
+
+
+class optimizer(object):
+    """
+    Rewrites an expression tree (see the module documentation).
+    """
+
+    _context = None
+
+    def optimize(self, node):
+        if isinstance(node, (_binary_expr, unary_expr)):
+            self._optimize_operands(node)
+            return self._fold(node)
+        if isinstance(node, _logical_expr):
+            return self._optimize_logical(node)
+        if isinstance(node, _comparison_expr):
+            self._optimize_operands(node)
+            node = self._fold(node)
+            if isinstance(node, _comparison_expr):
+                node = self._existence_test(node)
+            return node
+        if isinstance(node, function_call):
+            args = []
+            for arg in node._args:
+                if arg is not None:
+                    arg = self.optimize(arg)
+                args.append(arg)
+            node._args = tuple(args)
+            if type(node) in _PURE_FUNCTIONS:
+                if type(node) in _CONTEXT_DEFAULTS and None in node._args:
+                    return node
+                return self._fold(node)
+            return node
+        if isinstance(node, union_expr):
+            node._paths = [ self.optimize(path) for path in node._paths ]
+            return node
+        if isinstance(node, path_expr):
+            node._expression = self.optimize(node._expression)
+            self._optimize_steps(node._path)
+            return node
+        if isinstance(node, filter_expr):
+            node._expression = self.optimize(node._expression)
+            if node._predicates:
+                node._predicates = self._optimize_predicates(node._predicates)
+            return node
+        if isinstance(node, location_path):
+            self._optimize_steps(node)
+            return node
+        return node
+
+    def _optimize_operands(self, node):
+        if isinstance(node, unary_expr):
+            node._expr = self.optimize(node._expr)
+        else:
+            node._left = self.optimize(node._left)
+            node._right = self.optimize(node._right)
+        return
+
+    def _evaluate(self, node, method='evaluate'):
+        """
+        Returns the value of `node`, whose operands are all constant, or None
+        if evaluating it fails (leaving the error to be raised when the
+        expression is evaluated).
+        """
+        if self._context is None:
+            from amara.xpath import context
+            self._context = context(None)
+        try:
+            return getattr(node, method)(self._context)
+        except Exception:
+            return None
+
+    def _fold(self, node):
+        for operand in _operands(node):
+            if not _is_constant(operand):
+                return node
+        value = self._evaluate(node)
+        if isinstance(value, datatypes.boolean):
+            return _boolean_literal(value)
+        if isinstance(value, datatypes.number):
+            return number_literal(value)
+        if isinstance(value, datatypes.string):
+            # `string_literal` takes the value between quotes
+            return string_literal(u'"%s"' % value)
+        return node
+
+    def _optimize_logical(self, node):
+        self._optimize_operands(node)
+        left, right = node._left, node._right
+        if _is_constant(left):
+            value = self._evaluate(left, 'evaluate_as_boolean')
+            if value is None:
+                return node
+            if isinstance(node, or_expr) == bool(value):
+                # `true() or x` and `false() and x`
+                return _boolean_literal(value)
+            if right.return_type is not datatypes.boolean:
+                right = self._fold(function_call(u'boolean', (right,)))
+            return right
+        return node
+
+    def _existence_test(self, node):
+        left, op, right = node._left, node._op, node._right
+        if isinstance(right, count_function):
+            left, op, right = right, _FLIPPED[op], left
+        if not (isinstance(left, count_function) and
+                isinstance(right, number_literal)):
+            return node
+        nodes, = left._args
+        if not isinstance(nodes, nodeset_expression):
+            return node
+        exists = _EXISTENCE_TESTS.get((op, datatypes.number(right._literal)))
+        if exists is None:
+            return node
+        if exists:
+            return function_call(u'boolean', (nodes,))
+        return function_call(u'not', (nodes,))
+
+    def _optimize_steps(self, path):
+        steps = list(path._steps)
+        for step in steps:
+            if step.predicates:
+                step.predicates = self._optimize_predicates(step.predicates)
+        # descendant-or-self::node()/child::x -> descendant::x
+        i = 0
+        while i < len(steps) - 1:
+            step, next = steps[i], steps[i + 1]
+            if (step.axis.name == 'descendant-or-self' and
+                isinstance(step.node_test, any_node_test) and
+                not step.predicates and next.axis.name == 'child' and
+                not _positional(next.predicates)):
+                axis = axis_specifier('descendant')
+                steps[i:i+2] = [location_step(axis, next.node_test,
+                                              next.predicates)]
+            i += 1
+        path._steps = steps
+        return
+
+    def _optimize_predicates(self, preds):
+        result = []
+        for pred in preds:
+            expr = self.optimize(pred._expression)
+            expr, hoisted = self._hoist(expr)
+            pred = predicate(expr)
+            pred._hoisted = hoisted
+            result.append(pred)
+        return predicates(result)
+
+    def _hoist(self, node):
+        """
+        Replaces the largest subexpressions of `node` that do not depend on
+        the context with a `hoisted_expr`.  Returns the new node and whether
+        anything was hoisted.
+        """
+        if _independent(node):
+            if _is_constant(node) or isinstance(node, variable_reference):
+                # nothing to save
+                return node, False
+            return hoisted_expr(node, _rooted(node)), True
+        if isinstance(node, (_binary_expr, _logical_expr, _comparison_expr)):
+            node._left, left = self._hoist(node._left)
+            node._right, right = self._hoist(node._right)
+            return node, left or right
+        if isinstance(node, unary_expr):
+            node._expr, hoisted = self._hoist(node._expr)
+            return node, hoisted
+        if isinstance(node, function_call):
+            args, hoisted = [], False
+            for arg in node._args:
+                if arg is not None:
+                    arg, found = self._hoist(arg)
+                    hoisted = hoisted or found
+                args.append(arg)
+            node._args = tuple(args)
+            return node, hoisted
+        if isinstance(node, union_expr):
+            paths, hoisted = [], False
+            for path in node._paths:
+                path, found = self._hoist(path)
+                hoisted = hoisted or found
+                paths.append(path)
+            node._paths = paths
+            return node, hoisted
+        if isinstance(node, (path_expr, filter_expr)):
+            node._expression, hoisted = self._hoist(node._expression)
+            return node, hoisted
+        return node, False
+
+
+def optimize(expr):
+    """
+    Returns the optimized equivalent of the parsed expression `expr`, which
+    may be rewritten in place.
+    """
+    return optimizer().optimize(expr)
+
+
+def _predicate_notes(pred):
+    select = pred.select
+    if isinstance(select, positionfilter):
+        notes = ['selects node %d' % select.position]
+    elif isinstance(select, lastfilter):
+        notes = ['selects the last node']
+    elif isinstance(select, izip):
+        notes = ['selects no nodes']
+    else:
+        notes = [{'_slice': 'skips to a position',
+                  '_number': 'compares each position',
+                  '_boolean': 'tests each node',
+                  }.get(select.__name__, 'tests each node or position')]
+    if pred._provide_context_size:
+        notes.append('needs the context size')
+    return notes
+
+
+def _explain_step(step, compiler, indent, stream):
+    notes = []
+    try:
+        node_filter = step.node_test.get_filter(compiler,
+                                                step.axis.principal_type)
+    except Exception:
+        pass
+    else:
+        preds = step.predicates and [ pred.select for pred in step.predicates ]
+        if _step_walk(step.axis, node_filter, preds):
+            notes.append('walked in C')
+    if step.axis.reverse:
+        notes.append('reverse axis')
+    _explain_line(u'step', step, notes, indent, stream)
+    for pred in step.predicates or ():
+        _explain_predicate(pred, compiler, indent + '  ', stream)
+    return
+
+
+def _explain_predicate(pred, compiler, indent, stream):
+    _explain_line(u'predicate', u'[%s]' % pred._expression,
+                  _predicate_notes(pred), indent, stream)
+    _explain(pred._expression, compiler, indent + '  ', stream)
+    return
+
+
+def _explain_line(label, node, notes, indent, stream):
+    line = u'%s%s: %s' % (indent, label, node)
+    if notes:
+        line += u'  [%s]' % u', '.join(notes)
+    print >> stream, line.encode('utf-8')
+    return
+
+
+def _explain(node, compiler, indent, stream):
+    notes = []
+    if isinstance(node, nodeset_expression):
+        if node.ordered:
+            notes.append('in document order')
+        else:
+            notes.append('sorted')
+    elif isinstance(node, hoisted_expr):
+        notes.append('once per predicate')
+        if node._rooted:
+            notes.append('per document')
+    _explain_line(node.__class__.__name__, node, notes, indent, stream)
+    indent += '  '
+    for operand in _operands(node) or ():
+        _explain(operand, compiler, indent, stream)
+    for step in _steps_of(node):
+        _explain_step(step, compiler, indent, stream)
+    if isinstance(node, filter_expr):
+        for pred in node._predicates or ():
+            _explain_predicate(pred, compiler, indent, stream)
+    return
+
+
+def explain(expr, context=None, stream=None):
+    """
+    Prints the plan for evaluating `expr`, either an XPath expression string
+    (which is parsed and optimized) or an optimized expression: a line for
+    each part of the expression, with notes on how it is evaluated.  The
+    namespace prefixes of name tests are resolved using `context`, if given.
+    """
+    if isinstance(expr, basestring):
+        expr = optimize(parser.parse(expr))
+    if stream is None:
+        stream = sys.stdout
+    _explain(expr, xpathcompiler(context), '', stream)
+    return
@@ -16,6 +16,12 @@
 
 static PyObject *xmlns_namespace;
 
+/* Nodes of read-only documents are walked directly on the document arrays */
+#define FROZEN_AXIS_NEW(args, axis) \
+  if (PyTuple_GET_SIZE(args) == 1 && \
+      FrozenNode_Check(PyTuple_GET_ITEM(args, 0))) \
+    return FrozenNode_Axis(FrozenNode(PyTuple_GET_ITEM(args, 0)), axis)
+
 /** AncestorAxis object *******************************************/
 
 typedef struct {
@@ -29,6 +35,7 @@ static PyObject *ancestor_axis_new(PyTypeObject *type, PyObject *args,
   PyObject *node;
   ancestor_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_ANCESTOR);
   if (!PyArg_ParseTuple(args, "O!:ancestor_axis",
                         Domlette->Node_Type, &node)) {
     return NULL;
@@ -114,6 +121,7 @@ static PyObject *ancestor_self_axis_new(PyTypeObject *type, PyObject *args,
   PyObject *node;
   ancestor_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_ANCESTOR_OR_SELF);
   if (!PyArg_ParseTuple(args, "O!:ancestor_or_self_axis",
                         Domlette->Node_Type, &node)) {
     return NULL;
@@ -185,6 +193,7 @@ static PyObject *attribute_axis_new(PyTypeObject *type, PyObject *args,
   PyObject *node;
   attribute_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_ATTRIBUTE);
   if (!PyArg_ParseTuple(args, "O!:attribute_axis",
                         Domlette->Node_Type, &node)) {
     return NULL;
@@ -291,6 +300,7 @@ static PyObject *child_axis_new(PyTypeObject *type, PyObject *args,
   NodeObject *node;
   child_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_CHILD);
   if (!PyArg_ParseTuple(args, "O!:child_axis",
                         Domlette->Node_Type, &node)) {
     return NULL;
@@ -394,6 +404,7 @@ static PyObject *descendant_axis_new(PyTypeObject *type, PyObject *args,
   NodeObject *node;
   descendant_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_DESCENDANT);
   if (!PyArg_ParseTuple(args, "O!:descendant_axis",
                         Domlette->Node_Type, &node)) {
     return NULL;
@@ -513,6 +524,7 @@ static PyObject *descendant_self_axis_new(PyTypeObject *type, PyObject *args,
   PyObject *node;
   descendant_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_DESCENDANT_OR_SELF);
   if (!PyArg_ParseTuple(args, "O!:descendant_or_self_axis",
                         Domlette->Node_Type, &node)) {
     return NULL;
@@ -605,6 +617,7 @@ static PyObject *followingsibling_axis_new(PyTypeObject *type, PyObject *args,
   NodeObject *node;
   followingsibling_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_FOLLOWING_SIBLING);
   if (!PyArg_ParseTuple(args, "O!:following_sibling_axis",
                         Domlette->Node_Type, &node)) {
     return NULL;
@@ -707,6 +720,7 @@ static PyObject *namespace_axis_new(PyTypeObject *type, PyObject *args,
   PyObject *node;
   namespace_axis *axis;
 
+  FROZEN_AXIS_NEW(args, FROZEN_AXIS_NAMESPACE);
   if (!PyArg_ParseTuple(args, "O!:namespace_axis",
                         Domlette->Node_Type, &node))
     return NULL;
@@ -121,6 +121,10 @@ static PyObject *node_to_string(PyObject *node)
 {
   PyObject *result;
 
+  /* nodes of read-only documents read their text from the document */
+  if (FrozenNode_Check(node))
+    return FrozenNode_StringValue(FrozenNode(node));
+
   /* convert amara.tree node to string */
   if (Element_Check(node) || Entity_Check(node)) {
     /* The concatenation of all text descendants in document order */
@@ -216,7 +220,7 @@ static PyObject *String_New(PyObject *value)
     Py_INCREF(value);
   }
 
-  if (Node_Check(value)) {
+  if (Node_Check(value) || FrozenNode_Check(value)) {
     /* we know that `value` has been incref'ed */
     Py_DECREF(value);
     value = node_to_string(value);
@@ -357,7 +361,7 @@ static PyObject *Number_New(PyObject *value)
     }
     value = PyList_GET_ITEM(value, 0);
   }
-  if (Node_Check(value)) {
+  if (Node_Check(value) || FrozenNode_Check(value)) {
     value = node_to_string(value);
     if (value == NULL) return NULL;
     result = Number_New(value);
@@ -1327,7 +1331,7 @@ static PyObject *nodeset_new(PyTypeObject *type, PyObject *args,
       Py_INCREF(arg);
       return arg;
     }
-    if (Node_Check(arg)) {
+    if (Node_Check(arg) || FrozenNode_Check(arg)) {
       PyErr_Format(PyExc_TypeError, "cannot convert '%s' object to nodeset",
                    arg->ob_type->tp_name);
       return NULL;
@@ -1388,6 +1392,32 @@ static PyObject *nodeset_repr(PyObject *self)
   return repr;
 }
 
+/* Finds the smallest and largest number values of the nodes in `nodeset`,
+ * skipping NaN.  Returns 0 if there are none, 1 if found and -1 on error. */
+static int nodeset_number_range(PyObject *nodeset, double *min, double *max)
+{
+  Py_ssize_t i, size = PyList_GET_SIZE(nodeset);
+  int found = 0;
+
+  for (i = 0; i < size; i++) {
+    PyObject *number = Number_New(PyList_GET_ITEM(nodeset, i));
+    double d;
+    if (number == NULL) return -1;
+    d = PyFloat_AS_DOUBLE(number);
+    Py_DECREF(number);
+    if (isnan(d)) continue;
+    if (!found) {
+      *min = *max = d;
+      found = 1;
+    } else if (d < *min) {
+      *min = d;
+    } else if (d > *max) {
+      *max = d;
+    }
+  }
+  return found;
+}
+
 static PyObject *nodeset_richcompare(PyObject *v, PyObject *w, int op)
 {
   Py_ssize_t i, lhs_size = PyList_GET_SIZE(v);
@@ -1428,6 +1458,7 @@ static PyObject *nodeset_richcompare(PyObject *v, PyObject *w, int op)
           Py_DECREF(rhs);
           return NULL;
         }
+        Py_DECREF(b);
       }
       for (i = 0; i < lhs_size; i++) {
         a = String_New(PyList_GET_ITEM(v, i));
@@ -1445,60 +1476,62 @@ static PyObject *nodeset_richcompare(PyObject *v, PyObject *w, int op)
       }
       Py_DECREF(rhs);
     } else if (op == Py_NE) {
-      /* Check for a node in `w` that has a different string value as a
-       * node in `v`. */
-      for (i = 0; i < lhs_size; i++) {
-        a = String_New(PyList_GET_ITEM(v, i));
-        if (a == NULL) return NULL;
-        for (j = 0; j < rhs_size; j++) {
-          b = String_New(PyList_GET_ITEM(w, j));
-          if (b == NULL) {
-            Py_DECREF(a);
-            return NULL;
-          }
-          result = object_richcompare(a, b, Py_NE);
-          if (result != Boolean_False) {
-            assert(result == NULL || result == Boolean_True);
-            Py_DECREF(a);
-            Py_DECREF(b);
-            return result;
-          }
-          Py_DECREF(b);
+      /* There is a pair of different string values unless every node of
+       * both node-sets has the same one (that of the first node in `v`). */
+      PyObject *nodeset = v;
+      a = String_New(PyList_GET_ITEM(v, 0));
+      if (a == NULL) return NULL;
+      for (i = 1, j = lhs_size; ; i++) {
+        if (i == j) {
+          if (nodeset == w) break;
+          nodeset = w;
+          i = 0;
+          j = rhs_size;
         }
-        Py_DECREF(a);
-      }
-    } else {
-      rhs = PyTuple_New(rhs_size);
-      if (rhs == NULL) return NULL;
-      for (i = 0; i < lhs_size; i++) {
-        a = Number_New(PyList_GET_ITEM(v, i));
-        if (a == NULL) {
-          Py_DECREF(rhs);
+        b = String_New(PyList_GET_ITEM(nodeset, i));
+        if (b == NULL) {
+          Py_DECREF(a);
           return NULL;
         }
-        for (j = 0; j < rhs_size; j++) {
-          b = PyTuple_GET_ITEM(rhs, i);
-          if (b == NULL) {
-            b = Number_New(PyList_GET_ITEM(w, i));
-            if (b == NULL) {
-              Py_DECREF(a);
-              Py_DECREF(rhs);
-              return NULL;
-            }
-            /* `rhs` now owns the reference */
-            PyTuple_SET_ITEM(rhs, i, b);
-          }
-          result = object_richcompare(a, b, op);
-          if (result != Boolean_False) {
-            assert(result == NULL || result == Boolean_True);
-            Py_DECREF(a);
-            Py_DECREF(rhs);
-            return result;
-          }
+        result = object_richcompare(a, b, Py_NE);
+        Py_DECREF(b);
+        if (result != Boolean_False) {
+          assert(result == NULL || result == Boolean_True);
+          Py_DECREF(a);
+          return result;
         }
-        Py_DECREF(a);
+        Py_DECREF(result);
       }
-      Py_DECREF(rhs);
+      Py_DECREF(a);
+    } else {
+      /* A relational comparison holds for some pair of numbers if it does
+       * for the smallest or largest number of each side (NaN compares
+       * false with everything, so it is left out). */
+      double lhs_min, lhs_max, rhs_min, rhs_max;
+      int cmp;
+      switch (nodeset_number_range(v, &lhs_min, &lhs_max)) {
+      case -1:
+        return NULL;
+      case 0:
+        Py_INCREF(Boolean_False);
+        return Boolean_False;
+      }
+      switch (nodeset_number_range(w, &rhs_min, &rhs_max)) {
+      case -1:
+        return NULL;
+      case 0:
+        Py_INCREF(Boolean_False);
+        return Boolean_False;
+      }
+      switch (op) {
+      case Py_LT: cmp = lhs_min < rhs_max; break;
+      case Py_LE: cmp = lhs_min <= rhs_max; break;
+      case Py_GT: cmp = lhs_max > rhs_min; break;
+      default: cmp = lhs_max >= rhs_min; break;
+      }
+      result = cmp ? Boolean_True : Boolean_False;
+      Py_INCREF(result);
+      return result;
     }
     Py_INCREF(Boolean_False);
     return Boolean_False;
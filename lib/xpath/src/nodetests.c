@@ -39,9 +39,11 @@ static int filter_traverse(FilterObject *self, visitproc visit, void *arg)
   return 0;
 }
 
+static FilterObject *filter_copy(FilterObject *self);
+
 static PyObject *filter_call(PyObject *self, PyObject *args, PyObject *kwds)
 {
-  FilterObject *filter = (FilterObject *)self;
+  FilterObject *filter;
   PyObject *context, *nodes = Py_None;
   static char *kwlist[] = { "context", "nodes", NULL };
 
@@ -69,11 +71,15 @@ static PyObject *filter_call(PyObject *self, PyObject *args, PyObject *kwds)
   if (nodes == NULL) {
     return NULL;
   }
-  Py_XDECREF(filter->nodes);
+  /* the filter is shared by every evaluation of its (cached) expression, so
+   * each call filters through a copy of its own */
+  filter = filter_copy((FilterObject *)self);
+  if (filter == NULL) {
+    Py_DECREF(nodes);
+    return NULL;
+  }
   filter->nodes = nodes;
-
-  Py_INCREF(self);
-  return self;
+  return (PyObject *)filter;
 }
 
 static PyMethodDef filter_methods[] = {
@@ -135,8 +141,30 @@ typedef struct NodeFilterObject {
   int (*nametest)(struct NodeFilterObject *, PyObject *);
   PyObject *name;
   PyObject *namespace;
+  int frozen_kinds;             /* bit set of the matching FrozenKinds */
 } NodeFilterObject;
 
+/* Parsed documents share their name strings (see the Expat reader), so most
+ * matches are decided by identity; strings of differing length or hash
+ * cannot be equal either. */
+Py_LOCAL_INLINE(int)
+name_equal(PyObject *a, PyObject *b)
+{
+  if (a == b)
+    return 1;
+  if (PyUnicode_CheckExact(a) && PyUnicode_CheckExact(b)) {
+    long hash_a = ((PyUnicodeObject *)a)->hash;
+    long hash_b = ((PyUnicodeObject *)b)->hash;
+    if (PyUnicode_GET_SIZE(a) != PyUnicode_GET_SIZE(b))
+      return 0;
+    if (hash_a != -1 && hash_b != -1 && hash_a != hash_b)
+      return 0;
+    return memcmp(PyUnicode_AS_UNICODE(a), PyUnicode_AS_UNICODE(b),
+                  PyUnicode_GET_SIZE(a) * sizeof(Py_UNICODE)) == 0;
+  }
+  return PyObject_RichCompareBool(a, b, Py_EQ);
+}
+
 Py_LOCAL_INLINE(int)
 node_nametest(NodeFilterObject *self, PyObject *namespace, PyObject *name)
 {
@@ -144,8 +172,10 @@ node_nametest(NodeFilterObject *self, PyObject *namespace, PyObject *name)
   if (self->namespace == NULL) {
     if (namespace != Py_None)
       return 0;
+  } else if (namespace == Py_None) {
+    return 0;
   } else {
-    rv = PyObject_RichCompareBool(self->namespace, namespace, Py_EQ);
+    rv = name_equal(self->namespace, namespace);
     if (rv != 1)
       return rv;
   }
@@ -153,7 +183,7 @@ node_nametest(NodeFilterObject *self, PyObject *namespace, PyObject *name)
   if (self->name == NULL)
     return 1;
   /* otherwise, compare it with the node's local name */
-  return PyObject_RichCompareBool(self->name, name, Py_EQ);
+  return name_equal(self->name, name);
 }
 
 static int element_nametest(NodeFilterObject *self, PyObject *node)
@@ -178,6 +208,27 @@ static int pi_nametest(NodeFilterObject *self, PyObject *node)
   return node_nametest(self, Py_None, ProcessingInstruction_GET_TARGET(node));
 }
 
+/* Returns the kinds of frozen node whose tree type is `node_type` */
+static int frozen_kinds(PyTypeObject *node_type)
+{
+  PyTypeObject *types[] = {
+    DomletteEntity_Type,
+    DomletteElement_Type,
+    DomletteNamespace_Type,
+    DomletteAttr_Type,
+    DomletteText_Type,
+    DomletteComment_Type,
+    DomletteProcessingInstruction_Type,
+  };
+  int kind, kinds = 0;
+
+  for (kind = FROZEN_ENTITY; kind <= FROZEN_PROCESSING_INSTRUCTION; kind++) {
+    if (PyType_IsSubtype(types[kind], node_type))
+      kinds |= 1 << kind;
+  }
+  return kinds;
+}
+
 static PyObject *nodefilter_new(PyTypeObject *type, PyObject *args,
                                 PyObject *kwds)
 {
@@ -249,6 +300,7 @@ static PyObject *nodefilter_new(PyTypeObject *type, PyObject *args,
     return NULL;
   }
   filter->nametest = nametest;
+  filter->frozen_kinds = frozen_kinds(node_type);
   Py_INCREF(node_type);
   filter->node_type = node_type;
   Py_XINCREF(name);
@@ -262,6 +314,7 @@ static PyObject *nodefilter_new(PyTypeObject *type, PyObject *args,
 static void nodefilter_dealloc(NodeFilterObject *self)
 {
   PyObject_GC_UnTrack(self);
+  Py_XDECREF(self->node_type);
   Py_XDECREF(self->name);
   Py_XDECREF(self->namespace);
   filter_dealloc((FilterObject *)self);
@@ -287,6 +340,7 @@ static PyObject *nodefilter_next(NodeFilterObject *self)
   PyObject *nodes = self->nodes;
   PyObject *(*iternext)(PyObject *);
   PyObject *node;
+  int matched;
 
   /* check if exhausted */
   if (nodes == NULL) 
@@ -295,20 +349,31 @@ static PyObject *nodefilter_next(NodeFilterObject *self)
   assert(PyIter_Check(nodes));
   iternext = *nodes->ob_type->tp_iternext;
   while ((node = iternext(nodes))) {
-    if (PyObject_TypeCheck(node, node_type)) {
-      if (nametest != NULL) {
-        switch (nametest(self, node)) {
-        case 1: 
-          return node;
-        case 0: 
-          break;
-        default:
-          Py_DECREF(node);
-          return NULL;
-        }
-      } else {
-        return node;
-      }
+    if (FrozenNode_Check(node)) {
+      /* nodes of read-only documents are tested on the document arrays */
+      FrozenDocumentObject *document = FrozenNode_GET_DOCUMENT(node);
+      int index = FrozenNode_GET_INDEX(node);
+      if (!(self->frozen_kinds & (1 << FrozenNode_GET_KIND(node))))
+        matched = 0;
+      else if (nametest == NULL)
+        matched = 1;
+      else
+        matched = node_nametest(self,
+                                Frozen_GET_NAMESPACE_URI(document, index),
+                                Frozen_GET_LOCAL_NAME(document, index));
+    } else if (PyObject_TypeCheck(node, node_type)) {
+      matched = (nametest == NULL) ? 1 : nametest(self, node);
+    } else {
+      matched = 0;
+    }
+    switch (matched) {
+    case 1:
+      return node;
+    case 0:
+      break;
+    default:
+      Py_DECREF(node);
+      return NULL;
     }
     Py_DECREF(node);
   }
@@ -428,6 +493,11 @@ static PyObject *positionfilter_next(PositionFilterObject *self)
   return node;
 }
 
+static PyMemberDef positionfilter_members[] = {
+  { "position", T_INT, offsetof(PositionFilterObject, position), RO },
+  { NULL }
+};
+
 static PyTypeObject PositionFilter_Type = {
   /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
   /* ob_size           */ 0,
@@ -458,7 +528,7 @@ static PyTypeObject PositionFilter_Type = {
   /* tp_iter           */ (getiterfunc) 0,
   /* tp_iternext       */ (iternextfunc) positionfilter_next,
   /* tp_methods        */ (PyMethodDef *) 0,
-  /* tp_members        */ (PyMemberDef *) 0,
+  /* tp_members        */ (PyMemberDef *) positionfilter_members,
   /* tp_getset         */ (PyGetSetDef *) 0,
   /* tp_base           */ (PyTypeObject *) &Filter_Type,
   /* tp_dict           */ (PyObject *) 0,
@@ -471,6 +541,104 @@ static PyTypeObject PositionFilter_Type = {
   /* tp_free           */ 0,
 };
 
+/** lastfilter object ************************************************/
+
+static PyObject *lastfilter_next(FilterObject *self)
+{
+  PyObject *nodes = self->nodes;
+  PyObject *(*iternext)(PyObject *);
+  PyObject *node, *last = NULL;
+
+  if (nodes == NULL) return NULL;
+
+  assert(PyIter_Check(nodes));
+  iternext = nodes->ob_type->tp_iternext;
+  /* only the last node is kept, rather than a list of them all */
+  while ((node = iternext(nodes))) {
+    Py_XDECREF(last);
+    last = node;
+  }
+  self->nodes = NULL;
+  Py_DECREF(nodes);
+  if (PyErr_Occurred()) {
+    Py_XDECREF(last);
+    return NULL;
+  }
+  return last;
+}
+
+static PyTypeObject LastFilter_Type = {
+  /* PyObject_HEAD     */ PyObject_HEAD_INIT(NULL)
+  /* ob_size           */ 0,
+  /* tp_name           */ MODULE_NAME ".lastfilter",
+  /* tp_basicsize      */ sizeof(FilterObject),
+  /* tp_itemsize       */ 0,
+  /* tp_dealloc        */ (destructor) 0,
+  /* tp_print          */ (printfunc) 0,
+  /* tp_getattr        */ (getattrfunc) 0,
+  /* tp_setattr        */ (setattrfunc) 0,
+  /* tp_compare        */ (cmpfunc) 0,
+  /* tp_repr           */ (reprfunc) 0,
+  /* tp_as_number      */ (PyNumberMethods *) 0,
+  /* tp_as_sequence    */ (PySequenceMethods *) 0,
+  /* tp_as_mapping     */ (PyMappingMethods *) 0,
+  /* tp_hash           */ (hashfunc) 0,
+  /* tp_call           */ (ternaryfunc) 0,
+  /* tp_str            */ (reprfunc) 0,
+  /* tp_getattro       */ (getattrofunc) 0,
+  /* tp_setattro       */ (setattrofunc) 0,
+  /* tp_as_buffer      */ (PyBufferProcs *) 0,
+  /* tp_flags          */ Py_TPFLAGS_DEFAULT,
+  /* tp_doc            */ (char *) 0,
+  /* tp_traverse       */ (traverseproc) 0,
+  /* tp_clear          */ (inquiry) 0,
+  /* tp_richcompare    */ (richcmpfunc) 0,
+  /* tp_weaklistoffset */ 0,
+  /* tp_iter           */ (getiterfunc) 0,
+  /* tp_iternext       */ (iternextfunc) lastfilter_next,
+  /* tp_methods        */ (PyMethodDef *) 0,
+  /* tp_members        */ (PyMemberDef *) 0,
+  /* tp_getset         */ (PyGetSetDef *) 0,
+  /* tp_base           */ (PyTypeObject *) &Filter_Type,
+  /* tp_dict           */ (PyObject *) 0,
+  /* tp_descr_get      */ (descrgetfunc) 0,
+  /* tp_descr_set      */ (descrsetfunc) 0,
+  /* tp_dictoffset     */ 0,
+  /* tp_init           */ (initproc) 0,
+  /* tp_alloc          */ (allocfunc) 0,
+  /* tp_new            */ (newfunc) filter_new,
+  /* tp_free           */ 0,
+};
+
+/** filter copies ****************************************************/
+
+/* Returns a new filter with the test of `self`, without any nodes */
+static FilterObject *filter_copy(FilterObject *self)
+{
+  PyTypeObject *type = self->ob_type;
+  FilterObject *copy;
+
+  copy = (FilterObject *)type->tp_alloc(type, 0);
+  if (copy == NULL)
+    return NULL;
+  if (PyObject_TypeCheck(self, &NodeFilter_Type)) {
+    NodeFilterObject *from = (NodeFilterObject *)self;
+    NodeFilterObject *to = (NodeFilterObject *)copy;
+    to->nametest = from->nametest;
+    to->frozen_kinds = from->frozen_kinds;
+    Py_INCREF(from->node_type);
+    to->node_type = from->node_type;
+    Py_XINCREF(from->name);
+    to->name = from->name;
+    Py_XINCREF(from->namespace);
+    to->namespace = from->namespace;
+  } else if (PyObject_TypeCheck(self, &PositionFilter_Type)) {
+    ((PositionFilterObject *)copy)->position =
+      ((PositionFilterObject *)self)->position;
+  }
+  return copy;
+}
+
 
 static PyMethodDef module_methods[] = {
   { NULL }
@@ -483,6 +651,7 @@ PyMODINIT_FUNC MODULE_INITFUNC(void)
     &Filter_Type,
     &NodeFilter_Type,
     &PositionFilter_Type,
+    &LastFilter_Type,
     NULL
   };
   int i;
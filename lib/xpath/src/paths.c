@@ -8,6 +8,7 @@ XPath PathExpr as types\n\
 
 #include "Python.h"
 #include "structmember.h"
+#include "domlette_interface.h"
 
 #define MODULE_NAME "amara.xpath.locationpaths._paths"
 #define MODULE_INITFUNC init_paths
@@ -116,6 +117,22 @@ static PyObject *ReverseIter_New(PyObject *iterable)
 
 /** stepiter object **************************************************/
 
+/* The axes that a stepiter walks itself, for nodes of amara.tree documents */
+typedef enum {
+  WALK_NONE = 0,
+  WALK_CHILD,
+  WALK_DESCENDANT,
+  WALK_ATTRIBUTE,
+} WalkAxis;
+
+typedef struct {
+  NodeObject *node;
+  Py_ssize_t index;
+} WalkFrame;
+
+/* The walk position that selects the last matching node */
+#define WALK_LAST (-1)
+
 typedef struct {
   PyObject_HEAD
   PyObject *context;
@@ -125,35 +142,328 @@ typedef struct {
   PyObject *node_test;
   PyObject *predicates;
   int reversed;
+  /* A step that tests just the node type or name (and maybe a constant
+   * position) along one of the WalkAxis axes is walked over the nodes
+   * directly, rather than through `axis`, `node_test` and `predicates`. */
+  WalkAxis walk_axis;
+  PyTypeObject *walk_type;
+  int walk_names;               /* test the names, as well as the type */
+  PyObject *walk_namespace;     /* NULL for no namespace */
+  PyObject *walk_name;          /* NULL for any local name */
+  Py_ssize_t walk_position;     /* 0 for every matching node, or WALK_LAST */
+  int walk_indexed;             /* use the element name index of documents */
+  /* the walk from the current context node (`walk_depth` is -1 if none) */
+  WalkFrame *frames;
+  Py_ssize_t frames_allocated;
+  Py_ssize_t walk_depth;
+  Py_ssize_t walk_count;        /* the nodes matched so far */
+  PyObject *walk_attributes;    /* the attributes walked (attribute axis) */
+  PyObject *walk_elements;      /* the indexed elements walked and the */
+  Py_ssize_t walk_index;        /* range of them left */
+  Py_ssize_t walk_end;
 } StepIterObject;
 
+#define StepIter_WALKING(op) \
+  ((op)->walk_depth >= 0 || (op)->walk_elements != NULL)
+
+/* The name comparison of nodefilter (see nodetests.c) */
+Py_LOCAL_INLINE(int)
+name_equal(PyObject *a, PyObject *b)
+{
+  if (a == b)
+    return 1;
+  if (PyUnicode_CheckExact(a) && PyUnicode_CheckExact(b)) {
+    long hash_a = ((PyUnicodeObject *)a)->hash;
+    long hash_b = ((PyUnicodeObject *)b)->hash;
+    if (PyUnicode_GET_SIZE(a) != PyUnicode_GET_SIZE(b))
+      return 0;
+    if (hash_a != -1 && hash_b != -1 && hash_a != hash_b)
+      return 0;
+    return memcmp(PyUnicode_AS_UNICODE(a), PyUnicode_AS_UNICODE(b),
+                  PyUnicode_GET_SIZE(a) * sizeof(Py_UNICODE)) == 0;
+  }
+  return PyObject_RichCompareBool(a, b, Py_EQ);
+}
+
+/* Returns 1 if `node` passes the node test of the walk, 0 if not and -1 on
+ * error. */
+Py_LOCAL_INLINE(int)
+walk_test(StepIterObject *self, NodeObject *node)
+{
+  PyObject *namespace, *name;
+  int rv;
+
+  if (!PyObject_TypeCheck(node, self->walk_type))
+    return 0;
+  if (!self->walk_names)
+    return 1;
+  if (Element_Check(node)) {
+    namespace = Element_NAMESPACE_URI(node);
+    name = Element_LOCAL_NAME(node);
+  } else {
+    namespace = Attr_GET_NAMESPACE_URI(node);
+    name = Attr_GET_LOCAL_NAME(node);
+  }
+  if (self->walk_namespace == NULL) {
+    if (namespace != Py_None)
+      return 0;
+  } else if (namespace == Py_None) {
+    return 0;
+  } else {
+    rv = name_equal(self->walk_namespace, namespace);
+    if (rv != 1)
+      return rv;
+  }
+  if (self->walk_name == NULL)
+    return 1;
+  return name_equal(self->walk_name, name);
+}
+
+static int walk_push(StepIterObject *self, NodeObject *node)
+{
+  Py_ssize_t depth = self->walk_depth + 1;
+
+  if (depth == self->frames_allocated) {
+    Py_ssize_t allocated = self->frames_allocated + 16;
+    WalkFrame *frames = self->frames;
+    if (PyMem_Resize(frames, WalkFrame, allocated) == NULL) {
+      PyErr_NoMemory();
+      return -1;
+    }
+    self->frames = frames;
+    self->frames_allocated = allocated;
+  }
+  Py_INCREF(node);
+  self->frames[depth].node = node;
+  self->frames[depth].index = 0;
+  self->walk_depth = depth;
+  return 0;
+}
+
+static void walk_clear(StepIterObject *self)
+{
+  while (self->walk_depth >= 0) {
+    Py_DECREF(self->frames[self->walk_depth].node);
+    self->walk_depth--;
+  }
+  Py_CLEAR(self->walk_attributes);
+  Py_CLEAR(self->walk_elements);
+}
+
+/* Starts the walk from the context node `node` */
+static int walk_start(StepIterObject *self, NodeObject *node)
+{
+  self->walk_count = 0;
+  if (self->walk_indexed) {
+    PyObject *namespace = self->walk_namespace ? self->walk_namespace : Py_None;
+    self->walk_elements = Entity_NamedDescendants(node, namespace,
+                                                  self->walk_name,
+                                                  &self->walk_index,
+                                                  &self->walk_end);
+    if (self->walk_elements != NULL) {
+      /* just the element at that position */
+      if (self->walk_position == WALK_LAST) {
+        if (self->walk_index < self->walk_end)
+          self->walk_index = self->walk_end - 1;
+      } else if (self->walk_position) {
+        self->walk_index += self->walk_position - 1;
+        if (self->walk_index < self->walk_end)
+          self->walk_end = self->walk_index + 1;
+      }
+      return 0;
+    }
+    if (PyErr_Occurred())
+      return -1;
+  }
+  if (self->walk_axis == WALK_ATTRIBUTE) {
+    if (!Element_Check(node) || Element_ATTRIBUTES(node) == NULL)
+      return 0;
+    self->walk_attributes = Element_ATTRIBUTES(node);
+    Py_INCREF(self->walk_attributes);
+  } else if (!Element_Check(node) && !Entity_Check(node)) {
+    return 0;
+  }
+  return walk_push(self, node);
+}
+
+/* Returns the next node of the walk that passes the node test, or NULL
+ * once the walk is complete (or on error, with an exception set). */
+static PyObject *walk_match(StepIterObject *self)
+{
+  while (self->walk_depth >= 0) {
+    WalkFrame *frame = self->frames + self->walk_depth;
+    NodeObject *node;
+    int matched;
+
+    if (self->walk_axis == WALK_ATTRIBUTE) {
+      node = (NodeObject *)AttributeMap_Next(self->walk_attributes,
+                                             &frame->index);
+    } else if (frame->index < Container_GET_COUNT(frame->node)) {
+      node = Container_GET_CHILD(frame->node, frame->index);
+      frame->index++;
+    } else {
+      node = NULL;
+    }
+    if (node == NULL) {
+      /* this level is complete */
+      Py_DECREF(frame->node);
+      self->walk_depth--;
+      continue;
+    }
+    if (self->walk_axis == WALK_DESCENDANT && Element_Check(node) &&
+        Container_GET_COUNT(node) > 0) {
+      if (walk_push(self, node) < 0)
+        return NULL;
+    }
+    matched = walk_test(self, node);
+    if (matched < 0)
+      return NULL;
+    if (matched) {
+      Py_INCREF(node);
+      return (PyObject *)node;
+    }
+  }
+  Py_CLEAR(self->walk_attributes);
+  return NULL;
+}
+
+/* Returns the last node of the walk that passes the node test (if any) and
+ * completes the walk */
+static PyObject *walk_last(StepIterObject *self)
+{
+  PyObject *node, *last = NULL;
+
+  if (self->walk_axis == WALK_CHILD) {
+    /* the children can be tested from the end */
+    NodeObject *parent = self->frames[0].node;
+    Py_ssize_t i = Container_GET_COUNT(parent);
+    while (--i >= 0) {
+      int matched = walk_test(self, Container_GET_CHILD(parent, i));
+      if (matched < 0)
+        return NULL;
+      if (matched) {
+        last = (PyObject *)Container_GET_CHILD(parent, i);
+        Py_INCREF(last);
+        break;
+      }
+    }
+    walk_clear(self);
+    return last;
+  }
+  while ((node = walk_match(self)) != NULL) {
+    Py_XDECREF(last);
+    last = node;
+  }
+  if (PyErr_Occurred()) {
+    Py_XDECREF(last);
+    return NULL;
+  }
+  return last;
+}
+
+/* Returns the next node of the walk, or NULL once it is complete (or on
+ * error, with an exception set). */
+static PyObject *walk_next(StepIterObject *self)
+{
+  PyObject *node;
+
+  if (self->walk_elements != NULL) {
+    /* the range left is already limited to the position */
+    if (self->walk_index < self->walk_end &&
+        self->walk_index < PyList_GET_SIZE(self->walk_elements)) {
+      node = PyList_GET_ITEM(self->walk_elements, self->walk_index++);
+      Py_INCREF(node);
+      return node;
+    }
+    Py_CLEAR(self->walk_elements);
+    return NULL;
+  }
+  if (self->walk_position == WALK_LAST)
+    return walk_last(self);
+  while ((node = walk_match(self)) != NULL) {
+    if (self->walk_position == 0)
+      return node;
+    if (++self->walk_count == self->walk_position) {
+      /* the only node at that position has been found */
+      walk_clear(self);
+      return node;
+    }
+    Py_DECREF(node);
+  }
+  return NULL;
+}
+
 static void stepiter_dealloc(StepIterObject *self)
 {
   PyObject_GC_UnTrack(self);
+  walk_clear(self);
+  PyMem_Free(self->frames);
   Py_XDECREF(self->context);
   Py_XDECREF(self->context_nodes);
   Py_XDECREF(self->current_nodes);
   Py_XDECREF(self->axis);
   Py_XDECREF(self->node_test);
   Py_XDECREF(self->predicates);
+  Py_XDECREF(self->walk_type);
+  Py_XDECREF(self->walk_namespace);
+  Py_XDECREF(self->walk_name);
   self->ob_type->tp_free((PyObject *)self);
 }
 
 static int stepiter_traverse(StepIterObject *self, visitproc visit, void *arg)
 {
+  Py_ssize_t i;
+
   Py_VISIT(self->context);
   Py_VISIT(self->context_nodes);
   Py_VISIT(self->current_nodes);
   Py_VISIT(self->axis);
   Py_VISIT(self->node_test);
   Py_VISIT(self->predicates);
+  for (i = 0; i <= self->walk_depth; i++)
+    Py_VISIT(self->frames[i].node);
+  Py_VISIT(self->walk_attributes);
+  Py_VISIT(self->walk_elements);
   return 0;
 }
 
-static PyObject *stepiter_call(StepIterObject *self, PyObject *args,
+/* Returns a new stepiter for the step described by `step`, to hold the
+ * state of one evaluation.  A step is shared by every evaluation of its
+ * (cached) expression, possibly from several threads, so it never holds
+ * that state itself. */
+static StepIterObject *stepiter_copy(StepIterObject *step)
+{
+  StepIterObject *self;
+
+  self = (StepIterObject *) step->ob_type->tp_alloc(step->ob_type, 0);
+  if (self == NULL)
+    return NULL;
+  Py_INCREF(step->axis);
+  self->axis = step->axis;
+  self->reversed = step->reversed;
+  Py_XINCREF(step->node_test);
+  self->node_test = step->node_test;
+  Py_XINCREF(step->predicates);
+  self->predicates = step->predicates;
+  self->walk_axis = step->walk_axis;
+  Py_XINCREF(step->walk_type);
+  self->walk_type = step->walk_type;
+  self->walk_names = step->walk_names;
+  Py_XINCREF(step->walk_namespace);
+  self->walk_namespace = step->walk_namespace;
+  Py_XINCREF(step->walk_name);
+  self->walk_name = step->walk_name;
+  self->walk_position = step->walk_position;
+  self->walk_indexed = step->walk_indexed;
+  self->walk_depth = -1;
+  return self;
+}
+
+static PyObject *stepiter_call(StepIterObject *step, PyObject *args,
                                PyObject *kwds)
 {
   PyObject *context, *nodes = Py_None;
+  StepIterObject *self;
   static char *kwlist[] = { "context", "nodes", NULL };
 
   if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O:stepiter", kwlist,
@@ -180,40 +490,60 @@ static PyObject *stepiter_call(StepIterObject *self, PyObject *args,
   if (nodes == NULL) {
     return NULL;
   }
-  Py_XDECREF(self->context_nodes);
+  self = stepiter_copy(step);
+  if (self == NULL) {
+    Py_DECREF(nodes);
+    return NULL;
+  }
   self->context_nodes = nodes;
-  Py_XDECREF(self->current_nodes);
-  self->current_nodes = NULL;
   Py_INCREF(context);
   self->context = context;
-  Py_INCREF(self);
   return (PyObject *)self;
 }
 
 static PyObject *stepiter_next(StepIterObject *self)
 {
-  PyObject *context_nodes = self->context_nodes;
-  PyObject *current_nodes = self->current_nodes;
+  PyObject *context_nodes, *current_nodes;
   PyObject *node, *nodes, *args;
 
-  if (current_nodes) {
-    assert(PyIter_Check(current_nodes));
-    node = current_nodes->ob_type->tp_iternext(current_nodes);
-    if (node) return node;
-    /* The current node iterator is exhausted, get the next one. */
-    self->current_nodes = NULL;
-    Py_DECREF(current_nodes);
-  }
+  for (;;) {
+    if (StepIter_WALKING(self)) {
+      node = walk_next(self);
+      if (node || PyErr_Occurred()) return node;
+    }
+
+    current_nodes = self->current_nodes;
+    if (current_nodes) {
+      assert(PyIter_Check(current_nodes));
+      node = current_nodes->ob_type->tp_iternext(current_nodes);
+      if (node) return node;
+      /* The current node iterator is exhausted, get the next one. */
+      self->current_nodes = NULL;
+      Py_DECREF(current_nodes);
+      if (PyErr_Occurred()) return NULL;
+    }
 
-  if (context_nodes) {
+    context_nodes = self->context_nodes;
+    if (context_nodes == NULL) {
+      /* iterators exhausted */
+      return NULL;
+    }
     assert(PyIter_Check(context_nodes));
     node = context_nodes->ob_type->tp_iternext(context_nodes);
     if (node == NULL) {
-    /* The context node iterator is exhausted, signal complete. */
+      /* The context node iterator is exhausted, signal complete. */
       self->context_nodes = NULL;
       Py_DECREF(context_nodes);
       return NULL;
     }
+
+    if (self->walk_axis != WALK_NONE && Node_Check(node)) {
+      int rv = walk_start(self, (NodeObject *)node);
+      Py_DECREF(node);
+      if (rv < 0) return NULL;
+      continue;
+    }
+
     /* nodes = axis(node) */
     args = PyTuple_New(1);
     if (args == NULL) {
@@ -266,22 +596,83 @@ static PyObject *stepiter_next(StepIterObject *self)
     } else {
       self->current_nodes = nodes;
     }
-    return stepiter_next(self);
   }
-  /* iterators exhausted */
-  return NULL;
+}
+
+/* Sets up the walk of `step` from its description `walk`, a tuple of the
+ * axis name, the node type, the (namespace, local name) pair to test or None
+ * and the position to select (0 for all, -1 for the last). */
+static int stepiter_set_walk(StepIterObject *step, PyObject *walk)
+{
+  static const struct {
+    const char *name;
+    WalkAxis axis;
+  } axes[] = {
+    { "child", WALK_CHILD },
+    { "descendant", WALK_DESCENDANT },
+    { "attribute", WALK_ATTRIBUTE },
+    { NULL, WALK_NONE }
+  };
+  const char *axis_name;
+  PyTypeObject *node_type;
+  PyObject *names, *namespace = NULL, *name = NULL;
+  Py_ssize_t position;
+  int i;
+
+  if (!PyArg_ParseTuple(walk, "sO!On:stepiter", &axis_name,
+                        &PyType_Type, &node_type, &names, &position))
+    return -1;
+  for (i = 0; axes[i].name && strcmp(axes[i].name, axis_name); i++);
+  if (axes[i].name == NULL) {
+    PyErr_Format(PyExc_ValueError, "cannot walk the '%s' axis", axis_name);
+    return -1;
+  }
+  if (!PyType_IsSubtype(node_type, DomletteNode_Type)) {
+    PyErr_Format(PyExc_TypeError, "walk node type must be a subclass of %s",
+                 DomletteNode_Type->tp_name);
+    return -1;
+  }
+  if (names != Py_None) {
+    if (!PyType_IsSubtype(node_type, DomletteElement_Type) &&
+        !PyType_IsSubtype(node_type, DomletteAttr_Type)) {
+      PyErr_SetString(PyExc_TypeError,
+                      "only elements and attributes have names to test");
+      return -1;
+    }
+    if (!PyArg_ParseTuple(names, "OO:stepiter", &namespace, &name))
+      return -1;
+    if (namespace == Py_None) namespace = NULL;
+    if (name == Py_None) name = NULL;
+  }
+  if (position < 0 && position != WALK_LAST) {
+    PyErr_SetString(PyExc_ValueError, "walk position must not be negative");
+    return -1;
+  }
+  step->walk_axis = axes[i].axis;
+  Py_INCREF(node_type);
+  step->walk_type = node_type;
+  step->walk_names = (names != Py_None);
+  Py_XINCREF(namespace);
+  step->walk_namespace = namespace;
+  Py_XINCREF(name);
+  step->walk_name = name;
+  step->walk_position = position;
+  /* the elements of a name can be looked up, rather than walked to */
+  step->walk_indexed = (step->walk_axis == WALK_DESCENDANT &&
+                        node_type == DomletteElement_Type && name != NULL);
+  return 0;
 }
 
 static PyObject *stepiter_new(PyTypeObject *type, PyObject *args,
                               PyObject *kwds)
 {
-  PyObject *axis, *node_test, *predicates = Py_None;
+  PyObject *axis, *node_test, *predicates = Py_None, *walk = Py_None;
   int reversed;
   Py_ssize_t i;
   StepIterObject *step;
 
-  if (!PyArg_ParseTuple(args, "OiO|O:stepiter",
-                        &axis, &reversed, &node_test, &predicates)) {
+  if (!PyArg_ParseTuple(args, "OiO|OO:stepiter",
+                        &axis, &reversed, &node_test, &predicates, &walk)) {
     return NULL;
   }
 
@@ -327,6 +718,11 @@ static PyObject *stepiter_new(PyTypeObject *type, PyObject *args,
   Py_XINCREF(node_test);
   step->node_test = node_test;
   step->predicates = predicates;
+  step->walk_depth = -1;
+  if (walk != Py_None && stepiter_set_walk(step, walk) < 0) {
+    Py_DECREF(step);
+    return NULL;
+  }
   return (PyObject *)step;
 }
 
@@ -560,10 +956,95 @@ static PyObject *UnionIter(PyObject *module, PyObject *args)
   return iter;
 }
 
+/** count and first **************************************************/
+
+static char count_doc[] =
+"count(nodes) -> int\n\
+\n\
+Returns the number of nodes in the iterable `nodes`, without keeping them.";
+
+static PyObject *Count(PyObject *module, PyObject *nodes)
+{
+  PyObject *iter, *item;
+  iternextfunc iternext;
+  Py_ssize_t count = 0;
+
+  iter = PyObject_GetIter(nodes);
+  if (iter == NULL) {
+    return NULL;
+  }
+  iternext = iter->ob_type->tp_iternext;
+  while ((item = iternext(iter))) {
+    Py_DECREF(item);
+    count++;
+  }
+  Py_DECREF(iter);
+  if (PyErr_Occurred()) {
+    if (!PyErr_ExceptionMatches(PyExc_StopIteration))
+      return NULL;
+    PyErr_Clear();
+  }
+  return PyInt_FromSsize_t(count);
+}
+
+static char first_doc[] =
+"first(nodes, default) -> node\n\
+\n\
+Returns the first of the nodes of the iterable `nodes` in document order\n\
+(without sorting them), or `default` if there are none.";
+
+static PyObject *First(PyObject *module, PyObject *args)
+{
+  PyObject *nodes, *first, *iter, *item;
+  iternextfunc iternext;
+  int found = 0, rv;
+
+  if (!PyArg_ParseTuple(args, "OO:first", &nodes, &first)) {
+    return NULL;
+  }
+  iter = PyObject_GetIter(nodes);
+  if (iter == NULL) {
+    return NULL;
+  }
+  Py_INCREF(first);
+  iternext = iter->ob_type->tp_iternext;
+  while ((item = iternext(iter))) {
+    if (found) {
+      rv = PyObject_RichCompareBool(item, first, Py_LT);
+      if (rv < 0) {
+        Py_DECREF(item);
+        goto error;
+      }
+    } else {
+      found = rv = 1;
+    }
+    if (rv) {
+      Py_DECREF(first);
+      first = item;
+    } else {
+      Py_DECREF(item);
+    }
+  }
+  if (PyErr_Occurred()) {
+    if (!PyErr_ExceptionMatches(PyExc_StopIteration))
+      goto error;
+    PyErr_Clear();
+  }
+  Py_DECREF(iter);
+  return first;
+
+error:
+  Py_DECREF(iter);
+  Py_DECREF(first);
+  return NULL;
+}
+
 /** Module Initialization ********************************************/
 
 static PyMethodDef module_methods[] = {
   { "unioniter", UnionIter, METH_VARARGS },
+  { "count", Count, METH_O, count_doc },
+  { "first", First, METH_VARARGS, first_doc },
   { NULL }
 };
 
@@ -580,6 +1061,8 @@ PyMODINIT_FUNC MODULE_INITFUNC(void)
   module = Py_InitModule3(MODULE_NAME, module_methods, module_doc);
   if (module == NULL) return;
 
+  Domlette_IMPORT;
+
   if (PyType_Ready(&ReverseIter_Type) < 0) return;
 
   for (i = 0; typelist[i]; i++) {
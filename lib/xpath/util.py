@@ -143,7 +143,7 @@ def paramvalue(obj):
         return datatypes.TRUE if obj else datatypes.FALSE
     elif isinstance(obj, (int, long, float)):
         return datatypes.number(obj)
-    elif isinstance(obj, tree.node):
+    elif isinstance(obj, (tree.node, tree.frozen_node)):
         return obj
     # NOTE: At one time (WSGI.xml days) this attemped to be smart and handle
     # all iterables but this would mean blindly dealing with dangerous
@@ -168,7 +168,7 @@ def paramvalue(obj):
             return datatypes.nodeset(entity.xml_children)
         # We can only use the list if all the items are nodes.
         for item in obj:
-            if not isinstance(item, tree.node):
+            if not isinstance(item, (tree.node, tree.frozen_node)):
                 return None
         return datatypes.nodeset(obj)
     else:
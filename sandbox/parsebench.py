@@ -65,6 +65,25 @@ def amara_parse5():
     assert len(result) == 1
     return dt
 
+#EXERCISE 6: Parse once and test speed of XPath union (document order sort), with large result
+def amara_parse6():
+    doc = amara.parse(ATTRDOC)
+    result, dt = timeit(doc.xml_select, u'//b/@c | //b')
+    assert len(result) == 2*N
+    return dt
+
+#EXERCISE 7: Parse once and test per-call overhead of XPath, with tiny expression
+def amara_parse7():
+    doc = amara.parse(ATTRDOC)
+    select = doc.xml_first_child.xml_first_child.xml_select
+    def select_many():
+        for i in xrange(1000):
+            result = select(u'@c')
+        return result
+    result, dt = timeit(select_many)
+    assert len(result) == 1
+    return dt
+
 #EXERCISE 1: Testing speed of parse
 def bindery_parse1():
     result, dt = timeit(bindery.parse, SIMPLEDOC)
@@ -96,20 +115,181 @@ def bindery_parse5():
     assert len(result) == 1
     return dt
 
+#EXERCISE 6: Parse once and test speed of XPath union (document order sort), with large result
+def bindery_parse6():
+    doc = bindery.parse(ATTRDOC)
+    result, dt = timeit(doc.xml_select, u'//b/@c | //b')
+    assert len(result) == 2*N
+    return dt
+
+#EXERCISE 7: Parse once and test per-call overhead of XPath, with tiny expression
+def bindery_parse7():
+    doc = bindery.parse(ATTRDOC)
+    select = doc.xml_first_child.xml_first_child.xml_select
+    def select_many():
+        for i in xrange(1000):
+            result = select(u'@c')
+        return result
+    result, dt = timeit(select_many)
+    assert len(result) == 1
+    return dt
+
+#EXERCISE 8: Input path throughput on a large file (--input-size MB), with the
+#stream read in blocks and with zero-copy (mmap) input.  SAX without handlers,
+#so that building the tree doesn't swamp the cost of getting the bytes in
+def input_file(size):
+    import os, tempfile
+    from amara.lib import inputsource
+    chunk = ''.join([ "<b c='%i'>text</b>" % i for i in xrange(N) ])
+    fd, path = tempfile.mkstemp('.xml')
+    stream = os.fdopen(fd, 'wb')
+    stream.write('<a>')
+    written = 0
+    while written < size:
+        stream.write(chunk)
+        written += len(chunk)
+    stream.write('</a>')
+    stream.close()
+    from amara import sax
+    def parse(zerocopy):
+        sax.create_parser().parse(inputsource(path, zerocopy=zerocopy))
+    try:
+        best = {}
+        for zerocopy in (False, True, False, True):
+            t1 = time.time()
+            parse(zerocopy)
+            dt = (time.time() - t1) * 1000
+            best[zerocopy] = min(best.get(zerocopy, dt), dt)
+    finally:
+        os.remove(path)
+    return written, best[False], best[True]
+
+#EXERCISE 9: Memory held per element by parsed trees whose elements have
+#`nattrs` attributes each (Linux only, as it reads the RSS from /proc)
+def memory_per_element(nattrs, copies=20, readonly=False):
+    def rss():
+        for line in open('/proc/self/status'):
+            if line.startswith('VmRSS:'):
+                return int(line.split()[1]) * 1024
+    attrs = ' '.join([ "c%i='%%i'" % j for j in xrange(nattrs) ])
+    doc = ''.join(chain(['<a>'], [ ("<b %s/>" % attrs) % ((i,) * nattrs) for i in xrange(N) ], ['</a>']))
+    import gc
+    gc.collect()
+    before = rss()
+    docs = [ amara.parse(doc, readonly=readonly) for i in xrange(copies) ]
+    after = rss()
+    return float(after - before) / (N * copies)
+
+#EXERCISE 10: Throughput on tiny documents, each parsed with a new reader
+#(`amara.parse`) and with a reused one (`amara.tree.parser`)
+TINYDOC = "<msg id='%i'><to>x</to><body>hello</body></msg>"
+
+def tiny_documents(count=50000):
+    from amara import tree
+    docs = [ TINYDOC % i for i in xrange(count) ]
+    def parse_all(parse):
+        for doc in docs:
+            parse(doc)
+    best = []
+    for parse in (amara.parse, tree.parser().parse):
+        result, dt = timeit(parse_all, parse)
+        best.append(count / dt * 1000)
+    return best
+
+#EXERCISE 11: Single location steps over a document of N items, each with a
+#link and a few nested elements
+STEPDOC = ''.join(chain(['<items>'], [
+    "<item href='#%i'><title>%i</title><foo/><body><foo/></body></item>" % (i, i)
+    for i in xrange(N) ], ['</items>']))
+
+def location_steps():
+    doc = amara.parse(STEPDOC)
+    items = doc.xml_first_child
+    item = items.xml_first_child
+    select = item.xml_select
+    def attribute_many():
+        for i in xrange(1000):
+            result = select(u'@href')
+        return result
+    best = []
+    for f, args, count in ((items.xml_select, (u'child::item',), N),
+                           (items.xml_select, (u'item/descendant::foo[1]',), N),
+                           (attribute_many, (), 1)):
+        result, dt = timeit(f, *args)
+        assert len(result) == count
+        best.append(dt)
+    return best
+
+#EXERCISE 12: Conversions of large node-sets that need not build the node-set
+#(or even visit all of its nodes)
+def nodeset_conversions():
+    doc = amara.parse(STEPDOC)
+    items = doc.xml_first_child
+    best = []
+    for expr, expected in ((u'count(//foo)', 2*N),
+                           (u'string(//item//foo)', u''),
+                           (u'item[last()]', 1),
+                           (u'item[position() = last() - 1]', 1),
+                           (u'(//foo)[last()]', 1)):
+        result, dt = timeit(items.xml_select, expr)
+        if isinstance(result, list):
+            result = len(result)
+        assert result == expected, (expr, result)
+        best.append(dt)
+    return best
+
+#EXERCISE 13: Expressions evaluated as parsed and as rewritten by the optimizer
+OPTIMIZED = [u'item[@href = /items/item[last()]/@href]',
+             u'//item[title = 7]',
+             u'item[count(foo) > 0]',
+             u'item[1 + 1]',
+             u'item/title']
+
+def optimized_expressions():
+    from amara.xpath import context, parser, optimizer
+    doc = amara.parse(STEPDOC)
+    ctx = context(doc.xml_first_child)
+    best = []
+    for expr in OPTIMIZED:
+        plain = parser.parse(expr)
+        optimized = optimizer.optimize(parser.parse(expr))
+        result, dt1 = timeit(plain.evaluate, ctx)
+        result, dt2 = timeit(optimized.evaluate, ctx)
+        best.append((expr, dt1, dt2))
+    return best
+
+#EXERCISE 14: Document order sorts (a union and a sort of the same nodes) on
+#documents whose N nodes are nested `depth` elements deep
+def deep_unions(depths=(1, 300, 3000)):
+    best = []
+    for depth in depths:
+        doc = amara.parse(''.join(chain(['<a>'] * depth,
+                                        [ '<x/><y/>' for i in xrange(N) ],
+                                        ['</a>'] * depth)))
+        nodes = doc.xml_select(u'//x') + doc.xml_select(u'//y')
+        result, dt1 = timeit(doc.xml_select, u'//x | //y')
+        assert len(result) == 2*N
+        result, dt2 = timeit(sorted, nodes)
+        best.append((depth, dt1, dt2))
+    return best
+
 row_names = [
     "Parse once (no attributes)",
     " descendant-or-self, many results",
     " descendant-or-self, no results",
     "Parse once (with attributes)",
     " descendant-or-self w/ attribute, 1 result",
+    " union w/ attributes, many results",
+    " attribute of one element, 1000 calls",
     ]
 colwidth = max(len(name) for name in row_names)
 header_format = "%" + str(colwidth) + "s   %10s  %10s"
 row_format = "%-" + str(colwidth) + "s:" + " %8.2f ms  %8.2f ms"
 
-amara_parse_tests = [amara_parse1, amara_parse2, amara_parse3, amara_parse4, amara_parse5]
+amara_parse_tests = [amara_parse1, amara_parse2, amara_parse3, amara_parse4, amara_parse5,
+                     amara_parse6, amara_parse7]
 bindery_parse_tests = [bindery_parse1, bindery_parse2, bindery_parse3, bindery_parse4,
-                       bindery_parse5]
+                       bindery_parse5, bindery_parse6, bindery_parse7]
 
 now = datetime.datetime.now().isoformat().split("T")[0]
 
@@ -146,7 +326,52 @@ def main():
     parser = optparse.OptionParser()
     parser.add_option("--markup", dest="markup", action="store_true")
     parser.add_option("--profile", dest="profile")
+    parser.add_option("--input-size", dest="input_size", type="int",
+                      help="time the input path on a file of this many MB")
+    parser.add_option("--memory", dest="memory", action="store_true",
+                      help="report the memory used per element")
+    parser.add_option("--tiny", dest="tiny", action="store_true",
+                      help="report the throughput on tiny documents")
+    parser.add_option("--steps", dest="steps", action="store_true",
+                      help="time single location steps")
+    parser.add_option("--conversions", dest="conversions", action="store_true",
+                      help="time conversions of large node-sets")
+    parser.add_option("--optimizer", dest="optimizer", action="store_true",
+                      help="time expressions before and after optimization")
+    parser.add_option("--deep", dest="deep", action="store_true",
+                      help="time document order sorts on deep documents")
     options, args = parser.parse_args()
+    if options.deep:
+        for depth, union, sort in deep_unions():
+            print "depth %i: //x | //y %.2f ms, sorted() %.2f ms" % (depth, union, sort)
+        return
+    if options.optimizer:
+        for expr, plain, optimized in optimized_expressions():
+            print "%s: %.2f ms parsed, %.2f ms optimized" % (expr, plain, optimized)
+        return
+    if options.conversions:
+        print ("count(//foo): %.2f ms, string(//item//foo): %.2f ms, "
+               "item[last()]: %.2f ms, item[position() = last() - 1]: %.2f ms, "
+               "(//foo)[last()]: %.2f ms" % tuple(nodeset_conversions()))
+        return
+    if options.steps:
+        child, descendant, attribute = location_steps()
+        print "child::item: %.2f ms, item/descendant::foo[1]: %.2f ms, @href x1000: %.2f ms" % (
+            child, descendant, attribute)
+        return
+    if options.tiny:
+        new, reused = tiny_documents()
+        print "Tiny documents: %.0f/s with a new reader, %.0f/s reused" % (new, reused)
+        return
+    if options.memory:
+        for nattrs in (0, 1, 3, 5, 6, 9):
+            print "%i attributes: %.1f bytes per element (%.1f read-only)" % (
+                nattrs, memory_per_element(nattrs), memory_per_element(nattrs, readonly=True))
+        return
+    if options.input_size:
+        size, dt1, dt2 = input_file(options.input_size * 1024 * 1024)
+        print "Input of %i bytes: %.2f ms blocked, %.2f ms zero-copy" % (size, dt1, dt2)
+        return
     if options.profile:
         # See if I can find the function.
         func = globals()[options.profile]
@@ -357,6 +357,8 @@ setup(name='Amara',
                              'lib/src/domlette/processinginstruction.c',
                              'lib/src/domlette/entity.c',
                              'lib/src/domlette/namespace.c',
+                             'lib/src/domlette/frozen.c',
+                             'lib/src/domlette/snapshot.c',
                              # Document builder
                              'lib/src/domlette/builder.c',
                              # Reference count testing
@@ -368,6 +370,7 @@ setup(name='Amara',
                              ],
                     ),
           Extension('amara.writers._xmlstream',
+                    include_dirs=['lib/src', 'lib/src/domlette'],
                     sources=['lib/writers/src/xmlstream.c'],
                     ),
           Extension('amara.writers.treewriter',
@@ -387,6 +390,7 @@ setup(name='Amara',
                     sources=['lib/xpath/src/nodetests.c'],
                     ),
           Extension('amara.xpath.locationpaths._paths',
+                    include_dirs=['lib/src/domlette'],
                     sources=['lib/xpath/src/paths.c'],
                     ),
           Extension('amara.xpath.parser._xpathparser',
@@ -55,6 +55,37 @@ def test_many_inputsources():
         except:
             print "Failed after", i, "files"
 
+def test_zerocopy():
+    import tempfile
+    from amara import tree, ReaderError
+    DOC = '<a>' + ''.join([ '<b c="%i">%i</b>' % (i, i) for i in range(1000) ]) + '</a>'
+    fd, path = tempfile.mkstemp('.xml')
+    try:
+        os.write(fd, '<?xml version="1.0"?>' + DOC)
+        os.close(fd)
+        expected = tree.parse(DOC).xml_encode()
+        assert inputsource(DOC, zerocopy=True).zeroCopy
+        assert not inputsource(DOC).zeroCopy
+        doc = tree.parse(inputsource(DOC, zerocopy=True))
+        assert doc.xml_encode() == expected
+        doc = tree.parse(inputsource(path, zerocopy=True))
+        assert doc.xml_encode() == expected
+        #Mapping starts at the current position and consumes the file
+        stream = open(path, 'rb')
+        stream.read(len('<?xml version="1.0"?>'))
+        doc = tree.parse(inputsource(stream, zerocopy=True))
+        assert doc.xml_encode() == expected
+        assert stream.read() == ''
+        stream.close()
+        try:
+            tree.parse(inputsource('<a><b></a>', zerocopy=True))
+        except ReaderError:
+            pass
+        else:
+            raise AssertionError("ReaderError not raised")
+    finally:
+        os.remove(path)
+
 #
 if __name__ == '__main__':
     raise SystemExit("Use nosetests")
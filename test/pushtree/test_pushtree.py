@@ -85,6 +85,24 @@ def test_4():
 
     return
 
+def test_prune():
+    EXPECTED = ['<a>0</a>', '<a>1</a>', '<a>10</a>', '<a>11</a>']
+    results = []
+
+    def callback(node):
+        #The matched subtree is whole, but no longer part of the document
+        results.append(node)
+        assert node.xml_parent is not None
+
+    doc = pushtree(XML1, u"a", callback, prune=True)
+
+    assert len(results) == len(EXPECTED)
+    for result, expected in zip(results, EXPECTED):
+        assert result.xml_parent is None
+        treecompare.check_xml(result.xml_encode(), XMLDECL+expected)
+    assert not doc.xml_children
+    return
+
 testdoc = """\
     <a xmlns:x='http://spam.com/'>
     <?xml-stylesheet href='mystyle.css' type='text/css'?>
@@ -93,6 +93,225 @@ class Test_attributes(unittest.TestCase):
         for k in [(None, 'g'), (None, 'h'), (None, 'z')]:
             self.assertFalse(k in attrs)
 
+def test_attribute_map_growth():
+    names = [ u'a%i' % i for i in range(12) ]
+    elem = tree.parse('<e %s/>' % ' '.join([ '%s="%s"' % (n, n) for n in names[:3] ])).xml_first_child
+    attrs = elem.xml_attributes
+    #Grow past the inline slots, then shrink again
+    for n in names[3:]:
+        attrs[None, n] = n
+        assert attrs[None, n] == n
+    assert sorted(attrs.keys()) == sorted([ (None, n) for n in names ])
+    for n in names[::2]:
+        del attrs[None, n]
+    assert sorted(attrs.keys()) == sorted([ (None, n) for n in names[1::2] ])
+    assert len(attrs) == len(names[1::2])
+    #Removing from a small map keeps the others reachable
+    elem = tree.parse('<e a="1" b="2" c="3"/>').xml_first_child
+    attrs = elem.xml_attributes
+    del attrs[None, u'a']
+    assert attrs.get((None, u'c')) == u'3' and (None, u'b') in attrs and (None, u'a') not in attrs
+    attrs[None, u'd'] = u'4'
+    assert [ k for k in attrs.keys() ] == [(None, u'b'), (None, u'c'), (None, u'd')]
+    assert [ a.xml_local for a in elem.xml_select(u'@*') ] == [u'b', u'c', u'd']
+    #Up to 8 attributes stay inline, in document order
+    elem = tree.parse('<e h="8" g="7" f="6" e="5" d="4" c="3" b="2" a="1"/>').xml_first_child
+    assert [ k for k in elem.xml_attributes.keys() ] == [ (None, n) for n in u'hgfedcba' ]
+    doc = '<subject classtype="dewey" source="lc"/>'
+    assert tree.parse(doc).xml_encode().endswith('\n' + doc)
+
+def test_parse_many():
+    from amara import ReaderError
+    sources = [ '<a n="%i">%s</a>' % (i, 'x' * i) for i in range(50) ]
+    for workers in (1, 4):
+        docs = list(tree.parse_many(sources, workers=workers))
+        assert [ int(d.xml_first_child.xml_attributes[None, u'n']) for d in docs ] == range(50)
+        pairs = sorted(tree.parse_many(iter(sources), workers=workers, ordered=False))
+        assert [ i for i, d in pairs ] == range(50)
+        assert [ int(d.xml_first_child.xml_attributes[None, u'n']) for i, d in pairs ] == range(50)
+        results = tree.parse_many(sources[:3] + ['<bad>'] + sources, workers=workers)
+        assert len([ results.next() for i in range(3) ]) == 3
+        try:
+            results.next()
+        except ReaderError:
+            pass
+        else:
+            raise AssertionError("ReaderError not raised")
+
+def test_recycled_nodes():
+    import gc
+    DOC = '<a>' + ''.join([ '<b c="%i">%i</b>' % (i, i) for i in range(100) ]) + '</a>'
+    expected = tree.parse(DOC).xml_encode()
+    gc.collect()
+    #Nodes released by the first parse come back without stale state
+    doc = tree.parse('<x y="1"><!--z--><?w v?></x>')
+    assert doc.xml_encode() == '<?xml version="1.0" encoding="UTF-8"?>\n<x y="1"><!--z--><?w v?></x>'
+    del doc
+    #Subclass instances are released normally
+    class elem(tree.element): pass
+    elem(None, u'x')
+    gc.collect()
+    assert tree.parse(DOC).xml_encode() == expected
+
+def test_node_freelists():
+    import gc
+    DOC = '<a>' + ''.join([ '<b c="%i">%i</b>' % (i, i) for i in range(100) ]) + '</a>'
+    tree.parse(DOC)
+    gc.collect()
+    free, allocated, reused = tree.node_freelists()['amara.tree.element']
+    assert free >= 101
+    doc = tree.parse(DOC)
+    stats = tree.node_freelists()
+    #The second parse is built from the nodes the first one released
+    assert stats['amara.tree.element'] == (free - 101, allocated, reused + 101)
+    assert stats['amara.tree.text'][2] >= 100
+
+def test_shared_names():
+    DOC = '<x:a xmlns:x="urn:x" b="1"><c x:d="2"/></x:a>'
+    first, second = tree.parse(DOC).xml_first_child, tree.parse(DOC).xml_first_child
+    #Names are the same objects in every parsed document
+    assert first.xml_local is second.xml_local
+    assert first.xml_qname is second.xml_qname
+    assert first.xml_namespace is second.xml_namespace
+    assert first.xml_first_child.xml_local is second.xml_first_child.xml_local
+    attrs = list(first.xml_first_child.xml_attributes.nodes()) + list(second.xml_first_child.xml_attributes.nodes())
+    assert attrs[0].xml_local is attrs[1].xml_local
+    assert attrs[0].xml_qname == u'x:d'
+    assert first.xml_select(u'c/@*[local-name()="d"]')[0].xml_value == u'2'
+
+def test_readonly_parse():
+    DOC = '<x:a xmlns:x="urn:x" xmlns="urn:y" b="1"><c x:d="2">t&amp;<![CDATA[u]]></c><!--e--><?f g?><c/></x:a>'
+    doc, frozen = tree.parse(DOC), tree.parse(DOC, readonly=True)
+    assert isinstance(frozen, tree.frozen_node)
+    assert frozen.xml_type == tree.entity.xml_type
+    top = frozen.xml_first_child
+    assert top.xml_name == (u'urn:x', u'a')
+    assert top.xml_attributes == {(None, u'b'): u'1'}
+    assert top.xml_namespaces == dict(doc.xml_first_child.xml_namespaces.iteritems())
+    #Adjacent text is a single node; nodes are equal (not identical) per visit
+    assert top.xml_first_child.xml_first_child.xml_value == u't&u'
+    assert top.xml_first_child.xml_parent == top
+    assert [ n.xml_type for n in top ] == [ n.xml_type for n in doc.xml_first_child ]
+    for expr in (u'//*', u'//@*', u'//node()', u'//y:c[2]/preceding::node()', u'string(/)', u'count(//y:c)', u'name(//@*[2])'):
+        expected = doc.xml_select(expr, {u'y': u'urn:y'})
+        result = frozen.xml_select(expr, {u'y': u'urn:y'})
+        if isinstance(expected, list):
+            assert [ (n.xml_type, getattr(n, 'xml_name', None)) for n in result ] == [ (n.xml_type, getattr(n, 'xml_name', None)) for n in expected ]
+        else:
+            assert result == expected
+    assert frozen.xml_encode() == doc.xml_encode()
+    assert top.xml_encode(indent=True) == doc.xml_first_child.xml_encode(indent=True)
+    #Namespace undeclarations are written; an ID finds its element
+    DOC = '<!DOCTYPE a [<!ATTLIST c id ID #IMPLIED>]><a xmlns="urn:y"><c xmlns="" id="i"/></a>'
+    frozen = tree.parse(DOC, readonly=True)
+    assert frozen.xml_encode() == tree.parse(DOC).xml_encode()
+    assert frozen.xml_lookup(u'i').xml_name == (None, u'c')
+    #lang() finds xml:lang on the element or its ancestors
+    DOC = '<a xml:lang="en-US"><b/><c xml:lang="fr"><d/></c></a>'
+    doc, frozen = tree.parse(DOC), tree.parse(DOC, readonly=True)
+    for expr in (u'count(//*[lang("en")])', u'count(//*[lang("fr")])', u'count(//*[lang("en-us")])', u'count(//*[lang("de")])'):
+        assert frozen.xml_select(expr) == doc.xml_select(expr), expr
+    assert frozen.xml_select(u'count(//*[lang("en")])') == 2
+
+def test_snapshot():
+    DOC = '<!DOCTYPE a [<!ATTLIST b id ID #IMPLIED>]><a xmlns:x="urn:x" x:y="1">t<b id="i">u</b><!--c--><?d e?></a>'
+    fd, path = tempfile.mkstemp()
+    os.close(fd)
+    try:
+        for readonly in (False, True):
+            doc = tree.parse(DOC, 'urn:doc', readonly=readonly)
+            doc.xml_dump(path)
+            for target in (False, True):
+                loaded = tree.load(path, readonly=target)
+                assert isinstance(loaded, (tree.entity, tree.frozen_node)[target])
+                assert loaded.xml_encode() == tree.parse(DOC, readonly=target).xml_encode()
+                assert loaded.xml_base == u'urn:doc'
+                assert loaded.xml_lookup(u'i').xml_first_child.xml_value == u'u'
+        #A damaged snapshot is rejected
+        data = open(path, 'rb').read()
+        try:
+            tree.load(data[:-10])
+        except ValueError:
+            pass
+        else:
+            raise AssertionError("truncated snapshot loaded")
+    finally:
+        os.remove(path)
+
+def test_parser():
+    import amara
+    p = tree.parser()
+    for i in range(3):
+        doc = p.parse('<a x="%i"><b xml:lang="en">t</b></a>' % i)
+        assert doc.xml_first_child.xml_attributes[None, u'x'] == unicode(i)
+        #A failed parse leaves nothing behind for the next one
+        try:
+            p.parse('<a xml:space="preserve"><b>t</a>')
+        except amara.ReaderError:
+            pass
+        else:
+            raise AssertionError("malformed document parsed")
+    assert doc.xml_encode() == tree.parse('<a x="2"><b xml:lang="en">t</b></a>').xml_encode()
+    class myentity(tree.entity):
+        xml_element_factory = type('myelement', (tree.element,), {})
+    p = tree.parser(entity_factory=myentity)
+    for i in range(2):
+        doc = p.parse('<a/>')
+        assert isinstance(doc, myentity)
+        assert isinstance(doc.xml_first_child, myentity.xml_element_factory)
+
+def test_incremental_parser():
+    import amara
+    DOC = '<a xmlns="urn:x"><b x="1">t&amp;u</b><!--c--><?d e?></a>'
+    p = tree.incremental_parser('urn:doc')
+    for size in (1, 5, len(DOC)):
+        for i in range(0, len(DOC), size):
+            p.feed(DOC[i:i+size])
+        doc = p.close()
+        assert doc.xml_encode() == tree.parse(DOC).xml_encode()
+        assert doc.xml_base == u'urn:doc'
+    #Feeding after a whole-document parse copies the parts as before
+    p.parse(DOC)
+    for i in range(0, len(DOC), 5):
+        p.feed(DOC[i:i+5])
+    assert p.close().xml_encode() == tree.parse(DOC).xml_encode()
+    #After an error, feeding starts a new document
+    try:
+        p.feed('<a><b></a>')
+    except amara.ReaderError:
+        pass
+    else:
+        raise AssertionError("malformed document parsed")
+    p.feed('<a/>')
+    try:
+        p.parse('<a/>')
+    except RuntimeError:
+        pass
+    else:
+        raise AssertionError("parsed while feeding")
+    assert p.close().xml_first_child.xml_local == u'a'
+    p.feed('<a>')
+    try:
+        p.close()
+    except amara.ReaderError:
+        pass
+    else:
+        raise AssertionError("incomplete document parsed")
+
+def test_sendtree():
+    DOC = '<a><b>1</b><c><b>2<b>3</b></b></c></a>'
+    def collect(results):
+        while True:
+            node = (yield)
+            results.append(node.xml_encode())
+    for prune in (False, True):
+        results = []
+        target = collect(results)
+        target.next()
+        doc = tree.sendtree(DOC, u'b', target, prune=prune)
+        assert results == ['<b>1</b>', '<b>3</b>', '<b>2<b>3</b></b>']
+        assert bool(doc.xml_children) != prune
+
 if __name__ == '__main__':
     raise SystemExit("use nosetests")
 
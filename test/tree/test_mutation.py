@@ -84,6 +84,98 @@ def test_delns1():
     treecompare.check_xml(doc2.xml_encode(), XMLDECL+EXPECTED)
     return
 
+def test_document_order():
+    doc = parse('<a x="1"><b y="2"/><c/></a>')
+    a = doc.xml_first_child
+    b, c = a.xml_children
+    x = a.xml_attributes.getnode(None, u'x')
+    y = b.xml_attributes.getnode(None, u'y')
+    assert doc < a < x < b < y < c
+    assert sorted([c, y, a, b, x, doc]) == [doc, a, x, b, y, c]
+    #Document order must follow mutations
+    a.xml_remove(c)
+    a.xml_insert(0, c)
+    assert a < c < b < y
+    assert sorted([b, c, y]) == [c, b, y]
+    #Nodes detached from or moved to another document are ordered by document
+    other = parse('<d/>')
+    d = other.xml_first_child
+    d.xml_append(b)
+    assert (b < c) == (y < x) == (other < doc)
+    assert a < x < c and d < b < y
+    a.xml_remove(c)
+    assert c.xml_parent is None and c != a
+    #Keys that were just compared are not trusted after a move
+    doc = parse('<a><b/><c><d/></c></a>')
+    b, c = doc.xml_first_child.xml_children
+    d = c.xml_first_child
+    assert b < c < d
+    c.xml_insert(0, b)
+    assert c < b < d and sorted([d, b, c]) == [c, b, d]
+    #The keys are numbered without recursion
+    deep = parse('<e>' * 10000 + '</e>' * 10000)
+    deep.xml_first_child.xml_append(tree.element(None, u'f'))
+    assert deep.xml_first_child.xml_first_child < deep.xml_first_child.xml_children[-1]
+    return
+
+def test_lookup_mutation():
+    doc = parse('<!DOCTYPE a [<!ATTLIST b id ID #IMPLIED>]>'
+                '<a><b id="x"/><b id="y"/></a>')
+    a = doc.xml_first_child
+    b1, b2 = a.xml_children
+    assert doc.xml_lookup(u'x') is b1
+    assert doc.xml_lookup(u'y') is b2
+    #The ID index must follow mutations
+    a.xml_remove(b1)
+    assert doc.xml_lookup(u'x') is None
+    b2.xml_attributes.getnode(None, u'id').xml_value = u'z'
+    assert doc.xml_lookup(u'y') is None
+    assert doc.xml_lookup(u'z') is b2
+    a.xml_append(b1)
+    assert doc.xml_lookup(u'x') is b1
+    return
+
+def test_children_view():
+    doc = parse('<a><b/><c/><d/></a>')
+    a = doc.xml_first_child
+    b, c, d = children = a.xml_children
+    assert len(children) == 3 and children[-1] is d
+    assert children[1:] == (c, d) and children == (b, c, d)
+    assert c in children and children.index(c) == 1
+    #The view is live until the children are modified
+    e = a.xml_append(tree.element(None, u'e'))
+    assert children == (b, c, d)
+    assert a.xml_children == (b, c, d, e)
+    #Removing while iterating sees the children as they were
+    removed = []
+    for child in a.xml_children:
+        removed.append(a.xml_remove(child))
+    assert removed == [b, c, d, e]
+    assert len(a.xml_children) == 0
+    return
+
+def test_children_view_as_tuple():
+    import copy, pickle
+    doc = parse('<a><b/><c/></a>')
+    a = doc.xml_first_child
+    b, c = children = a.xml_children
+    #Concatenates and repeats like a tuple, on either side
+    assert children + (doc,) == (b, c, doc)
+    assert (doc,) + children == (doc, b, c)
+    assert children + children == (b, c, b, c)
+    assert children * 2 == 2 * children == (b, c, b, c)
+    assert isinstance((doc,) + children, tuple)
+    assert isinstance(children * 2, tuple)
+    #Copies are plain tuples
+    assert copy.copy(children) == (b, c)
+    assert type(copy.copy(children)) is tuple
+    assert type(pickle.loads(pickle.dumps(children))) is tuple
+    assert len(copy.deepcopy(children)) == 2
+    #The view itself is not a tuple subclass
+    assert isinstance(tuple(children), tuple)
+    assert not isinstance(children, tuple)
+    return
+
 
 if __name__ == '__main__':
     raise SystemExit("use nosetests")
@@ -67,6 +67,32 @@ class test_namespaces(unittest.TestCase):
         self.assertEqual(doc.xml_first_child.xml_attributes[XML_NAMESPACE, u'xml:base'], u'urn:bogus')
         return
 
+    def test_inscope_namespaces(self):
+        '''In-scope namespaces follow namespace mutations'''
+        doc = amara.parse(TEST1)
+        top = doc.xml_first_child
+        monty = top.xml_first_child
+        namespaces = monty.xml_namespaces
+        self.assertEqual(namespaces.copy(), {u'xml': XML_NAMESPACE, u'a': NS_A, u'b': NS_B})
+        #Every namespace node belongs to the element it is in scope for
+        for ns in namespaces.nodes():
+            self.assertTrue(ns.xml_parent is monty)
+        for ns in top.xml_namespaces.nodes():
+            self.assertTrue(ns.xml_parent is top)
+        #Binding a prefix declares it on the element itself
+        namespaces[u'a'] = u'urn:bogus:c'
+        self.assertEqual(namespaces[u'a'], u'urn:bogus:c')
+        self.assertEqual(top.xml_namespaces[u'a'], NS_A)
+        top.xml_namespaces[u'b'] = u'urn:bogus:d'
+        self.assertEqual(monty.xml_namespaces[u'b'], u'urn:bogus:d')
+        self.assertTrue('xmlns:b="urn:bogus:d"' in monty.xml_encode())
+        #Moving an element changes its namespaces
+        other = amara.parse('<x xmlns:b="urn:bogus:e"/>').xml_first_child
+        other.xml_append(top.xml_remove(monty))
+        self.assertEqual(monty.xml_namespaces.copy(), {u'xml': XML_NAMESPACE, u'a': u'urn:bogus:c', u'b': u'urn:bogus:e'})
+        self.assertTrue('xmlns:b="urn:bogus:e"' in monty.xml_encode())
+        return
+
 
 if __name__ == '__main__':
     raise SystemExit("use nosetests")
@@ -41,6 +41,59 @@ def test_simple_atom_entry():
     #Make sure we can parse the result
     doc2 = bindery.parse(out)
 
+def test_unencodable_charrefs():
+    '''Characters the output encoding lacks become character references'''
+    doc = tree.parse('<a b="\xc3\xa9\xe2\x82\xac">x&lt;\xc3\xa9\xe2\x82\xac\xf0\x90\x80\x80y</a>')
+    EXPECTED = {
+        'us-ascii': '<a b="&#233;&#8364;">x&lt;&#233;&#8364;&#65536;y</a>',
+        'iso-8859-1': '<a b="\xe9&#8364;">x&lt;\xe9&#8364;&#65536;y</a>',
+        'windows-1252': '<a b="\xe9\x80">x&lt;\xe9\x80&#65536;y</a>',
+        }
+    for encoding, expected in EXPECTED.items():
+        expected = ('<?xml version="1.0" encoding="%s"?>\n' % encoding
+                    + expected)
+        out = doc.xml_encode(encoding=encoding)
+        assert out == expected, (encoding, out)
+
+def test_buffered_stream():
+    '''Small writes are held until the buffer fills or is flushed'''
+    import StringIO
+    from amara.writers._xmlstream import xmlstream
+    s = StringIO.StringIO()
+    xs = xmlstream(s, 'utf-8', buffer_size=6)
+    xs.write_ascii('<a>')
+    xs.write_encode(u'b')
+    assert s.getvalue() == ''
+    xs.write_ascii('</a>')
+    assert s.getvalue() == '<a>b'
+    xs.flush()
+    assert s.getvalue() == '<a>b</a>'
+    xs.write_ascii('<c>long enough to bypass</c>')
+    assert s.getvalue() == '<a>b</a><c>long enough to bypass</c>'
+    #Output of xml_write() to such streams must be complete
+    doc = tree.parse('<a><b/>text</a>')
+    s = StringIO.StringIO()
+    doc.xml_write(stream=s)
+    assert s.getvalue() == doc.xml_encode()
+
+NATIVE_DOC = '''<?pi data?><a xmlns="urn:a" xmlns:p="urn:p" x='say "hi"' y="&lt;&amp;&#9;&#10;"><p:b p:z="1"><c xmlns="">t&gt;\xc3\xa9</c></p:b><!--c--><d>mixed<e/></d></a>'''
+
+def test_native_printer():
+    '''The native tree printer matches the printers driven by a _Visitor'''
+    from amara.writers import lookup, node as nodewriter
+    doc = tree.parse(NATIVE_DOC)
+    doc.xml_system_id = u'a.dtd'
+    doc.xml_select(u'//*')[3].xml_append(tree.element(u'urn:q', u'q:f'))
+    for node in [doc] + list(doc.xml_select(u'//node()')):
+        for writer in ('xml', 'xml-indent', 'xml-canonical'):
+            s = cStringIO.StringIO()
+            printer = lookup(writer)(s, 'UTF-8')
+            nodewriter._Visitor(printer).visit(node)
+            printer.flush()
+            expected = s.getvalue()
+            out = node.xml_encode(writer)
+            assert out == expected, (node, writer, out, expected)
+
 
 #from Ft.Xml import EMPTY_NAMESPACE
 
@@ -82,5 +82,41 @@ class Test_parse_functions_2(unittest.TestCase):
         self.assertEqual(doc.xml_children[0].xml_namespace, None)
         self.assertEqual(doc.xml_children[0].xml_prefix, None,)
 
+def test_parse_threads():
+    #Documents are tokenized without the GIL and the events replayed
+    import threading
+    doc = '<a>' + '<b c="1">t</b>' * 20000 + '<c>' + 'y' * 200000 + '</c></a>'
+    results = []
+    def run():
+        results.append(len(parse(doc).xml_first_child.xml_children))
+    threads = [ threading.Thread(target=run) for i in range(3) ]
+    for t in threads: t.start()
+    for t in threads: t.join()
+    assert results == [20001] * 3, results
+    try:
+        parse('<a>' + 'y' * 200000 + '\n<b></a>')
+    except ReaderError, e:
+        assert (e.lineNumber, e.columnNumber) == (2, 5), str(e)
+    else:
+        raise AssertionError("ReaderError not raised")
+
+def test_sax_handler_error():
+    #A handler raising while a large text node is still being tokenized
+    from amara import sax
+    from amara.lib import inputsource
+    class handler(object):
+        def startElementNS(self, name, qname, attribs):
+            if name[1] == 'c': raise ValueError(name[1])
+        def characters(self, data):
+            pass
+    parser = sax.create_parser()
+    parser.setContentHandler(handler())
+    try:
+        parser.parse(inputsource('<a><c>' + 'y' * 200000 + '</c></a>'))
+    except ValueError:
+        pass
+    else:
+        raise AssertionError("ValueError not raised")
+
 if __name__ == '__main__':
     raise SystemExit("use nosetests")
@@ -128,6 +128,9 @@ def test_inequality_expr():
         ((string_literal('egg2'), nodeset_literal([EGG1])), datatypes.TRUE),
         # Yeah, non-intuitive, but datatypes.TRUE acc to XPath spec 3.4
         ((string_literal('egg1'), nodeset_literal([EGG1, EGG2])), datatypes.TRUE),
+        ((nodeset_literal([EGG1, EGG2]), nodeset_literal([EGG1])), datatypes.TRUE),
+        ((nodeset_literal([EGG1]), nodeset_literal([EGG1, EGG2])), datatypes.TRUE),
+        ((nodeset_literal([EGG1]), nodeset_literal([EGG2])), datatypes.TRUE),
         ):
         node = equality_expr(left, '!=', right)
         result = node.evaluate_as_boolean(default_context)
@@ -217,6 +220,12 @@ def test_relational_expr():
         ((nodeset_literal([NUM4]), '<=', nodeset_literal([NUM2])), datatypes.FALSE),
         ((nodeset_literal([NUM4]), '>',  nodeset_literal([NUM2])), datatypes.TRUE),
         ((nodeset_literal([NUM4]), '>=', nodeset_literal([NUM2])), datatypes.TRUE),
+        ((nodeset_literal([NUM0, NUM4]), '<',  nodeset_literal([NUM2])), datatypes.TRUE),
+        ((nodeset_literal([NUM0, NUM4]), '>',  nodeset_literal([NUM2])), datatypes.TRUE),
+        ((nodeset_literal([NUM4]), '<',  nodeset_literal([NUM0, NUM2])), datatypes.FALSE),
+        ((nodeset_literal([NUM0]), '>',  nodeset_literal([NUM2, NUM4])), datatypes.FALSE),
+        ((nodeset_literal([NUM2, EGG1]), '>=', nodeset_literal([NUM2])), datatypes.TRUE),
+        ((nodeset_literal([EGG1]), '<=', nodeset_literal([EGG1])), datatypes.FALSE),
         ):
         
         node = relational_expr(left, op, right)
@@ -0,0 +1,76 @@
+from amara import tree
+from amara.xpath import context
+from amara.xpath.cache import expression_cache
+
+DOC = tree.parse('<a xmlns:x="urn:x" xmlns:y="urn:y"><x:b/><y:b/></a>')
+
+def test_hits_and_misses():
+    cache = expression_cache()
+    ctx = context(DOC, namespaces={u'p': u'urn:x'})
+    first = cache.get(u'//p:b', ctx)
+    assert cache.get(u'//p:b', ctx) is first
+    assert (cache.hits, cache.misses) == (1, 1)
+    cache.clear()
+    assert (cache.hits, cache.misses, len(cache)) == (0, 0, 0)
+    return
+
+def test_namespace_bindings():
+    cache = expression_cache()
+    ctx_x = context(DOC, namespaces={u'p': u'urn:x', u'q': u'urn:q'})
+    ctx_y = context(DOC, namespaces={u'p': u'urn:y'})
+    expr_x = cache.get(u'//p:b', ctx_x)
+    expr_y = cache.get(u'//p:b', ctx_y)
+    assert expr_x is not expr_y
+    result = expr_x.evaluate(ctx_x)
+    assert [ n.xml_namespace for n in result ] == [u'urn:x']
+    result = expr_y.evaluate(ctx_y)
+    assert [ n.xml_namespace for n in result ] == [u'urn:y']
+    #Unrelated bindings do not affect the key
+    ctx_x2 = context(DOC, namespaces={u'p': u'urn:x'})
+    assert cache.get(u'//p:b', ctx_x2) is expr_x
+    return
+
+def test_eviction():
+    cache = expression_cache(maxsize=2)
+    ctx = context(DOC)
+    one = cache.get(u'1', ctx)
+    cache.get(u'2', ctx)
+    cache.get(u'1', ctx)
+    cache.get(u'3', ctx)
+    assert len(cache) == 2
+    assert cache.get(u'1', ctx) is one
+    assert cache.misses == 3
+    return
+
+def test_select():
+    a = DOC.xml_first_child
+    assert len(a.xml_select(u'x:b')) == 1
+    assert len(a.xml_select(u'x:b', {u'x': u'urn:y'})) == 1
+    assert a.xml_select(u'x:b', {u'x': u'urn:y'})[0].xml_namespace == u'urn:y'
+    return
+
+def test_threads():
+    import threading
+    #Each evaluation of the one cached expression keeps its own state
+    SOURCE = '<r>' + ''.join([ '<x n="%i"><y/><y/></x>' % i for i in range(50) ]) + '</r>'
+    EXPR = u'//x[string-length(@n) > 0]/y'
+    results, errors = [], []
+    def select():
+        doc = tree.parse(SOURCE)
+        try:
+            for i in range(200):
+                results.append(len(doc.xml_select(EXPR)))
+        except Exception, e:
+            errors.append(e)
+    threads = [ threading.Thread(target=select) for i in range(4) ]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert not errors, errors
+    assert results == [100] * 800, set(results)
+    return
+
+
+if __name__ == '__main__':
+    raise SystemExit("use nosetests")
@@ -70,5 +70,73 @@ def test_abbreviated_relative_location_path():
     expected = datatypes.nodeset(GCHILDREN1 + GCHILDREN2 + LCHILDREN)
     assert result == expected, (result, expected)
 
+def test_walked_steps():
+    # steps on the child, descendant and attribute axes that test only the
+    # node type or name, with at most a constant position, are walked by
+    # the step iterator itself
+    src = """<r xmlns:x="urn:x" a="1" x:a="2"><a b="3">t1<a/><x:a/><!--c--></a>\
+<?p d?><b><a><x:b a="4"/></a></b>t2<a x:b="5"/></r>"""
+    prefixes = {u'x': u'urn:x'}
+    for expr, expected in (
+        (u'a', [u'a', u'a']),
+        (u'*', [u'a', u'b', u'a']),
+        (u'x:*', []),
+        (u'node()', [u'a', u'p', u'b', u't2', u'a']),
+        (u'text()', [u't2']),
+        (u'processing-instruction()', [u'p']),
+        (u'descendant::a', [u'a', u'a', u'a', u'a']),
+        (u'descendant::x:*', [u'x:a', u'x:b']),
+        (u'descendant::text()', [u't1', u't2']),
+        (u'descendant::comment()', [u'c']),
+        (u'descendant::a[2]', [u'a']),
+        (u'descendant::*[4]', [u'b']),
+        (u'descendant::a[9]', []),
+        (u'a[2]', [u'a']),
+        (u'*/a[1]', [u'a', u'a']),
+        (u'@*', [u'a', u'x:a']),
+        (u'@a', [u'a']),
+        (u'@x:a', [u'x:a']),
+        (u'@node()', [u'a', u'x:a']),
+        (u'@*[2]', [u'x:a']),
+        (u'//@a', [u'a', u'a']),
+        (u'//@x:*', [u'x:a', u'x:b']),
+        (u'//x:b/@a', [u'a']),
+        ):
+        for readonly in (False, True):
+            doc = tree.parse(src, readonly=readonly)
+            result = doc.xml_first_child.xml_select(expr, prefixes=prefixes)
+            names = []
+            for node in result:
+                if isinstance(node, (tree.element, tree.attribute)) or \
+                        getattr(node, 'xml_type', None) in ('element', 'attribute'):
+                    names.append(node.xml_qname)
+                elif hasattr(node, 'xml_target'):
+                    names.append(node.xml_target)
+                else:
+                    names.append(node.xml_value)
+            assert names == expected, (expr, readonly, names, expected)
+
+def test_descendant_name_index():
+    # repeated searches for descendants by name use an index of the
+    # document, which has to follow changes to the tree
+    doc = tree.parse('<r>%s</r>' % ('<a><b/><c><b/></c></a>' * 50))
+    root = doc.xml_first_child
+    first, last = root.xml_children[0], root.xml_children[-1]
+    def check(count):
+        for i in range(2):
+            assert len(doc.xml_select(u'//b')) == count
+            assert len(root.xml_select(u'descendant::b')) == count
+            assert len(first.xml_select(u'descendant::b')) == 2
+            assert len(root.xml_select(u'descendant::b[3]')) == 1
+    check(100)
+    last.xml_append(tree.element(None, u'b'))
+    check(101)
+    last.xml_first_child.xml_local = u'x'
+    check(100)
+    root.xml_remove(last)
+    check(98)
+    root.xml_insert(0, tree.element(None, u'b'))
+    assert root.xml_select(u'descendant::b[1]')[0] is root.xml_first_child
+
 if __name__ == '__main__':
     raise SystemExit('Use nosetests')
@@ -0,0 +1,106 @@
+from cStringIO import StringIO
+
+from amara import tree
+from amara.xpath import context, datatypes, parser
+from amara.xpath.functions import string_function
+from amara.xpath.optimizer import optimize, explain, hoisted_expr
+
+DOC = tree.parse('<r v="2"><a x="1"><b>1</b><b>2</b></a><a x="2"><c/></a>'
+                 '<a x="3"><b>3</b><a x="2"><b>4</b></a></a></r>')
+VARIABLES = {(None, u'n'): datatypes.number(1), (None, u'p'): u'2'}
+
+def evaluate(expr, optimized=True):
+    parsed = parser.parse(expr)
+    if optimized:
+        parsed = optimize(parsed)
+    result = parsed.evaluate(context(DOC, variables=VARIABLES))
+    if isinstance(result, datatypes.nodeset):
+        result = [ node.xml_select(u'string(@x)') or
+                   node.xml_select(u'string(.)') for node in result ]
+    return result
+
+def test_same_results():
+    for expr in (u'//a[@x = concat("", $p)]',
+                 u'//a[@x = $n + 1]/b',
+                 u'//a[position() = $n + 1]',
+                 u'//a[1 + 1]',
+                 u'//a[@x = /r/@v]',
+                 u'//a//b',
+                 u'//a//b[2]',
+                 u'//a//b[. > 1]',
+                 u'//a[count(b) > 0]',
+                 u'//a[count(b) = 0]',
+                 u'/r/a//b',
+                 u'(//a | //b)',
+                 u'string(//a//b)',
+                 u'count(//b) != 0',
+                 u'1 <= count(//zz)',
+                 u'concat("x", substring("abc", 2))',
+                 # positions that fold to no node
+                 u'//a[-1]',
+                 u'//a[3 - 3]',
+                 u'//a[1 div 2]',
+                 u'//a[position() = 1 - 1]',
+                 u'//a[1 - 1 = position()]',
+                 ):
+        expected = evaluate(expr, optimized=False)
+        result = evaluate(expr)
+        assert result == expected, (expr, result, expected)
+    return
+
+def test_folding():
+    for expr, expected in ((u'1 + 2 * 3', u'7'),
+                           (u'concat("a", "b")', u'"ab"'),
+                           (u'2 > 1', u'true()'),
+                           (u'false() and $n', u'false()'),
+                           (u'true() and $n', u'boolean($n)'),
+                           (u'a[1 + 1]', u'child::a[2]'),
+                           (u'true() or $undefined', u'true()'),
+                           ):
+        result = unicode(optimize(parser.parse(expr)))
+        assert result == expected, (expr, result, expected)
+    # string() is the string-value of the context node
+    assert isinstance(optimize(parser.parse(u'string()')), string_function)
+    return
+
+def test_rewrites():
+    for expr, expected in (
+        (u'//a[@x]', u'/descendant::a[attribute::x]'),
+        (u'$v//a[@x]', u'$v/descendant::a[attribute::x]'),
+        (u'descendant-or-self::node()/child::a', u'descendant::a'),
+        # positional predicates need the child axis
+        (u'//a[1]', u'//child::a[1]'),
+        (u'//a[position() > 1]', u'//child::a[position() > 1]'),
+        (u'count(a) > 0', u'boolean(child::a)'),
+        (u'0 = count(a)', u'not(child::a)'),
+        (u'count(a) > 1', u'count(child::a) > 1'),
+        ):
+        result = unicode(optimize(parser.parse(expr)))
+        assert result == expected, (expr, result, expected)
+    return
+
+def test_hoisting():
+    expr = optimize(parser.parse(u'//a[@x = concat($p, "")][b = /r/@v]'))
+    first, second = expr._steps[0].predicates
+    assert isinstance(first._expr._right, hoisted_expr)
+    assert isinstance(second._expr._right, hoisted_expr)
+    assert second._expr._right._rooted
+    # relative paths and the context position are not hoisted
+    expr = optimize(parser.parse(u'//a[@x = string(b)][position() = $n]'))
+    first, second = expr._steps[-1].predicates
+    assert not isinstance(first._expr._right, hoisted_expr)
+    assert first._expr._right._args[0] is not None
+    assert not second._hoisted
+    return
+
+def test_explain():
+    stream = StringIO()
+    explain(u'/r/a[@x = /r/@v]//b', stream=stream)
+    lines = stream.getvalue().splitlines()
+    assert lines[0].startswith('absolute_location_path:'), lines
+    assert lines[0].endswith('[in document order]'), lines
+    assert 'walked in C' in lines[1], lines
+    assert [ line for line in lines
+             if line.strip().startswith('hoisted_expr') ], lines
+    assert lines[-1].strip() == 'step: descendant::b  [walked in C]', lines
+    return
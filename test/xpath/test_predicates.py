@@ -31,6 +31,47 @@ def test_simple_attr_update3():
     assert len(ns) == 1, (len(ns), 1)
     return
 
+LAST = """<r><a><b>1</b><b>2</b><b>3</b></a><a><b>4</b><c><b>5</b></c></a></r>"""
+
+def test_last():
+    import amara
+    doc = amara.parse(LAST)
+    for expr, expected in (
+        (u'/r/a/b[last()]', [u'3', u'4']),
+        (u'/r/a/b[position() = last()]', [u'3', u'4']),
+        (u'/r/a/b[last() = position()]', [u'3', u'4']),
+        (u'/r/a/b[last() - 1]', [u'2']),
+        (u'/r/a/b[position() < last()]', [u'1', u'2']),
+        (u'/r/a/b[last() > 1]', [u'1', u'2', u'3']),
+        (u'/r/a[last()]/b', [u'4']),
+        (u'//b[last()]', [u'3', u'4', u'5']),
+        (u'(//b)[last()]', [u'5']),
+        (u'/r/descendant::b[last()]', [u'5']),
+        (u'/r/a/descendant::node()[last()]', [u'3', u'5']),
+        (u'/r/a/b[count(../b[last()]) = 1][last()]', [u'3', u'4']),
+        ):
+        result = [node.xml_select(u'string(.)') for node in doc.xml_select(expr)]
+        assert result == expected, (expr, result, expected)
+    return
+
+def test_nodeset_conversions():
+    import amara
+    doc = amara.parse(LAST)
+    for expr, expected in (
+        (u'count(//b)', 5),
+        (u'count(/r/a/b)', 4),
+        (u'count(//x)', 0),
+        (u'count(//a | //b)', 7),
+        # not yielded in document order, but converted as the first node
+        (u'string(//a//b)', u'1'),
+        (u'string(/r/a[2]/descendant-or-self::*/b)', u'4'),
+        (u'number(/r/a[2]/descendant-or-self::*/b)', 4),
+        (u'string(//x)', u''),
+        ):
+        result = doc.xml_select(expr)
+        assert result == expected, (expr, result, expected)
+    return
+
 #XXX The rest are in old unittest style.  Probably best to add new test cases above in nose test style
 
 from test_expressions import (
@@ -0,0 +1,40 @@
+from amara import tree, bindery
+from amara.xpath.util import simple_evaluate
+
+DOC = """<a xmlns="urn:d" xmlns:x="urn:x"><x:b id="1">t<c xmlns:x="urn:y"><x:d/></c></x:b><?pi?></a>"""
+
+EXPRESSIONS = [u'x:*', u'.//x:*', u'count(//node())', u'name(..)',
+               u'string(.)', '@id', u'namespace::*', u'/*/x:b/c/x:d']
+
+def _compare(doc):
+    nodes = [doc] + list(doc.xml_select(u'//node()|//@*'))
+    for node in nodes:
+        for expr in EXPRESSIONS:
+            for prefixes in (None, {u'x': u'urn:y'}):
+                expected = simple_evaluate(expr, node, prefixes)
+                result = node.xml_select(expr, prefixes)
+                if isinstance(expected, list):
+                    expected, result = list(expected), list(result)
+                assert result == expected, (node, expr, prefixes)
+    return
+
+#xml_select() must agree with the generic Python implementation
+def test_select_tree():
+    _compare(tree.parse(DOC))
+    return
+
+def test_select_bindery():
+    _compare(bindery.parse(DOC))
+    return
+
+def test_reentrant_select():
+    doc = tree.parse(DOC)
+    a = doc.xml_first_child
+    for node in a.xml_select(u'*'):
+        assert node.xml_select(u'..')[0] is a
+        assert [ n.xml_parent for n in node.xml_select(u'@id') ] == [node]
+    return
+
+
+if __name__ == '__main__':
+    raise SystemExit("use nosetests")